@@ -15,7 +15,6 @@ import random
 import struct
 import queue
 from enum import Enum
-from multiprocessing import Pool, cpu_count
 from typing import Union
 from pathlib import Path
 from platform import uname
@@ -24,11 +23,14 @@ import hardnested_utils
 
 import chameleon_com
 import chameleon_cmd
+import chameleon_crack
 from chameleon_utils import (
     ArgumentParserNoExit,
     ArgsParserError,
     UnexpectedResponseError,
     execute_tool,
+    ToolStream,
+    read_key_dic,
     tqdm_if_exists,
     print_key_table,
     default_cwd
@@ -54,6 +56,9 @@ from chameleon_enum import (
 from chameleon_enum import HIDFormat
 from crypto1 import Crypto1
 
+# The cracking cores run in process when the chameleon_crack library is built, else through the tools
+_crack_lib = chameleon_crack.load(default_cwd)
+
 # NXP IDs based on https://www.nxp.com/docs/en/application-note/AN10833.pdf
 type_id_SAK_dict = {
     0x00: "MIFARE Ultralight Classic/C/EV1/Nano | NTAG 2xx",
@@ -1362,58 +1367,80 @@ class HFMFNested(ReaderRequiredUnit):
             nt_uid_obj = self.cmd.mf1_static_nested_acquire(
                 block_known, type_known, key_known, block_target, type_target
             )
-            cmd_param = f"{nt_uid_obj['uid']} {int(type_target)}"
-            for nt_item in nt_uid_obj["nts"]:
-                cmd_param += f" {nt_item['nt']} {nt_item['nt_enc']}"
+            uid = nt_uid_obj["uid"]
+            nonces = [(nt_item["nt"], nt_item["nt_enc"]) for nt_item in nt_uid_obj["nts"]]
+            # the target key type for staticnested, the nt distance for nested
+            tool_arg = int(type_target)
             tool_name = "staticnested"
         else:
             dist_obj = self.cmd.mf1_detect_nt_dist(block_known, type_known, key_known)
             nt_obj = self.cmd.mf1_nested_acquire(
                 block_known, type_known, key_known, block_target, type_target
             )
-            # create cmd
-            cmd_param = f"{dist_obj['uid']} {dist_obj['dist']}"
-            for nt_item in nt_obj:
-                cmd_param += f" {nt_item['nt']} {nt_item['nt_enc']} {nt_item['par']}"
+            uid = dist_obj["uid"]
+            nonces = [(nt_item["nt"], nt_item["nt_enc"], nt_item["par"]) for nt_item in nt_obj]
+            tool_arg = dist_obj["dist"]
             tool_name = "nested"
+        # create cmd
+        cmd_param = f"{uid} {tool_arg}"
+        for nonce in nonces:
+            cmd_param += "".join(f" {value}" for value in nonce)
+
+        def show_elapsed(seconds):
+            print(f"   [ Time elapsed {seconds:#.1f}s ]\r", end="")
 
-        # Cross-platform compatibility
-        if sys.platform == "win32":
-            cmd_recover = f"{tool_name}.exe {cmd_param}"
+        if _crack_lib is not None:
+            print(f"   Recovering with {tool_name} in process")
+            try:
+                if tool_name == "staticnested":
+                    keys = _crack_lib.staticnested(uid, tool_arg, nonces, on_wait=show_elapsed)
+                else:
+                    keys = _crack_lib.nested(uid, tool_arg, nonces, on_wait=show_elapsed)
+            except chameleon_crack.CrackError:
+                # e.g. a static nt staticnested doesn't know, the tool exits non zero there
+                print()
+                return None
+            # clear \r
+            print()
+            key_list = [f"{key:012x}" for key in keys]
         else:
-            cmd_recover = f"./{tool_name} {cmd_param}"
+            # Cross-platform compatibility
+            if sys.platform == "win32":
+                cmd_recover = f"{tool_name}.exe {cmd_param}"
+            else:
+                cmd_recover = f"./{tool_name} {cmd_param}"
 
-        print(f"   Executing {cmd_recover}")
-        # start a decrypt process
-        process = self.sub_process(cmd_recover)
+            print(f"   Executing {cmd_recover}")
+            # start a decrypt process
+            process = self.sub_process(cmd_recover)
 
-        # wait end
-        while process.is_running():
-            msg = f"   [ Time elapsed {process.get_time_distance()/1000:#.1f}s ]\r"
-            print(msg, end="")
-            time.sleep(0.1)
-        # clear \r
-        print()
+            # wait end
+            while process.is_running():
+                show_elapsed(process.get_time_distance() / 1000)
+                time.sleep(0.1)
+            # clear \r
+            print()
 
-        if process.get_ret_code() == 0:
+            if process.get_ret_code() != 0:
+                # No keys recover, and no errors.
+                return None
             output_str = process.get_output_sync()
             key_list = []
             for line in output_str.split("\n"):
                 sea_obj = re.search(r"([a-fA-F0-9]{12})", line)
                 if sea_obj is not None:
                     key_list.append(sea_obj[1])
-            # Here you have to verify the password first, and then get the one that is successfully verified
-            # If there is no verified password, it means that the recovery failed, you can try again
-            print(f" - [{len(key_list)} candidate key(s) found ]")
-            for key in key_list:
-                key_bytes = bytearray.fromhex(key)
-                if self.cmd.mf1_auth_one_key_block(
-                    block_target, type_target, key_bytes
-                ):
-                    return key
-        else:
-            # No keys recover, and no errors.
-            return None
+
+        # Here you have to verify the password first, and then get the one that is successfully verified
+        # If there is no verified password, it means that the recovery failed, you can try again
+        print(f" - [{len(key_list)} candidate key(s) found ]")
+        for key in key_list:
+            key_bytes = bytearray.fromhex(key)
+            if self.cmd.mf1_auth_one_key_block(
+                block_target, type_target, key_bytes
+            ):
+                return key
+        return None
 
     def on_exec(self, args: argparse.Namespace):
         block_known = args.blk
@@ -1480,32 +1507,39 @@ class HFMFDarkside(ReaderRequiredUnit):
                 self.darkside_list.clear()
 
             self.darkside_list.append(darkside_obj)
-            recover_params = f"{darkside_obj['uid']}"
-            for darkside_item in self.darkside_list:
-                recover_params += f" {darkside_item['nt1']} {darkside_item['ks1']} {darkside_item['par']}"
-                recover_params += f" {darkside_item['nr']} {darkside_item['ar']}"
-            if sys.platform == "win32":
-                cmd_recover = f"darkside.exe {recover_params}"
-            else:
-                cmd_recover = f"./darkside {recover_params}"
-            # subprocess.run(cmd_recover, cwd=os.path.abspath("../bin/"), shell=True)
-            # print(f"   Executing {cmd_recover}")
-            # start a decrypt process
-            process = self.sub_process(cmd_recover)
-            # wait end
-            process.wait_process()
-            # get output
-            output_str = process.get_output_sync()
-            if "key not found" in output_str:
-                print(f" - No key found, retrying({retry_count})...")
-                retry_count += 1
-                continue  # retry
+            if _crack_lib is not None:
+                key_list = [
+                    f"{key:012x}"
+                    for key in _crack_lib.darkside(darkside_obj["uid"], [
+                        (item["nt1"], item["ks1"], item["par"], item["nr"], item["ar"])
+                        for item in self.darkside_list
+                    ])
+                ]
             else:
+                recover_params = f"{darkside_obj['uid']}"
+                for darkside_item in self.darkside_list:
+                    recover_params += f" {darkside_item['nt1']} {darkside_item['ks1']} {darkside_item['par']}"
+                    recover_params += f" {darkside_item['nr']} {darkside_item['ar']}"
+                if sys.platform == "win32":
+                    cmd_recover = f"darkside.exe {recover_params}"
+                else:
+                    cmd_recover = f"./darkside {recover_params}"
+                # start a decrypt process
+                process = self.sub_process(cmd_recover)
+                # wait end
+                process.wait_process()
+                # get output
+                output_str = process.get_output_sync()
                 key_list = []
                 for line in output_str.split("\n"):
                     sea_obj = re.search(r"([a-fA-F0-9]{12})", line)
                     if sea_obj is not None:
                         key_list.append(sea_obj[1])
+            if not key_list:
+                print(f" - No key found, retrying({retry_count})...")
+                retry_count += 1
+                continue  # retry
+            else:
                 # auth key
                 for key in key_list:
                     key_bytes = bytearray.fromhex(key)
@@ -1587,6 +1621,34 @@ class HFMFHardNested(ReaderRequiredUnit):
             metavar="<dec>",
             help="Maximum acquisition attempts if MSB sum is invalid (default: 3)",
         )
+        parser.add_argument(
+            "--cache-dir",
+            type=str,
+            metavar="<dir>",
+            help="Keep the expanded hardnested tables in <dir> (several hundred MB), later runs start faster",
+        )
+        parser.add_argument(
+            "--rebenchmark",
+            action="store_true",
+            help="Measure the brute force speed again instead of using the stored benchmark",
+        )
+        parser.add_argument(
+            "--stream",
+            action="store_true",
+            help="Run hardnested while acquiring and stop acquiring as soon as it has enough nonces",
+        )
+        parser.add_argument(
+            "--low-memory",
+            action="store_true",
+            help="Keep the hardnested tables compressed, for hosts with little memory (slower, no --cache-dir)",
+        )
+        parser.add_argument(
+            "--key-hint",
+            type=str,
+            metavar="<hint>",
+            help="Only search keys matching <hint>: hex digits, '?' for unknown ones, a shorter one is a prefix "
+            "(a0a1a2, ????????ff00), ',' between alternatives, @<file> for one per line",
+        )
         return parser
 
     def recover_key(
@@ -1600,6 +1662,11 @@ class HFMFHardNested(ReaderRequiredUnit):
         keep_nonce_file,
         max_runs,
         max_attempts,
+        cache_dir=None,
+        rebenchmark=False,
+        stream=False,
+        low_memory=False,
+        key_hint=None,
     ):
         """
         Recover a key using the HardNested attack via a nonce file, with dynamic MSB-based acquisition and restart on invalid sum.
@@ -1613,11 +1680,24 @@ class HFMFHardNested(ReaderRequiredUnit):
         :param keep_nonce_file: Boolean indicating whether to keep the nonce file.
         :param max_runs: Maximum number of acquisition runs per attempt.
         :param max_attempts: Maximum number of full acquisition attempts.
+        :param cache_dir: Directory of the hardnested tables cache, None for no cache.
+        :param rebenchmark: Boolean indicating whether to measure the brute force speed again.
+        :param stream: Boolean indicating whether to feed hardnested while acquiring, until it has enough nonces.
+        :param low_memory: Boolean indicating whether hardnested should keep its tables compressed.
+        :param key_hint: Known key digits or prefixes for hardnested --key-hint, None for none.
         :return: Recovered key as a hex string, or None if not found.
         """
         print(" - Starting HardNested attack...")
         nonces_buffer = bytearray()  # This will hold the final data for the file
         uid_bytes = b""  # To store UID from the successful attempt
+        tool_args = ["--cache", os.path.abspath(cache_dir)] if cache_dir else []
+        if rebenchmark:
+            tool_args.append("--rebenchmark")
+        if low_memory:
+            tool_args.append("--low-memory")
+        if key_hint:
+            tool_args += ["--key-hint", key_hint]
+        tool_stream = None  # hardnested reading the nonces of this attempt as they come in
 
         # --- Outer loop for acquisition attempts ---
         acquisition_success = False  # Flag to indicate if any attempt was successful
@@ -1706,6 +1786,9 @@ class HFMFHardNested(ReaderRequiredUnit):
                 struct.pack("!BB", block_target, type_target.value & 0x01)
             )
             print(f"   Nonce file header prepared: {nonces_buffer.hex().upper()}")
+            if stream:
+                tool_stream = ToolStream("hardnested", tool_args + ["-"], "Nonce acquisition complete")
+                tool_stream.write(bytes(nonces_buffer))
 
             # 2. Acquire nonces dynamically based on MSB criteria (Inner loop for runs)
             print(
@@ -1757,6 +1840,8 @@ class HFMFHardNested(ReaderRequiredUnit):
 
                     # Append successfully acquired nonces to the total buffer for this attempt
                     total_raw_nonces_bytes.extend(raw_nonces_bytes_this_run)
+                    if tool_stream is not None:
+                        tool_stream.write(raw_nonces_bytes_this_run)
 
                     # --- Process acquired nonces for MSB tracking ---
                     num_pairs_this_run = len(raw_nonces_bytes_this_run) // 9
@@ -1801,12 +1886,22 @@ class HFMFHardNested(ReaderRequiredUnit):
                         print()  # Print a newline after progress update
 
                     # --- Check termination condition ---
-                    if unique_msb_count == 256:
+                    if unique_msb_count == 256 and new_msbs_found_this_run > 0:
                         print()
                         print(
                             f"{color_string((CG, '   All 256 unique MSBs found.'))} Final parity sum: {msb_parity_sum}"
                         )
-                        if msb_parity_sum in hardnested_utils.hardnested_sums:
+                        if msb_parity_sum in hardnested_utils.hardnested_sums and tool_stream is not None:
+                            print(
+                                color_string(
+                                    (
+                                        CG,
+                                        f"   Parity sum {msb_parity_sum} is VALID. Acquiring until hardnested has enough nonces.",
+                                    )
+                                )
+                            )
+                            acquisition_success = True
+                        elif msb_parity_sum in hardnested_utils.hardnested_sums:
                             print(
                                 color_string(
                                     (
@@ -1831,6 +1926,18 @@ class HFMFHardNested(ReaderRequiredUnit):
                             acquisition_success = False
                             break  # Exit the inner run loop to restart the attempt
 
+                    if tool_stream is not None and tool_stream.stopped_reading():
+                        if tool_stream.complete:
+                            # it checked the first byte sum itself, possibly before all 256 MSBs were seen here
+                            print(color_string((CG, "   hardnested has enough nonces. Stopping acquisition runs.")))
+                            acquisition_goal_met = True
+                            acquisition_success = True
+                        else:
+                            print(color_string((CR, "   hardnested stopped before it had enough nonces.")))
+                            acquisition_goal_met = False
+                            acquisition_success = False
+                        break
+
                 except chameleon_com.CMDInvalidException:
                     print(
                         color_string(
@@ -1893,6 +2000,9 @@ class HFMFHardNested(ReaderRequiredUnit):
 
             # --- Post-Acquisition Summary for this attempt ---
             print(f"\n   Finished acquisition phase for attempt {attempt + 1}.")
+            if tool_stream is not None and not acquisition_success:
+                tool_stream.stop()
+                tool_stream = None
             if acquisition_success:
                 print(
                     color_string(
@@ -1993,6 +2103,8 @@ class HFMFHardNested(ReaderRequiredUnit):
                     )
                 )
             )
+            if tool_stream is not None:
+                tool_stream.stop()
             return None
 
         # 3. Save nonces to a temporary file
@@ -2004,39 +2116,67 @@ class HFMFHardNested(ReaderRequiredUnit):
             # --- Nonce File Handling ---
             delete_nonce_on_close = not keep_nonce_file
             # Use delete_on_close=False to manage deletion manually in finally block
-            temp_nonce_file = tempfile.NamedTemporaryFile(
-                suffix=".bin",
-                prefix="hardnested_nonces_",
-                delete=False,
-                mode="wb",
-                dir=".",
-            )
-            temp_nonce_file.write(
-                nonces_buffer
-            )  # Write the buffer from the successful attempt
-            temp_nonce_file.flush()
-            nonce_file_path = temp_nonce_file.name
-            temp_nonce_file.close()  # Close it so hardnested can access it
-            temp_nonce_file = None  # Clear variable after closing
-            print(
-                f"   Nonces saved to {'temporary ' if delete_nonce_on_close else ''}file: {os.path.abspath(nonce_file_path)}"
-            )
+            # A streaming hardnested or the library already has the nonces, the file is only kept for later
+            if (tool_stream is None and _crack_lib is None) or keep_nonce_file:
+                temp_nonce_file = tempfile.NamedTemporaryFile(
+                    suffix=".bin",
+                    prefix="hardnested_nonces_",
+                    delete=False,
+                    mode="wb",
+                    dir=".",
+                )
+                temp_nonce_file.write(
+                    nonces_buffer
+                )  # Write the buffer from the successful attempt
+                temp_nonce_file.flush()
+                nonce_file_path = temp_nonce_file.name
+                temp_nonce_file.close()  # Close it so hardnested can access it
+                temp_nonce_file = None  # Clear variable after closing
+                print(
+                    f"   Nonces saved to {'temporary ' if delete_nonce_on_close else ''}file: {os.path.abspath(nonce_file_path)}"
+                )
 
-            # 4. Prepare and run the external hardnested tool, redirecting output
-            print(
-                color_string(
-                    (CC, "--- Running Hardnested Tool (Output redirected) ---")
+            # 4. Run hardnested: in process when the chameleon_crack library is there,
+            #    else the external hardnested tool, redirecting output.
+            key_list = []
+            key_prefix = "Key found: "  # Define the specific prefix to look for
+            if tool_stream is None and _crack_lib is not None:
+                print(color_string((CC, "--- Running Hardnested in process ---")))
+                nonces = []
+                for nt_enc1, nt_enc2, par in struct.iter_unpack("!IIB", bytes(nonces_buffer[6:])):
+                    nonces += [(nt_enc1, par >> 4), (nt_enc2, par & 0x0F)]
+                flags = chameleon_crack.HARDNESTED_REBENCHMARK if rebenchmark else 0
+                if low_memory:
+                    flags |= chameleon_crack.HARDNESTED_LOW_MEMORY
+                try:
+                    key = _crack_lib.hardnested(
+                        struct.unpack("!I", nonces_buffer[0:4])[0], nonces,
+                        cache_dir=os.path.abspath(cache_dir) if cache_dir else None,
+                        key_hint=key_hint or None, flags=flags)
+                except chameleon_crack.CrackError as e:
+                    print(color_string((CR, f"   hardnested: {e}")))
+                    return None
+                print(color_string((CC, "--- Hardnested Finished ---")))
+                if key is None:
+                    print(color_string((CY, "   hardnested found no key.")))
+                    return None
+                key_list.append(f"{key:012x}")
+            else:
+                print(
+                    color_string(
+                        (CC, "--- Running Hardnested Tool (Output redirected) ---")
+                    )
                 )
-            )
 
-            output_str = execute_tool("hardnested", [os.path.abspath(nonce_file_path)])
+                if tool_stream is not None:
+                    output_str = tool_stream.finish()
+                else:
+                    output_str = execute_tool("hardnested", tool_args + [os.path.abspath(nonce_file_path)])
 
-            print(color_string((CC, "--- Hardnested Tool Finished ---")))
+                print(color_string((CC, "--- Hardnested Tool Finished ---")))
 
             # 5. Read the output from the temporary log file
             # 6. Process the result (using output_str read from the file)
-            key_list = []
-            key_prefix = "Key found: "  # Define the specific prefix to look for
             for line in output_str.splitlines():
                 line_stripped = line.strip()  # Remove leading/trailing whitespace
                 if line_stripped.startswith(key_prefix):
@@ -2175,6 +2315,11 @@ class HFMFHardNested(ReaderRequiredUnit):
             args.keep_nonce_file,
             args.max_runs,
             args.max_attempts,
+            args.cache_dir,
+            args.rebenchmark,
+            args.stream,
+            args.low_memory,
+            args.key_hint,
         )
 
         if recovered_key:
@@ -2231,41 +2376,64 @@ class HFMFStaticEncryptedNested(ReaderRequiredUnit):
 
         check_speed = 1.95  # sec per 64 keys
 
+        def nonce(key_type, sector):
+            return acquire_datas["nts"][key_type][sector]
+
+        def to_bytes(keys):
+            return [key.to_bytes(6, "big") for key in keys]
+
+        print("Generating key candidates of", stopping_sector - starting_sector, "sectors...")
+        if _crack_lib is None:
+            # all the dictionaries of the card in one run, the tool spreads the nonces over the CPUs
+            with tempfile.NamedTemporaryFile(
+                mode="w", suffix=".txt", prefix="senested_", dir=tempfile.gettempdir(), delete=False
+            ) as nonce_list:
+                for sector in range(starting_sector, stopping_sector):
+                    for key_type in ("a", "b"):
+                        nonce_list.write(
+                            " ".join(
+                                [
+                                    uid,
+                                    str(sector).zfill(2),
+                                    format(nonce(key_type, sector)["nt"], "x").zfill(8),
+                                    format(nonce(key_type, sector)["nt_enc"], "x").zfill(8),
+                                    str(nonce(key_type, sector)["parity"]).zfill(4),
+                                ]
+                            )
+                            + "\n"
+                        )
+            try:
+                execute_tool("staticnested_1nt", ["-b", "-f", nonce_list.name])
+            finally:
+                os.remove(nonce_list.name)
+
         for sector in range(starting_sector, stopping_sector):
             sector_name = str(sector).zfill(2)
             print("Recovering", sector, "sector...")
-            execute_tool(
-                "staticnested_1nt",
-                [
-                    uid,
-                    sector_name,
-                    format(acquire_datas["nts"]["a"][sector]["nt"], "x").zfill(8),
-                    format(acquire_datas["nts"]["a"][sector]["nt_enc"], "x").zfill(8),
-                    str(acquire_datas["nts"]["a"][sector]["parity"]).zfill(4),
-                ],
-            )
-            execute_tool(
-                "staticnested_1nt",
-                [
-                    uid,
-                    sector_name,
-                    format(acquire_datas["nts"]["b"][sector]["nt"], "x").zfill(8),
-                    format(acquire_datas["nts"]["b"][sector]["nt_enc"], "x").zfill(8),
-                    str(acquire_datas["nts"]["b"][sector]["parity"]).zfill(4),
-                ],
-            )
-            a_key_dic = f"keys_{uid}_{sector_name}_{format(acquire_datas['nts']['a'][sector]['nt'], 'x').zfill(8)}.dic"
-            b_key_dic = f"keys_{uid}_{sector_name}_{format(acquire_datas['nts']['b'][sector]['nt'], 'x').zfill(8)}.dic"
-            execute_tool("staticnested_2x1nt_rf08s", [a_key_dic, b_key_dic])
+            a_key_dic = f"keys_{uid}_{sector_name}_{format(nonce('a', sector)['nt'], 'x').zfill(8)}.bdic"
+            b_key_dic = f"keys_{uid}_{sector_name}_{format(nonce('b', sector)['nt'], 'x').zfill(8)}.bdic"
+            a_keys, a_filtered = [], []
+            if _crack_lib is not None:
+                # the dictionaries stay in memory
+                a_keys, b_keys = (
+                    _crack_lib.staticnested_1nt(
+                        acquire_datas["uid"], nonce(key_type, sector)["nt"],
+                        nonce(key_type, sector)["nt_enc"], int(nonce(key_type, sector)["parity"], 2)
+                    )
+                    for key_type in ("a", "b")
+                )
+                a_filtered, b_filtered = _crack_lib.rf08s_filter(
+                    nonce("a", sector)["nt"], a_keys, nonce("b", sector)["nt"], b_keys
+                )
+                keys_bytes = to_bytes(b_filtered)
+            else:
+                execute_tool("staticnested_2x1nt_rf08s", [a_key_dic, b_key_dic])
 
-            keys = open(
-                os.path.join(
-                    tempfile.gettempdir(), b_key_dic.replace(".dic", "_filtered.dic")
+                keys_bytes = read_key_dic(
+                    os.path.join(
+                        tempfile.gettempdir(), b_key_dic.replace(".bdic", "_filtered.bdic")
+                    )
                 )
-            ).readlines()
-            keys_bytes = []
-            for key in keys:
-                keys_bytes.append(bytes.fromhex(key.strip()))
 
             key = None
 
@@ -2287,17 +2455,22 @@ class HFMFStaticEncryptedNested(ReaderRequiredUnit):
                     break
 
             if key:
-                a_key = execute_tool(
-                    "staticnested_2x1nt_rf08s_1key",
-                    [
-                        format(acquire_datas["nts"]["b"][sector]["nt"], "x").zfill(8),
-                        key,
-                        a_key_dic,
-                    ],
-                )
-                keys_bytes = []
-                for key in a_key.split("\n"):
-                    keys_bytes.append(bytes.fromhex(key.strip()))
+                if _crack_lib is not None:
+                    keys_bytes = to_bytes(
+                        _crack_lib.rf08s_1key(nonce("b", sector)["nt"], int(key, 16), nonce("a", sector)["nt"], a_keys)
+                    )
+                else:
+                    a_key = execute_tool(
+                        "staticnested_2x1nt_rf08s_1key",
+                        [
+                            format(nonce("b", sector)["nt"], "x").zfill(8),
+                            key,
+                            a_key_dic,
+                        ],
+                    )
+                    keys_bytes = []
+                    for key in a_key.split("\n"):
+                        keys_bytes.append(bytes.fromhex(key.strip()))
                 data = self.cmd.mf1_check_keys_on_block(
                     sector * 4 + 3, 0x60, keys_bytes
                 )
@@ -2310,15 +2483,15 @@ class HFMFStaticEncryptedNested(ReaderRequiredUnit):
                     print(
                         "Failed to find A key by fast method, trying all possible keys"
                     )
-                    keys = open(
-                        os.path.join(
-                            tempfile.gettempdir(),
-                            a_key_dic.replace(".dic", "_filtered.dic"),
+                    if _crack_lib is not None:
+                        keys_bytes = to_bytes(a_filtered)
+                    else:
+                        keys_bytes = read_key_dic(
+                            os.path.join(
+                                tempfile.gettempdir(),
+                                a_key_dic.replace(".bdic", "_filtered.bdic"),
+                            )
                         )
-                    ).readlines()
-                    keys_bytes = []
-                    for key in keys:
-                        keys_bytes.append(bytes.fromhex(key.strip()))
 
                     print(
                         "Start checking possible A keys, will take up to",
@@ -2339,7 +2512,7 @@ class HFMFStaticEncryptedNested(ReaderRequiredUnit):
             else:
                 print("Failed to find key")
 
-        for file in glob.glob(tempfile.gettempdir() + "/keys_*.dic"):
+        for file in glob.glob(tempfile.gettempdir() + "/keys_*.*dic"):
             os.remove(file)
 
         return key_map
@@ -3512,7 +3685,7 @@ class HFMFVALUE(ReaderRequiredUnit):
 _KEY = re.compile("[a-fA-F0-9]{12}", flags=re.MULTILINE)
 
 
-# Sentinel values returned by _run_mfkey64 / _run_mfkey32v2_sniff
+# Sentinel values returned by _run_mfkey64_batch / _run_mfkey32v2_sniff
 # to distinguish "tool unavailable" from "tool ran but found no key".
 _TOOL_MISSING = "MISSING"    # binary not found on disk
 _TOOL_BLOCKED = "BLOCKED"    # binary exists but OS/AV prevented execution
@@ -3526,69 +3699,78 @@ def _sniff_tool_path(name):
     return p if p.exists() else None
 
 
-def _run_mfkey64(uid, nt, nr, ar, at):
+def _run_mfkey64_batch(records):
     """
-    Run mfkey64 and return the recovered key string (12 hex chars), or one of
+    Run mfkey64 once over all records and return, for each of them, the
+    recovered key string (12 hex chars), or one of
     _TOOL_MISSING / _TOOL_BLOCKED / _TOOL_NO_KEY.
 
-    mfkey64 requires 5 args: uid nt {nr} {ar} {at}
+    Every record is a tuple of the 5 mfkey64 args: uid nt {nr} {ar} {at}
     When cracking a sniff pair (both at==\'\'):
         at = nonce[1].nt  (the CU sent this as {at} after nonce[0]; the reader
                            treated it as a fresh nt for the next auth round)
     When cracking a single complete auth:
         at = the directly captured {at} frame
     """
+    if _crack_lib is not None:
+        keys = [_crack_lib.mfkey64(*(int(value, 16) for value in record)) for record in records]
+        return [_TOOL_NO_KEY if key is None else f"{key:012x}" for key in keys]
     path = _sniff_tool_path("mfkey64")
     if path is None:
-        return _TOOL_MISSING
+        return [_TOOL_MISSING] * len(records)
     try:
         result = subprocess.run(
-            [str(path), uid, nt, nr, ar, at],
+            [str(path), "-f", "-"],
+            input="".join(" ".join(record) + "\n" for record in records),
             capture_output=True,
-            timeout=30,
+            timeout=30 + 5 * len(records),
             encoding="ascii",
         )
     except FileNotFoundError:
-        return _TOOL_MISSING
+        return [_TOOL_MISSING] * len(records)
     except PermissionError:
-        return _TOOL_BLOCKED
+        return [_TOOL_BLOCKED] * len(records)
     except OSError:
         # Covers antivirus quarantine, wrong arch, etc.
-        return _TOOL_BLOCKED
+        return [_TOOL_BLOCKED] * len(records)
     except subprocess.TimeoutExpired:
-        return _TOOL_BLOCKED
-    if result.returncode not in (0, 1):
-        # Non-zero exit other than 1 (usage error) usually means OS blocked it
-        return _TOOL_BLOCKED
-    sea_obj = _KEY.search(result.stdout)
-    return sea_obj[0] if sea_obj is not None else _TOOL_NO_KEY
+        return [_TOOL_BLOCKED] * len(records)
+    if result.returncode != 0:
+        # A build without batch mode exits with 1 (usage), anything else usually means OS blocked it
+        return [_TOOL_BLOCKED] * len(records)
+    keys = [_TOOL_NO_KEY] * len(records)
+    for line in result.stdout.splitlines():
+        index, key = line.split()
+        if _KEY.fullmatch(key):
+            keys[int(index)] = key
+    return keys
 
 
-def _run_mfkey32v2(items):
+def _run_mfkey32v2_batch(records):
     """
-    Used by HFMFELog (detection-log path) via multiprocessing Pool.
-    Returns (key_str, items) on success, None if not found, raises on binary errors
-    so the pool can propagate them.
+    Used by HFMFELog (detection-log path): one mfkey32v2 process cracks every
+    record, grouped by uid, block and key type, on all CPUs.
+    Yields (index, key_str or None) as every group is done, raises on binary errors.
     """
-    output_str = subprocess.run(
-        [
-            default_cwd / ("mfkey32v2.exe" if sys.platform == "win32" else "mfkey32v2"),
-            items[0]["uid"],
-            items[0]["nt"],
-            items[0]["nr"],
-            items[0]["ar"],
-            items[1]["nt"],
-            items[1]["nr"],
-            items[1]["ar"],
-        ],
-        capture_output=True,
-        check=True,
+    with subprocess.Popen(
+        [default_cwd / ("mfkey32v2.exe" if sys.platform == "win32" else "mfkey32v2"), "-f", "-"],
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
         encoding="ascii",
-    ).stdout
-    sea_obj = _KEY.search(output_str)
-    if sea_obj is not None:
-        return sea_obj[0], items
-    return None
+    ) as process:
+        assert process.stdin is not None and process.stdout is not None
+        process.stdin.write(
+            "".join(
+                "{uid} {block} {type} {nt} {nr} {ar}\n".format(**record)
+                for record in records
+            )
+        )
+        process.stdin.close()
+        for line in process.stdout:
+            index, key = line.split()
+            yield int(index), (key if _KEY.fullmatch(key) else None)
+    if process.returncode != 0:
+        raise subprocess.CalledProcessError(process.returncode, process.args)
 
 
 def _run_mfkey32v2_sniff(n0, n1):
@@ -3596,6 +3778,10 @@ def _run_mfkey32v2_sniff(n0, n1):
     Sniff-path wrapper for mfkey32v2.  Returns a key string, or one of
     _TOOL_MISSING / _TOOL_BLOCKED / _TOOL_NO_KEY — never raises.
     """
+    if _crack_lib is not None:
+        key = _crack_lib.mfkey32v2(*(int(value, 16) for value in (
+            n0["uid"], n0["nt"], n0["nr"], n0["ar"], n1["nt"], n1["nr"], n1["ar"])))
+        return _TOOL_NO_KEY if key is None else f"{key:012x}"
     path = _sniff_tool_path("mfkey32v2")
     if path is None:
         return _TOOL_MISSING
@@ -3624,61 +3810,6 @@ def _run_mfkey32v2_sniff(n0, n1):
     return sea_obj[0] if sea_obj is not None else _TOOL_NO_KEY
 
 
-class ItemGenerator:
-    def __init__(self, rs, uid_found_keys=set()):
-        self.rs: list = rs
-        self.progress = 0
-        self.i = 0
-        self.j = 1
-        self.found = set()
-        self.keys = set()
-        for known_key in uid_found_keys:
-            self.test_key(known_key)
-
-    def __iter__(self):
-        return self
-
-    def __next__(self):
-        size = len(self.rs)
-        if self.j >= size:
-            self.i += 1
-            if self.i >= size - 1:
-                raise StopIteration
-            self.j = self.i + 1
-        item_i, item_j = self.rs[self.i], self.rs[self.j]
-        self.progress += 1
-        self.j += 1
-        if self.key_from_item(item_i) in self.found:
-            self.progress += max(0, size - self.j)
-            self.i += 1
-            self.j = self.i + 1
-            return next(self)
-        if self.key_from_item(item_j) in self.found:
-            return next(self)
-        return item_i, item_j
-
-    @staticmethod
-    def key_from_item(item):
-        return "{uid}-{nt}-{nr}-{ar}".format(**item)
-
-    def test_key(self, key, items=list()):
-        for item in self.rs:
-            item_key = self.key_from_item(item)
-            if item_key in self.found:
-                continue
-            if (item in items) or (
-                Crypto1.mfkey32_is_reader_has_key(
-                    int(item["uid"], 16),
-                    int(item["nt"], 16),
-                    int(item["nr"], 16),
-                    int(item["ar"], 16),
-                    key,
-                )
-            ):
-                self.keys.add(key)
-                self.found.add(item_key)
-
-
 @hf_mf.command("elog")
 class HFMFELog(DeviceRequiredUnit):
     detection_log_size = 18
@@ -3691,26 +3822,6 @@ class HFMFELog(DeviceRequiredUnit):
         )
         return parser
 
-    def decrypt_by_list(self, rs: list, uid_found_keys: set = set()):
-        """
-            Decrypt key from reconnaissance log list
-
-        :param rs:
-        :return:
-        """
-        msg1 = f"  > {len(rs)} records => "
-        msg2 = f"/{(len(rs)*(len(rs)-1))//2} combinations. "
-        msg3 = " key(s) found"
-        gen = ItemGenerator(rs, uid_found_keys)
-        print(f"{msg1}{gen.progress}{msg2}{len(gen.keys)}{msg3}\r", end="")
-        with Pool(cpu_count()) as pool:
-            for result in pool.imap(_run_mfkey32v2, gen):
-                if result is not None:
-                    gen.test_key(*result)
-                print(f"{msg1}{gen.progress}{msg2}{len(gen.keys)}{msg3}\r", end="")
-        print(f"{msg1}{gen.progress}{msg2}{len(gen.keys)}{msg3}")
-        return gen.keys
-
     def on_exec(self, args: argparse.Namespace):
         if not args.decrypt:
             count = self.cmd.mf1_get_detection_count()
@@ -3746,25 +3857,28 @@ class HFMFELog(DeviceRequiredUnit):
 
             result_maps[uid][block][type].append(item)
 
+        # one mfkey32v2 run for the whole log, keys found on a block are tried on the next ones
+        records = []
         for uid in result_maps.keys():
-            print(f" - Detection log for uid [{uid.upper()}]")
-            result_maps_for_uid = result_maps[uid]
-            uid_found_keys = set()
-            for block in result_maps_for_uid:
+            for block in result_maps[uid]:
                 for keyType in "AB":
-                    records = (
-                        result_maps_for_uid[block][keyType]
-                        if keyType in result_maps_for_uid[block]
-                        else []
-                    )
-                    if len(records) < 1:
-                        continue
-                    print(f"  > Decrypting block {block} key {keyType} detect log...")
-                    result_maps[uid][block][keyType] = self.decrypt_by_list(
-                        records, uid_found_keys
-                    )
-                    uid_found_keys.update(result_maps[uid][block][keyType])
+                    if keyType in result_maps[uid][block]:
+                        records.extend(result_maps[uid][block][keyType])
+                        result_maps[uid][block][keyType] = set()
+        keys = set()
+        msg = f"  > Decrypting {len(records)} records => "
+        print(f"{msg}0/{len(records)} done, 0 key(s) found\r", end="")
+        for done, (index, key) in enumerate(_run_mfkey32v2_batch(records), 1):
+            if key is not None:
+                record = records[index]
+                result_maps[record["uid"]][record["block"]][record["type"]].add(key)
+                keys.add(key)
+            print(f"{msg}{done}/{len(records)} done, {len(keys)} key(s) found\r", end="")
+        print(f"{msg}{len(records)}/{len(records)} done, {len(keys)} key(s) found")
 
+        for uid in result_maps.keys():
+            print(f" - Detection log for uid [{uid.upper()}]")
+            result_maps_for_uid = result_maps[uid]
             print("  > Result ---------------------------")
             for block in result_maps_for_uid.keys():
                 if "A" in result_maps_for_uid[block]:
@@ -8587,6 +8701,13 @@ def _print_14a_sniff_summary(frames):
         total = sum(len(v) for v in groups.values())
         print(f" {CC}Nonces   :{C0} {total} auth exchange(s) captured")
 
+        # one mfkey64 run for every group holding a pair of exchanges
+        paired = [g for g, ns in groups.items() if len(ns) >= 2]
+        keys64 = dict(zip(paired, _run_mfkey64_batch([
+            (g[0], groups[g][0]['nt'], groups[g][0]['nr'], groups[g][0]['ar'], groups[g][1]['nt'])
+            for g in paired
+        ]))) if paired else {}
+
         for (uid, block, kt), ns in groups.items():
             print(f"   Block {block} Key {kt}  uid={uid}")
             for idx, n in enumerate(ns):
@@ -8607,7 +8728,7 @@ def _print_14a_sniff_summary(frames):
                 print(f"   {CC}mfkey64 :{C0} {cmd64}")
                 print(f"   {CC}mfkey32v2:{C0} {cmd32}")
 
-                key = _run_mfkey64(uid, n0['nt'], n0['nr'], n0['ar'], n1['nt'])
+                key = keys64[(uid, block, kt)]
 
                 if key not in (_TOOL_MISSING, _TOOL_BLOCKED, _TOOL_NO_KEY):
                     print(f"   {CG}Key: [{key.upper()}]{C0}")
@@ -0,0 +1,230 @@
+"""
+ctypes binding of the chameleon_crack shared library (software/src/chameleon_crack.h):
+the key recovery cores of the nested, staticnested, staticnested_1nt, staticnested_2x1nt_rf08s(_1key),
+darkside, mfkey32/32v2/64 and hardnested tools, called in process instead of spawning the tools.
+
+Keys are ints (48 bits). Recovering calls return a list of keys, or a key / None for the mfkey ones.
+The long running calls can be interrupted with Ctrl-C: the library is asked to stop, and
+KeyboardInterrupt is raised once it did.
+"""
+import ctypes
+import sys
+import threading
+import time
+from pathlib import Path
+from typing import Callable, List, Optional, Sequence, Tuple, Union
+
+API_VERSION = 3
+
+OK = 0
+NOT_FOUND = 1
+BUFFER_TOO_SMALL = 2
+CANCELLED = 3
+ERROR_ARGS = -1
+ERROR_MEMORY = -2
+
+# Most keys staticnested_1nt yields for one nonce
+STATICNESTED_KEY_SPACE_SIZE = 1 << 18
+# Most keys nested and staticnested yield
+NESTED_MAX_KEYS = 50
+# Key buffer of the calls whose key count isn't bounded, the keys that don't fit are taken afterwards
+DEFAULT_MAX_KEYS = 1 << 16
+
+# hardnested flags
+HARDNESTED_REBENCHMARK = 0x01
+HARDNESTED_LOW_MEMORY = 0x02
+HARDNESTED_RESUME = 0x04
+
+u32 = ctypes.c_uint32
+u64 = ctypes.c_uint64
+p_u32 = ctypes.POINTER(u32)
+p_u64 = ctypes.POINTER(u64)
+p_int = ctypes.POINTER(ctypes.c_int)
+
+_PROTOTYPES = {
+    "crack_api_version": [],
+    "crack_take_keys": [p_u64, u32, p_u32],
+    "crack_nested": [u32, u32, p_u32, u32, u32, p_u64, u32, p_u32, p_int],
+    "crack_staticnested": [u32, ctypes.c_uint8, p_u32, u32, u32, p_u64, u32, p_u32, p_int],
+    "crack_darkside": [u32, p_u64, u32, u32, p_u64, u32, p_u32, p_int],
+    "crack_mfkey32": [u32, u32, u32, u32, u32, u32, u32, p_u64, p_int],
+    "crack_mfkey32v2": [u32, u32, u32, u32, u32, u32, u32, u32, p_u64, p_int],
+    "crack_mfkey64": [u32, u32, u32, u32, u32, p_u64],
+    "crack_staticnested_1nt": [u32, u32, u32, ctypes.c_uint8, u32, p_u64, u32, p_u32, p_int],
+    "crack_rf08s_filter": [u32, p_u64, u32, u32, p_u64, u32, ctypes.c_char_p, ctypes.c_char_p, u32, p_int],
+    "crack_rf08s_1key": [u32, u64, u32, p_u64, u32, p_u64, u32, p_u32, p_int],
+    "crack_hardnested": [u32, p_u32, u32, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, u32, p_u64, p_int],
+}
+
+
+class CrackError(Exception):
+    pass
+
+
+def library_names() -> List[str]:
+    if sys.platform == "win32":
+        # MSVC and MinGW builds
+        return ["chameleon_crack.dll", "libchameleon_crack.dll"]
+    if sys.platform == "darwin":
+        return ["libchameleon_crack.dylib"]
+    return ["libchameleon_crack.so"]
+
+
+def load(directory: Union[str, Path]) -> Optional["CrackLibrary"]:
+    """
+    The library found in directory, or None when it isn't there or doesn't load
+    (missing build, other API version, wrong architecture...): callers fall back to the tools.
+    """
+    for name in library_names():
+        path = Path(directory) / name
+        if not path.exists():
+            continue
+        try:
+            return CrackLibrary(path)
+        except (OSError, AttributeError, CrackError):
+            return None
+    return None
+
+
+def _array(ctype, values: Sequence[int]):
+    return (ctype * max(len(values), 1))(*values)
+
+
+class CrackLibrary:
+    def __init__(self, path: Union[str, Path]):
+        self._lib = ctypes.CDLL(str(path))
+        for name, argtypes in _PROTOTYPES.items():
+            func = getattr(self._lib, name)
+            func.argtypes = argtypes
+            func.restype = ctypes.c_int
+        version = self._lib.crack_api_version()
+        if version != API_VERSION:
+            raise CrackError(f"{path}: API version {version}, expected {API_VERSION}")
+        self.path = Path(path)
+
+    @staticmethod
+    def _check(ret: int):
+        if ret < 0:
+            raise CrackError("invalid arguments" if ret == ERROR_ARGS else "out of memory")
+        return ret
+
+    def _run(self, work: Callable[[object], int], on_wait: Optional[Callable[[float], None]]) -> int:
+        """
+        Run work(cancel) on a worker thread, so Ctrl-C still reaches this one,
+        calling on_wait(elapsed seconds) every 0.1s meanwhile.
+        """
+        cancel = ctypes.c_int(0)
+        result = []
+        worker = threading.Thread(target=lambda: result.append(work(ctypes.byref(cancel))), daemon=True)
+        start = time.monotonic()
+        worker.start()
+        try:
+            while worker.is_alive():
+                worker.join(0.1)
+                if on_wait is not None:
+                    on_wait(time.monotonic() - start)
+        except KeyboardInterrupt:
+            cancel.value = 1
+            worker.join()
+            raise
+        return self._check(result[0])
+
+    def _keys(self, call: Callable[[ctypes.Array, int, object, object], int], max_keys: int,
+              on_wait: Optional[Callable[[float], None]] = None) -> List[int]:
+        """
+        call(keys, max_keys, byref(key_count), cancel) on a worker thread. Keys that don't fit are
+        kept by the library for crack_take_keys() on that same thread, the recovery runs only once.
+        """
+        found = []
+
+        def work(cancel) -> int:
+            keys = (u64 * max_keys)()
+            count = u32(0)
+            ret = call(keys, max_keys, ctypes.byref(count), cancel)
+            if ret == BUFFER_TOO_SMALL:
+                keys = (u64 * count.value)()
+                ret = self._lib.crack_take_keys(keys, count.value, ctypes.byref(count))
+            if ret == OK:
+                found.extend(keys[:count.value])
+            return ret
+
+        self._run(work, on_wait)
+        return found
+
+    def nested(self, uid: int, dist: int, nonces: Sequence[Tuple[int, int, int]], threads: int = 0,
+               on_wait: Optional[Callable[[float], None]] = None) -> List[int]:
+        """Key candidates of nested nonces (nt, nt_enc, par), most likely first."""
+        flat = _array(u32, [v for nonce in nonces for v in nonce])
+        return self._keys(lambda keys, max_keys, count, cancel: self._lib.crack_nested(
+            uid, dist, flat, len(nonces), threads, keys, max_keys, count, cancel), NESTED_MAX_KEYS, on_wait)
+
+    def staticnested(self, uid: int, key_type: int, nonces: Sequence[Tuple[int, int]], threads: int = 0,
+                     on_wait: Optional[Callable[[float], None]] = None) -> List[int]:
+        """Key candidates of static nested nonces (nt, nt_enc), key_type 0x60 / 0x61."""
+        flat = _array(u32, [v for nonce in nonces for v in nonce])
+        return self._keys(lambda keys, max_keys, count, cancel: self._lib.crack_staticnested(
+            uid, key_type, flat, len(nonces), threads, keys, max_keys, count, cancel), NESTED_MAX_KEYS, on_wait)
+
+    def darkside(self, uid: int, nonces: Sequence[Tuple[int, int, int, int, int]], threads: int = 0,
+                 on_wait: Optional[Callable[[float], None]] = None) -> List[int]:
+        """Key candidates of darkside acquisitions (nt, ks_list, par_list, nr, ar)."""
+        flat = _array(u64, [v for nonce in nonces for v in nonce])
+        return self._keys(lambda keys, max_keys, count, cancel: self._lib.crack_darkside(
+            uid, flat, len(nonces), threads, keys, max_keys, count, cancel), DEFAULT_MAX_KEYS, on_wait)
+
+    def mfkey32(self, uid: int, nt: int, nr0: int, ar0: int, nr1: int, ar1: int, threads: int = 0) -> Optional[int]:
+        key = u64(0)
+        ret = self._run(lambda cancel: self._lib.crack_mfkey32(
+            uid, nt, nr0, ar0, nr1, ar1, threads, ctypes.byref(key), cancel), None)
+        return key.value if ret == OK else None
+
+    def mfkey32v2(self, uid: int, nt0: int, nr0: int, ar0: int, nt1: int, nr1: int, ar1: int,
+                  threads: int = 0) -> Optional[int]:
+        key = u64(0)
+        ret = self._run(lambda cancel: self._lib.crack_mfkey32v2(
+            uid, nt0, nr0, ar0, nt1, nr1, ar1, threads, ctypes.byref(key), cancel), None)
+        return key.value if ret == OK else None
+
+    def mfkey64(self, uid: int, nt: int, nr: int, ar: int, at: int) -> Optional[int]:
+        key = u64(0)
+        ret = self._check(self._lib.crack_mfkey64(uid, nt, nr, ar, at, ctypes.byref(key)))
+        return key.value if ret == OK else None
+
+    def staticnested_1nt(self, uid: int, nt: int, nt_enc: int, par_err: int, threads: int = 0) -> List[int]:
+        """Key candidates of one static encrypted nonce, par_err the 4 parity error bits (first byte MSB)."""
+        return self._keys(lambda keys, max_keys, count, cancel: self._lib.crack_staticnested_1nt(
+            uid, nt, nt_enc, par_err, threads, keys, max_keys, count, cancel), STATICNESTED_KEY_SPACE_SIZE)
+
+    def rf08s_filter(self, nt1: int, keys1: Sequence[int], nt2: int, keys2: Sequence[int],
+                     threads: int = 0) -> Tuple[List[int], List[int]]:
+        """The candidates of keys1 and keys2 (a sector's keyA and keyB) having a partner on the other side."""
+        keep1 = ctypes.create_string_buffer(len(keys1) + 1)
+        keep2 = ctypes.create_string_buffer(len(keys2) + 1)
+        flat1, flat2 = _array(u64, keys1), _array(u64, keys2)
+        self._run(lambda cancel: self._lib.crack_rf08s_filter(
+            nt1, flat1, len(keys1), nt2, flat2, len(keys2), keep1, keep2, threads, cancel), None)
+        return ([k for k, keep in zip(keys1, keep1.raw) if keep],
+                [k for k, keep in zip(keys2, keep2.raw) if keep])
+
+    def rf08s_1key(self, nt1: int, key1: int, nt2: int, keys2: Sequence[int]) -> List[int]:
+        """The candidates of keys2 (nonce nt2) matching key1 found on nt1."""
+        flat = _array(u64, keys2)
+        return self._keys(lambda keys, max_keys, count, cancel: self._lib.crack_rf08s_1key(
+            nt1, key1, nt2, flat, len(keys2), keys, max_keys, count, cancel), max(len(keys2), 1))
+
+    def hardnested(self, uid: int, nonces: Sequence[Tuple[int, int]], cache_dir: Optional[str] = None,
+                   key_hint: Optional[str] = None, journal: Optional[str] = None, flags: int = 0,
+                   on_wait: Optional[Callable[[float], None]] = None) -> Optional[int]:
+        """
+        Key of hardnested nonces (nt_enc, par_enc) in acquisition order, None when they don't give it.
+        The progress is printed to stdout, like the hardnested tool does.
+        """
+        def path(value: Optional[str]) -> Optional[bytes]:
+            return None if value is None else value.encode()
+
+        flat = _array(u32, [v for nonce in nonces for v in nonce])
+        key = u64(0)
+        ret = self._run(lambda cancel: self._lib.crack_hardnested(
+            uid, flat, len(nonces), path(cache_dir), path(key_hint), path(journal), flags, ctypes.byref(key), cancel),
+            on_wait)
+        return key.value if ret == OK else None
@@ -1,7 +1,9 @@
 import argparse
+import struct
 import subprocess
 import sys
 import tempfile
+import threading
 import os.path
 from pathlib import Path
 
@@ -243,6 +245,89 @@ def execute_tool(tool_name, args):
     return temp_output_file.read()
 
 
+class ToolStream:
+    """
+    A tool reading its input from a pipe while the input is still being acquired,
+    e.g. hardnested with "-" as the nonce file. Once the tool needs no more input
+    it prints a line starting with done_prefix and closes its end of the pipe.
+    """
+
+    def __init__(self, tool_name, args, done_prefix):
+        tool_executable = f"{tool_name}.exe" if sys.platform == "win32" else f"./{tool_name}"
+        self._process = subprocess.Popen(
+            [os.path.join(default_cwd, tool_executable)] + args,
+            cwd=tempfile.gettempdir(),
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+        )
+        self._done_prefix = done_prefix
+        self._output = []
+        self.complete = False  # the tool said it has enough input
+        self._stopped_reading = threading.Event()
+        self._reader = threading.Thread(target=self._read_output, daemon=True)
+        self._reader.start()
+
+    def _read_output(self):
+        for line in self._process.stdout:
+            text = line.decode("utf-8", errors="replace")
+            self._output.append(text)
+            if text.startswith(self._done_prefix):
+                self.complete = True
+                self._stopped_reading.set()
+        self._stopped_reading.set()
+
+    def stopped_reading(self):
+        """True once the tool has enough input or has exited"""
+        return self._stopped_reading.is_set()
+
+    def write(self, data):
+        """Pass data on to the tool, False if it takes no more"""
+        if self.stopped_reading():
+            return False
+        try:
+            self._process.stdin.write(data)
+            self._process.stdin.flush()
+        except OSError:
+            # BrokenPipeError once the tool closed its end
+            return False
+        return True
+
+    def finish(self):
+        """End of input, wait for the tool and return its output"""
+        try:
+            self._process.stdin.close()
+        except OSError:
+            pass
+        self._process.wait()
+        self._reader.join()
+        return "".join(self._output)
+
+    def stop(self):
+        self._process.kill()
+        self.finish()
+
+
+def read_key_dic(path):
+    """
+    Keys of a staticnested_* dictionary as 6 byte values, either the text
+    .dic format or the binary .bdic one (see software/src/keydic.h)
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"CUKD":
+        return [bytes.fromhex(line.strip()) for line in data.decode().splitlines() if line.strip()]
+    version, header_size = struct.unpack_from("<HH", data, 4)
+    if version != 1:
+        raise ValueError(f"Unsupported key dictionary version {version} in {path}")
+    (count,) = struct.unpack_from("<I", data, 20)
+    keys = []
+    for i in range(count):
+        offset = header_size + i * 6
+        keys.append(int.from_bytes(data[offset: offset + 6], "little").to_bytes(6, "big"))
+    return keys
+
+
 def tqdm_if_exists(iterator):
     try:
         import tqdm
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+import ctypes
+import os
+import sys
+import unittest
+
+CURRENT_DIR = os.path.split(os.path.abspath(__file__))[0]
+config_path = CURRENT_DIR.rsplit(os.sep, 1)[0]
+sys.path.append(config_path)
+
+import chameleon_crack  # noqa: E402
+from crypto1 import Crypto1  # noqa: E402
+
+lib = chameleon_crack.load(os.path.join(config_path, "bin"))
+
+
+def reader_auth(uid, nt, nr, key):
+    """{nr} {ar} {at} of a reader authenticating on nt"""
+    reader = Crypto1()
+    reader.key = key
+    reader.lfsr48_u32(uid ^ nt, False)
+    nr_enc = nr ^ reader.lfsr48_u32(nr, False)
+    ar_enc = Crypto1.prng_next(nt, 64) ^ reader.lfsr48_u32(0, False)
+    at_enc = Crypto1.prng_next(nt, 96) ^ reader.lfsr48_u32(0, False)
+    return nr_enc, ar_enc, at_enc
+
+
+@unittest.skipIf(lib is None, "chameleon_crack library not built")
+class TestChameleonCrack(unittest.TestCase):
+    uid, key = 0x65535D33, 0x974C262B9278
+    lib: chameleon_crack.CrackLibrary
+
+    def setUp(self):
+        assert lib is not None
+        self.lib = lib
+
+    def test_mfkey64(self):
+        self.assertEqual(self.lib.mfkey64(self.uid, 0xBE2B7B5D, 0xB1E1B891, 0x2CF7A248, 0x36081500), self.key)
+
+    def test_mfkey32v2(self):
+        nt0, nt1 = 0xBE2B7B5D, 0x2C198BE4
+        nr0, ar0, _ = reader_auth(self.uid, nt0, 0x0B4271BA, f"{self.key:012x}")
+        nr1, ar1, _ = reader_auth(self.uid, nt1, 0x12345678, f"{self.key:012x}")
+        self.assertEqual(self.lib.mfkey32v2(self.uid, nt0, nr0, ar0, nt1, nr1, ar1), self.key)
+        self.assertIsNone(self.lib.mfkey32v2(self.uid, nt0, nr0, ar0, nt1, nr1, ar1 ^ 1))
+
+    def test_mfkey32(self):
+        nt = 0xBE2B7B5D
+        nr0, ar0, _ = reader_auth(self.uid, nt, 0x0B4271BA, f"{self.key:012x}")
+        nr1, ar1, _ = reader_auth(self.uid, nt, 0x12345678, f"{self.key:012x}")
+        self.assertEqual(self.lib.mfkey32(self.uid, nt, nr0, ar0, nr1, ar1), self.key)
+
+    def test_darkside(self):
+        keys = self.lib.darkside(0x12345678, [(0x01200145, 868354740005372672, 4595808931325927367, 0, 0)])
+        self.assertEqual(keys, [0xA0A1A2A3A4A5])
+
+    def test_staticnested_1nt(self):
+        # the staticnested_1nt usage example
+        keys = self.lib.staticnested_1nt(0xA13E4902, 0xD14191B3, 0x2E9E49FC, 0b1111)
+        self.assertEqual(len(keys), 44075)
+        self.assertEqual(len(set(keys)), len(keys))
+
+    def test_nested(self):
+        # the nested vector of the bench suite
+        keys = self.lib.nested(2624915588, 564, [(3777279546, 1561631980, 0), (1692513196, 934799250, 5)])
+        self.assertIn(0x4B791BEA7BCC, keys)
+        self.assertLessEqual(len(keys), chameleon_crack.NESTED_MAX_KEYS)
+
+    def test_staticnested(self):
+        # the staticnested vector of the bench suite, key type 0x60
+        keys = self.lib.staticnested(1548124003, 0x60, [(18874693, 3584171429), (18874693, 2578853988)])
+        self.assertIn(0xA3B7C1D2E4F5, keys)
+
+    def test_rf08s(self):
+        # keyA and keyB of the bench suite sector, nt / nt_enc / parity errors of each
+        uid, nt_a, nt_b = 0x3A5B7C9D, 0x4D8F2A61, 0x9E3C7B15
+        key_a, key_b = 0x1A2B3C4D5E6F, 0x77CD66A5442F
+        keys_a = self.lib.staticnested_1nt(uid, nt_a, 0xDD8BF693, 0b0111)
+        keys_b = self.lib.staticnested_1nt(uid, nt_b, 0x320E6B93, 0b0110)
+        self.assertIn(key_a, keys_a)
+        self.assertIn(key_b, keys_b)
+        filtered_a, filtered_b = self.lib.rf08s_filter(nt_a, keys_a, nt_b, keys_b)
+        self.assertIn(key_a, filtered_a)
+        self.assertIn(key_b, filtered_b)
+        self.assertLess(len(filtered_a), len(keys_a))
+        self.assertIn(key_b, self.lib.rf08s_1key(nt_a, key_a, nt_b, filtered_b))
+
+    def test_cancelled(self):
+        # a flag set before the call: nothing is started and CANCELLED comes back
+        raw = self.lib._lib
+        cancel = ctypes.byref(ctypes.c_int(1))
+        key = chameleon_crack.u64(0)
+        count = chameleon_crack.u32(0)
+        keys = (chameleon_crack.u64 * 4)()
+        keep = ctypes.create_string_buffer(2)
+        self.assertEqual(raw.crack_mfkey32(self.uid, 0xBE2B7B5D, 0, 0, 0, 0, 2, ctypes.byref(key), cancel),
+                         chameleon_crack.CANCELLED)
+        self.assertEqual(raw.crack_mfkey32v2(self.uid, 0xBE2B7B5D, 0, 0, 0x2C198BE4, 0, 0, 2, ctypes.byref(key), cancel),
+                         chameleon_crack.CANCELLED)
+        self.assertEqual(raw.crack_staticnested_1nt(0xA13E4902, 0xD14191B3, 0x2E9E49FC, 0b1111, 2,
+                                                    keys, 4, ctypes.byref(count), cancel), chameleon_crack.CANCELLED)
+        self.assertEqual(raw.crack_rf08s_filter(1, keys, 1, 2, keys, 1, keep, keep, 2, cancel),
+                         chameleon_crack.CANCELLED)
+        self.assertEqual(raw.crack_rf08s_1key(1, 0, 2, keys, 1, keys, 4, ctypes.byref(count), cancel),
+                         chameleon_crack.CANCELLED)
+        nonces = (chameleon_crack.u32 * 2)()
+        self.assertEqual(raw.crack_hardnested(self.uid, nonces, 1, None, None, None, 0, ctypes.byref(key), cancel),
+                         chameleon_crack.CANCELLED)
+
+    def test_invalid_args(self):
+        with self.assertRaises(chameleon_crack.CrackError):
+            self.lib.rf08s_1key(1, 0, 1, [0])
+        with self.assertRaises(chameleon_crack.CrackError):
+            self.lib.hardnested(self.uid, [(0, 0)], key_hint="not a hint")
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -36,12 +36,18 @@
 #include "crapto1.h"
 #include "parity.h"
 #include "hardnested/hardnested_bruteforce.h"
+#include "hardnested/hardnested_job.h"
 #include "hardnested/hardnested_bf_core.h"
 #include "hardnested/hardnested_bitarray_core.h"
 #include "pm3/ui.h"
 #include "pm3/commonutil.h"
 #include "pm3/util_posix.h"
 #include "hardnested/tables.h"
+#include "hardnested/hardnested_tables_cache.h"
+#include "hardnested/hardnested_bench_cache.h"
+#include "hardnested/hardnested_sparse_bitarray.h"
+#include "hardnested/hardnested_journal.h"
+#include "key_hint.h"
 #include <lzma.h>
 
 #define NUM_CHECK_BITFLIPS_THREADS      (num_CPUs())
@@ -66,10 +72,6 @@ static uint16_t sums[NUM_SUMS] = {0, 32, 56, 64, 80, 96, 104, 112, 120, 128, 136
                                   256
                                  };
 
-// number of possible partial sum property values
-#define NUM_PART_SUMS                  9
-
-static uint32_t num_acquired_nonces = 0;
 static uint64_t start_time = 0;
 static uint16_t effective_bitflip[2][0x400];
 static uint16_t num_effective_bitflips[2] = {0, 0};
@@ -78,9 +80,6 @@ static uint16_t num_all_effective_bitflips = 0;
 static uint16_t num_1st_byte_effective_bitflips = 0;
 #define CHECK_1ST_BYTES 0x01
 #define CHECK_2ND_BYTES 0x02
-static uint8_t hardnested_stage = CHECK_1ST_BYTES;
-static uint64_t known_target_key;
-static uint32_t test_state[2] = {0, 0};
 static float brute_force_per_second;
 
 static void get_SIMD_instruction_set(char *instruction_set) {
@@ -139,7 +138,7 @@ static void print_progress_header(void) {
 
 void hardnested_print_progress(uint32_t nonces, const char *activity, float brute_force, uint64_t min_diff_print_time) {
     static uint64_t last_print_time = 0;
-    if (msclock() - last_print_time > min_diff_print_time) {
+    if (min_diff_print_time == 0 || msclock() - last_print_time > min_diff_print_time) {
         last_print_time = msclock();
         uint64_t total_time = msclock() - start_time;
         float brute_force_time = brute_force / brute_force_per_second;
@@ -229,7 +228,17 @@ static inline uint32_t next_state(uint32_t *bitarray, uint32_t state) {
 // bitflip property bitarrays
 
 static uint32_t *bitflip_bitarrays[2][0x400];
+static sparse_bitarray_t *sparse_bitflip_bitarrays[2][0x400];   // instead of bitflip_bitarrays with low_memory
 static uint32_t count_bitflip_bitarrays[2][0x400];
+static bool low_memory = false;
+
+void hardnested_set_low_memory(bool enable) {
+    low_memory = enable;
+}
+
+static inline bool have_bitflip_bitarray(odd_even_t odd_even, uint16_t bitflip) {
+    return bitflip_bitarrays[odd_even][bitflip] != NULL || sparse_bitflip_bitarrays[odd_even][bitflip] != NULL;
+}
 
 static int compare_count_bitflip_bitarrays(const void *b1, const void *b2) {
     uint64_t count1 = (uint64_t) count_bitflip_bitarrays[ODD_STATE][*(uint16_t *) b1] *
@@ -247,15 +256,18 @@ static int compare_count_bitflip_bitarrays(const void *b1, const void *b2) {
 // Initialize decompression of the respective bitflip_bitarray stream
 //----------------------------------------------------------------------------
 
+// With low_memory every table is decompressed into the same buffer and kept as a sparse bitarray.
 static void init_bitflip_bitarrays(void) {
 
     //  z_stream compressed_stream;
     lzma_stream strm = LZMA_STREAM_INIT;
+    uint32_t *buffer = NULL;
+    size_t sparse_size = 0;
 
     for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
-        num_effective_bitflips[odd_even] = 0;
         for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
             bitflip_bitarrays[odd_even][bitflip] = NULL;
+            sparse_bitflip_bitarrays[odd_even][bitflip] = NULL;
             count_bitflip_bitarrays[odd_even][bitflip] = 1 << 24;
             bitflip_info p = get_bitflip(odd_even, bitflip);
             if (p.input_buffer != NULL) {
@@ -263,7 +275,10 @@ static void init_bitflip_bitarrays(void) {
 
                 lzma_init_inflate(&strm, p.input_buffer, p.len, (uint8_t*)&count, sizeof(count));
                 if ((float)count / (1 << 24) < IGNORE_BITFLIP_THRESHOLD) {
-                    uint32_t *bitset = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+                    uint32_t *bitset = buffer;
+                    if (bitset == NULL) {
+                        bitset = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+                    }
                     if (bitset == NULL) {
                         printf("Out of memory error in init_bitflip_statelists(). Aborting...\n");
                         lzma_end(&strm);
@@ -274,13 +289,42 @@ static void init_bitflip_bitarrays(void) {
                     strm.avail_out = sizeof(uint32_t) * (1 << 19);
                     decompress(&strm);
 
-                    effective_bitflip[odd_even][num_effective_bitflips[odd_even]++] = bitflip;
-                    bitflip_bitarrays[odd_even][bitflip] = bitset;
+                    if (low_memory) {
+                        buffer = bitset;
+                        sparse_bitflip_bitarrays[odd_even][bitflip] = sparse_bitarray_from_dense(bitset);
+                        if (sparse_bitflip_bitarrays[odd_even][bitflip] == NULL) {
+                            printf("Out of memory error in init_bitflip_statelists(). Aborting...\n");
+                            lzma_end(&strm);
+                            exit(4);
+                        }
+                        sparse_size += sparse_bitarray_size(sparse_bitflip_bitarrays[odd_even][bitflip]);
+                    } else {
+                        bitflip_bitarrays[odd_even][bitflip] = bitset;
+                    }
                     count_bitflip_bitarrays[odd_even][bitflip] = count;
                 }
                 lzma_end(&strm);
             }
         }
+    }
+
+    if (buffer != NULL) {
+        free_bitarray(buffer);
+        char progress_text[80];
+        snprintf(progress_text, sizeof(progress_text), "Low memory: bitflip state tables compressed to %zu kB", sparse_size / 1024);
+        hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+    }
+}
+
+// the lists of effective bitflips, from the bitflip_bitarrays and their counts
+static void init_effective_bitflips(bool cached) {
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        num_effective_bitflips[odd_even] = 0;
+        for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
+            if (have_bitflip_bitarray(odd_even, bitflip)) {
+                effective_bitflip[odd_even][num_effective_bitflips[odd_even]++] = bitflip;
+            }
+        }
         effective_bitflip[odd_even][num_effective_bitflips[odd_even]] = 0x400; // EndOfList marker
     }
     uint16_t i = 0;
@@ -306,17 +350,28 @@ static void init_bitflip_bitarrays(void) {
     qsort(all_effective_bitflip, num_1st_byte_effective_bitflips, sizeof(uint16_t), compare_count_bitflip_bitarrays);
     qsort(all_effective_bitflip + num_1st_byte_effective_bitflips, num_all_effective_bitflips - num_1st_byte_effective_bitflips, sizeof(uint16_t), compare_count_bitflip_bitarrays);
     char progress_text[80];
-    sprintf(progress_text, "Using %d precalculated bitflip state tables", num_all_effective_bitflips);
+    sprintf(progress_text, "Using %d precalculated bitflip state tables%s", num_all_effective_bitflips, cached ? " (cached)" : "");
     hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
 }
 
+// bitarrays mapped from the tables cache are released with the cache
+static void free_table_bitarray(uint32_t *bitarray) {
+    if (!tables_cache_contains(bitarray)) {
+        free_bitarray(bitarray);
+    }
+}
+
 static void free_bitflip_bitarrays(void) {
     for (int16_t bitflip = 0x3ff; bitflip > 0x000; bitflip--) {
-        free_bitarray(bitflip_bitarrays[ODD_STATE][bitflip]);
+        free_table_bitarray(bitflip_bitarrays[ODD_STATE][bitflip]);
+        sparse_bitarray_free(sparse_bitflip_bitarrays[ODD_STATE][bitflip]);
     }
     for (int16_t bitflip = 0x3ff; bitflip > 0x000; bitflip--) {
-        free_bitarray(bitflip_bitarrays[EVEN_STATE][bitflip]);
+        free_table_bitarray(bitflip_bitarrays[EVEN_STATE][bitflip]);
+        sparse_bitarray_free(sparse_bitflip_bitarrays[EVEN_STATE][bitflip]);
     }
+    memset(bitflip_bitarrays, 0, sizeof(bitflip_bitarrays));
+    memset(sparse_bitflip_bitarrays, 0, sizeof(sparse_bitflip_bitarrays));
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -325,6 +380,7 @@ static void free_bitflip_bitarrays(void) {
 static uint32_t *part_sum_a0_bitarrays[2][NUM_PART_SUMS];
 static uint32_t *part_sum_a8_bitarrays[2][NUM_PART_SUMS];
 static uint32_t *sum_a0_bitarrays[2][NUM_SUMS];
+static sparse_bitarray_t *sparse_sum_a0_bitarrays[2][NUM_SUMS];   // instead of sum_a0_bitarrays with low_memory
 
 static uint16_t PartialSumProperty(uint32_t state, odd_even_t odd_even) {
     uint16_t sum = 0;
@@ -393,47 +449,377 @@ static void init_part_sum_bitarrays(void) {
 
 static void free_part_sum_bitarrays(void) {
     for (int16_t part_sum_a8 = (NUM_PART_SUMS - 1); part_sum_a8 >= 0; part_sum_a8--) {
-        free_bitarray(part_sum_a8_bitarrays[ODD_STATE][part_sum_a8]);
+        free_table_bitarray(part_sum_a8_bitarrays[ODD_STATE][part_sum_a8]);
     }
     for (int16_t part_sum_a8 = (NUM_PART_SUMS - 1); part_sum_a8 >= 0; part_sum_a8--) {
-        free_bitarray(part_sum_a8_bitarrays[EVEN_STATE][part_sum_a8]);
+        free_table_bitarray(part_sum_a8_bitarrays[EVEN_STATE][part_sum_a8]);
     }
     for (int16_t part_sum_a0 = (NUM_PART_SUMS - 1); part_sum_a0 >= 0; part_sum_a0--) {
-        free_bitarray(part_sum_a0_bitarrays[ODD_STATE][part_sum_a0]);
+        free_table_bitarray(part_sum_a0_bitarrays[ODD_STATE][part_sum_a0]);
     }
     for (int16_t part_sum_a0 = (NUM_PART_SUMS - 1); part_sum_a0 >= 0; part_sum_a0--) {
-        free_bitarray(part_sum_a0_bitarrays[EVEN_STATE][part_sum_a0]);
+        free_table_bitarray(part_sum_a0_bitarrays[EVEN_STATE][part_sum_a0]);
     }
 }
 
+// With low_memory every table is built in the same buffer and kept as a sparse bitarray.
 static void init_sum_bitarrays(void) {
+    uint32_t *buffer = NULL;
+    size_t sparse_size = 0;
+
     for (uint16_t sum_a0 = 0; sum_a0 < NUM_SUMS; sum_a0++) {
         for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
-            sum_a0_bitarrays[odd_even][sum_a0] = (uint32_t *) malloc_bitarray(sizeof(uint32_t) * (1 << 19));
-            if (sum_a0_bitarrays[odd_even][sum_a0] == NULL) {
+            uint32_t *bitset = buffer;
+            if (bitset == NULL) {
+                bitset = (uint32_t *) malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+            }
+            if (bitset == NULL) {
                 PrintAndLogEx(ERR, "Out of memory error in init_sum_bitarrays(). Aborting...\n");
                 exit(4);
             }
-            clear_bitarray24(sum_a0_bitarrays[odd_even][sum_a0]);
-        }
-    }
-    for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
-        for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
-            uint16_t sum_a0 = 2 * p * (16 - 2 * q) + (16 - 2 * p) * 2 * q;
-            uint16_t sum_a0_idx = 0;
-            while (sums[sum_a0_idx] != sum_a0) sum_a0_idx++;
-            bitarray_OR(sum_a0_bitarrays[EVEN_STATE][sum_a0_idx], part_sum_a0_bitarrays[EVEN_STATE][q]);
-            bitarray_OR(sum_a0_bitarrays[ODD_STATE][sum_a0_idx], part_sum_a0_bitarrays[ODD_STATE][p]);
+            clear_bitarray24(bitset);
+            for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
+                for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
+                    if (sums[sum_a0] == 2 * p * (16 - 2 * q) + (16 - 2 * p) * 2 * q) {
+                        bitarray_OR(bitset, part_sum_a0_bitarrays[odd_even][odd_even == ODD_STATE ? p : q]);
+                    }
+                }
+            }
+
+            if (low_memory) {
+                buffer = bitset;
+                sparse_sum_a0_bitarrays[odd_even][sum_a0] = sparse_bitarray_from_dense(bitset);
+                if (sparse_sum_a0_bitarrays[odd_even][sum_a0] == NULL) {
+                    PrintAndLogEx(ERR, "Out of memory error in init_sum_bitarrays(). Aborting...\n");
+                    exit(4);
+                }
+                sparse_size += sparse_bitarray_size(sparse_sum_a0_bitarrays[odd_even][sum_a0]);
+            } else {
+                sum_a0_bitarrays[odd_even][sum_a0] = bitset;
+            }
         }
     }
 
+    if (buffer != NULL) {
+        free_bitarray(buffer);
+        char progress_text[80];
+        snprintf(progress_text, sizeof(progress_text), "Low memory: sum state tables compressed to %zu kB", sparse_size / 1024);
+        hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+    }
 }
 
 static void free_sum_bitarrays(void) {
     for (int8_t sum_a0 = NUM_SUMS - 1; sum_a0 >= 0; sum_a0--) {
-        free_bitarray(sum_a0_bitarrays[ODD_STATE][sum_a0]);
-        free_bitarray(sum_a0_bitarrays[EVEN_STATE][sum_a0]);
+        free_table_bitarray(sum_a0_bitarrays[ODD_STATE][sum_a0]);
+        free_table_bitarray(sum_a0_bitarrays[EVEN_STATE][sum_a0]);
+        sparse_bitarray_free(sparse_sum_a0_bitarrays[ODD_STATE][sum_a0]);
+        sparse_bitarray_free(sparse_sum_a0_bitarrays[EVEN_STATE][sum_a0]);
+    }
+    memset(sparse_sum_a0_bitarrays, 0, sizeof(sparse_sum_a0_bitarrays));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// on-disk cache of the bitflip and sum property bitarrays
+
+#define CACHE_BITFLIP(odd_even, bitflip)        ((odd_even) * 0x400 + (bitflip))
+#define CACHE_PART_SUM_A0(odd_even, part_sum)   (2 * 0x400 + (odd_even) * NUM_PART_SUMS + (part_sum))
+#define CACHE_PART_SUM_A8(odd_even, part_sum)   (2 * 0x400 + (2 + (odd_even)) * NUM_PART_SUMS + (part_sum))
+#define CACHE_SUM_A0(odd_even, sum)             (2 * 0x400 + 4 * NUM_PART_SUMS + (odd_even) * NUM_SUMS + (sum))
+#define NUM_CACHE_TABLES                        (2 * 0x400 + 4 * NUM_PART_SUMS + 2 * NUM_SUMS)
+
+static char *tables_cache_dir = NULL;
+
+void hardnested_set_cache_dir(const char *dir) {
+    free(tables_cache_dir);
+    tables_cache_dir = (dir != NULL) ? strdup(dir) : NULL;
+}
+
+// identifies the compressed bitflip tables a cache was expanded from
+static uint64_t bitflip_tables_fingerprint(void) {
+    uint64_t hash = TABLES_CACHE_HASH_INIT;
+    float threshold = IGNORE_BITFLIP_THRESHOLD;
+    hash = tables_cache_hash(hash, &threshold, sizeof(threshold));
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
+            bitflip_info p = get_bitflip(odd_even, bitflip);
+            if (p.input_buffer != NULL) {
+                hash = tables_cache_hash(hash, &bitflip, sizeof(bitflip));
+                hash = tables_cache_hash(hash, &p.len, sizeof(p.len));
+                hash = tables_cache_hash(hash, p.input_buffer, p.len);
+            }
+        }
+    }
+    return hash;
+}
+
+static bool load_cached_tables(uint64_t fingerprint) {
+    if (!tables_cache_open(tables_cache_dir, fingerprint, NUM_CACHE_TABLES)) {
+        return false;
+    }
+    bool complete = true;
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
+            bitflip_bitarrays[odd_even][bitflip] = tables_cache_get(CACHE_BITFLIP(odd_even, bitflip), &count_bitflip_bitarrays[odd_even][bitflip]);
+        }
+        for (uint16_t part_sum = 0; part_sum < NUM_PART_SUMS; part_sum++) {
+            part_sum_a0_bitarrays[odd_even][part_sum] = tables_cache_get(CACHE_PART_SUM_A0(odd_even, part_sum), NULL);
+            part_sum_a8_bitarrays[odd_even][part_sum] = tables_cache_get(CACHE_PART_SUM_A8(odd_even, part_sum), NULL);
+            complete &= part_sum_a0_bitarrays[odd_even][part_sum] != NULL && part_sum_a8_bitarrays[odd_even][part_sum] != NULL;
+        }
+        for (uint16_t sum = 0; sum < NUM_SUMS; sum++) {
+            sum_a0_bitarrays[odd_even][sum] = tables_cache_get(CACHE_SUM_A0(odd_even, sum), NULL);
+            complete &= sum_a0_bitarrays[odd_even][sum] != NULL;
+        }
+    }
+    if (!complete) {
+        tables_cache_close();
+        memset(bitflip_bitarrays, 0, sizeof(bitflip_bitarrays));
+        memset(part_sum_a0_bitarrays, 0, sizeof(part_sum_a0_bitarrays));
+        memset(part_sum_a8_bitarrays, 0, sizeof(part_sum_a8_bitarrays));
+        memset(sum_a0_bitarrays, 0, sizeof(sum_a0_bitarrays));
     }
+    return complete;
+}
+
+static void save_cached_tables(uint64_t fingerprint) {
+    cached_table_t *tables = (cached_table_t *)calloc(NUM_CACHE_TABLES, sizeof(cached_table_t));
+    if (tables == NULL) {
+        return;
+    }
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
+            tables[CACHE_BITFLIP(odd_even, bitflip)].bitarray = bitflip_bitarrays[odd_even][bitflip];
+            tables[CACHE_BITFLIP(odd_even, bitflip)].count = count_bitflip_bitarrays[odd_even][bitflip];
+        }
+        for (uint16_t part_sum = 0; part_sum < NUM_PART_SUMS; part_sum++) {
+            tables[CACHE_PART_SUM_A0(odd_even, part_sum)].bitarray = part_sum_a0_bitarrays[odd_even][part_sum];
+            tables[CACHE_PART_SUM_A8(odd_even, part_sum)].bitarray = part_sum_a8_bitarrays[odd_even][part_sum];
+        }
+        for (uint16_t sum = 0; sum < NUM_SUMS; sum++) {
+            tables[CACHE_SUM_A0(odd_even, sum)].bitarray = sum_a0_bitarrays[odd_even][sum];
+        }
+    }
+    if (tables_cache_write(tables_cache_dir, fingerprint, tables, NUM_CACHE_TABLES)) {
+        hardnested_print_progress(0, "Wrote the tables cache", (float)(1LL << 47), 0);
+    } else {
+        PrintAndLogEx(WARNING, "Could not write the tables cache to %s", tables_cache_dir);
+    }
+    free(tables);
+}
+
+// The tables mapped from the cache are checked against their checksum when an attack first uses
+// them. A corrupt one is expanded again in place, the mapping being copy-on-write, and the cache
+// file removed for the next run to rebuild it.
+static pthread_mutex_t cached_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void inflate_bitflip_bitarray(uint32_t *bitset, odd_even_t odd_even, uint16_t bitflip) {
+    lzma_stream strm = LZMA_STREAM_INIT;
+    uint32_t count = 0;
+    bitflip_info p = get_bitflip(odd_even, bitflip);
+    lzma_init_inflate(&strm, p.input_buffer, p.len, (uint8_t *)&count, sizeof(count));
+    strm.next_out = (uint8_t *)bitset;
+    strm.avail_out = sizeof(uint32_t) * (1 << 19);
+    decompress(&strm);
+    lzma_end(&strm);
+}
+
+// the states of the part sums (a bit each) of Sum(a0), or Sum(a8) with a8, as
+// init_part_sum_bitarrays() and init_sum_bitarrays() set them
+static void fill_part_sum_bitarray(uint32_t *bitarray, odd_even_t odd_even, bool a8, uint16_t part_sums) {
+    clear_bitarray24(bitarray);
+    for (uint32_t state = 0; state < (1 << 20); state++) {
+        if ((part_sums >> (PartialSumProperty(state, odd_even) / 2)) & 1) {
+            for (uint16_t bits = 0; bits < 1 << 4; bits++) {
+                set_bit24(bitarray, a8 ? (state | bits << 20) : (state << 4 | bits));
+            }
+        }
+    }
+}
+
+static void expand_cached_table(uint32_t id, uint32_t *bitarray) {
+    if (id < CACHE_PART_SUM_A0(EVEN_STATE, 0)) {
+        inflate_bitflip_bitarray(bitarray, id / 0x400, id % 0x400);
+    } else if (id < CACHE_SUM_A0(EVEN_STATE, 0)) {
+        uint32_t i = id - CACHE_PART_SUM_A0(EVEN_STATE, 0);
+        fill_part_sum_bitarray(bitarray, i / NUM_PART_SUMS % 2, i >= 2 * NUM_PART_SUMS, 1 << (i % NUM_PART_SUMS));
+    } else {
+        uint32_t i = id - CACHE_SUM_A0(EVEN_STATE, 0);
+        odd_even_t odd_even = i / NUM_SUMS;
+        uint16_t part_sums = 0;
+        for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
+            for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
+                if (sums[i % NUM_SUMS] == 2 * p * (16 - 2 * q) + (16 - 2 * p) * 2 * q) {
+                    part_sums |= 1 << ((odd_even == EVEN_STATE) ? q : p);
+                }
+            }
+        }
+        fill_part_sum_bitarray(bitarray, odd_even, false, part_sums);
+    }
+}
+
+static void check_cached_table(uint32_t id, uint32_t *bitarray) {
+    if (!tables_cache_contains(bitarray)) {
+        return;
+    }
+    pthread_mutex_lock(&cached_table_mutex);
+    if (!tables_cache_check(id)) {
+        PrintAndLogEx(WARNING, "Table %u of the tables cache in %s is corrupt, expanding it again. The next run rebuilds the cache", id, tables_cache_dir);
+        expand_cached_table(id, bitarray);
+    }
+    pthread_mutex_unlock(&cached_table_mutex);
+}
+
+// states &= the bitflip table, returns the states left
+static uint32_t count_bitflip_AND(uint32_t *states, odd_even_t odd_even, uint16_t bitflip) {
+    if (sparse_bitflip_bitarrays[odd_even][bitflip] != NULL) {
+        return count_bitarray_AND_sparse(states, sparse_bitflip_bitarrays[odd_even][bitflip]);
+    }
+    check_cached_table(CACHE_BITFLIP(odd_even, bitflip), bitflip_bitarrays[odd_even][bitflip]);
+    return count_bitarray_AND(states, bitflip_bitarrays[odd_even][bitflip]);
+}
+
+// Expand the bitflip tables and compute the sum property bitarrays, or map them from the
+// cache when one is set and matches the compressed tables. A missing or stale cache is rebuilt.
+// The cache holds dense tables only and isn't used with low_memory.
+static bool tables_cached = false;
+
+static void init_tables(void) {
+    uint64_t fingerprint = 0;
+    bool use_cache = tables_cache_dir != NULL && !low_memory;
+    tables_cached = false;
+    if (use_cache) {
+        fingerprint = bitflip_tables_fingerprint();
+        if (load_cached_tables(fingerprint)) {
+            tables_cached = true;
+            init_effective_bitflips(true);
+            return;
+        }
+    }
+    init_bitflip_bitarrays();
+    init_effective_bitflips(false);
+    init_part_sum_bitarrays();
+    init_sum_bitarrays();
+    if (use_cache) {
+        save_cached_tables(fingerprint);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// brute force benchmark, measured once per host
+
+static bool rebenchmark = false;
+
+void hardnested_set_rebenchmark(bool force) {
+    rebenchmark = force;
+}
+
+// next to the tables cache when there is one, in the per user cache otherwise
+static bool benchmark_cache_dir(char *dir, size_t len) {
+    if (tables_cache_dir != NULL) {
+        snprintf(dir, len, "%s", tables_cache_dir);
+        return true;
+    }
+    return bench_cache_default_dir(dir, len);
+}
+
+float hardnested_benchmark(bool force) {
+    char dir[512], key[256], cpu_model[128];
+    char instr_set[12] = "";
+    get_SIMD_instruction_set(instr_set);
+    bench_cache_cpu_model(cpu_model, sizeof(cpu_model));
+    snprintf(key, sizeof(key), "%s, %s SIMD, %u threads", cpu_model, instr_set, get_brute_force_threads());
+
+    float rate;
+    bool have_dir = benchmark_cache_dir(dir, sizeof(dir));
+    if (have_dir && !force && bench_cache_load(dir, key, &rate)) {
+        return rate;
+    }
+    rate = brute_force_benchmark();
+    if (have_dir && !bench_cache_store(dir, key, rate)) {
+        PrintAndLogEx(WARNING, "Could not store the brute force benchmark in %s", dir);
+    }
+    return rate;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// session: the tables and the benchmark shared by the attacks between hardnested_begin() and hardnested_end()
+
+static bool session_open = false;
+static float session_brute_force_per_second = 0;
+
+static void init_table_pointers(void) {
+    memset(bitflip_bitarrays, 0, sizeof(bitflip_bitarrays));
+    memset(sparse_bitflip_bitarrays, 0, sizeof(sparse_bitflip_bitarrays));
+    memset(count_bitflip_bitarrays, 0, sizeof(count_bitflip_bitarrays));
+    memset(part_sum_a0_bitarrays, 0, sizeof(part_sum_a0_bitarrays));
+    memset(part_sum_a8_bitarrays, 0, sizeof(part_sum_a8_bitarrays));
+    memset(sum_a0_bitarrays, 0, sizeof(sum_a0_bitarrays));
+    memset(sparse_sum_a0_bitarrays, 0, sizeof(sparse_sum_a0_bitarrays));
+}
+
+static uint32_t *copy_table_bitarray(const uint32_t *bitarray) {
+    uint32_t *copy = (uint32_t *) malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+    if (copy == NULL) {
+        PrintAndLogEx(ERR, "Out of memory error in copy_table_bitarray(). Aborting...\n");
+        exit(4);
+    }
+    memcpy(copy, bitarray, sizeof(uint32_t) * (1 << 19));
+    return copy;
+}
+
+// The part sum bitarrays an attack narrows down: copies of the tables in a session, which stay as
+// initialized for the next attack, the tables themselves otherwise.
+static void init_job_part_sums(hardnested_job_t *job) {
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        for (uint16_t part_sum = 0; part_sum < NUM_PART_SUMS; part_sum++) {
+            check_cached_table(CACHE_PART_SUM_A0(odd_even, part_sum), part_sum_a0_bitarrays[odd_even][part_sum]);
+            check_cached_table(CACHE_PART_SUM_A8(odd_even, part_sum), part_sum_a8_bitarrays[odd_even][part_sum]);
+            if (session_open) {
+                job->part_sum_a0_bitarrays[odd_even][part_sum] = copy_table_bitarray(part_sum_a0_bitarrays[odd_even][part_sum]);
+                job->part_sum_a8_bitarrays[odd_even][part_sum] = copy_table_bitarray(part_sum_a8_bitarrays[odd_even][part_sum]);
+            } else {
+                job->part_sum_a0_bitarrays[odd_even][part_sum] = part_sum_a0_bitarrays[odd_even][part_sum];
+                job->part_sum_a8_bitarrays[odd_even][part_sum] = part_sum_a8_bitarrays[odd_even][part_sum];
+            }
+        }
+    }
+    if (!session_open) {
+        memset(part_sum_a0_bitarrays, 0, sizeof(part_sum_a0_bitarrays));
+        memset(part_sum_a8_bitarrays, 0, sizeof(part_sum_a8_bitarrays));
+    }
+}
+
+static void free_job_part_sums(hardnested_job_t *job) {
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        for (uint16_t part_sum = 0; part_sum < NUM_PART_SUMS; part_sum++) {
+            free_table_bitarray(job->part_sum_a0_bitarrays[odd_even][part_sum]);
+            free_table_bitarray(job->part_sum_a8_bitarrays[odd_even][part_sum]);
+        }
+    }
+    memset(job->part_sum_a0_bitarrays, 0, sizeof(job->part_sum_a0_bitarrays));
+    memset(job->part_sum_a8_bitarrays, 0, sizeof(job->part_sum_a8_bitarrays));
+}
+
+void hardnested_begin(void) {
+    if (session_open) {
+        return;
+    }
+    init_table_pointers();
+    session_brute_force_per_second = hardnested_benchmark(rebenchmark);
+    init_tables();
+    session_open = true;
+}
+
+void hardnested_end(void) {
+    if (!session_open) {
+        return;
+    }
+    session_open = false;
+    free_bitflip_bitarrays();
+    free_part_sum_bitarrays();
+    free_sum_bitarrays();
+    tables_cache_close();
+    init_table_pointers();
 }
 
 #ifdef DEBUG_KEY_ELIMINATION
@@ -444,33 +830,32 @@ static const float p_K0[NUM_SUMS] = { // the probability that a random nonce has
     0.0290, 0.0083, 0.0006, 0.0339, 0.0048, 0.0934, 0.0119, 0.0489, 0.0602, 0.4180, 0.0602, 0.0489, 0.0119, 0.0934,
     0.0048, 0.0339, 0.0006, 0.0083, 0.0290
 };
-static float my_p_K[NUM_SUMS];
-static const float *p_K;
-
-static uint32_t cuid;
-static noncelist_t nonces[256];
-static uint8_t best_first_bytes[256];
-static uint64_t maximum_states = 0;
-static uint8_t best_first_byte_smallest_bitarray = 0;
-static uint16_t first_byte_Sum = 0;
-static uint16_t first_byte_num = 0;
+
 static bool write_stats = false;
-static uint32_t *all_bitflips_bitarray[2];
-static uint32_t num_all_bitflips_bitarray[2];
-static bool all_bitflips_bitarray_dirty[2];
-static uint64_t last_sample_clock = 0;
-static uint64_t sample_period = 0;
-static uint64_t num_keys_tested = 0;
-static statelist_t *candidates = NULL;
-
-static int add_nonce(uint32_t nonce_enc, uint8_t par_enc) {
+
+// all states possible for a 1st byte just seen. Until then the byte has no bitarrays,
+// nothing reads them before the bitflip properties of its nonces are checked
+static void init_states_bitarrays(hardnested_job_t *job, uint8_t first_byte) {
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        job->nonces[first_byte].states_bitarray[odd_even] = (uint32_t *) malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+        if (job->nonces[first_byte].states_bitarray[odd_even] == NULL) {
+            PrintAndLogEx(ERR, "Out of memory error in init_states_bitarrays(). Aborting...\n");
+            exit(4);
+        }
+        set_bitarray24(job->nonces[first_byte].states_bitarray[odd_even]);
+        job->nonces[first_byte].num_states_bitarray[odd_even] = 1 << 24;
+    }
+}
+
+static int add_nonce(hardnested_job_t *job, uint32_t nonce_enc, uint8_t par_enc) {
     uint8_t first_byte = nonce_enc >> 24;
-    noncelistentry_t *p1 = nonces[first_byte].first;
+    noncelistentry_t *p1 = job->nonces[first_byte].first;
     noncelistentry_t *p2 = NULL;
 
     if (p1 == NULL) { // first nonce with this 1st byte
-        first_byte_num++;
-        first_byte_Sum += evenparity32((nonce_enc & 0xff000000) | (par_enc & 0x08));
+        init_states_bitarrays(job, first_byte);
+        job->first_byte_num++;
+        job->first_byte_Sum += evenparity32((nonce_enc & 0xff000000) | (par_enc & 0x08));
     }
 
     while (p1 != NULL && (p1->nonce_enc & 0x00ff0000) < (nonce_enc & 0x00ff0000)) {
@@ -480,14 +865,14 @@ static int add_nonce(uint32_t nonce_enc, uint8_t par_enc) {
 
     if (p1 == NULL) {                                                          // need to add at the end of the list
         if (p2 == NULL) {           // list is empty yet. Add first entry.
-            p2 = nonces[first_byte].first = calloc(1, sizeof(noncelistentry_t));
+            p2 = job->nonces[first_byte].first = calloc(1, sizeof(noncelistentry_t));
         } else {                    // add new entry at end of existing list.
             p2 = p2->next = calloc(1, sizeof(noncelistentry_t));
         }
     } else if ((p1->nonce_enc & 0x00ff0000) !=
                (nonce_enc & 0x00ff0000)) {     // found distinct 2nd byte. Need to insert.
         if (p2 == NULL) {           // need to insert at start of list
-            p2 = nonces[first_byte].first = calloc(1, sizeof(noncelistentry_t));
+            p2 = job->nonces[first_byte].first = calloc(1, sizeof(noncelistentry_t));
         } else {
             p2 = p2->next = calloc(1, sizeof(noncelistentry_t));
         }
@@ -500,44 +885,35 @@ static int add_nonce(uint32_t nonce_enc, uint8_t par_enc) {
     p2->nonce_enc = nonce_enc;
     p2->par_enc = par_enc;
 
-    nonces[first_byte].num++;
-    nonces[first_byte].Sum += evenparity32((nonce_enc & 0x00ff0000) | (par_enc & 0x04));
-    nonces[first_byte].sum_a8_guess_dirty = true;   // indicates that we need to recalculate the Sum(a8) probability for this first byte
+    job->nonces[first_byte].num++;
+    job->nonces[first_byte].Sum += evenparity32((nonce_enc & 0x00ff0000) | (par_enc & 0x04));
+    job->nonces[first_byte].sum_a8_guess_dirty = true;   // indicates that we need to recalculate the Sum(a8) probability for this first byte
     return (1); // new nonce added
 }
 
-static void init_nonce_memory(void) {
+static void init_nonce_memory(hardnested_job_t *job) {
     for (uint16_t i = 0; i < 256; i++) {
-        nonces[i].num = 0;
-        nonces[i].Sum = 0;
-        nonces[i].first = NULL;
+        job->nonces[i].num = 0;
+        job->nonces[i].Sum = 0;
+        job->nonces[i].first = NULL;
         for (uint8_t j = 0; j < NUM_SUMS; j++) {
-            nonces[i].sum_a8_guess[j].sum_a8_idx = j;
-            nonces[i].sum_a8_guess[j].prob = 0.0;
+            job->nonces[i].sum_a8_guess[j].sum_a8_idx = j;
+            job->nonces[i].sum_a8_guess[j].prob = 0.0;
         }
-        nonces[i].sum_a8_guess_dirty = false;
+        job->nonces[i].sum_a8_guess_dirty = false;
         for (uint16_t bitflip = 0x000; bitflip < 0x400; bitflip++) {
-            nonces[i].BitFlips[bitflip] = 0;
-        }
-        nonces[i].states_bitarray[EVEN_STATE] = (uint32_t *) malloc_bitarray(sizeof(uint32_t) * (1 << 19));
-        if (nonces[i].states_bitarray[EVEN_STATE] == NULL) {
-            PrintAndLogEx(ERR, "Out of memory error in init_nonce_memory(). Aborting...\n");
-            exit(4);
+            job->nonces[i].BitFlips[bitflip] = 0;
         }
-        set_bitarray24(nonces[i].states_bitarray[EVEN_STATE]);
-        nonces[i].num_states_bitarray[EVEN_STATE] = 1 << 24;
-        nonces[i].states_bitarray[ODD_STATE] = (uint32_t *) malloc_bitarray(sizeof(uint32_t) * (1 << 19));
-        if (nonces[i].states_bitarray[ODD_STATE] == NULL) {
-            PrintAndLogEx(ERR, "Out of memory error in init_nonce_memory(). Aborting...\n");
-            exit(4);
-        }
-        set_bitarray24(nonces[i].states_bitarray[ODD_STATE]);
-        nonces[i].num_states_bitarray[ODD_STATE] = 1 << 24;
-        nonces[i].all_bitflips_dirty[EVEN_STATE] = false;
-        nonces[i].all_bitflips_dirty[ODD_STATE] = false;
+        // allocated by add_nonce() with the first nonce of this 1st byte
+        job->nonces[i].states_bitarray[EVEN_STATE] = NULL;
+        job->nonces[i].num_states_bitarray[EVEN_STATE] = 1 << 24;
+        job->nonces[i].states_bitarray[ODD_STATE] = NULL;
+        job->nonces[i].num_states_bitarray[ODD_STATE] = 1 << 24;
+        job->nonces[i].all_bitflips_dirty[EVEN_STATE] = false;
+        job->nonces[i].all_bitflips_dirty[ODD_STATE] = false;
     }
-    first_byte_num = 0;
-    first_byte_Sum = 0;
+    job->first_byte_num = 0;
+    job->first_byte_Sum = 0;
 }
 
 static void free_nonce_list(noncelistentry_t *p) {
@@ -549,13 +925,15 @@ static void free_nonce_list(noncelistentry_t *p) {
     }
 }
 
-static void free_nonces_memory(void) {
+static void free_nonces_memory(hardnested_job_t *job) {
     for (uint16_t i = 0; i < 256; i++) {
-        free_nonce_list(nonces[i].first);
+        free_nonce_list(job->nonces[i].first);
     }
     for (int i = 255; i >= 0; i--) {
-        free_bitarray(nonces[i].states_bitarray[ODD_STATE]);
-        free_bitarray(nonces[i].states_bitarray[EVEN_STATE]);
+        free_bitarray(job->nonces[i].states_bitarray[ODD_STATE]);
+        free_bitarray(job->nonces[i].states_bitarray[EVEN_STATE]);
+        job->nonces[i].states_bitarray[ODD_STATE] = NULL;
+        job->nonces[i].states_bitarray[EVEN_STATE] = NULL;
     }
 }
 
@@ -607,46 +985,44 @@ static double p_hypergeometric(uint16_t i_K, uint16_t n, uint16_t k) {
     }
 }
 
-static float sum_probability(uint16_t i_K, uint16_t n, uint16_t k) {
+static float sum_probability(hardnested_job_t *job, uint16_t i_K, uint16_t n, uint16_t k) {
     if (k > sums[i_K]) {
         return 0.0;
     }
 
     double p_T_is_k_when_S_is_K = p_hypergeometric(i_K, n, k);
-    double p_S_is_K = p_K[i_K];
+    double p_S_is_K = job->p_K[i_K];
     double p_T_is_k = 0;
     for (uint8_t i = 0; i < NUM_SUMS; i++) {
-        p_T_is_k += p_K[i] * p_hypergeometric(i, n, k);
+        p_T_is_k += job->p_K[i] * p_hypergeometric(i, n, k);
     }
     return (p_T_is_k_when_S_is_K * p_S_is_K / p_T_is_k);
 }
 
-static uint32_t part_sum_count[2][NUM_PART_SUMS][NUM_PART_SUMS];
-
-static void init_allbitflips_array(void) {
+static void init_allbitflips_array(hardnested_job_t *job) {
     for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
-        uint32_t *bitset = all_bitflips_bitarray[odd_even] = (uint32_t *) malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+        uint32_t *bitset = job->all_bitflips_bitarray[odd_even] = (uint32_t *) malloc_bitarray(sizeof(uint32_t) * (1 << 19));
         if (bitset == NULL) {
             PrintAndLogEx(WARNING, "Out of memory in init_allbitflips_array(). Aborting...");
             exit(4);
         }
         set_bitarray24(bitset);
-        all_bitflips_bitarray_dirty[odd_even] = false;
-        num_all_bitflips_bitarray[odd_even] = 1 << 24;
+        job->all_bitflips_bitarray_dirty[odd_even] = false;
+        job->num_all_bitflips_bitarray[odd_even] = 1 << 24;
     }
 }
 
-static void update_allbitflips_array(void) {
-    if (hardnested_stage & CHECK_2ND_BYTES) {
+static void update_allbitflips_array(hardnested_job_t *job) {
+    if (job->stage & CHECK_2ND_BYTES) {
         for (uint16_t i = 0; i < 256; i++) {
             for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
-                if (nonces[i].all_bitflips_dirty[odd_even]) {
-                    uint32_t old_count = num_all_bitflips_bitarray[odd_even];
-                    num_all_bitflips_bitarray[odd_even] = count_bitarray_low20_AND(all_bitflips_bitarray[odd_even],
-                                                          nonces[i].states_bitarray[odd_even]);
-                    nonces[i].all_bitflips_dirty[odd_even] = false;
-                    if (num_all_bitflips_bitarray[odd_even] != old_count) {
-                        all_bitflips_bitarray_dirty[odd_even] = true;
+                if (job->nonces[i].all_bitflips_dirty[odd_even]) {
+                    uint32_t old_count = job->num_all_bitflips_bitarray[odd_even];
+                    job->num_all_bitflips_bitarray[odd_even] = count_bitarray_low20_AND(job->all_bitflips_bitarray[odd_even],
+                                                          job->nonces[i].states_bitarray[odd_even]);
+                    job->nonces[i].all_bitflips_dirty[odd_even] = false;
+                    if (job->num_all_bitflips_bitarray[odd_even] != old_count) {
+                        job->all_bitflips_bitarray_dirty[odd_even] = true;
                     }
                 }
             }
@@ -655,21 +1031,21 @@ static void update_allbitflips_array(void) {
 }
 
 static uint32_t
-estimated_num_states_part_sum_coarse(uint16_t part_sum_a0_idx, uint16_t part_sum_a8_idx, odd_even_t odd_even) {
-    return part_sum_count[odd_even][part_sum_a0_idx][part_sum_a8_idx];
+estimated_num_states_part_sum_coarse(hardnested_job_t *job, uint16_t part_sum_a0_idx, uint16_t part_sum_a8_idx, odd_even_t odd_even) {
+    return job->part_sum_count[odd_even][part_sum_a0_idx][part_sum_a8_idx];
 }
 
-static uint32_t estimated_num_states_part_sum(uint8_t first_byte, uint16_t part_sum_a0_idx, uint16_t part_sum_a8_idx,
+static uint32_t estimated_num_states_part_sum(hardnested_job_t *job, uint8_t first_byte, uint16_t part_sum_a0_idx, uint16_t part_sum_a8_idx,
         odd_even_t odd_even) {
     if (odd_even == ODD_STATE) {
-        return count_bitarray_AND3(part_sum_a0_bitarrays[odd_even][part_sum_a0_idx],
-                                   part_sum_a8_bitarrays[odd_even][part_sum_a8_idx],
-                                   nonces[first_byte].states_bitarray[odd_even]);
+        return count_bitarray_AND3(job->part_sum_a0_bitarrays[odd_even][part_sum_a0_idx],
+                                   job->part_sum_a8_bitarrays[odd_even][part_sum_a8_idx],
+                                   job->nonces[first_byte].states_bitarray[odd_even]);
     } else {
-        return count_bitarray_AND4(part_sum_a0_bitarrays[odd_even][part_sum_a0_idx],
-                                   part_sum_a8_bitarrays[odd_even][part_sum_a8_idx],
-                                   nonces[first_byte].states_bitarray[odd_even],
-                                   nonces[first_byte ^ 0x80].states_bitarray[odd_even]);
+        return count_bitarray_AND4(job->part_sum_a0_bitarrays[odd_even][part_sum_a0_idx],
+                                   job->part_sum_a8_bitarrays[odd_even][part_sum_a8_idx],
+                                   job->nonces[first_byte].states_bitarray[odd_even],
+                                   job->nonces[first_byte ^ 0x80].states_bitarray[odd_even]);
     }
 
     // estimate reduction by all_bitflips_match()
@@ -681,7 +1057,7 @@ static uint32_t estimated_num_states_part_sum(uint8_t first_byte, uint16_t part_
     // }
 }
 
-static uint64_t estimated_num_states(uint8_t first_byte, uint16_t sum_a0, uint16_t sum_a8) {
+static uint64_t estimated_num_states(hardnested_job_t *job, uint8_t first_byte, uint16_t sum_a0, uint16_t sum_a8) {
     uint64_t num_states = 0;
     for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
         for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
@@ -689,8 +1065,8 @@ static uint64_t estimated_num_states(uint8_t first_byte, uint16_t sum_a0, uint16
                 for (uint8_t r = 0; r < NUM_PART_SUMS; r++) {
                     for (uint8_t s = 0; s < NUM_PART_SUMS; s++) {
                         if (2 * r * (16 - 2 * s) + (16 - 2 * r) * 2 * s == sum_a8) {
-                            num_states += (uint64_t) estimated_num_states_part_sum(first_byte, p, r, ODD_STATE) *
-                                          estimated_num_states_part_sum(first_byte, q, s, EVEN_STATE);
+                            num_states += (uint64_t) estimated_num_states_part_sum(job, first_byte, p, r, ODD_STATE) *
+                                          estimated_num_states_part_sum(job, first_byte, q, s, EVEN_STATE);
                         }
                     }
                 }
@@ -700,7 +1076,7 @@ static uint64_t estimated_num_states(uint8_t first_byte, uint16_t sum_a0, uint16
     return num_states;
 }
 
-static uint64_t estimated_num_states_coarse(uint16_t sum_a0, uint16_t sum_a8) {
+static uint64_t estimated_num_states_coarse(hardnested_job_t *job, uint16_t sum_a0, uint16_t sum_a8) {
     uint64_t num_states = 0;
     for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
         for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
@@ -708,8 +1084,8 @@ static uint64_t estimated_num_states_coarse(uint16_t sum_a0, uint16_t sum_a8) {
                 for (uint8_t r = 0; r < NUM_PART_SUMS; r++) {
                     for (uint8_t s = 0; s < NUM_PART_SUMS; s++) {
                         if (2 * r * (16 - 2 * s) + (16 - 2 * r) * 2 * s == sum_a8) {
-                            num_states += (uint64_t) estimated_num_states_part_sum_coarse(p, r, ODD_STATE) *
-                                          estimated_num_states_part_sum_coarse(q, s, EVEN_STATE);
+                            num_states += (uint64_t) estimated_num_states_part_sum_coarse(job, p, r, ODD_STATE) *
+                                          estimated_num_states_part_sum_coarse(job, q, s, EVEN_STATE);
                         }
                     }
                 }
@@ -719,52 +1095,55 @@ static uint64_t estimated_num_states_coarse(uint16_t sum_a0, uint16_t sum_a8) {
     return num_states;
 }
 
-static void update_p_K(void) {
-    if (hardnested_stage & CHECK_2ND_BYTES) {
+static void update_p_K(hardnested_job_t *job) {
+    if (job->stage & CHECK_2ND_BYTES) {
         uint64_t total_count = 0;
-        uint16_t sum_a0 = sums[first_byte_Sum];
+        uint16_t sum_a0 = sums[job->first_byte_Sum];
         for (uint8_t sum_a8_idx = 0; sum_a8_idx < NUM_SUMS; sum_a8_idx++) {
             uint16_t sum_a8 = sums[sum_a8_idx];
-            total_count += estimated_num_states_coarse(sum_a0, sum_a8);
+            total_count += estimated_num_states_coarse(job, sum_a0, sum_a8);
         }
         for (uint8_t sum_a8_idx = 0; sum_a8_idx < NUM_SUMS; sum_a8_idx++) {
             uint16_t sum_a8 = sums[sum_a8_idx];
-            float f = estimated_num_states_coarse(sum_a0, sum_a8);
-            my_p_K[sum_a8_idx] = f / total_count;
+            float f = estimated_num_states_coarse(job, sum_a0, sum_a8);
+            job->p_K[sum_a8_idx] = f / total_count;
         }
-        // PrintAndLogEx(INFO,  "my_p_K = [");
+        // PrintAndLogEx(INFO,  "p_K = [");
         // for (uint8_t sum_a8_idx = 0; sum_a8_idx < NUM_SUMS; sum_a8_idx++) {
-        // PrintAndLogEx(INFO, "%7.4f ", my_p_K[sum_a8_idx]);
+        // PrintAndLogEx(INFO, "%7.4f ", job->p_K[sum_a8_idx]);
         // }
-        p_K = my_p_K;
     }
 }
 
-static void update_sum_bitarrays(odd_even_t odd_even) {
-    if (all_bitflips_bitarray_dirty[odd_even]) {
+static void update_sum_bitarrays(hardnested_job_t *job, odd_even_t odd_even) {
+    if (job->all_bitflips_bitarray_dirty[odd_even]) {
         for (uint8_t part_sum = 0; part_sum < NUM_PART_SUMS; part_sum++) {
-            bitarray_AND(part_sum_a0_bitarrays[odd_even][part_sum], all_bitflips_bitarray[odd_even]);
-            bitarray_AND(part_sum_a8_bitarrays[odd_even][part_sum], all_bitflips_bitarray[odd_even]);
+            bitarray_AND(job->part_sum_a0_bitarrays[odd_even][part_sum], job->all_bitflips_bitarray[odd_even]);
+            bitarray_AND(job->part_sum_a8_bitarrays[odd_even][part_sum], job->all_bitflips_bitarray[odd_even]);
         }
         for (uint16_t i = 0; i < 256; i++) {
-            nonces[i].num_states_bitarray[odd_even] = count_bitarray_AND(nonces[i].states_bitarray[odd_even],
-                all_bitflips_bitarray[odd_even]);
+            job->nonces[i].num_states_bitarray[odd_even] = count_bitarray_AND(job->nonces[i].states_bitarray[odd_even],
+                job->all_bitflips_bitarray[odd_even]);
         }
         for (uint8_t part_sum_a0 = 0; part_sum_a0 < NUM_PART_SUMS; part_sum_a0++) {
             for (uint8_t part_sum_a8 = 0; part_sum_a8 < NUM_PART_SUMS; part_sum_a8++) {
-                part_sum_count[odd_even][part_sum_a0][part_sum_a8] += count_bitarray_AND2(
-                        part_sum_a0_bitarrays[odd_even][part_sum_a0], part_sum_a8_bitarrays[odd_even][part_sum_a8]);
+                job->part_sum_count[odd_even][part_sum_a0][part_sum_a8] += count_bitarray_AND2(
+                        job->part_sum_a0_bitarrays[odd_even][part_sum_a0], job->part_sum_a8_bitarrays[odd_even][part_sum_a8]);
             }
         }
-        all_bitflips_bitarray_dirty[odd_even] = false;
+        job->all_bitflips_bitarray_dirty[odd_even] = false;
     }
 }
 
+// a first byte and its expected number of states to brute force, for sorting the best first bytes
+typedef struct {
+    float expected_num_brute_force;
+    uint8_t first_byte;
+} first_byte_score_t;
+
 static int compare_expected_num_brute_force(const void *b1, const void *b2) {
-    uint8_t index1 = *(uint8_t *) b1;
-    uint8_t index2 = *(uint8_t *) b2;
-    float score1 = nonces[index1].expected_num_brute_force;
-    float score2 = nonces[index2].expected_num_brute_force;
+    float score1 = ((first_byte_score_t *) b1)->expected_num_brute_force;
+    float score2 = ((first_byte_score_t *) b2)->expected_num_brute_force;
     return (score1 > score2) - (score1 < score2);
 }
 
@@ -775,78 +1154,86 @@ static int compare_sum_a8_guess(const void *b1, const void *b2) {
 
 }
 
-static float check_smallest_bitflip_bitarrays(void) {
+static float check_smallest_bitflip_bitarrays(hardnested_job_t *job) {
     uint64_t smallest = 1LL << 48;
     // initialize best_first_bytes, do a rough estimation on remaining states
     for (uint16_t i = 0; i < 256; i++) {
-        uint32_t num_odd = nonces[i].num_states_bitarray[ODD_STATE];
-        uint32_t num_even = nonces[i].num_states_bitarray[EVEN_STATE]; // * (float)nonces[i^0x80].num_states_bitarray[EVEN_STATE] / num_all_bitflips_bitarray[EVEN_STATE];
+        uint32_t num_odd = job->nonces[i].num_states_bitarray[ODD_STATE];
+        uint32_t num_even = job->nonces[i].num_states_bitarray[EVEN_STATE]; // * (float)nonces[i^0x80].num_states_bitarray[EVEN_STATE] / num_all_bitflips_bitarray[EVEN_STATE];
         if ((uint64_t) num_odd * num_even < smallest) {
             smallest = (uint64_t) num_odd * num_even;
-            best_first_byte_smallest_bitarray = i;
+            job->best_first_byte_smallest_bitarray = i;
         }
     }
 
 #if defined (DEBUG_REDUCTION)
-    uint32_t num_odd = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[ODD_STATE];
-    uint32_t num_even = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[EVEN_STATE]; // * (float)nonces[best_first_byte_smallest_bitarray^0x80].num_states_bitarray[EVEN_STATE] / num_all_bitflips_bitarray[EVEN_STATE];
-    PrintAndLogEx(INFO, "0x%02x: %8d * %8d = %12" PRIu64 " (2^%1.1f)\n", best_first_byte_smallest_bitarray, num_odd, num_even, (uint64_t)num_odd * num_even, log((uint64_t)num_odd * num_even) / log(2.0));
+    uint32_t num_odd = job->nonces[job->best_first_byte_smallest_bitarray].num_states_bitarray[ODD_STATE];
+    uint32_t num_even = job->nonces[job->best_first_byte_smallest_bitarray].num_states_bitarray[EVEN_STATE]; // * (float)nonces[best_first_byte_smallest_bitarray^0x80].num_states_bitarray[EVEN_STATE] / num_all_bitflips_bitarray[EVEN_STATE];
+    PrintAndLogEx(INFO, "0x%02x: %8d * %8d = %12" PRIu64 " (2^%1.1f)\n", job->best_first_byte_smallest_bitarray, num_odd, num_even, (uint64_t)num_odd * num_even, log((uint64_t)num_odd * num_even) / log(2.0));
 #endif
     return (float) smallest / 2.0;
 }
 
-static void update_expected_brute_force(uint8_t best_byte) {
+static void update_expected_brute_force(hardnested_job_t *job, uint8_t best_byte) {
 
     float total_prob = 0.0;
     for (uint8_t i = 0; i < NUM_SUMS; i++) {
-        total_prob += nonces[best_byte].sum_a8_guess[i].prob;
+        total_prob += job->nonces[best_byte].sum_a8_guess[i].prob;
     }
     // linear adjust probabilities to result in total_prob = 1.0;
     for (uint8_t i = 0; i < NUM_SUMS; i++) {
-        nonces[best_byte].sum_a8_guess[i].prob /= total_prob;
+        job->nonces[best_byte].sum_a8_guess[i].prob /= total_prob;
     }
     float prob_all_failed = 1.0;
-    nonces[best_byte].expected_num_brute_force = 0.0;
+    job->nonces[best_byte].expected_num_brute_force = 0.0;
     for (uint8_t i = 0; i < NUM_SUMS; i++) {
-        nonces[best_byte].expected_num_brute_force +=
-            nonces[best_byte].sum_a8_guess[i].prob * (float) nonces[best_byte].sum_a8_guess[i].num_states / 2.0;
-        prob_all_failed -= nonces[best_byte].sum_a8_guess[i].prob;
-        nonces[best_byte].expected_num_brute_force +=
-            prob_all_failed * (float) nonces[best_byte].sum_a8_guess[i].num_states / 2.0;
+        job->nonces[best_byte].expected_num_brute_force +=
+            job->nonces[best_byte].sum_a8_guess[i].prob * (float) job->nonces[best_byte].sum_a8_guess[i].num_states / 2.0;
+        prob_all_failed -= job->nonces[best_byte].sum_a8_guess[i].prob;
+        job->nonces[best_byte].expected_num_brute_force +=
+            prob_all_failed * (float) job->nonces[best_byte].sum_a8_guess[i].num_states / 2.0;
     }
     return;
 }
 
-static float sort_best_first_bytes(void) {
+static float sort_best_first_bytes(hardnested_job_t *job) {
 
     // initialize best_first_bytes, do a rough estimation on remaining states for each Sum_a8 property
     // and the expected number of states to brute force
     for (uint16_t i = 0; i < 256; i++) {
-        best_first_bytes[i] = i;
+        job->best_first_bytes[i] = i;
         float prob_all_failed = 1.0;
-        nonces[i].expected_num_brute_force = 0.0;
+        job->nonces[i].expected_num_brute_force = 0.0;
         for (uint8_t j = 0; j < NUM_SUMS; j++) {
-            nonces[i].sum_a8_guess[j].num_states = estimated_num_states_coarse(sums[first_byte_Sum],
-                                                   sums[nonces[i].sum_a8_guess[j].sum_a8_idx]);
-            nonces[i].expected_num_brute_force +=
-                nonces[i].sum_a8_guess[j].prob * (float) nonces[i].sum_a8_guess[j].num_states / 2.0;
-            prob_all_failed -= nonces[i].sum_a8_guess[j].prob;
-            nonces[i].expected_num_brute_force += prob_all_failed * (float) nonces[i].sum_a8_guess[j].num_states / 2.0;
+            job->nonces[i].sum_a8_guess[j].num_states = estimated_num_states_coarse(job, sums[job->first_byte_Sum],
+                                                   sums[job->nonces[i].sum_a8_guess[j].sum_a8_idx]);
+            job->nonces[i].expected_num_brute_force +=
+                job->nonces[i].sum_a8_guess[j].prob * (float) job->nonces[i].sum_a8_guess[j].num_states / 2.0;
+            prob_all_failed -= job->nonces[i].sum_a8_guess[j].prob;
+            job->nonces[i].expected_num_brute_force += prob_all_failed * (float) job->nonces[i].sum_a8_guess[j].num_states / 2.0;
         }
     }
 
     // sort based on expected number of states to brute force
-    qsort(best_first_bytes, 256, 1, compare_expected_num_brute_force);
+    first_byte_score_t scores[256];
+    for (uint16_t i = 0; i < 256; i++) {
+        scores[i].expected_num_brute_force = job->nonces[i].expected_num_brute_force;
+        scores[i].first_byte = i;
+    }
+    qsort(scores, 256, sizeof(first_byte_score_t), compare_expected_num_brute_force);
+    for (uint16_t i = 0; i < 256; i++) {
+        job->best_first_bytes[i] = scores[i].first_byte;
+    }
 
     // PrintAndLogEx(INFO, "refine estimations: ");
 #define NUM_REFINES 1
     // refine scores for the best:
     for (uint16_t i = 0; i < NUM_REFINES; i++) {
         // PrintAndLogEx(INFO, "%d...", i);
-        uint16_t first_byte = best_first_bytes[i];
-        for (uint8_t j = 0; j < NUM_SUMS && nonces[first_byte].sum_a8_guess[j].prob > 0.05; j++) {
-            nonces[first_byte].sum_a8_guess[j].num_states = estimated_num_states(first_byte, sums[first_byte_Sum],
-                sums[nonces[first_byte].sum_a8_guess[j].sum_a8_idx]);
+        uint16_t first_byte = job->best_first_bytes[i];
+        for (uint8_t j = 0; j < NUM_SUMS && job->nonces[first_byte].sum_a8_guess[j].prob > 0.05; j++) {
+            job->nonces[first_byte].sum_a8_guess[j].num_states = estimated_num_states(job, first_byte, sums[job->first_byte_Sum],
+                sums[job->nonces[first_byte].sum_a8_guess[j].sum_a8_idx]);
         }
         // while (nonces[first_byte].sum_a8_guess[0].num_states == 0
         // || nonces[first_byte].sum_a8_guess[1].num_states == 0
@@ -880,14 +1267,14 @@ static float sort_best_first_bytes(void) {
         // nonces[first_byte].sum_a8_guess[j].num_states = estimated_num_states(first_byte, sums[first_byte_Sum], sums[nonces[first_byte].sum_a8_guess[j].sum_a8_idx]);
         // }
         float prob_all_failed = 1.0;
-        nonces[first_byte].expected_num_brute_force = 0.0;
+        job->nonces[first_byte].expected_num_brute_force = 0.0;
         for (uint8_t j = 0; j < NUM_SUMS; j++) {
-            nonces[first_byte].expected_num_brute_force +=
-                nonces[first_byte].sum_a8_guess[j].prob * (float) nonces[first_byte].sum_a8_guess[j].num_states /
+            job->nonces[first_byte].expected_num_brute_force +=
+                job->nonces[first_byte].sum_a8_guess[j].prob * (float) job->nonces[first_byte].sum_a8_guess[j].num_states /
                 2.0;
-            prob_all_failed -= nonces[first_byte].sum_a8_guess[j].prob;
-            nonces[first_byte].expected_num_brute_force +=
-                prob_all_failed * (float) nonces[first_byte].sum_a8_guess[j].num_states / 2.0;
+            prob_all_failed -= job->nonces[first_byte].sum_a8_guess[j].prob;
+            job->nonces[first_byte].expected_num_brute_force +=
+                prob_all_failed * (float) job->nonces[first_byte].sum_a8_guess[j].num_states / 2.0;
         }
     }
 
@@ -895,25 +1282,25 @@ static float sort_best_first_bytes(void) {
     float least_expected_brute_force = (1LL << 48);
     uint8_t best_byte = 0;
     for (uint16_t i = 0; i < 10; i++) {
-        uint16_t first_byte = best_first_bytes[i];
-        if (nonces[first_byte].expected_num_brute_force < least_expected_brute_force) {
-            least_expected_brute_force = nonces[first_byte].expected_num_brute_force;
+        uint16_t first_byte = job->best_first_bytes[i];
+        if (job->nonces[first_byte].expected_num_brute_force < least_expected_brute_force) {
+            least_expected_brute_force = job->nonces[first_byte].expected_num_brute_force;
             best_byte = i;
         }
     }
     if (best_byte != 0) {
         // PrintAndLogEx(INFO, "0x%02x <-> 0x%02x", best_first_bytes[0], best_first_bytes[best_byte]);
-        uint8_t tmp = best_first_bytes[0];
-        best_first_bytes[0] = best_first_bytes[best_byte];
-        best_first_bytes[best_byte] = tmp;
+        uint8_t tmp = job->best_first_bytes[0];
+        job->best_first_bytes[0] = job->best_first_bytes[best_byte];
+        job->best_first_bytes[best_byte] = tmp;
     }
 
-    return nonces[best_first_bytes[0]].expected_num_brute_force;
+    return job->nonces[job->best_first_bytes[0]].expected_num_brute_force;
 }
 
-static float update_reduction_rate(float last, bool init) {
+static float update_reduction_rate(hardnested_job_t *job, float last, bool init) {
 #define QUEUE_LEN 4
-    static float queue[QUEUE_LEN];
+    float *queue = job->reduction_queue;
 
     for (uint16_t i = 0; i < QUEUE_LEN - 1; i++) {
         if (init) {
@@ -948,46 +1335,46 @@ static float update_reduction_rate(float last, bool init) {
     float reduction_rate = -1.0 * dev_xy / dev_x2;  // the negative slope of the linear regression
 
 #if defined (DEBUG_REDUCTION)
-    PrintAndLogEx(INFO, "update_reduction_rate(%1.0f) = %1.0f per sample, brute_force_per_sample = %1.0f\n", last, reduction_rate, brute_force_per_second * (float)sample_period / 1000.0);
+    PrintAndLogEx(INFO, "update_reduction_rate(%1.0f) = %1.0f per sample, brute_force_per_sample = %1.0f\n", last, reduction_rate, brute_force_per_second * (float)job->sample_period / 1000.0);
 #endif
     return reduction_rate;
 }
 
-static bool shrink_key_space(float *brute_forces) {
+static bool shrink_key_space(hardnested_job_t *job, float *brute_forces) {
 #if defined(DEBUG_REDUCTION)
-    PrintAndLogEx(INFO, "shrink_key_space() with stage = 0x%02x\n", hardnested_stage);
+    PrintAndLogEx(INFO, "shrink_key_space() with stage = 0x%02x\n", job->stage);
 #endif
-    float brute_forces1 = check_smallest_bitflip_bitarrays();
+    float brute_forces1 = check_smallest_bitflip_bitarrays(job);
     float brute_forces2 = (float)(1LL << 47);
-    if (hardnested_stage & CHECK_2ND_BYTES) {
-        brute_forces2 = sort_best_first_bytes();
+    if (job->stage & CHECK_2ND_BYTES) {
+        brute_forces2 = sort_best_first_bytes(job);
     }
     *brute_forces = MIN(brute_forces1, brute_forces2);
-    float reduction_rate = update_reduction_rate(*brute_forces, false);
+    float reduction_rate = update_reduction_rate(job, *brute_forces, false);
 
 //iceman 2018
-    return ((hardnested_stage & CHECK_2ND_BYTES) && reduction_rate >= 0.0 &&
-            (reduction_rate < brute_force_per_second * (float) sample_period / 1000.0 || *brute_forces < 0xF00000));
+    return ((job->stage & CHECK_2ND_BYTES) && reduction_rate >= 0.0 &&
+            (reduction_rate < brute_force_per_second * (float) job->sample_period / 1000.0 || *brute_forces < 0xF00000));
 
 }
 
-static void estimate_sum_a8(void) {
-    if (first_byte_num == 256) {
+static void estimate_sum_a8(hardnested_job_t *job) {
+    if (job->first_byte_num == 256) {
         for (uint16_t i = 0; i < 256; i++) {
-            if (nonces[i].sum_a8_guess_dirty) {
+            if (job->nonces[i].sum_a8_guess_dirty) {
                 for (uint8_t j = 0; j < NUM_SUMS; j++) {
-                    uint16_t sum_a8_idx = nonces[i].sum_a8_guess[j].sum_a8_idx;
-                    nonces[i].sum_a8_guess[j].prob = sum_probability(sum_a8_idx, nonces[i].num, nonces[i].Sum);
+                    uint16_t sum_a8_idx = job->nonces[i].sum_a8_guess[j].sum_a8_idx;
+                    job->nonces[i].sum_a8_guess[j].prob = sum_probability(job, sum_a8_idx, job->nonces[i].num, job->nonces[i].Sum);
                 }
-                qsort(nonces[i].sum_a8_guess, NUM_SUMS, sizeof(guess_sum_a8_t), compare_sum_a8_guess);
-                nonces[i].sum_a8_guess_dirty = false;
+                qsort(job->nonces[i].sum_a8_guess, NUM_SUMS, sizeof(guess_sum_a8_t), compare_sum_a8_guess);
+                job->nonces[i].sum_a8_guess_dirty = false;
             }
         }
     }
 }
 
-static noncelistentry_t *SearchFor2ndByte(uint8_t b1, uint8_t b2) {
-    noncelistentry_t *p = nonces[b1].first;
+static noncelistentry_t *SearchFor2ndByte(hardnested_job_t *job, uint8_t b1, uint8_t b2) {
+    noncelistentry_t *p = job->nonces[b1].first;
     while (p != NULL) {
         if ((p->nonce_enc >> 16 & 0xff) == b2) {
             return p;
@@ -997,11 +1384,19 @@ static noncelistentry_t *SearchFor2ndByte(uint8_t b1, uint8_t b2) {
     return NULL;
 }
 
-static bool timeout(void) {
-    return (msclock() > last_sample_clock + sample_period);
+static bool timeout(hardnested_job_t *job) {
+    return (msclock() > job->last_sample_clock + job->sample_period);
 }
 
 
+typedef struct {
+    hardnested_job_t *job;
+    uint8_t first_byte;
+    uint8_t last_byte;
+    uint8_t time_budget;
+    uint8_t stage1_left;                // bitflips still to go in stage 1
+} check_bitflips_arg_t;
+
 static void
 #ifdef __has_attribute
 #if __has_attribute(force_align_arg_pointer)
@@ -1009,15 +1404,17 @@ __attribute__((force_align_arg_pointer))
 #endif
 #endif
 *check_for_BitFlipProperties_thread(void *args) {
-    uint8_t first_byte = ((uint8_t *) args)[0];
-    uint8_t last_byte = ((uint8_t *) args)[1];
-    uint8_t time_budget = ((uint8_t *) args)[2];
+    check_bitflips_arg_t *arg = (check_bitflips_arg_t *) args;
+    hardnested_job_t *job = arg->job;
+    uint8_t first_byte = arg->first_byte;
+    uint8_t last_byte = arg->last_byte;
+    uint8_t time_budget = arg->time_budget;
 
-    if (hardnested_stage & CHECK_1ST_BYTES) {
+    if (job->stage & CHECK_1ST_BYTES) {
         // for (uint16_t bitflip = 0x001; bitflip < 0x200; bitflip++) {
         for (uint16_t bitflip_idx = 0; bitflip_idx < num_1st_byte_effective_bitflips; bitflip_idx++) {
             uint16_t bitflip = all_effective_bitflip[bitflip_idx];
-            if (time_budget && timeout()) {
+            if (time_budget && timeout(job)) {
 #if defined (DEBUG_REDUCTION)
                 PrintAndLogEx(INFO, "break at bitflip_idx " _YELLOW_("%d") " ...", bitflip_idx);
 #endif
@@ -1025,26 +1422,26 @@ __attribute__((force_align_arg_pointer))
             }
             for (uint16_t i = first_byte; i <= last_byte; i++) {
 
-                if (nonces[i].BitFlips[bitflip] == 0 && nonces[i].BitFlips[bitflip ^ 0x100] == 0 &&
-                        nonces[i].first != NULL && nonces[i ^ (bitflip & 0xff)].first != NULL) {
+                if (job->nonces[i].BitFlips[bitflip] == 0 && job->nonces[i].BitFlips[bitflip ^ 0x100] == 0 &&
+                        job->nonces[i].first != NULL && job->nonces[i ^ (bitflip & 0xff)].first != NULL) {
 
-                    uint8_t parity1 = (nonces[i].first->par_enc) >> 3;                  // parity of first byte
+                    uint8_t parity1 = (job->nonces[i].first->par_enc) >> 3;                  // parity of first byte
                     uint8_t parity2 =
-                        (nonces[i ^ (bitflip & 0xff)].first->par_enc) >> 3; // parity of nonce with bits flipped
+                        (job->nonces[i ^ (bitflip & 0xff)].first->par_enc) >> 3; // parity of nonce with bits flipped
 
                     if ((parity1 == parity2 && !(bitflip & 0x100))          // bitflip
                             || (parity1 != parity2 && (bitflip & 0x100))) {     // not bitflip
 
-                        nonces[i].BitFlips[bitflip] = 1;
+                        job->nonces[i].BitFlips[bitflip] = 1;
 
                         for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
 
-                            if (bitflip_bitarrays[odd_even][bitflip] != NULL) {
-                                uint32_t old_count = nonces[i].num_states_bitarray[odd_even];
-                                nonces[i].num_states_bitarray[odd_even] = count_bitarray_AND(
-                                        nonces[i].states_bitarray[odd_even], bitflip_bitarrays[odd_even][bitflip]);
-                                if (nonces[i].num_states_bitarray[odd_even] != old_count) {
-                                    nonces[i].all_bitflips_dirty[odd_even] = true;
+                            if (have_bitflip_bitarray(odd_even, bitflip)) {
+                                uint32_t old_count = job->nonces[i].num_states_bitarray[odd_even];
+                                job->nonces[i].num_states_bitarray[odd_even] = count_bitflip_AND(
+                                        job->nonces[i].states_bitarray[odd_even], odd_even, bitflip);
+                                if (job->nonces[i].num_states_bitarray[odd_even] != old_count) {
+                                    job->nonces[i].all_bitflips_dirty[odd_even] = true;
                                 }
                                 // PrintAndLogEx(INFO, "bitflip: %d old: %d, new: %d ", bitflip, old_count, nonces[i].num_states_bitarray[odd_even]);
                             }
@@ -1052,18 +1449,17 @@ __attribute__((force_align_arg_pointer))
                     }
                 }
             }
-            ((uint8_t *) args)[1] =
-                num_1st_byte_effective_bitflips - bitflip_idx - 1;  // bitflips still to go in stage 1
+            arg->stage1_left = num_1st_byte_effective_bitflips - bitflip_idx - 1;
         }
     }
 
-    ((uint8_t *) args)[1] = 0;  // stage 1 definitely completed
+    arg->stage1_left = 0;  // stage 1 definitely completed
 
-    if (hardnested_stage & CHECK_2ND_BYTES) {
+    if (job->stage & CHECK_2ND_BYTES) {
         for (uint16_t bitflip_idx = num_1st_byte_effective_bitflips;
                 bitflip_idx < num_all_effective_bitflips; bitflip_idx++) {
             uint16_t bitflip = all_effective_bitflip[bitflip_idx];
-            if (time_budget && timeout()) {
+            if (time_budget && timeout(job)) {
 #if defined (DEBUG_REDUCTION)
                 PrintAndLogEx(INFO, "break at bitflip_idx " _YELLOW_("%d") " ...", bitflip_idx);
 #endif
@@ -1071,24 +1467,23 @@ __attribute__((force_align_arg_pointer))
             }
             for (uint16_t i = first_byte; i <= last_byte; i++) {
                 // Check for Bit Flip Property of 2nd bytes
-                if (nonces[i].BitFlips[bitflip] == 0) {
+                if (job->nonces[i].BitFlips[bitflip] == 0) {
                     for (uint16_t j = 0; j < 256; j++) { // for each 2nd Byte
-                        noncelistentry_t *byte1 = SearchFor2ndByte(i, j);
-                        noncelistentry_t *byte2 = SearchFor2ndByte(i, j ^ (bitflip & 0xff));
+                        noncelistentry_t *byte1 = SearchFor2ndByte(job, i, j);
+                        noncelistentry_t *byte2 = SearchFor2ndByte(job, i, j ^ (bitflip & 0xff));
                         if (byte1 != NULL && byte2 != NULL) {
                             uint8_t parity1 = byte1->par_enc >> 2 & 0x01; // parity of 2nd byte
                             uint8_t parity2 = byte2->par_enc >> 2 & 0x01; // parity of 2nd byte with bits flipped
                             if ((parity1 == parity2 && !(bitflip & 0x100)) // bitflip
                                     || (parity1 != parity2 && (bitflip & 0x100))) { // not bitflip
-                                nonces[i].BitFlips[bitflip] = 1;
+                                job->nonces[i].BitFlips[bitflip] = 1;
                                 for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
-                                    if (bitflip_bitarrays[odd_even][bitflip] != NULL) {
-                                        uint32_t old_count = nonces[i].num_states_bitarray[odd_even];
-                                        nonces[i].num_states_bitarray[odd_even] = count_bitarray_AND(
-                                                nonces[i].states_bitarray[odd_even],
-                                                bitflip_bitarrays[odd_even][bitflip]);
-                                        if (nonces[i].num_states_bitarray[odd_even] != old_count) {
-                                            nonces[i].all_bitflips_dirty[odd_even] = true;
+                                    if (have_bitflip_bitarray(odd_even, bitflip)) {
+                                        uint32_t old_count = job->nonces[i].num_states_bitarray[odd_even];
+                                        job->nonces[i].num_states_bitarray[odd_even] = count_bitflip_AND(
+                                                job->nonces[i].states_bitarray[odd_even], odd_even, bitflip);
+                                        if (job->nonces[i].num_states_bitarray[odd_even] != old_count) {
+                                            job->nonces[i].all_bitflips_dirty[odd_even] = true;
                                         }
                                     }
                                 }
@@ -1106,23 +1501,25 @@ __attribute__((force_align_arg_pointer))
     return NULL;
 }
 
-static void check_for_BitFlipProperties(bool time_budget) {
+static void check_for_BitFlipProperties(hardnested_job_t *job, bool time_budget) {
     // create and run worker threads
     pthread_t thread_id[NUM_CHECK_BITFLIPS_THREADS_ALLOC];
 
-    uint8_t args[NUM_CHECK_BITFLIPS_THREADS_ALLOC][3];
+    check_bitflips_arg_t args[NUM_CHECK_BITFLIPS_THREADS_ALLOC];
     uint16_t bytes_per_thread = (256 + (NUM_CHECK_BITFLIPS_THREADS / 2)) / NUM_CHECK_BITFLIPS_THREADS;
     for (uint32_t i = 0; i < NUM_CHECK_BITFLIPS_THREADS; i++) {
-        args[i][0] = i * bytes_per_thread;
-        args[i][1] = MIN(args[i][0] + bytes_per_thread - 1, 255);
-        args[i][2] = time_budget;
+        args[i].job = job;
+        args[i].first_byte = i * bytes_per_thread;
+        args[i].last_byte = MIN(args[i].first_byte + bytes_per_thread - 1, 255);
+        args[i].time_budget = time_budget;
+        args[i].stage1_left = args[i].last_byte;    // not 0 until the thread is through stage 1
     }
-    // args[][] is uint8_t so max 255, no need to check it
-    // args[NUM_CHECK_BITFLIPS_THREADS - 1][1] = MAX(args[NUM_CHECK_BITFLIPS_THREADS - 1][1], 255);
+    // the bytes are uint8_t so max 255, no need to check it
+    // args[NUM_CHECK_BITFLIPS_THREADS - 1].last_byte = MAX(args[NUM_CHECK_BITFLIPS_THREADS - 1].last_byte, 255);
 
     // start threads
     for (uint32_t i = 0; i < NUM_CHECK_BITFLIPS_THREADS; i++) {
-        pthread_create(&thread_id[i], NULL, check_for_BitFlipProperties_thread, args[i]);
+        pthread_create(&thread_id[i], NULL, check_for_BitFlipProperties_thread, &args[i]);
     }
 
     // wait for threads to terminate:
@@ -1130,90 +1527,126 @@ static void check_for_BitFlipProperties(bool time_budget) {
         pthread_join(thread_id[i], NULL);
     }
 
-    if (hardnested_stage & CHECK_2ND_BYTES) {
-        hardnested_stage &= ~CHECK_1ST_BYTES; // we are done with 1st stage, except...
+    if (job->stage & CHECK_2ND_BYTES) {
+        job->stage &= ~CHECK_1ST_BYTES; // we are done with 1st stage, except...
         for (uint32_t i = 0; i < NUM_CHECK_BITFLIPS_THREADS; i++) {
-            if (args[i][1] != 0) {
-                hardnested_stage |= CHECK_1ST_BYTES;  // ... when any of the threads didn't complete in time
+            if (args[i].stage1_left != 0) {
+                job->stage |= CHECK_1ST_BYTES;  // ... when any of the threads didn't complete in time
                 break;
             }
         }
     }
 #if defined (DEBUG_REDUCTION)
-    if (hardnested_stage & CHECK_1ST_BYTES) PrintAndLogEx(INFO, "stage 1 not completed yet\n");
+    if (job->stage & CHECK_1ST_BYTES) PrintAndLogEx(INFO, "stage 1 not completed yet\n");
 #endif
 }
 
-static void update_nonce_data(bool time_budget) {
-    check_for_BitFlipProperties(time_budget);
-    update_allbitflips_array();
-    update_sum_bitarrays(EVEN_STATE);
-    update_sum_bitarrays(ODD_STATE);
-    update_p_K();
-    estimate_sum_a8();
+static void update_nonce_data(hardnested_job_t *job, bool time_budget) {
+    check_for_BitFlipProperties(job, time_budget);
+    update_allbitflips_array(job);
+    update_sum_bitarrays(job, EVEN_STATE);
+    update_sum_bitarrays(job, ODD_STATE);
+    update_p_K(job);
+    estimate_sum_a8(job);
 }
 
-static void apply_sum_a0(void) {
-    uint32_t old_count = num_all_bitflips_bitarray[EVEN_STATE];
-    num_all_bitflips_bitarray[EVEN_STATE] = count_bitarray_AND(all_bitflips_bitarray[EVEN_STATE],
-                                            sum_a0_bitarrays[EVEN_STATE][first_byte_Sum]);
-    if (num_all_bitflips_bitarray[EVEN_STATE] != old_count) {
-        all_bitflips_bitarray_dirty[EVEN_STATE] = true;
+// states &= the sum(a0) table, returns the states left
+static uint32_t count_sum_a0_AND(uint32_t *states, odd_even_t odd_even, uint16_t sum_a0) {
+    if (sparse_sum_a0_bitarrays[odd_even][sum_a0] != NULL) {
+        return count_bitarray_AND_sparse(states, sparse_sum_a0_bitarrays[odd_even][sum_a0]);
     }
-    old_count = num_all_bitflips_bitarray[ODD_STATE];
-    num_all_bitflips_bitarray[ODD_STATE] = count_bitarray_AND(all_bitflips_bitarray[ODD_STATE],
-                                           sum_a0_bitarrays[ODD_STATE][first_byte_Sum]);
-    if (num_all_bitflips_bitarray[ODD_STATE] != old_count) {
-        all_bitflips_bitarray_dirty[ODD_STATE] = true;
+    check_cached_table(CACHE_SUM_A0(odd_even, sum_a0), sum_a0_bitarrays[odd_even][sum_a0]);
+    return count_bitarray_AND(states, sum_a0_bitarrays[odd_even][sum_a0]);
+}
+
+static void apply_sum_a0(hardnested_job_t *job) {
+    uint32_t old_count = job->num_all_bitflips_bitarray[EVEN_STATE];
+    job->num_all_bitflips_bitarray[EVEN_STATE] = count_sum_a0_AND(job->all_bitflips_bitarray[EVEN_STATE], EVEN_STATE, job->first_byte_Sum);
+    if (job->num_all_bitflips_bitarray[EVEN_STATE] != old_count) {
+        job->all_bitflips_bitarray_dirty[EVEN_STATE] = true;
+    }
+    old_count = job->num_all_bitflips_bitarray[ODD_STATE];
+    job->num_all_bitflips_bitarray[ODD_STATE] = count_sum_a0_AND(job->all_bitflips_bitarray[ODD_STATE], ODD_STATE, job->first_byte_Sum);
+    if (job->num_all_bitflips_bitarray[ODD_STATE] != old_count) {
+        job->all_bitflips_bitarray_dirty[ODD_STATE] = true;
     }
 }
 
-static int simulate_acquire_nonces(uint32_t uid, char* path) {
+// Nonces taken from the source so far, kept for rolling back an invalid one
+typedef struct {
+    hardnested_nonce_t *nonces;
+    uint32_t count;
+    uint32_t size;
+} nonce_history_t;
+
+static bool next_source_nonce(const hardnested_nonce_source_t *source, nonce_history_t *history) {
+    if (history->count == history->size) {
+        uint32_t size = history->size ? 2 * history->size : 4096;
+        hardnested_nonce_t *nonces = (hardnested_nonce_t *) realloc(history->nonces, size * sizeof(hardnested_nonce_t));
+        if (nonces == NULL) {
+            PrintAndLogEx(ERR, "Out of memory error in next_source_nonce()");
+            exit(4);
+        }
+        history->nonces = nonces;
+        history->size = size;
+    }
+    if (!source->next(source->ctx, &history->nonces[history->count])) {
+        return false;
+    }
+    history->count++;
+    return true;
+}
+
+static int simulate_acquire_nonces(hardnested_job_t *job, uint32_t uid, const hardnested_nonce_source_t *source) {
     time_t time1 = time(NULL);
-    last_sample_clock = 0;
-    sample_period = 1000; // for emulation
-    hardnested_stage = CHECK_1ST_BYTES;
+    job->last_sample_clock = 0;
+    job->sample_period = 1000; // for emulation
+    job->stage = CHECK_1ST_BYTES;
     bool acquisition_completed = false;
     uint32_t total_num_nonces = 0;
-    float brute_force_depth;
+    float brute_force_depth = (float)(1LL << 47);
     bool reported_suma8 = false;
     bool got_invalid = false;
 
-    cuid = uid;
+    bool source_exhausted = false;
+    nonce_history_t history = {NULL, 0, 0};
 
-    num_acquired_nonces = 0;
+    job->cuid = uid;
 
-    FILE *fp;
-    char line[100];
-    fp = fopen(path, "r");
-    if (fp == NULL) {
-        perror("Error opening file");
-        exit(EXIT_FAILURE);
-    }
+    job->num_acquired_nonces = 0;
 
     do {
-        uint32_t nt_enc = 0;
-        uint8_t par_enc = 0;
-
-        if (fgets(line, sizeof(line), fp) != NULL) {
-            sscanf(line, "%u|%hhu", &nt_enc, &par_enc);
-            num_acquired_nonces += add_nonce(nt_enc, par_enc);
+        if (hardnested_job_cancelled(job)) {
+            hardnested_print_progress(job->num_acquired_nonces, "Cancelled", brute_force_depth, 0);
+            free(history.nonces);
+            return -1;
+        }
+        if (total_num_nonces == history.count && !source_exhausted && !next_source_nonce(source, &history)) {
+            source_exhausted = true;
+        }
+        if (total_num_nonces < history.count) {
+            job->num_acquired_nonces += add_nonce(job, history.nonces[total_num_nonces].nt_enc, history.nonces[total_num_nonces].par_enc);
             total_num_nonces++;
+        } else if (job->first_byte_num < 256) {
+            // without all first bytes the key space never shrinks enough
+            hardnested_print_progress(job->num_acquired_nonces, "Not enough nonces", brute_force_depth, 0);
+            free(history.nonces);
+            return -1;
         }
 
-        if (num_acquired_nonces % 256 == 0) {
-            hardnested_print_progress(num_acquired_nonces, "Loading nonces from file", brute_force_depth, 0);
+        if (job->num_acquired_nonces % 256 == 0) {
+            hardnested_print_progress(job->num_acquired_nonces, "Loading nonces from file", brute_force_depth, 0);
         }
 
-        last_sample_clock = msclock();
+        job->last_sample_clock = msclock();
 
-        if (first_byte_num == 256) {
-            if (hardnested_stage == CHECK_1ST_BYTES) {
+        if (job->first_byte_num == 256) {
+            if (job->stage == CHECK_1ST_BYTES) {
 
                 bool got_match = false;
                 for (uint8_t i = 0; i < NUM_SUMS; i++) {
-                    if (first_byte_Sum == sums[i]) {
-                        first_byte_Sum = i;
+                    if (job->first_byte_Sum == sums[i]) {
+                        job->first_byte_Sum = i;
                         got_match = true;
                         break;
                     }
@@ -1221,53 +1654,61 @@ static int simulate_acquire_nonces(uint32_t uid, char* path) {
 
                 if (got_match == false) {
                     PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ",
-                                  first_byte_Sum);
+                                  job->first_byte_Sum);
+                    free(history.nonces);
                     return -1;
                 }
 
-                hardnested_stage |= CHECK_2ND_BYTES;
-                apply_sum_a0();
+                job->stage |= CHECK_2ND_BYTES;
+                apply_sum_a0(job);
             }
-            update_nonce_data(true);
-            acquisition_completed = shrink_key_space(&brute_force_depth);
+            update_nonce_data(job, true);
+            acquisition_completed = shrink_key_space(job, &brute_force_depth);
             if (!reported_suma8) {
                 char progress_string[80];
                 snprintf(progress_string, sizeof(progress_string), "Apply Sum property. Sum(a0) = %d",
-                         sums[first_byte_Sum]);
-                hardnested_print_progress(num_acquired_nonces, progress_string, brute_force_depth, 0);
+                         sums[job->first_byte_Sum]);
+                hardnested_print_progress(job->num_acquired_nonces, progress_string, brute_force_depth, 0);
                 reported_suma8 = true;
             } else {
-                hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+                hardnested_print_progress(job->num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
             }
         } else {
-            update_nonce_data(true);
-            acquisition_completed = shrink_key_space(&brute_force_depth);
+            update_nonce_data(job, true);
+            acquisition_completed = shrink_key_space(job, &brute_force_depth);
             if (brute_force_depth == 0) {
                 // something went wrong, wipe nonce memory and skip this nonce
                 if (got_invalid) {
-                    hardnested_print_progress(num_acquired_nonces, "Too many invalid nonces", brute_force_depth, 0);
+                    hardnested_print_progress(job->num_acquired_nonces, "Too many invalid nonces", brute_force_depth, 0);
+                    free(history.nonces);
                     return -1;
                 }
-                hardnested_print_progress(num_acquired_nonces, "Found invalid nonce! Trying without it...", brute_force_depth, 0);
+                hardnested_print_progress(job->num_acquired_nonces, "Found invalid nonce! Trying without it...", brute_force_depth, 0);
                 got_invalid = true;
-                fclose(fp);
-                fp = fopen(path, "r");
-                init_nonce_memory();
-                uint32_t to = total_num_nonces - 1;
-                num_acquired_nonces = 0;
-                total_num_nonces = 0;
-                for (uint32_t i = 0; i < to; i++) {
-                    if (fgets(line, sizeof(line), fp) != NULL) {
-                        sscanf(line, "%u|%hhu", &nt_enc, &par_enc);
-                        num_acquired_nonces += add_nonce(nt_enc, par_enc);
-                        total_num_nonces++;
-                    }
+                free_nonces_memory(job);
+                init_nonce_memory(job);
+                uint32_t skip = total_num_nonces - 1;
+                job->num_acquired_nonces = 0;
+                for (uint32_t i = 0; i < skip; i++) {
+                    job->num_acquired_nonces += add_nonce(job, history.nonces[i].nt_enc, history.nonces[i].par_enc);
                 }
-                fgets(line, sizeof(line), fp); // skip line
+                total_num_nonces = skip + 1;
             }
         }
     } while (!acquisition_completed);
 
+    // identifies the nonces for the brute force journal
+    job->nonces_hash = tables_cache_hash(TABLES_CACHE_HASH_INIT, &uid, sizeof(uid));
+    for (uint32_t i = 0; i < total_num_nonces; i++) {
+        job->nonces_hash = tables_cache_hash(job->nonces_hash, &history.nonces[i].nt_enc, sizeof(history.nonces[i].nt_enc));
+        job->nonces_hash = tables_cache_hash(job->nonces_hash, &history.nonces[i].par_enc, sizeof(history.nonces[i].par_enc));
+    }
+
+    free(history.nonces);
+    if (source->done != NULL) {
+        source->done(source->ctx, total_num_nonces);
+    }
+
     time_t end_time = time(NULL);
 
     return 0;
@@ -1347,58 +1788,93 @@ remaining_bits_match(uint_fast8_t num_common_bits, uint_fast8_t byte_diff, uint_
     return true; // valid state
 }
 
-static pthread_mutex_t statelist_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_mutex_t book_of_work_mutex = PTHREAD_MUTEX_INITIALIZER;
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// key hint, applied to the candidate states
+
+// The candidate states are the cipher state after the first byte. Feeding it shifts each 24 bit half by 4,
+// so a half still holds 20 bits of the key: all of it but the first key byte (bits 40..47). A key pattern
+// becomes a pattern on each half, a state not matching any of them is dropped from the candidate lists.
+// Both halves are matched on their own, the brute force still tests the odd and even states of different
+// patterns together.
+static key_hint_t state_hint[2] = {KEY_HINT_INIT, KEY_HINT_INIT};
+
+void hardnested_set_key_hint(const key_hint_t *hint) {
+    key_hint_free(&state_hint[ODD_STATE]);
+    key_hint_free(&state_hint[EVEN_STATE]);
+    for (uint32_t i = 0; hint != NULL && i < hint->count; i++) {
+        struct Crypto1State mask, value;
+        crypto1_init(&mask, hint->patterns[i].mask);
+        crypto1_init(&value, hint->patterns[i].value);
+        if (!key_hint_add(&state_hint[ODD_STATE], (mask.odd << 4) & 0x00ffffff, (value.odd << 4) & 0x00ffffff)
+                || !key_hint_add(&state_hint[EVEN_STATE], (mask.even << 4) & 0x00ffffff, (value.even << 4) & 0x00ffffff)) {
+            PrintAndLogEx(ERR, "Out of memory error in hardnested_set_key_hint()");
+            exit(4);
+        }
+    }
+    key_hint_finish(&state_hint[ODD_STATE]);
+    key_hint_finish(&state_hint[EVEN_STATE]);
+}
 
-typedef enum {
-    TO_BE_DONE, WORK_IN_PROGRESS, COMPLETED
-} work_status_t;
+static bool have_key_hint(void) {
+    return state_hint[ODD_STATE].count > 0;
+}
+
+static void print_key_hint_space(void) {
+    char progress_text[80];
+    snprintf(progress_text, sizeof(progress_text), "Key hint keeps 2^%1.1f of the odd and 2^%1.1f of the even states",
+             log2(key_hint_fraction(&state_hint[ODD_STATE], 24)), log2(key_hint_fraction(&state_hint[EVEN_STATE], 24)));
+    hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+}
+
+static void print_key_hint_pruned(hardnested_job_t *job, float brute_force) {
+    char progress_text[80];
+    snprintf(progress_text, sizeof(progress_text), "Key hint pruned %1.1f%% of %" PRIu64 " odd, %1.1f%% of %" PRIu64 " even states",
+             job->hint_states[ODD_STATE] ? 100.0 * job->hint_pruned[ODD_STATE] / job->hint_states[ODD_STATE] : 0.0, job->hint_states[ODD_STATE],
+             job->hint_states[EVEN_STATE] ? 100.0 * job->hint_pruned[EVEN_STATE] / job->hint_states[EVEN_STATE] : 0.0, job->hint_states[EVEN_STATE]);
+    hardnested_print_progress(job->num_acquired_nonces, progress_text, brute_force, 0);
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        job->hint_states[odd_even] = 0;
+        job->hint_pruned[odd_even] = 0;
+    }
+}
 
-static struct sl_cache_entry {
-    uint32_t *sl;
-    uint32_t len;
-    work_status_t cache_status;
-} sl_cache[NUM_PART_SUMS][NUM_PART_SUMS][2];
+static pthread_mutex_t statelist_work_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static void init_statelist_cache(void) {
-    pthread_mutex_lock(&statelist_cache_mutex);
+static void init_statelist_cache(hardnested_job_t *job) {
     for (uint16_t i = 0; i < NUM_PART_SUMS; i++) {
         for (uint16_t j = 0; j < NUM_PART_SUMS; j++) {
             for (uint16_t k = 0; k < 2; k++) {
-                sl_cache[i][j][k].sl = NULL;
-                sl_cache[i][j][k].len = 0;
-                sl_cache[i][j][k].cache_status = TO_BE_DONE;
+                job->sl_cache[i][j][k].sl = NULL;
+                job->sl_cache[i][j][k].len = 0;
+                job->sl_cache[i][j][k].cache_status = TO_BE_DONE;
             }
         }
     }
-    pthread_mutex_unlock(&statelist_cache_mutex);
 }
 
-static void free_statelist_cache(void) {
-    pthread_mutex_lock(&statelist_cache_mutex);
+static void free_statelist_cache(hardnested_job_t *job) {
     for (uint16_t i = 0; i < NUM_PART_SUMS; i++) {
         for (uint16_t j = 0; j < NUM_PART_SUMS; j++) {
             for (uint16_t k = 0; k < 2; k++) {
-                free(sl_cache[i][j][k].sl);
+                free(job->sl_cache[i][j][k].sl);
             }
         }
     }
-    pthread_mutex_unlock(&statelist_cache_mutex);
 }
 
 
 #ifdef DEBUG_KEY_ELIMINATION
 
-static inline bool bitflips_match(uint8_t byte, uint32_t state, odd_even_t odd_even, bool quiet)
+static inline bool bitflips_match(hardnested_job_t *job, uint8_t byte, uint32_t state, odd_even_t odd_even, bool quiet)
 #else
-static inline bool bitflips_match(uint8_t byte, uint32_t state, odd_even_t odd_even)
+static inline bool bitflips_match(hardnested_job_t *job, uint8_t byte, uint32_t state, odd_even_t odd_even)
 #endif
 {
-    uint32_t *bitset = nonces[byte].states_bitarray[odd_even];
+    uint32_t *bitset = job->nonces[byte].states_bitarray[odd_even];
     bool possible = test_bit24(bitset, state);
     if (!possible) {
 #ifdef DEBUG_KEY_ELIMINATION
-        if (!quiet && known_target_key != -1 && state == test_state[odd_even]) {
+        if (!quiet && job->known_target_key != -1 && state == job->test_state[odd_even]) {
             PrintAndLogEx(INFO, "Initial state lists: "
                           _YELLOW_("%s")
                                 " test state eliminated by bitflip property.", odd_even == EVEN_STATE ? "even" : "odd");
@@ -1417,7 +1893,7 @@ static uint_fast8_t reverse(uint_fast8_t b) {
     return (b * 0x0202020202ULL & 0x010884422010ULL) % 1023;
 }
 
-static bool all_bitflips_match(uint8_t byte, uint32_t state, odd_even_t odd_even) {
+static bool all_bitflips_match(hardnested_job_t *job, uint8_t byte, uint32_t state, odd_even_t odd_even) {
     uint32_t masks[2][8] = {{0x00fffff0, 0x00fffff8, 0x00fffff8, 0x00fffffc, 0x00fffffc, 0x00fffffe, 0x00fffffe, 0x00ffffff},
         {0x00fffff0, 0x00fffff0, 0x00fffff8, 0x00fffff8, 0x00fffffc, 0x00fffffc, 0x00fffffe, 0x00fffffe}
     };
@@ -1432,9 +1908,9 @@ static bool all_bitflips_match(uint8_t byte, uint32_t state, odd_even_t odd_even
             if (remaining_bits_match(num_common, bytes_diff, state, (state & mask) | remaining_bits, odd_even)) {
 
 # ifdef DEBUG_KEY_ELIMINATION
-                if (bitflips_match(byte2, (state & mask) | remaining_bits, odd_even, true))
+                if (bitflips_match(job, byte2, (state & mask) | remaining_bits, odd_even, true))
 # else
-                if (bitflips_match(byte2, (state & mask) | remaining_bits, odd_even))
+                if (bitflips_match(job, byte2, (state & mask) | remaining_bits, odd_even))
 # endif
                 {
                     found_match = true;
@@ -1446,10 +1922,10 @@ static bool all_bitflips_match(uint8_t byte, uint32_t state, odd_even_t odd_even
         if (!found_match) {
 
 # ifdef DEBUG_KEY_ELIMINATION
-            if (known_target_key != -1 && state == test_state[odd_even]) {
+            if (job->known_target_key != -1 && state == job->test_state[odd_even]) {
                 PrintAndLogEx(INFO,
                               "all_bitflips_match() 1st Byte: %s test state (0x%06x): Eliminated. Bytes = %02x, %02x, Common Bits = %d\n",
-                              odd_even == ODD_STATE ? "odd" : "even", test_state[odd_even], byte, byte2, num_common);
+                              odd_even == ODD_STATE ? "odd" : "even", job->test_state[odd_even], byte, byte2, num_common);
                 if (failstr[0] == '\0') {
                     snprintf(failstr, sizeof(failstr), "Other 1st Byte %s, all_bitflips_match(), no match",
                              odd_even ? "odd" : "even");
@@ -1462,73 +1938,162 @@ static bool all_bitflips_match(uint8_t byte, uint32_t state, odd_even_t odd_even
     return true;
 }
 
+// The candidate state lists are built in chunks of the state space. Any thread takes the next chunk
+// of any list and filters it into its own buffer, the chunks are joined in state order afterwards.
+// This gives the same lists as walking each bitarray in a single thread.
+#define STATELIST_CHUNK_STATES          (1 << 16)
+#define STATELIST_CHUNKS                ((1 << 24) / STATELIST_CHUNK_STATES)
+
+typedef struct {
+    uint8_t byte;                       // all states must match the bitflip properties of this first byte
+    odd_even_t odd_even;
+    const uint32_t *bitarrays[3];       // the list's states are set in all of these, unused ones NULL
+    sl_cache_entry_t *result;
+    uint32_t *chunk_states[STATELIST_CHUNKS];
+    uint32_t chunk_len[STATELIST_CHUNKS];
+    uint32_t chunk_hint_states[STATELIST_CHUNKS];   // states tested against the key hint
+    uint32_t chunk_hint_pruned[STATELIST_CHUNKS];   // of those, not matching it
+} statelist_task_t;
+
+typedef struct {
+    hardnested_job_t *job;
+    statelist_task_t *tasks;
+    uint32_t num_tasks;
+    uint32_t next_chunk;
+} statelist_work_t;
+
 static void
-bitarray_to_list(uint8_t byte, uint32_t *bitarray, uint32_t *state_list, uint32_t *len, odd_even_t odd_even) {
-    uint32_t *p = state_list;
-    for (uint32_t state = next_state(bitarray, -1L); state < (1 << 24); state = next_state(bitarray, state)) {
-        if (all_bitflips_match(byte, state, odd_even)) {
-            *p++ = state;
-        }
+#ifdef __has_attribute
+#if __has_attribute(force_align_arg_pointer)
+__attribute__((force_align_arg_pointer))
+#endif
+#endif
+*statelist_worker_thread(void *args) {
+    statelist_work_t *work = (statelist_work_t *) args;
+    uint32_t *buffer = (uint32_t *) malloc(sizeof(uint32_t) * STATELIST_CHUNK_STATES);
+    if (buffer == NULL) {
+        PrintAndLogEx(ERR, "Out of memory error in statelist_worker_thread()");
+        exit(4);
     }
-    // add End Of List marker
-    *p = 0xffffffff;
-    *len = p - state_list;
-}
-
-static void add_cached_states(statelist_t *cands, uint16_t part_sum_a0, uint16_t part_sum_a8, odd_even_t odd_even) {
-    cands->states[odd_even] = sl_cache[part_sum_a0 / 2][part_sum_a8 / 2][odd_even].sl;
-    cands->len[odd_even] = sl_cache[part_sum_a0 / 2][part_sum_a8 / 2][odd_even].len;
-}
 
+    while (true) {
+        pthread_mutex_lock(&statelist_work_mutex);
+        uint32_t item = work->next_chunk++;
+        pthread_mutex_unlock(&statelist_work_mutex);
+        if (item >= work->num_tasks * STATELIST_CHUNKS) {
+            break;
+        }
 
-static void add_matching_states(statelist_t *cands, uint8_t part_sum_a0, uint8_t part_sum_a8, odd_even_t odd_even) {
+        statelist_task_t *task = &work->tasks[item / STATELIST_CHUNKS];
+        uint32_t chunk = item % STATELIST_CHUNKS;
+        uint32_t first_index = chunk * (STATELIST_CHUNK_STATES / 32);
+        uint32_t len = 0;
+        uint32_t hint_tested = 0, hint_failed = 0;
+        const key_hint_t *hint = &state_hint[task->odd_even];
+        for (uint32_t index = first_index; index < first_index + STATELIST_CHUNK_STATES / 32; index++) {
+            uint32_t line = task->bitarrays[0][index];
+            for (uint8_t i = 1; i < 3 && task->bitarrays[i] != NULL; i++) {
+                line &= task->bitarrays[i][index];
+            }
+            for (uint32_t state = index << 5; line != 0; state++, line <<= 1) {
+                if ((line & 0x80000000) == 0) {
+                    continue;
+                }
+                // the hint is much cheaper than the bitflip properties of all the other first bytes
+                if (hint->count > 0) {
+                    hint_tested++;
+                    if (!key_hint_match(hint, state)) {
+                        hint_failed++;
+                        continue;
+                    }
+                }
+                if (all_bitflips_match(work->job, task->byte, state, task->odd_even)) {
+                    buffer[len++] = state;
+                }
+            }
+        }
+        task->chunk_hint_states[chunk] = hint_tested;
+        task->chunk_hint_pruned[chunk] = hint_failed;
+
+        task->chunk_states[chunk] = NULL;
+        task->chunk_len[chunk] = len;
+        if (len > 0) {
+            task->chunk_states[chunk] = (uint32_t *) malloc(sizeof(uint32_t) * len);
+            if (task->chunk_states[chunk] == NULL) {
+                PrintAndLogEx(ERR, "Out of memory error in statelist_worker_thread() - chunk.");
+                exit(4);
+            }
+            memcpy(task->chunk_states[chunk], buffer, sizeof(uint32_t) * len);
+        }
+    }
 
-    const uint32_t worstcase_size = 1 << 20;
+    free(buffer);
+    return NULL;
+}
 
-    cands->states[odd_even] = (uint32_t *) malloc(sizeof(uint32_t) * worstcase_size);
-    if (cands->states[odd_even] == NULL) {
-        PrintAndLogEx(ERR, "Out of memory error in add_matching_states() - statelist.\n");
-        exit(4);
+static void join_statelist_chunks(hardnested_job_t *job, statelist_task_t *task) {
+    uint32_t len = 0;
+    for (uint32_t chunk = 0; chunk < STATELIST_CHUNKS; chunk++) {
+        len += task->chunk_len[chunk];
+        job->hint_states[task->odd_even] += task->chunk_hint_states[chunk];
+        job->hint_pruned[task->odd_even] += task->chunk_hint_pruned[chunk];
     }
 
-    uint32_t *cands_bitarray = (uint32_t *) malloc_bitarray(sizeof(uint32_t) * worstcase_size);
-    if (cands_bitarray == NULL) {
-        PrintAndLogEx(ERR, "Out of memory error in add_matching_states() - bitarray.\n");
-        free(cands->states[odd_even]);
-        exit(4);
+    task->result->sl = NULL;
+    task->result->len = len;
+    if (len > 0) {
+        task->result->sl = (uint32_t *) malloc(sizeof(uint32_t) * (len + 1));
+        if (task->result->sl == NULL) {
+            PrintAndLogEx(ERR, "Out of memory error in join_statelist_chunks().");
+            exit(4);
+        }
+        uint32_t *p = task->result->sl;
+        for (uint32_t chunk = 0; chunk < STATELIST_CHUNKS; chunk++) {
+            if (task->chunk_len[chunk] > 0) {
+                memcpy(p, task->chunk_states[chunk], sizeof(uint32_t) * task->chunk_len[chunk]);
+                p += task->chunk_len[chunk];
+            }
+            free(task->chunk_states[chunk]);
+        }
+        // add End Of List marker
+        *p = 0xffffffff;
     }
+    task->result->cache_status = COMPLETED;
+}
 
-    uint32_t *bitarray_a0 = part_sum_a0_bitarrays[odd_even][part_sum_a0 / 2];
-    uint32_t *bitarray_a8 = part_sum_a8_bitarrays[odd_even][part_sum_a8 / 2];
-    uint32_t *bitarray_bitflips = nonces[best_first_bytes[0]].states_bitarray[odd_even];
-
-    bitarray_AND4(cands_bitarray, bitarray_a0, bitarray_a8, bitarray_bitflips);
+static void build_statelists(hardnested_job_t *job, statelist_task_t *tasks, uint32_t num_tasks) {
+    if (num_tasks == 0) {
+        return;
+    }
 
-    bitarray_to_list(best_first_bytes[0], cands_bitarray, cands->states[odd_even], &(cands->len[odd_even]), odd_even);
+    statelist_work_t work = {job, tasks, num_tasks, 0};
+    pthread_t thread_id[NUM_REDUCTION_WORKING_THREADS_ALLOC];
+    for (uint32_t i = 0; i < NUM_REDUCTION_WORKING_THREADS; i++) {
+        pthread_create(thread_id + i, NULL, statelist_worker_thread, &work);
+    }
+    for (uint32_t i = 0; i < NUM_REDUCTION_WORKING_THREADS; i++) {
+        pthread_join(thread_id[i], NULL);
+    }
 
-    if (cands->len[odd_even] == 0) {
-        free(cands->states[odd_even]);
-        cands->states[odd_even] = NULL;
-    } else if (cands->len[odd_even] + 1 < worstcase_size) {
-        cands->states[odd_even] = realloc(cands->states[odd_even], sizeof(uint32_t) * (cands->len[odd_even] + 1));
+    for (uint32_t i = 0; i < num_tasks; i++) {
+        join_statelist_chunks(job, &tasks[i]);
     }
-    free_bitarray(cands_bitarray);
+}
 
-    pthread_mutex_lock(&statelist_cache_mutex);
-    sl_cache[part_sum_a0 / 2][part_sum_a8 / 2][odd_even].sl = cands->states[odd_even];
-    sl_cache[part_sum_a0 / 2][part_sum_a8 / 2][odd_even].len = cands->len[odd_even];
-    sl_cache[part_sum_a0 / 2][part_sum_a8 / 2][odd_even].cache_status = COMPLETED;
-    pthread_mutex_unlock(&statelist_cache_mutex);
-    return;
+static void print_statelists_time(hardnested_job_t *job, uint32_t num_lists, uint64_t build_start, float brute_force) {
+    char progress_text[80];
+    snprintf(progress_text, sizeof(progress_text), "Built %" PRIu32 " candidate state lists in %" PRIu64 " ms",
+             num_lists, msclock() - build_start);
+    hardnested_print_progress(job->num_acquired_nonces, progress_text, brute_force, 0);
 }
 
-static statelist_t *add_more_candidates(void) {
+static statelist_t *add_more_candidates(hardnested_job_t *job) {
     statelist_t *new_candidates;
-    if (candidates == NULL) {
-        candidates = (statelist_t *) calloc(sizeof(statelist_t), sizeof(uint8_t));
-        new_candidates = candidates;
+    if (job->candidates == NULL) {
+        job->candidates = (statelist_t *) calloc(sizeof(statelist_t), sizeof(uint8_t));
+        new_candidates = job->candidates;
     } else {
-        new_candidates = candidates;
+        new_candidates = job->candidates;
         while (new_candidates->next != NULL) {
             new_candidates = new_candidates->next;
         }
@@ -1542,232 +2107,141 @@ static statelist_t *add_more_candidates(void) {
     return new_candidates;
 }
 
-static void add_bitflip_candidates(uint8_t byte) {
-    statelist_t *candidates1 = add_more_candidates();
+static void add_bitflip_candidates(hardnested_job_t *job, uint8_t byte) {
+    uint64_t build_start = msclock();
+    statelist_t *candidates1 = add_more_candidates(job);
 
+    sl_cache_entry_t lists[2];
+    statelist_task_t *tasks = (statelist_task_t *) calloc(2, sizeof(statelist_task_t));
+    if (tasks == NULL) {
+        PrintAndLogEx(ERR, "Out of memory error in add_bitflip_candidates()");
+        exit(4);
+    }
     for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
-        uint32_t worstcase_size = nonces[byte].num_states_bitarray[odd_even] + 1;
-        candidates1->states[odd_even] = (uint32_t *) calloc(worstcase_size, sizeof(uint32_t));
-        if (candidates1->states[odd_even] == NULL) {
-            PrintAndLogEx(ERR, "Out of memory error in add_bitflip_candidates()");
-            exit(4);
-        }
-
-        bitarray_to_list(byte, nonces[byte].states_bitarray[odd_even], candidates1->states[odd_even],
-                         &(candidates1->len[odd_even]), odd_even);
+        tasks[odd_even].byte = byte;
+        tasks[odd_even].odd_even = odd_even;
+        tasks[odd_even].bitarrays[0] = job->nonces[byte].states_bitarray[odd_even];
+        tasks[odd_even].result = &lists[odd_even];
+    }
+    build_statelists(job, tasks, 2);
+    free(tasks);
 
-        // slim down the allocated memory.
-        if (candidates1->len[odd_even] + 1 < worstcase_size) {
-            candidates1->states[odd_even] = realloc(candidates1->states[odd_even],
-                                                    sizeof(uint32_t) * (candidates1->len[odd_even] + 1));
-        }
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        candidates1->states[odd_even] = lists[odd_even].sl;
+        candidates1->len[odd_even] = lists[odd_even].len;
+    }
+    print_statelists_time(job, 2, build_start, (float) candidates1->len[ODD_STATE] * candidates1->len[EVEN_STATE] / 2.0);
+    if (have_key_hint()) {
+        print_key_hint_pruned(job, (float) candidates1->len[ODD_STATE] * candidates1->len[EVEN_STATE] / 2.0);
     }
-    return;
 }
 
-static work_status_t book_of_work[NUM_PART_SUMS][NUM_PART_SUMS][NUM_PART_SUMS][NUM_PART_SUMS];
+static inline bool part_sums_match(uint8_t part_sum_idx1, uint8_t part_sum_idx2, uint16_t sum) {
+    return 2 * part_sum_idx1 * (16 - 2 * part_sum_idx2) + (16 - 2 * part_sum_idx1) * 2 * part_sum_idx2 == sum;
+}
 
-static void init_book_of_work(void) {
+// Queue the odd or even state lists of all (p, q, r, s) part sum combinations matching Sum(a0) and Sum(a8),
+// each list once. The odd lists are (p, r), the even lists (q, s) and are only needed next to a non empty odd list.
+static uint32_t queue_matching_states(hardnested_job_t *job, statelist_task_t *tasks, uint16_t sum_a0, uint16_t sum_a8, odd_even_t odd_even) {
+    uint32_t num_tasks = 0;
     for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
         for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
+            if (!part_sums_match(p, q, sum_a0)) {
+                continue;
+            }
             for (uint8_t r = 0; r < NUM_PART_SUMS; r++) {
                 for (uint8_t s = 0; s < NUM_PART_SUMS; s++) {
-                    book_of_work[p][q][r][s] = TO_BE_DONE;
+                    if (!part_sums_match(r, s, sum_a8)) {
+                        continue;
+                    }
+                    uint8_t part_sum_a0_idx = (odd_even == ODD_STATE) ? p : q;
+                    uint8_t part_sum_a8_idx = (odd_even == ODD_STATE) ? r : s;
+                    sl_cache_entry_t *entry = &job->sl_cache[part_sum_a0_idx][part_sum_a8_idx][odd_even];
+                    if (entry->cache_status != TO_BE_DONE) {
+                        continue;
+                    }
+                    if (odd_even == EVEN_STATE && job->sl_cache[p][r][ODD_STATE].len == 0) {
+                        continue;
+                    }
+                    entry->cache_status = WORK_IN_PROGRESS;
+                    statelist_task_t *task = &tasks[num_tasks++];
+                    memset(task, 0, sizeof(statelist_task_t));
+                    task->byte = job->best_first_bytes[0];
+                    task->odd_even = odd_even;
+                    task->bitarrays[0] = job->part_sum_a0_bitarrays[odd_even][part_sum_a0_idx];
+                    task->bitarrays[1] = job->part_sum_a8_bitarrays[odd_even][part_sum_a8_idx];
+                    task->bitarrays[2] = job->nonces[job->best_first_bytes[0]].states_bitarray[odd_even];
+                    task->result = entry;
                 }
             }
         }
     }
+    return num_tasks;
 }
 
-static void
-#ifdef __has_attribute
-#if __has_attribute(force_align_arg_pointer)
-__attribute__((force_align_arg_pointer))
-#endif
-#endif
-*generate_candidates_worker_thread(void *args) {
-    uint16_t *sum_args = (uint16_t *) args;
-    uint16_t sum_a0 = sums[sum_args[0]];
-    uint16_t sum_a8 = sums[sum_args[1]];
-    // uint16_t my_thread_number = sums[2];
-
-    bool there_might_be_more_work = true;
-    do {
-        there_might_be_more_work = false;
-        for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
-            for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
-                if (2 * p * (16 - 2 * q) + (16 - 2 * p) * 2 * q == sum_a0) {
-                    // PrintAndLogEx(INFO, "Reducing Partial Statelists (p,q) = (%d,%d) with lengths %d, %d",
-                    // p, q, partial_statelist[p].len[ODD_STATE], partial_statelist[q].len[EVEN_STATE]);
-                    for (uint8_t r = 0; r < NUM_PART_SUMS; r++) {
-                        for (uint8_t s = 0; s < NUM_PART_SUMS; s++) {
-                            if (2 * r * (16 - 2 * s) + (16 - 2 * r) * 2 * s == sum_a8) {
-                                pthread_mutex_lock(&book_of_work_mutex);
-                                if (book_of_work[p][q][r][s] !=
-                                        TO_BE_DONE) {  // this has been done or is currently been done by another thread. Look for some other work.
-                                    pthread_mutex_unlock(&book_of_work_mutex);
-                                    continue;
-                                }
-
-                                pthread_mutex_lock(&statelist_cache_mutex);
-                                if (sl_cache[p][r][ODD_STATE].cache_status == WORK_IN_PROGRESS ||
-                                        sl_cache[q][s][EVEN_STATE].cache_status ==
-                                        WORK_IN_PROGRESS) { // defer until not blocked by another thread.
-                                    pthread_mutex_unlock(&statelist_cache_mutex);
-                                    pthread_mutex_unlock(&book_of_work_mutex);
-                                    there_might_be_more_work = true;
-                                    continue;
-                                }
 
-                                // we finally can do some work.
-                                book_of_work[p][q][r][s] = WORK_IN_PROGRESS;
-                                statelist_t *current_candidates = add_more_candidates();
+static void generate_candidates(hardnested_job_t *job, uint8_t sum_a0_idx, uint8_t sum_a8_idx) {
+    uint16_t sum_a0 = sums[sum_a0_idx];
+    uint16_t sum_a8 = sums[sum_a8_idx];
+    uint64_t build_start = msclock();
 
-                                // Check for cached results and add them first
-                                bool odd_completed = false;
-                                if (sl_cache[p][r][ODD_STATE].cache_status == COMPLETED) {
-                                    add_cached_states(current_candidates, 2 * p, 2 * r, ODD_STATE);
-                                    odd_completed = true;
-                                }
-                                bool even_completed = false;
-                                if (sl_cache[q][s][EVEN_STATE].cache_status == COMPLETED) {
-                                    add_cached_states(current_candidates, 2 * q, 2 * s, EVEN_STATE);
-                                    even_completed = true;
-                                }
+    init_statelist_cache(job);
 
-                                bool work_required = true;
-
-                                // if there had been two cached results, there is no more work to do
-                                if (even_completed && odd_completed) {
-                                    work_required = false;
-                                }
-
-                                // if there had been one cached empty result, there is no need to calculate the other part:
-                                if (work_required) {
-                                    if (even_completed && !current_candidates->len[EVEN_STATE]) {
-                                        current_candidates->len[ODD_STATE] = 0;
-                                        current_candidates->states[ODD_STATE] = NULL;
-                                        work_required = false;
-                                    }
-                                    if (odd_completed && !current_candidates->len[ODD_STATE]) {
-                                        current_candidates->len[EVEN_STATE] = 0;
-                                        current_candidates->states[EVEN_STATE] = NULL;
-                                        work_required = false;
-                                    }
-                                }
-
-                                if (work_required == false) {
-                                    pthread_mutex_unlock(&statelist_cache_mutex);
-                                    pthread_mutex_unlock(&book_of_work_mutex);
-                                } else {
-                                    // we really need to calculate something
-                                    if (even_completed) { // we had one cache hit with non-zero even states
-                                        // PrintAndLogEx(INFO, "Thread #%u: start working on  odd states p=%2d, r=%2d...", my_thread_number, p, r);
-                                        sl_cache[p][r][ODD_STATE].cache_status = WORK_IN_PROGRESS;
-                                        pthread_mutex_unlock(&statelist_cache_mutex);
-                                        pthread_mutex_unlock(&book_of_work_mutex);
-                                        add_matching_states(current_candidates, 2 * p, 2 * r, ODD_STATE);
-                                        work_required = false;
-                                    } else if (odd_completed) { // we had one cache hit with non-zero odd_states
-                                        // PrintAndLogEx(INFO, "Thread #%u: start working on even states q=%2d, s=%2d...", my_thread_number, q, s);
-                                        sl_cache[q][s][EVEN_STATE].cache_status = WORK_IN_PROGRESS;
-                                        pthread_mutex_unlock(&statelist_cache_mutex);
-                                        pthread_mutex_unlock(&book_of_work_mutex);
-                                        add_matching_states(current_candidates, 2 * q, 2 * s, EVEN_STATE);
-                                        work_required = false;
-                                    }
-                                }
-
-                                if (work_required) { // we had no cached result. Need to calculate both odd and even
-                                    sl_cache[p][r][ODD_STATE].cache_status = WORK_IN_PROGRESS;
-                                    sl_cache[q][s][EVEN_STATE].cache_status = WORK_IN_PROGRESS;
-                                    pthread_mutex_unlock(&statelist_cache_mutex);
-                                    pthread_mutex_unlock(&book_of_work_mutex);
-
-                                    add_matching_states(current_candidates, 2 * p, 2 * r, ODD_STATE);
-                                    if (current_candidates->len[ODD_STATE]) {
-                                        // PrintAndLogEx(INFO, "Thread #%u: start working on even states q=%2d, s=%2d...", my_thread_number, q, s);
-                                        add_matching_states(current_candidates, 2 * q, 2 * s, EVEN_STATE);
-                                    } else { // no need to calculate even states yet
-                                        pthread_mutex_lock(&statelist_cache_mutex);
-                                        sl_cache[q][s][EVEN_STATE].cache_status = TO_BE_DONE;
-                                        pthread_mutex_unlock(&statelist_cache_mutex);
-                                        current_candidates->len[EVEN_STATE] = 0;
-                                        current_candidates->states[EVEN_STATE] = NULL;
-                                    }
-                                }
+    statelist_task_t *tasks = (statelist_task_t *) calloc(NUM_PART_SUMS * NUM_PART_SUMS, sizeof(statelist_task_t));
+    if (tasks == NULL) {
+        PrintAndLogEx(ERR, "Out of memory error in generate_candidates()");
+        exit(4);
+    }
+    uint32_t num_odd_lists = queue_matching_states(job, tasks, sum_a0, sum_a8, ODD_STATE);
+    build_statelists(job, tasks, num_odd_lists);
+    uint32_t num_even_lists = queue_matching_states(job, tasks, sum_a0, sum_a8, EVEN_STATE);
+    build_statelists(job, tasks, num_even_lists);
+    free(tasks);
 
-                                // update book of work
-                                pthread_mutex_lock(&book_of_work_mutex);
-                                book_of_work[p][q][r][s] = COMPLETED;
-                                pthread_mutex_unlock(&book_of_work_mutex);
-
-                                // if ((uint64_t)current_candidates->len[ODD_STATE] * current_candidates->len[EVEN_STATE]) {
-                                // PrintAndLogEx(INFO, "Candidates for p=%2u, q=%2u, r=%2u, s=%2u: %" PRIu32 " * %" PRIu32 " = %" PRIu64 " (2^%0.1f)\n",
-                                // 2*p, 2*q, 2*r, 2*s, current_candidates->len[ODD_STATE], current_candidates->len[EVEN_STATE],
-                                // (uint64_t)current_candidates->len[ODD_STATE] * current_candidates->len[EVEN_STATE],
-                                // log((uint64_t)current_candidates->len[ODD_STATE] * current_candidates->len[EVEN_STATE])/log(2));
-                                // uint32_t estimated_odd = estimated_num_states_part_sum(best_first_bytes[0], p, r, ODD_STATE);
-                                // uint32_t estimated_even= estimated_num_states_part_sum(best_first_bytes[0], q, s, EVEN_STATE);
-                                // uint64_t estimated_total = (uint64_t)estimated_odd * estimated_even;
-                                // PrintAndLogEx(INFO, "Estimated: %" PRIu32 " * %" PRIu32 " = %" PRIu64 " (2^%0.1f)\n", estimated_odd, estimated_even, estimated_total, log(estimated_total) / log(2));
-                                // if (estimated_odd < current_candidates->len[ODD_STATE] || estimated_even < current_candidates->len[EVEN_STATE]) {
-                                // PrintAndLogEx(INFO, "############################################################################ERROR! ESTIMATED < REAL !!!\n");
-                                // //exit(2);
-                                // }
-                                // }
-                            }
-                        }
+    // the candidates in the order of the part sum combinations, the lists stay owned by the statelist cache
+    for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
+        for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
+            if (!part_sums_match(p, q, sum_a0)) {
+                continue;
+            }
+            for (uint8_t r = 0; r < NUM_PART_SUMS; r++) {
+                for (uint8_t s = 0; s < NUM_PART_SUMS; s++) {
+                    if (!part_sums_match(r, s, sum_a8)) {
+                        continue;
+                    }
+                    statelist_t *current_candidates = add_more_candidates(job);
+                    sl_cache_entry_t *odd = &job->sl_cache[p][r][ODD_STATE];
+                    sl_cache_entry_t *even = &job->sl_cache[q][s][EVEN_STATE];
+                    if (odd->len > 0 && even->len > 0) {
+                        current_candidates->states[ODD_STATE] = odd->sl;
+                        current_candidates->len[ODD_STATE] = odd->len;
+                        current_candidates->states[EVEN_STATE] = even->sl;
+                        current_candidates->len[EVEN_STATE] = even->len;
                     }
                 }
             }
         }
-    } while (there_might_be_more_work);
-
-    return NULL;
-}
-
-
-static void generate_candidates(uint8_t sum_a0_idx, uint8_t sum_a8_idx) {
-
-    // create mutexes for accessing the statelist cache and our "book of work"
-    pthread_mutex_init(&statelist_cache_mutex, NULL);
-    pthread_mutex_init(&book_of_work_mutex, NULL);
-
-    init_statelist_cache();
-    init_book_of_work();
-
-    // create and run worker threads
-    pthread_t thread_id[NUM_REDUCTION_WORKING_THREADS_ALLOC];
-
-    uint16_t sums1[NUM_REDUCTION_WORKING_THREADS_ALLOC][3];
-    for (uint32_t i = 0; i < NUM_REDUCTION_WORKING_THREADS; i++) {
-        sums1[i][0] = sum_a0_idx;
-        sums1[i][1] = sum_a8_idx;
-        sums1[i][2] = i + 1;
-        pthread_create(thread_id + i, NULL, generate_candidates_worker_thread, sums1[i]);
     }
 
-    // wait for threads to terminate:
-    for (uint32_t i = 0; i < NUM_REDUCTION_WORKING_THREADS; i++) {
-        pthread_join(thread_id[i], NULL);
-    }
-
-    maximum_states = 0;
-    for (statelist_t *sl = candidates; sl != NULL; sl = sl->next) {
-        maximum_states += (uint64_t) sl->len[ODD_STATE] * sl->len[EVEN_STATE];
+    job->maximum_states = 0;
+    for (statelist_t *sl = job->candidates; sl != NULL; sl = sl->next) {
+        job->maximum_states += (uint64_t) sl->len[ODD_STATE] * sl->len[EVEN_STATE];
     }
 
     for (uint8_t i = 0; i < NUM_SUMS; i++) {
-        if (nonces[best_first_bytes[0]].sum_a8_guess[i].sum_a8_idx == sum_a8_idx) {
-            nonces[best_first_bytes[0]].sum_a8_guess[i].num_states = maximum_states;
+        if (job->nonces[job->best_first_bytes[0]].sum_a8_guess[i].sum_a8_idx == sum_a8_idx) {
+            job->nonces[job->best_first_bytes[0]].sum_a8_guess[i].num_states = job->maximum_states;
             break;
         }
     }
-    update_expected_brute_force(best_first_bytes[0]);
+    update_expected_brute_force(job, job->best_first_bytes[0]);
 
-    hardnested_print_progress(num_acquired_nonces, "Apply Sum(a8) and all bytes bitflip properties",
-                              nonces[best_first_bytes[0]].expected_num_brute_force, 0);
+    print_statelists_time(job, num_odd_lists + num_even_lists, build_start, job->nonces[job->best_first_bytes[0]].expected_num_brute_force);
+    if (have_key_hint()) {
+        print_key_hint_pruned(job, job->nonces[job->best_first_bytes[0]].expected_num_brute_force);
+    }
+    hardnested_print_progress(job->num_acquired_nonces, "Apply Sum(a8) and all bytes bitflip properties",
+                              job->nonces[job->best_first_bytes[0]].expected_num_brute_force, 0);
 }
 
 static void free_candidates_memory(statelist_t *sl) {
@@ -1780,26 +2254,85 @@ static void free_candidates_memory(statelist_t *sl) {
     free(sl);
 }
 
-static void pre_XOR_nonces(void) {
+static void pre_XOR_nonces(hardnested_job_t *job) {
     // prepare acquired nonces for faster brute forcing.
 
     // XOR the cryptoUID and its parity
     for (uint16_t i = 0; i < 256; i++) {
-        noncelistentry_t *test_nonce = nonces[i].first;
+        noncelistentry_t *test_nonce = job->nonces[i].first;
         while (test_nonce != NULL) {
-            test_nonce->nonce_enc ^= cuid;
-            test_nonce->par_enc ^= oddparity8(cuid >> 0 & 0xff) << 0;
-            test_nonce->par_enc ^= oddparity8(cuid >> 8 & 0xff) << 1;
-            test_nonce->par_enc ^= oddparity8(cuid >> 16 & 0xff) << 2;
-            test_nonce->par_enc ^= oddparity8(cuid >> 24 & 0xff) << 3;
+            test_nonce->nonce_enc ^= job->cuid;
+            test_nonce->par_enc ^= oddparity8(job->cuid >> 0 & 0xff) << 0;
+            test_nonce->par_enc ^= oddparity8(job->cuid >> 8 & 0xff) << 1;
+            test_nonce->par_enc ^= oddparity8(job->cuid >> 16 & 0xff) << 2;
+            test_nonce->par_enc ^= oddparity8(job->cuid >> 24 & 0xff) << 3;
             test_nonce = test_nonce->next;
         }
     }
 }
 
-static bool brute_force(uint64_t *found_key) {
-    return brute_force_bs(NULL, candidates, cuid, num_acquired_nonces, maximum_states, nonces, best_first_bytes,
-                          found_key);
+static bool brute_force(hardnested_job_t *job, uint64_t *found_key) {
+    return brute_force_bs(job, NULL, found_key);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// brute force progress journal, to resume an interrupted run
+
+#define GUESS_NO_SUM_A8     0xff    // journal guess (and sum_a8 index) of the brute force ignoring Sum(a8)
+
+static char *progress_journal = NULL;
+static bool resume_progress_journal = false;
+
+void hardnested_set_journal(const char *path, bool resume) {
+    free(progress_journal);
+    progress_journal = (path != NULL) ? strdup(path) : NULL;
+    resume_progress_journal = resume;
+}
+
+static void open_journal(hardnested_job_t *job) {
+    // a key hint changes the buckets, their records only count with the same hint
+    uint64_t run_hash = job->nonces_hash;
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        if (state_hint[odd_even].count > 0) {
+            run_hash = tables_cache_hash(run_hash, state_hint[odd_even].patterns, sizeof(key_pattern_t) * state_hint[odd_even].count);
+        }
+    }
+    if (progress_journal != NULL &&
+            !journal_open(progress_journal, resume_progress_journal, run_hash, job->best_first_bytes, 2)) {
+        PrintAndLogEx(WARNING, "Could not write the brute force journal %s", progress_journal);
+    }
+}
+
+static void journal_bucket_callback(void *ctx, uint32_t bucket) {
+    journal_bucket_done(*(uint8_t *) ctx, bucket);
+}
+
+// brute_force() over the candidates of a guess, skipping the buckets the journal has as tested
+static bool brute_force_guess(hardnested_job_t *job, uint8_t guess, uint8_t sum_a8_idx, uint64_t *found_key) {
+    if (!journal_is_open()) {
+        return brute_force(job, found_key);
+    }
+    uint32_t num_buckets = 0;
+    for (statelist_t *p = job->candidates; p != NULL; p = p->next) {
+        num_buckets++;
+    }
+    brute_force_progress_t progress = {journal_start_guess(guess, sum_a8_idx, num_buckets), journal_bucket_callback, &guess};
+    if (progress.done != NULL) {
+        uint32_t num_done = 0;
+        for (uint32_t i = 0; i < num_buckets; i++) {
+            num_done += progress.done[i];
+        }
+        char progress_text[80];
+        snprintf(progress_text, sizeof(progress_text), "Resuming: %u of %u buckets tested before", num_done, num_buckets);
+        hardnested_print_progress(job->num_acquired_nonces, progress_text, job->nonces[job->best_first_bytes[0]].expected_num_brute_force, 0);
+    }
+    job->bf_progress = &progress;
+    bool key_found = brute_force(job, found_key);
+    job->bf_progress = NULL;
+    if (!key_found && !hardnested_job_cancelled(job)) {
+        journal_exhaust_guess(guess);
+    }
+    return key_found;
 }
 
 static uint16_t SumProperty(struct Crypto1State *s) {
@@ -1809,72 +2342,73 @@ static uint16_t SumProperty(struct Crypto1State *s) {
 }
 
 
-static uint16_t real_sum_a8 = 0;
-
-static void set_test_state(uint8_t byte) {
+static void set_test_state(hardnested_job_t *job, uint8_t byte) {
     struct Crypto1State *pcs;
-    pcs = crypto1_create(known_target_key);
-    crypto1_byte(pcs, (cuid >> 24) ^ byte, true);
-    test_state[ODD_STATE] = pcs->odd & 0x00ffffff;
-    test_state[EVEN_STATE] = pcs->even & 0x00ffffff;
-    real_sum_a8 = SumProperty(pcs);
+    pcs = crypto1_create(job->known_target_key);
+    crypto1_byte(pcs, (job->cuid >> 24) ^ byte, true);
+    job->test_state[ODD_STATE] = pcs->odd & 0x00ffffff;
+    job->test_state[EVEN_STATE] = pcs->even & 0x00ffffff;
+    job->real_sum_a8 = SumProperty(pcs);
     crypto1_destroy(pcs);
 }
 
-static void init_it_all(void) {
-    memset(nonces, 0, sizeof(nonces));
-    maximum_states = 0;
-    best_first_byte_smallest_bitarray = 0;
-    first_byte_Sum = 0;
-    first_byte_num = 0;
+static void init_it_all(hardnested_job_t *job) {
+    volatile int *cancel = job->cancel;
+    memset(job, 0, sizeof(hardnested_job_t));
+    job->cancel = cancel;
+    job->stage = CHECK_1ST_BYTES;
+    init_statelist_cache(job);
+
     write_stats = false;
-    all_bitflips_bitarray[0] = NULL;
-    all_bitflips_bitarray[1] = NULL;
-    num_all_bitflips_bitarray[0] = 0;
-    num_all_bitflips_bitarray[1] = 0;
-    all_bitflips_bitarray_dirty[0] = false;
-    all_bitflips_bitarray_dirty[1] = false;
-    last_sample_clock = 0;
-    sample_period = 0;
-    num_keys_tested = 0;
-    candidates = NULL;
-    num_acquired_nonces = 0;
     start_time = 0;
     num_effective_bitflips[0] = 0;
     num_effective_bitflips[1] = 0;
     num_all_effective_bitflips = 0;
     num_1st_byte_effective_bitflips = 0;
-    hardnested_stage = CHECK_1ST_BYTES;
-    known_target_key = 0;
-    test_state[0] = 0;
-    test_state[1] = 0;
     brute_force_per_second = 0;
-    init_book_of_work();
-    real_sum_a8 = 0;
 
     memset(effective_bitflip, 0, sizeof(effective_bitflip));
     memset(all_effective_bitflip, 0, sizeof(all_effective_bitflip));
-    memset(bitflip_bitarrays, 0, sizeof(bitflip_bitarrays));
-    memset(count_bitflip_bitarrays, 0, sizeof(count_bitflip_bitarrays));
-    memset(part_sum_a0_bitarrays, 0, sizeof(part_sum_a0_bitarrays));
-    memset(part_sum_a8_bitarrays, 0, sizeof(part_sum_a8_bitarrays));
-    memset(sum_a0_bitarrays, 0, sizeof(sum_a0_bitarrays));
+    if (!session_open) {
+        init_table_pointers();
+    }
 }
 
-int
-mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey,
-             bool nonce_file_read, bool nonce_file_write, bool slow, uint64_t *foundkey, char *filename, uint32_t uid, char *path) {
+// memory of one attack, the tables of a session stay
+static void free_attack_memory(hardnested_job_t *job) {
+    free_nonces_memory(job);
+    free_bitarray(job->all_bitflips_bitarray[ODD_STATE]);
+    free_bitarray(job->all_bitflips_bitarray[EVEN_STATE]);
+    free_job_part_sums(job);
+    if (!session_open) {
+        free_bitflip_bitarrays();
+        free_sum_bitarrays();
+        tables_cache_close();
+    }
+}
+
+hardnested_job_t *hardnested_job_new(void) {
+    return (hardnested_job_t *) calloc(1, sizeof(hardnested_job_t));
+}
+
+void hardnested_job_free(hardnested_job_t *job) {
+    free(job);
+}
+
+void hardnested_job_set_cancel(hardnested_job_t *job, volatile int *cancel) {
+    job->cancel = cancel;
+}
+
+int mfnestedhard_source(hardnested_job_t *job, uint32_t uid, const hardnested_nonce_source_t *source, uint8_t *trgkey, uint64_t *foundkey) {
     char progress_text[80];
     char instr_set[12] = {0};
 
     get_SIMD_instruction_set(instr_set);
 
-    // initialize static arrays
-    memset(part_sum_count, 0, sizeof(part_sum_count));
-    init_it_all();
+    init_it_all(job);
 
     srand((unsigned) time(NULL));
-    brute_force_per_second = brute_force_benchmark();
+    brute_force_per_second = session_open ? session_brute_force_per_second : hardnested_benchmark(rebenchmark);
     // set the correct locale for the stats printing
     write_stats = true;
     setlocale(LC_NUMERIC, "");
@@ -1884,96 +2418,152 @@ mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo,
     snprintf(progress_text, sizeof(progress_text), "Brute force benchmark: %1.0f million (2^%1.1f) keys/s",
              brute_force_per_second / 1000000, log(brute_force_per_second) / log(2.0));
     hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+    if (have_key_hint()) {
+        print_key_hint_space();
+    }
 
     if (trgkey != NULL) {
-        known_target_key = bytes_to_num(trgkey, 6);
+        job->known_target_key = bytes_to_num(trgkey, 6);
     } else {
-        known_target_key = -1;
+        job->known_target_key = -1;
     }
 
-    init_bitflip_bitarrays();
-    init_part_sum_bitarrays();
-    init_sum_bitarrays();
-    init_allbitflips_array();
-    init_nonce_memory();
-    update_reduction_rate(0.0, true);
+    if (session_open) {
+        init_effective_bitflips(tables_cached);
+    } else {
+        init_tables();
+    }
+    init_job_part_sums(job);
+    init_allbitflips_array(job);
+    init_nonce_memory(job);
+    update_reduction_rate(job, 0.0, true);
 
-    int res = simulate_acquire_nonces(uid, path);
+    int res = simulate_acquire_nonces(job, uid, source);
     if (res != 0) {
+        free_attack_memory(job);
         return -1;
     }
 
-    set_test_state(best_first_bytes[0]);
+    set_test_state(job, job->best_first_bytes[0]);
 
-    free_bitflip_bitarrays();
+    // not needed for the brute force, but for the next attack of a session
+    if (!session_open) {
+        free_bitflip_bitarrays();
+    }
 
     bool key_found = false;
-    num_keys_tested = 0;
-    uint32_t num_odd = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[ODD_STATE];
-    uint32_t num_even = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[EVEN_STATE];
+    uint32_t num_odd = job->nonces[job->best_first_byte_smallest_bitarray].num_states_bitarray[ODD_STATE];
+    uint32_t num_even = job->nonces[job->best_first_byte_smallest_bitarray].num_states_bitarray[EVEN_STATE];
     float expected_brute_force1 = (float) num_odd * num_even / 2.0;
-    float expected_brute_force2 = nonces[best_first_bytes[0]].expected_num_brute_force;
+    float expected_brute_force2 = job->nonces[job->best_first_bytes[0]].expected_num_brute_force;
 
     if (expected_brute_force1 < expected_brute_force2) {
-        hardnested_print_progress(num_acquired_nonces, "(Ignoring Sum(a8) properties)", expected_brute_force1,
+        hardnested_print_progress(job->num_acquired_nonces, "(Ignoring Sum(a8) properties)", expected_brute_force1,
                                   0);
-        set_test_state(best_first_byte_smallest_bitarray);
-        add_bitflip_candidates(best_first_byte_smallest_bitarray);
-        maximum_states = 0;
-        for (statelist_t *sl = candidates; sl != NULL; sl = sl->next) {
-            maximum_states += (uint64_t) sl->len[ODD_STATE] * sl->len[EVEN_STATE];
-        }
-
-        best_first_bytes[0] = best_first_byte_smallest_bitarray;
-        pre_XOR_nonces();
-        prepare_bf_test_nonces(nonces, best_first_bytes[0]);
-
-        key_found = brute_force(foundkey);
-        free(candidates->states[ODD_STATE]);
-        free(candidates->states[EVEN_STATE]);
-        free_candidates_memory(candidates);
-        candidates = NULL;
+        set_test_state(job, job->best_first_byte_smallest_bitarray);
+        add_bitflip_candidates(job, job->best_first_byte_smallest_bitarray);
+        job->maximum_states = 0;
+        for (statelist_t *sl = job->candidates; sl != NULL; sl = sl->next) {
+            job->maximum_states += (uint64_t) sl->len[ODD_STATE] * sl->len[EVEN_STATE];
+        }
+
+        job->best_first_bytes[0] = job->best_first_byte_smallest_bitarray;
+        pre_XOR_nonces(job);
+        prepare_bf_test_nonces(job, job->best_first_bytes[0]);
+
+        open_journal(job);
+        if (journal_guess_exhausted(GUESS_NO_SUM_A8, GUESS_NO_SUM_A8)) {
+            hardnested_print_progress(job->num_acquired_nonces, "(All candidates tested before)", 0.0, 0);
+        } else {
+            key_found = brute_force_guess(job, GUESS_NO_SUM_A8, GUESS_NO_SUM_A8, foundkey);
+        }
+        free(job->candidates->states[ODD_STATE]);
+        free(job->candidates->states[EVEN_STATE]);
+        free_candidates_memory(job->candidates);
+        job->candidates = NULL;
     } else {
-        pre_XOR_nonces();
-        prepare_bf_test_nonces(nonces, best_first_bytes[0]);
-        for (uint8_t j = 0; j < NUM_SUMS && !key_found; j++) {
-            float expected_brute_force = nonces[best_first_bytes[0]].expected_num_brute_force;
+        pre_XOR_nonces(job);
+        prepare_bf_test_nonces(job, job->best_first_bytes[0]);
+        open_journal(job);
+        for (uint8_t j = 0; j < NUM_SUMS && !key_found && !hardnested_job_cancelled(job); j++) {
+            float expected_brute_force = job->nonces[job->best_first_bytes[0]].expected_num_brute_force;
             snprintf(progress_text, sizeof(progress_text), "(%d. guess: Sum(a8) = %" PRIu16 ")", j + 1,
-                     sums[nonces[best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx]);
-            hardnested_print_progress(num_acquired_nonces, progress_text, expected_brute_force, 0);
-            if (sums[nonces[best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx] != real_sum_a8) {
+                     sums[job->nonces[job->best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx]);
+            hardnested_print_progress(job->num_acquired_nonces, progress_text, expected_brute_force, 0);
+            if (sums[job->nonces[job->best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx] != job->real_sum_a8) {
                 snprintf(progress_text, sizeof(progress_text),
-                         "(Estimated Sum(a8) is WRONG! Correct Sum(a8) = %" PRIu16 ")", real_sum_a8);
-                hardnested_print_progress(num_acquired_nonces, progress_text, expected_brute_force, 0);
+                         "(Estimated Sum(a8) is WRONG! Correct Sum(a8) = %" PRIu16 ")", job->real_sum_a8);
+                hardnested_print_progress(job->num_acquired_nonces, progress_text, expected_brute_force, 0);
             }
-            generate_candidates(first_byte_Sum, nonces[best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx);
+            uint8_t sum_a8_idx = job->nonces[job->best_first_bytes[0]].sum_a8_guess[j].sum_a8_idx;
+            if (journal_guess_exhausted(j, sum_a8_idx)) {
+                hardnested_print_progress(job->num_acquired_nonces, "(All candidates of this guess tested before)", expected_brute_force, 0);
+            } else {
+                generate_candidates(job, job->first_byte_Sum, sum_a8_idx);
 
-            key_found = brute_force(foundkey);
-            free_statelist_cache();
-            free_candidates_memory(candidates);
-            candidates = NULL;
+                key_found = brute_force_guess(job, j, sum_a8_idx, foundkey);
+                free_statelist_cache(job);
+                free_candidates_memory(job->candidates);
+                job->candidates = NULL;
+            }
             if (key_found == false) {
                 // update the statistics
-                nonces[best_first_bytes[0]].sum_a8_guess[j].prob = 0;
-                nonces[best_first_bytes[0]].sum_a8_guess[j].num_states = 0;
+                job->nonces[job->best_first_bytes[0]].sum_a8_guess[j].prob = 0;
+                job->nonces[job->best_first_bytes[0]].sum_a8_guess[j].num_states = 0;
                 // and calculate new expected number of brute forces
-                update_expected_brute_force(best_first_bytes[0]);
+                update_expected_brute_force(job, job->best_first_bytes[0]);
             }
         }
     }
 
-    free_nonces_memory();
-    free_bitarray(all_bitflips_bitarray[ODD_STATE]);
-    free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
-    free_sum_bitarrays();
-    free_part_sum_bitarrays();
+    if (hardnested_job_cancelled(job)) {
+        hardnested_print_progress(job->num_acquired_nonces, "Brute force cancelled", 0.0, 0);
+    }
+    free_attack_memory(job);
+    journal_close(!hardnested_job_cancelled(job));
 
     return key_found;
 }
 
-char *run_hardnested(uint32_t uid, char* path) {
+typedef struct {
+    const hardnested_nonce_t *list;
+    uint32_t count;
+    uint32_t next;
+} nonce_array_t;
+
+static bool next_array_nonce(void *ctx, hardnested_nonce_t *nonce) {
+    nonce_array_t *array = (nonce_array_t *) ctx;
+    if (array->next == array->count) {
+        return false;
+    }
+    *nonce = array->list[array->next++];
+    return true;
+}
+
+int mfnestedhard_list(hardnested_job_t *job, uint32_t uid, const hardnested_nonce_t *nonce_list, uint32_t nonce_count,
+                      uint8_t *trgkey, uint64_t *foundkey) {
+    nonce_array_t array = {nonce_list, nonce_count, 0};
+    hardnested_nonce_source_t source = {next_array_nonce, NULL, &array};
+    return mfnestedhard_source(job, uid, &source, trgkey, foundkey);
+}
+
+int
+mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey,
+             bool nonce_file_read, bool nonce_file_write, bool slow, uint64_t *foundkey, char *filename, uint32_t uid,
+             const hardnested_nonce_t *nonce_list, uint32_t nonce_count) {
+    hardnested_job_t *job = hardnested_job_new();
+    if (job == NULL) {
+        PrintAndLogEx(ERR, "Out of memory error in mfnestedhard()");
+        return -1;
+    }
+    int res = mfnestedhard_list(job, uid, nonce_list, nonce_count, trgkey, foundkey);
+    hardnested_job_free(job);
+    return res;
+}
+
+char *run_hardnested(uint32_t uid, const hardnested_nonce_t *nonce_list, uint32_t nonce_count) {
     uint64_t foundkey = 0;
-    if (mfnestedhard(0, 0, NULL, 0, 0, NULL, false, false, false, &foundkey, NULL, uid, path) == 1) {
+    if (mfnestedhard(0, 0, NULL, 0, 0, NULL, false, false, false, &foundkey, NULL, uid, nonce_list, nonce_count) == 1) {
         char *keystr = malloc(14);
         snprintf(keystr, 14, "%012" PRIx64 ";", foundkey);
         return keystr;
@@ -20,10 +20,63 @@
 #define CMDHFMFHARD_H__
 
 #include "pm3/common.h"
+#include "key_hint.h"
+#include "hardnested/hardnested_bruteforce.h"
 
+// One acquired nonce: the encrypted nt and its 4 encrypted parity bits (first byte MSB)
+typedef struct {
+    uint32_t nt_enc;
+    uint8_t par_enc;
+} hardnested_nonce_t;
+
+// Nonces for mfnestedhard_source(). next() fills in the next nonce and may block until there is one,
+// it returns false when there are no more. done(), if set, is called once the key space is small
+// enough, before the brute force starts, and no more nonces are taken after that.
+typedef struct {
+    bool (*next)(void *ctx, hardnested_nonce_t *nonce);
+    void (*done)(void *ctx, uint32_t nonces_used);
+    void *ctx;
+} hardnested_nonce_source_t;
+
+// The state of one attack (hardnested/hardnested_job.h), reused by the attacks run with it one
+// after the other. NULL when out of memory.
+hardnested_job_t *hardnested_job_new(void);
+void hardnested_job_free(hardnested_job_t *job);
+// Stop the attacks of job once *cancel is non zero (NULL, default: never): no nonce is taken
+// anymore and the brute force stops between two work items, returning as without a key.
+// The journal of a stopped brute force is kept, to resume it.
+void hardnested_job_set_cancel(hardnested_job_t *job, volatile int *cancel);
+// Nonces are taken from the source one by one, until the key space is small enough
+int mfnestedhard_source(hardnested_job_t *job, uint32_t uid, const hardnested_nonce_source_t *source, uint8_t *trgkey, uint64_t *foundkey);
+// Nonces are taken from nonce_list in order, until the key space is small enough
+int mfnestedhard_list(hardnested_job_t *job, uint32_t uid, const hardnested_nonce_t *nonce_list, uint32_t nonce_count,
+                      uint8_t *trgkey, uint64_t *foundkey);
+// As mfnestedhard_list(), with a job of its own
 int
 mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey,
-             bool nonce_file_read, bool nonce_file_write, bool slow, uint64_t *foundkey, char *filename, uint32_t uid, char *path);
+             bool nonce_file_read, bool nonce_file_write, bool slow, uint64_t *foundkey, char *filename, uint32_t uid,
+             const hardnested_nonce_t *nonce_list, uint32_t nonce_count);
+// Directory of the on-disk tables cache, NULL (default) for none
+void hardnested_set_cache_dir(const char *dir);
+// Expand the tables and take the benchmark once for the mfnestedhard*() calls up to
+// hardnested_end(), instead of in every call. For cracking several keys back to back.
+void hardnested_begin(void);
+void hardnested_end(void);
+// Brute force keys/s for the progress estimates, measured once per CPU model, SIMD instruction
+// set and thread count and then taken from the benchmark cache, unless force is set
+float hardnested_benchmark(bool force);
+// Measure the benchmark again in mfnestedhard() instead of using the cached one
+void hardnested_set_rebenchmark(bool force);
+// Keep the bitflip tables compressed (hardnested_sparse_bitarray.h) instead of 2MB each,
+// for hosts with little memory. Slower on dense tables, and the tables cache isn't used.
+void hardnested_set_low_memory(bool enable);
+// Record the brute force progress in the journal at path (NULL, default: none), see
+// hardnested/hardnested_journal.h. With resume, the buckets and Sum(a8) guesses a journal of
+// the same nonces has as tested are skipped.
+void hardnested_set_journal(const char *path, bool resume);
+// Drop the candidate states not matching hint (key_hint.h, NULL: none) while the state lists are
+// built. The first key byte isn't in the candidate states, a hint on it alone prunes nothing.
+void hardnested_set_key_hint(const key_hint_t *hint);
 void hardnested_print_progress(uint32_t nonces, const char *activity, float brute_force, uint64_t min_diff_print_time);
 
 #endif
@@ -0,0 +1,185 @@
+//-----------------------------------------------------------------------------
+// Per host cache of the hardnested brute force benchmark, see hardnested_bench_cache.h
+//-----------------------------------------------------------------------------
+
+#include "hardnested_bench_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#define getpid _getpid
+#define make_dir(path) _mkdir(path)
+#else
+#include <unistd.h>
+#include <sys/stat.h>
+#define make_dir(path) mkdir(path, 0755)
+#endif
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#define BENCH_CACHE_LINE_LEN    512
+
+void bench_cache_cpu_model(char *buf, size_t len) {
+    snprintf(buf, len, "unknown CPU");
+#if defined(__i386__) || defined(__x86_64__)
+    uint32_t brand[12];
+    if (__get_cpuid_max(0x80000000, NULL) >= 0x80000004) {
+        for (uint32_t i = 0; i < 3; i++) {
+            __get_cpuid(0x80000002 + i, &brand[4 * i], &brand[4 * i + 1], &brand[4 * i + 2], &brand[4 * i + 3]);
+        }
+        char model[sizeof(brand) + 1] = {0};
+        memcpy(model, brand, sizeof(brand));
+        const char *start = model;
+        while (*start == ' ') {
+            start++;
+        }
+        snprintf(buf, len, "%s", start);
+    }
+#elif defined(__APPLE__)
+    size_t size = len;
+    if (sysctlbyname("machdep.cpu.brand_string", buf, &size, NULL, 0) != 0) {
+        snprintf(buf, len, "unknown CPU");
+    }
+#elif defined(__linux__)
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (f != NULL) {
+        char line[BENCH_CACHE_LINE_LEN];
+        while (fgets(line, sizeof(line), f) != NULL) {
+            // x86 and most others, then the ARM part number
+            if (strncmp(line, "model name", 10) == 0 || strncmp(line, "Hardware", 8) == 0 ||
+                    strncmp(line, "CPU part", 8) == 0) {
+                char *value = strchr(line, ':');
+                if (value != NULL) {
+                    snprintf(buf, len, "%s", value + 2);
+                    break;
+                }
+            }
+        }
+        fclose(f);
+    }
+#endif
+    // the model is part of a line of the cache file
+    for (char *p = buf; *p != '\0'; p++) {
+        if (*p == '\t' || *p == '\n' || *p == '\r') {
+            *p = (p[1] == '\0') ? '\0' : ' ';
+        }
+    }
+}
+
+bool bench_cache_default_dir(char *buf, size_t len) {
+#if defined(_WIN32)
+    const char *base = getenv("LOCALAPPDATA");
+    if (base == NULL || *base == '\0') {
+        return false;
+    }
+    snprintf(buf, len, "%s\\chameleon_ultra", base);
+#else
+    const char *base = getenv("XDG_CACHE_HOME");
+    if (base != NULL && *base != '\0') {
+        snprintf(buf, len, "%s/chameleon_ultra", base);
+    } else {
+        base = getenv("HOME");
+        if (base == NULL || *base == '\0') {
+            return false;
+        }
+        snprintf(buf, len, "%s/.cache/chameleon_ultra", base);
+    }
+#endif
+    return true;
+}
+
+// dir and its missing parents
+static void make_dirs(const char *dir) {
+    char path[BENCH_CACHE_LINE_LEN];
+    snprintf(path, sizeof(path), "%s", dir);
+    for (char *p = path + 1; *p != '\0'; p++) {
+        if (*p == '/' || *p == '\\') {
+            char c = *p;
+            *p = '\0';
+            make_dir(path);
+            *p = c;
+        }
+    }
+    make_dir(path);
+}
+
+static void cache_path(char *buf, size_t len, const char *dir, const char *suffix) {
+    snprintf(buf, len, "%s/%s%s", dir, BENCH_CACHE_FILE, suffix);
+}
+
+// key of a "<key>\t<rate>" line, false for a line that isn't one
+static bool split_line(char *line, float *rate) {
+    char *tab = strrchr(line, '\t');
+    if (tab == NULL) {
+        return false;
+    }
+    *tab = '\0';
+    char *end;
+    *rate = strtof(tab + 1, &end);
+    return end != tab + 1 && *rate > 0;
+}
+
+bool bench_cache_load(const char *dir, const char *key, float *rate) {
+    char path[BENCH_CACHE_LINE_LEN];
+    cache_path(path, sizeof(path), dir, "");
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return false;
+    }
+    bool found = false;
+    char line[BENCH_CACHE_LINE_LEN];
+    while (!found && fgets(line, sizeof(line), f) != NULL) {
+        float line_rate;
+        if (split_line(line, &line_rate) && strcmp(line, key) == 0) {
+            *rate = line_rate;
+            found = true;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+bool bench_cache_store(const char *dir, const char *key, float rate) {
+    char path[BENCH_CACHE_LINE_LEN], tmp_path[BENCH_CACHE_LINE_LEN + 24];
+    make_dirs(dir);
+    cache_path(path, sizeof(path), dir, "");
+    char suffix[24];
+    snprintf(suffix, sizeof(suffix), ".%d.tmp", (int)getpid());
+    cache_path(tmp_path, sizeof(tmp_path), dir, suffix);
+
+    FILE *out = fopen(tmp_path, "w");
+    if (out == NULL) {
+        return false;
+    }
+    // keep the other hosts' lines, e.g. with a shared home directory
+    FILE *in = fopen(path, "r");
+    if (in != NULL) {
+        char line[BENCH_CACHE_LINE_LEN];
+        while (fgets(line, sizeof(line), in) != NULL) {
+            float line_rate;
+            if (split_line(line, &line_rate) && strcmp(line, key) != 0) {
+                fprintf(out, "%s\t%.0f\n", line, line_rate);
+            }
+        }
+        fclose(in);
+    }
+    fprintf(out, "%s\t%.0f\n", key, rate);
+    bool ok = (fclose(out) == 0);
+    if (ok) {
+        remove(path);
+        ok = rename(tmp_path, path) == 0;
+    }
+    if (!ok) {
+        remove(tmp_path);
+    }
+    return ok;
+}
@@ -0,0 +1,30 @@
+//-----------------------------------------------------------------------------
+// Per host cache of the hardnested brute force benchmark
+//-----------------------------------------------------------------------------
+// brute_force_benchmark() only feeds the time estimates of the progress output
+// but runs on every attack. Its result is kept in a small text file, one
+// "<key>\t<keys/s>" line per host configuration, the key naming the CPU model,
+// the SIMD instruction set and the brute force thread count.
+//-----------------------------------------------------------------------------
+
+#ifndef HARDNESTED_BENCH_CACHE_H__
+#define HARDNESTED_BENCH_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BENCH_CACHE_FILE    "hardnested_benchmark.txt"
+
+// CPU model name as reported by the CPU or OS, "unknown CPU" when there is none
+void bench_cache_cpu_model(char *buf, size_t len);
+// Per user cache directory ($XDG_CACHE_HOME, ~/.cache or %LOCALAPPDATA%, then chameleon_ultra),
+// false when none of them is set
+bool bench_cache_default_dir(char *buf, size_t len);
+
+bool bench_cache_load(const char *dir, const char *key, float *rate);
+// Store rate for key, replacing its previous value and keeping the other keys.
+// The directory is created if needed.
+bool bench_cache_store(const char *dir, const char *key, float rate);
+
+#endif
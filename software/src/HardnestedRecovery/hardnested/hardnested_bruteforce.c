@@ -48,6 +48,7 @@ THE SOFTWARE.
 */
 
 #include "hardnested_bruteforce.h"
+#include "hardnested_job.h"
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -63,14 +64,10 @@ THE SOFTWARE.
 #include "../cmdhfmfhard.h"
 #include "hardnested_benchmark_data.h"
 
-#define NUM_BRUTE_FORCE_THREADS         (num_CPUs())
-#ifdef _WIN32
-#define NUM_BRUTE_FORCE_THREADS_ALLOC   128
-#else
-#define NUM_BRUTE_FORCE_THREADS_ALLOC   (num_CPUs())
-#endif
 #define DEFAULT_BRUTE_FORCE_RATE        (120000000.0) // if benchmark doesn't succeed
 #define TEST_BENCH_SIZE                 (6000)        // number of odd and even states for brute force benchmark
+#define WORK_ITEMS_PER_THREAD           (16)          // work queue granularity, lets all threads finish together
+#define MIN_ODD_STATES_PER_ITEM         (1024)        // smaller slices would spend too long bitslicing the even states again
 
 #ifdef _MSC_VER
 #include <Windows.h>
@@ -79,6 +76,8 @@ THE SOFTWARE.
 #include <fcntl.h>
 #include <sys/stat.h>
 #define atomic_add(num, val) (InterlockedExchangeAdd64(num, val) + val)
+#define atomic_fetch_inc(num) (InterlockedIncrement64((volatile LONG64 *)(num)) - 1)
+#define atomic_dec_fetch(num) InterlockedDecrement64((volatile LONG64 *)(num))
 FILE *fmemopen(void *buf, size_t len, const char *type) {
     int fd;
     FILE *fp;
@@ -108,6 +107,8 @@ FILE *fmemopen(void *buf, size_t len, const char *type) {
 }
 #else
 #define atomic_add __sync_fetch_and_add
+#define atomic_fetch_inc(num) __sync_fetch_and_add(num, 1)
+#define atomic_dec_fetch(num) __sync_sub_and_fetch(num, 1)
 #ifdef _WIN32 // Non-MSVC Windows (MinGW, etc.)
 // Include the compatibility header provided via CMake
 #include "../../compat/fmemopen/libfmemopen.h"
@@ -123,15 +124,9 @@ typedef enum {
     ODD_STATE = 1
 } odd_even_t;
 
-static uint32_t nonces_to_bruteforce = 0;
-static uint32_t bf_test_nonce[256];
-static uint8_t bf_test_nonce_2nd_byte[256];
-static uint8_t bf_test_nonce_par[256];
-static uint32_t bucket_count = 0;
-static statelist_t *buckets[128];
-static uint32_t keys_found = 0;
-static uint64_t num_keys_tested;
-static uint64_t found_bs_key = 0;
+static uint32_t num_brute_force_threads = 0; // 0: one per logical CPU
+// the bitsliced test nonces of hardnested_bf_core.c are shared by all jobs
+static pthread_mutex_t brute_force_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 uint8_t trailing_zeros(uint8_t byte) {
     static const uint8_t trailing_zeros_LUT[256] = {
@@ -183,6 +178,21 @@ bool verify_key(uint32_t cuid, noncelist_t *nonces, const uint8_t *best_first_by
     }
     return true;
 }
+typedef struct {
+    bool silent;
+    int thread_ID;
+    hardnested_job_t *job;
+    uint8_t *best_first_bytes;          // NULL: no key verified, for the benchmark
+} crack_states_arg_t;
+
+void set_brute_force_threads(uint32_t threads) {
+    num_brute_force_threads = threads;
+}
+
+uint32_t get_brute_force_threads(void) {
+    return num_brute_force_threads ? num_brute_force_threads : (uint32_t)num_CPUs();
+}
+
 static void *
 #ifdef __has_attribute
 #if __has_attribute(force_align_arg_pointer)
@@ -190,91 +200,168 @@ __attribute__((force_align_arg_pointer))
 #endif
 #endif
 crack_states_thread(void *x) {
-    struct arg {
-        bool silent;
-        int thread_ID;
-        uint32_t cuid;
-        uint32_t num_acquired_nonces;
-        uint64_t maximum_states;
-        noncelist_t *nonces;
-        uint8_t *best_first_bytes;
-    } *thread_arg;
-
-    thread_arg = (struct arg *)x;
+    crack_states_arg_t *thread_arg = (crack_states_arg_t *)x;
+    hardnested_job_t *job = thread_arg->job;
+#if defined (DEBUG_BRUTE_FORCE)
     const int thread_id = thread_arg->thread_ID;
-    uint32_t current_bucket = thread_id;
-    while (current_bucket < bucket_count) {
-        statelist_t *bucket = buckets[current_bucket];
-        if (bucket) {
+#endif
+    while (!job->keys_found && !hardnested_job_cancelled(job)) {
+        // take the next slice from the queue, a thread with a large one simply takes fewer
+        const uint64_t current_item = atomic_fetch_inc(&job->next_work_item);
+        if (current_item >= job->work_item_count) {
+            break;
+        }
+        statelist_t *bucket = &job->work_items[current_item];
 #if defined (DEBUG_BRUTE_FORCE)
-            PrintAndLogEx(INFO, "Thread " _YELLOW_("%u") " starts working on bucket " _YELLOW_("%u") "\n", thread_id, current_bucket);
+        PrintAndLogEx(INFO, "Thread " _YELLOW_("%u") " starts working on work item " _YELLOW_("%" PRIu64) "\n", thread_id, current_item);
 #endif
-            const uint64_t key = crack_states_bitsliced(thread_arg->cuid, thread_arg->best_first_bytes, bucket, &keys_found, &num_keys_tested, nonces_to_bruteforce, bf_test_nonce_2nd_byte, thread_arg->nonces);
-            if (key != -1) {
-                atomic_add(&keys_found, 1);
-                atomic_add(&found_bs_key, key);
-
+        const uint64_t key = crack_states_bitsliced(job->cuid, thread_arg->best_first_bytes, bucket, &job->keys_found, &job->num_keys_tested, job->nonces_to_bruteforce, job->bf_test_nonce_2nd_byte, job->nonces);
+        if (key != -1) {
+            atomic_add(&job->keys_found, 1);
+            atomic_add(&job->found_bs_key, key);
+
+            char progress_text[80];
+            char keystr[19];
+            snprintf(keystr, sizeof(keystr), "%012" PRIX64 "  ", key);
+            snprintf(progress_text, sizeof(progress_text), "Brute force phase completed.  Key found: " _GREEN_("%s"), keystr);
+            hardnested_print_progress(job->num_acquired_nonces, progress_text, 0.0, 0);
+            break;
+        } else if (job->keys_found) {
+            break;
+        } else {
+            // the last slice of a bucket done, and none given up because of a key found meanwhile
+            const uint32_t bucket_id = job->work_item_bucket[current_item];
+            const brute_force_progress_t *progress = job->bf_progress;
+            if (atomic_dec_fetch(&job->bucket_slices_left[bucket_id]) == 0 && progress != NULL && progress->bucket_done != NULL && !job->keys_found) {
+                progress->bucket_done(progress->ctx, bucket_id);
+            }
+            if (!thread_arg->silent) {
                 char progress_text[80];
-                char keystr[19];
-                snprintf(keystr, sizeof(keystr), "%012" PRIX64 "  ", key);
-                snprintf(progress_text, sizeof(progress_text), "Brute force phase completed.  Key found: " _GREEN_("%s"), keystr);
-                hardnested_print_progress(thread_arg->num_acquired_nonces, progress_text, 0.0, 0);
-                break;
-            } else if (keys_found) {
-                break;
-            } else {
-                if (!thread_arg->silent) {
-                    char progress_text[80];
-                    snprintf(progress_text, sizeof(progress_text), "Brute force phase: %6.02f%%", 100.0 * (float)num_keys_tested / (float)(thread_arg->maximum_states));
-                    float remaining_bruteforce = thread_arg->nonces[thread_arg->best_first_bytes[0]].expected_num_brute_force - (float)num_keys_tested / 2;
-                    hardnested_print_progress(thread_arg->num_acquired_nonces, progress_text, remaining_bruteforce, 5000);
-                }
+                snprintf(progress_text, sizeof(progress_text), "Brute force phase: %6.02f%%", 100.0 * (float)job->num_keys_tested / (float)(job->maximum_states));
+                float remaining_bruteforce = job->nonces[job->best_first_bytes[0]].expected_num_brute_force - (float)job->num_keys_tested / 2;
+                hardnested_print_progress(job->num_acquired_nonces, progress_text, remaining_bruteforce, 5000);
             }
         }
-        current_bucket += NUM_BRUTE_FORCE_THREADS;
     }
     return NULL;
 }
 
 
-void prepare_bf_test_nonces(noncelist_t *nonces, uint8_t best_first_byte) {
+// number of slices a bucket's odd states are cut into, each worth about item_work states
+static uint32_t bucket_slices(const statelist_t *p, uint64_t item_work) {
+    uint64_t slices = (uint64_t)p->len[ODD_STATE] * p->len[EVEN_STATE] / item_work + 1;
+    uint64_t max_slices = p->len[ODD_STATE] / MIN_ODD_STATES_PER_ITEM + 1;
+    return (uint32_t)MIN(slices, max_slices);
+}
+
+
+static bool bucket_skipped(const hardnested_job_t *job, const statelist_t *p, uint32_t bucket_id) {
+    return p->states[ODD_STATE] == NULL || p->states[EVEN_STATE] == NULL
+           || (job->bf_progress != NULL && job->bf_progress->done != NULL && job->bf_progress->done[bucket_id]);
+}
+
+static void free_work_queue(hardnested_job_t *job) {
+    free(job->work_items);
+    free(job->work_item_bucket);
+    free(job->bucket_slices_left);
+    job->work_items = NULL;
+    job->work_item_bucket = NULL;
+    job->bucket_slices_left = NULL;
+    job->work_item_count = 0;
+}
+
+// Fill the work queue with the buckets holding both odd and even states, in candidate order,
+// leaving out those done before. Large buckets are cut into slices of their odd states sharing
+// the bucket's even states, sized for about WORK_ITEMS_PER_THREAD items per thread.
+// Returns the states of the buckets left out as done, UINT64_MAX when out of memory.
+static uint64_t build_work_queue(hardnested_job_t *job, uint32_t num_threads) {
+    uint64_t total_work = 0;
+    uint64_t done_work = 0;
+    uint32_t count = 0;
+    uint32_t num_buckets = 0;
+    for (statelist_t *p = job->candidates; p != NULL; p = p->next, num_buckets++) {
+        if (!bucket_skipped(job, p, num_buckets)) {
+            total_work += (uint64_t)p->len[ODD_STATE] * p->len[EVEN_STATE];
+        } else if (p->states[ODD_STATE] != NULL && p->states[EVEN_STATE] != NULL) {
+            done_work += (uint64_t)p->len[ODD_STATE] * p->len[EVEN_STATE];
+        }
+    }
+    uint64_t item_work = total_work / ((uint64_t)num_threads * WORK_ITEMS_PER_THREAD) + 1;
+    uint32_t bucket_id = 0;
+    for (statelist_t *p = job->candidates; p != NULL; p = p->next, bucket_id++) {
+        if (!bucket_skipped(job, p, bucket_id)) {
+            count += bucket_slices(p, item_work);
+        }
+    }
+
+    job->work_items = (statelist_t *)calloc(MAX(count, 1), sizeof(statelist_t));
+    job->work_item_bucket = (uint32_t *)calloc(MAX(count, 1), sizeof(uint32_t));
+    job->bucket_slices_left = (uint64_t *)calloc(MAX(num_buckets, 1), sizeof(uint64_t));
+    if (job->work_items == NULL || job->work_item_bucket == NULL || job->bucket_slices_left == NULL) {
+        free_work_queue(job);
+        return UINT64_MAX;
+    }
+    job->work_item_count = 0;
+    job->next_work_item = 0;
+    bucket_id = 0;
+    for (statelist_t *p = job->candidates; p != NULL; p = p->next, bucket_id++) {
+        if (bucket_skipped(job, p, bucket_id)) {
+            continue;
+        }
+        uint32_t slices = bucket_slices(p, item_work);
+        uint32_t slice_len = p->len[ODD_STATE] / slices;
+        job->bucket_slices_left[bucket_id] = slices;
+        for (uint32_t i = 0; i < slices; i++) {
+            job->work_item_bucket[job->work_item_count] = bucket_id;
+            statelist_t *item = &job->work_items[job->work_item_count++];
+            *item = *p;
+            item->next = NULL;
+            item->states[ODD_STATE] = p->states[ODD_STATE] + i * slice_len;
+            item->len[ODD_STATE] = (i == slices - 1) ? p->len[ODD_STATE] - i * slice_len : slice_len;
+        }
+    }
+    return done_work;
+}
+
+
+void prepare_bf_test_nonces(hardnested_job_t *job, uint8_t best_first_byte) {
     // we do bitsliced brute forcing with best_first_bytes[0] only.
     // Extract the corresponding 2nd bytes
-    noncelistentry_t *test_nonce = nonces[best_first_byte].first;
+    noncelistentry_t *test_nonce = job->nonces[best_first_byte].first;
     uint32_t i = 0;
     while (test_nonce != NULL) {
-        bf_test_nonce[i] = test_nonce->nonce_enc;
-        bf_test_nonce_par[i] = test_nonce->par_enc;
-        bf_test_nonce_2nd_byte[i] = (test_nonce->nonce_enc >> 16) & 0xff;
+        job->bf_test_nonce[i] = test_nonce->nonce_enc;
+        job->bf_test_nonce_par[i] = test_nonce->par_enc;
+        job->bf_test_nonce_2nd_byte[i] = (test_nonce->nonce_enc >> 16) & 0xff;
         test_nonce = test_nonce->next;
         i++;
     }
-    nonces_to_bruteforce = i;
+    job->nonces_to_bruteforce = i;
 
-    // printf("Nonces to bruteforce: %d\n", nonces_to_bruteforce);
+    // printf("Nonces to bruteforce: %d\n", job->nonces_to_bruteforce);
     // printf("Common bits of first 4 2nd nonce bytes (before sorting): %u %u %u\n",
-    // trailing_zeros(bf_test_nonce_2nd_byte[1] ^ bf_test_nonce_2nd_byte[0]),
-    // trailing_zeros(bf_test_nonce_2nd_byte[2] ^ bf_test_nonce_2nd_byte[1]),
-    // trailing_zeros(bf_test_nonce_2nd_byte[3] ^ bf_test_nonce_2nd_byte[2]));
+    // trailing_zeros(job->bf_test_nonce_2nd_byte[1] ^ job->bf_test_nonce_2nd_byte[0]),
+    // trailing_zeros(job->bf_test_nonce_2nd_byte[2] ^ job->bf_test_nonce_2nd_byte[1]),
+    // trailing_zeros(job->bf_test_nonce_2nd_byte[3] ^ job->bf_test_nonce_2nd_byte[2]));
 
     uint8_t best_4[4] = {0};
     int sum_best = -1;
-    for (uint32_t n1 = 0; n1 < nonces_to_bruteforce; n1++) {
-        for (uint32_t n2 = 0; n2 < nonces_to_bruteforce; n2++) {
+    for (uint32_t n1 = 0; n1 < job->nonces_to_bruteforce; n1++) {
+        for (uint32_t n2 = 0; n2 < job->nonces_to_bruteforce; n2++) {
             if (n2 != n1) {
-                for (uint32_t n3 = 0; n3 < nonces_to_bruteforce; n3++) {
-                    if ((n3 != n2 && n3 != n1) || nonces_to_bruteforce < 3
-                            // && trailing_zeros(bf_test_nonce_2nd_byte[n1] ^ bf_test_nonce_2nd_byte[n2])
-                            // > trailing_zeros(bf_test_nonce_2nd_byte[n2] ^ bf_test_nonce_2nd_byte[n3])
+                for (uint32_t n3 = 0; n3 < job->nonces_to_bruteforce; n3++) {
+                    if ((n3 != n2 && n3 != n1) || job->nonces_to_bruteforce < 3
+                            // && trailing_zeros(job->bf_test_nonce_2nd_byte[n1] ^ job->bf_test_nonce_2nd_byte[n2])
+                            // > trailing_zeros(job->bf_test_nonce_2nd_byte[n2] ^ job->bf_test_nonce_2nd_byte[n3])
                        ) {
-                        for (uint32_t n4 = 0; n4 < nonces_to_bruteforce; n4++) {
-                            if ((n4 != n3 && n4 != n2 && n4 != n1) || nonces_to_bruteforce < 4
-                                    // && trailing_zeros(bf_test_nonce_2nd_byte[n2] ^ bf_test_nonce_2nd_byte[n3])
-                                    // > trailing_zeros(bf_test_nonce_2nd_byte[n3] ^ bf_test_nonce_2nd_byte[n4])
+                        for (uint32_t n4 = 0; n4 < job->nonces_to_bruteforce; n4++) {
+                            if ((n4 != n3 && n4 != n2 && n4 != n1) || job->nonces_to_bruteforce < 4
+                                    // && trailing_zeros(job->bf_test_nonce_2nd_byte[n2] ^ job->bf_test_nonce_2nd_byte[n3])
+                                    // > trailing_zeros(job->bf_test_nonce_2nd_byte[n3] ^ job->bf_test_nonce_2nd_byte[n4])
                                ) {
-                                int sum = nonces_to_bruteforce > 1 ? trailing_zeros(bf_test_nonce_2nd_byte[n1] ^ bf_test_nonce_2nd_byte[n2]) : 0.0
-                                          + nonces_to_bruteforce > 2 ? trailing_zeros(bf_test_nonce_2nd_byte[n2] ^ bf_test_nonce_2nd_byte[n3]) : 0.0
-                                          + nonces_to_bruteforce > 3 ? trailing_zeros(bf_test_nonce_2nd_byte[n3] ^ bf_test_nonce_2nd_byte[n4]) : 0.0;
+                                int sum = job->nonces_to_bruteforce > 1 ? trailing_zeros(job->bf_test_nonce_2nd_byte[n1] ^ job->bf_test_nonce_2nd_byte[n2]) : 0.0
+                                          + job->nonces_to_bruteforce > 2 ? trailing_zeros(job->bf_test_nonce_2nd_byte[n2] ^ job->bf_test_nonce_2nd_byte[n3]) : 0.0
+                                          + job->nonces_to_bruteforce > 3 ? trailing_zeros(job->bf_test_nonce_2nd_byte[n3] ^ job->bf_test_nonce_2nd_byte[n4]) : 0.0;
                                 if (sum > sum_best) {
                                     sum_best = sum;
                                     best_4[0] = n1;
@@ -293,85 +380,85 @@ void prepare_bf_test_nonces(noncelist_t *nonces, uint8_t best_first_byte) {
     uint32_t bf_test_nonce_temp[4];
     uint8_t bf_test_nonce_par_temp[4];
     uint8_t bf_test_nonce_2nd_byte_temp[4];
-    for (uint32_t j = 0; j < 4 && j < nonces_to_bruteforce; j++) {
-        bf_test_nonce_temp[j] = bf_test_nonce[best_4[j]];
+    for (uint32_t j = 0; j < 4 && j < job->nonces_to_bruteforce; j++) {
+        bf_test_nonce_temp[j] = job->bf_test_nonce[best_4[j]];
 
-        bf_test_nonce_par_temp[j] = bf_test_nonce_par[best_4[j]];
-        bf_test_nonce_2nd_byte_temp[j] = bf_test_nonce_2nd_byte[best_4[j]];
+        bf_test_nonce_par_temp[j] = job->bf_test_nonce_par[best_4[j]];
+        bf_test_nonce_2nd_byte_temp[j] = job->bf_test_nonce_2nd_byte[best_4[j]];
     }
-    for (uint32_t j = 0; j < 4 && j < nonces_to_bruteforce; j++) {
-        bf_test_nonce[j] = bf_test_nonce_temp[j];
-        bf_test_nonce_par[j] = bf_test_nonce_par_temp[j];
-        bf_test_nonce_2nd_byte[j] = bf_test_nonce_2nd_byte_temp[j];
+    for (uint32_t j = 0; j < 4 && j < job->nonces_to_bruteforce; j++) {
+        job->bf_test_nonce[j] = bf_test_nonce_temp[j];
+        job->bf_test_nonce_par[j] = bf_test_nonce_par_temp[j];
+        job->bf_test_nonce_2nd_byte[j] = bf_test_nonce_2nd_byte_temp[j];
     }
 }
 
-bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint32_t num_acquired_nonces, uint64_t maximum_states, noncelist_t *nonces, uint8_t *best_first_bytes, uint64_t *found_key) {
+bool brute_force_bs(hardnested_job_t *job, float *bf_rate, uint64_t *found_key) {
 #if defined (WRITE_BENCH_FILE)
-    write_benchfile(candidates);
+    write_benchfile(job->candidates);
 #endif
     bool silent = (bf_rate != NULL);
 
-    keys_found = 0;
-    num_keys_tested = 0;
-    found_bs_key = 0;
+    pthread_mutex_lock(&brute_force_mutex);
+    job->keys_found = 0;
+    job->num_keys_tested = 0;
+    job->found_bs_key = 0;
 
-    bitslice_test_nonces(nonces_to_bruteforce, bf_test_nonce, bf_test_nonce_par);
+    bitslice_test_nonces(job->nonces_to_bruteforce, job->bf_test_nonce, job->bf_test_nonce_par);
 
-    // count number of states to go
-    bucket_count = 0;
-    for (statelist_t *p = candidates; p != NULL; p = p->next) {
-        if (p->states[ODD_STATE] != NULL && p->states[EVEN_STATE] != NULL) {
-            buckets[bucket_count] = p;
-            bucket_count++;
-        }
+    uint32_t num_threads = get_brute_force_threads();
+    uint64_t done_work = build_work_queue(job, num_threads);
+    if (done_work == UINT64_MAX) {
+        pthread_mutex_unlock(&brute_force_mutex);
+        PrintAndLogEx(WARNING, "Out of memory error in brute_force. Aborting...");
+        return false;
+    }
+    // progress counts the buckets done before as tested, the rate doesn't
+    uint64_t resumed_keys = done_work;
+    job->num_keys_tested = resumed_keys;
+
+    pthread_t *threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
+    crack_states_arg_t *thread_args = (crack_states_arg_t *)calloc(num_threads, sizeof(crack_states_arg_t));
+    if (threads == NULL || thread_args == NULL) {
+        PrintAndLogEx(WARNING, "Out of memory error in brute_force. Aborting...");
+        free(threads);
+        free(thread_args);
+        free_work_queue(job);
+        pthread_mutex_unlock(&brute_force_mutex);
+        return false;
     }
 
     uint64_t start_time = msclock();
 
-#if defined(__linux__) ||  defined(__APPLE__)
-    if (NUM_BRUTE_FORCE_THREADS < 0)
-        return false;
-#endif
-
-    pthread_t threads[NUM_BRUTE_FORCE_THREADS_ALLOC];
-    struct args {
-        bool silent;
-        int thread_ID;
-        uint32_t cuid;
-        uint32_t num_acquired_nonces;
-        uint64_t maximum_states;
-        noncelist_t *nonces;
-        uint8_t *best_first_bytes;
-    } thread_args[NUM_BRUTE_FORCE_THREADS_ALLOC];
-
-    for (uint32_t i = 0; i < NUM_BRUTE_FORCE_THREADS; i++) {
+    for (uint32_t i = 0; i < num_threads; i++) {
         thread_args[i].thread_ID = i;
         thread_args[i].silent = silent;
-        thread_args[i].cuid = cuid;
-        thread_args[i].num_acquired_nonces = num_acquired_nonces;
-        thread_args[i].maximum_states = maximum_states;
-        thread_args[i].nonces = nonces;
-        thread_args[i].best_first_bytes = best_first_bytes;
+        thread_args[i].job = job;
+        thread_args[i].best_first_bytes = silent ? NULL : job->best_first_bytes;
         pthread_create(&threads[i], NULL, crack_states_thread, (void *)&thread_args[i]);
     }
-    for (uint32_t i = 0; i < NUM_BRUTE_FORCE_THREADS; i++) {
+    for (uint32_t i = 0; i < num_threads; i++) {
         pthread_join(threads[i], 0);
     }
 
     uint64_t elapsed_time = msclock() - start_time;
 
+    free(threads);
+    free(thread_args);
+    free_work_queue(job);
+    pthread_mutex_unlock(&brute_force_mutex);
+
     if (bf_rate != NULL)
-        *bf_rate = (float)num_keys_tested / ((float)elapsed_time / 1000.0);
+        *bf_rate = (float)(job->num_keys_tested - resumed_keys) / ((float)elapsed_time / 1000.0);
 
-    if (keys_found > 0)
-        *found_key = found_bs_key;
+    if (job->keys_found > 0)
+        *found_key = job->found_bs_key;
 
-    return (keys_found != 0);
+    return (job->keys_found != 0);
 }
 
 
-static bool read_bench_data(statelist_t *test_candidates) {
+static bool read_bench_data(hardnested_job_t *job, statelist_t *test_candidates) {
     size_t bytes_read = 0;
     uint32_t temp = 0;
     uint32_t num_states = 0;
@@ -381,19 +468,19 @@ static bool read_bench_data(statelist_t *test_candidates) {
     if (benchfile == NULL) {
         return false;
     }
-    bytes_read = fread(&nonces_to_bruteforce, 1, sizeof(nonces_to_bruteforce), benchfile);
-    if (bytes_read != sizeof(nonces_to_bruteforce)) {
+    bytes_read = fread(&job->nonces_to_bruteforce, 1, sizeof(job->nonces_to_bruteforce), benchfile);
+    if (bytes_read != sizeof(job->nonces_to_bruteforce)) {
         fclose(benchfile);
         return false;
     }
-    for (uint32_t i = 0; i < nonces_to_bruteforce && i < 256; i++) {
-        bytes_read = fread(&bf_test_nonce[i], 1, sizeof(uint32_t), benchfile);
+    for (uint32_t i = 0; i < job->nonces_to_bruteforce && i < 256; i++) {
+        bytes_read = fread(&job->bf_test_nonce[i], 1, sizeof(uint32_t), benchfile);
         if (bytes_read != sizeof(uint32_t)) {
             fclose(benchfile);
             return false;
         }
-        bf_test_nonce_2nd_byte[i] = (bf_test_nonce[i] >> 16) & 0xff;
-        bytes_read = fread(&bf_test_nonce_par[i], 1, sizeof(uint8_t), benchfile);
+        job->bf_test_nonce_2nd_byte[i] = (job->bf_test_nonce[i] >> 16) & 0xff;
+        bytes_read = fread(&job->bf_test_nonce_par[i], 1, sizeof(uint8_t), benchfile);
         if (bytes_read != sizeof(uint8_t)) {
             fclose(benchfile);
             return false;
@@ -438,39 +525,53 @@ static bool read_bench_data(statelist_t *test_candidates) {
 
 
 float brute_force_benchmark(void) {
-    statelist_t test_candidates[NUM_BRUTE_FORCE_THREADS_ALLOC];
+    // one test bucket per thread, so that every thread count runs the same work per thread
+    uint32_t num_buckets = get_brute_force_threads();
+    hardnested_job_t *job = (hardnested_job_t *)calloc(1, sizeof(hardnested_job_t));
+    statelist_t *test_candidates = (statelist_t *)calloc(num_buckets, sizeof(statelist_t));
+    if (job == NULL || test_candidates == NULL) {
+        free(job);
+        free(test_candidates);
+        return DEFAULT_BRUTE_FORCE_RATE;
+    }
 
     test_candidates[0].states[ODD_STATE] = calloc(1, (TEST_BENCH_SIZE + 1) * sizeof(uint32_t));
     test_candidates[0].states[EVEN_STATE] = calloc(1, (TEST_BENCH_SIZE + 1) * sizeof(uint32_t));
-    for (uint32_t i = 0; i < NUM_BRUTE_FORCE_THREADS - 1; i++) {
+    for (uint32_t i = 0; i < num_buckets - 1; i++) {
         test_candidates[i].next = test_candidates + i + 1;
         test_candidates[i + 1].states[ODD_STATE] = test_candidates[0].states[ODD_STATE];
         test_candidates[i + 1].states[EVEN_STATE] = test_candidates[0].states[EVEN_STATE];
     }
-    test_candidates[NUM_BRUTE_FORCE_THREADS - 1].next = NULL;
-
-    if (!read_bench_data(test_candidates)) {
+    test_candidates[num_buckets - 1].next = NULL;
+
+    if (test_candidates[0].states[ODD_STATE] == NULL || test_candidates[0].states[EVEN_STATE] == NULL
+            || !read_bench_data(job, test_candidates)) {
+        free(test_candidates[0].states[ODD_STATE]);
+        free(test_candidates[0].states[EVEN_STATE]);
+        free(test_candidates);
+        free(job);
         return DEFAULT_BRUTE_FORCE_RATE;
     }
 
-    for (uint32_t i = 0; i < NUM_BRUTE_FORCE_THREADS; i++) {
+    for (uint32_t i = 0; i < num_buckets; i++) {
         test_candidates[i].len[ODD_STATE] = TEST_BENCH_SIZE;
         test_candidates[i].len[EVEN_STATE] = TEST_BENCH_SIZE;
         test_candidates[i].states[ODD_STATE][TEST_BENCH_SIZE] = -1;
         test_candidates[i].states[EVEN_STATE][TEST_BENCH_SIZE] = -1;
     }
 
-    uint64_t maximum_states = TEST_BENCH_SIZE * TEST_BENCH_SIZE * (uint64_t)NUM_BRUTE_FORCE_THREADS;
+    job->candidates = test_candidates;
+    job->maximum_states = TEST_BENCH_SIZE * TEST_BENCH_SIZE * (uint64_t)num_buckets;
 
     float bf_rate;
     uint64_t found_key = 0;
-    brute_force_bs(&bf_rate, test_candidates, 0, 0, maximum_states, NULL, 0, &found_key);
+    if (!brute_force_bs(job, &bf_rate, &found_key) && job->num_keys_tested == 0) {
+        bf_rate = DEFAULT_BRUTE_FORCE_RATE;
+    }
 
     free(test_candidates[0].states[ODD_STATE]);
     free(test_candidates[0].states[EVEN_STATE]);
-    test_candidates[0].len[ODD_STATE] = 0;
-    test_candidates[0].len[EVEN_STATE] = 0;
+    free(test_candidates);
+    free(job);
     return bf_rate;
 }
-
-
@@ -53,9 +53,27 @@ typedef struct {
     void *next;
 } statelist_t;
 
-void prepare_bf_test_nonces(noncelist_t *nonces, uint8_t best_first_byte);
-bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint32_t num_acquired_nonces, uint64_t maximum_states, noncelist_t *nonces, uint8_t *best_first_bytes, uint64_t *found_key);
+typedef struct hardnested_job hardnested_job_t;    // hardnested_job.h
+
+// Pick the test nonces of the brute force among the nonces of job->nonces[best_first_byte]
+void prepare_bf_test_nonces(hardnested_job_t *job, uint8_t best_first_byte);
+// Test the states of job->candidates. With bf_rate set (the benchmark) it runs silently, doesn't
+// verify keys against job->nonces and stores the keys/s in *bf_rate.
+bool brute_force_bs(hardnested_job_t *job, float *bf_rate, uint64_t *found_key);
 float brute_force_benchmark(void);
+// brute force threads, 0 (default) for one per logical CPU
+void set_brute_force_threads(uint32_t threads);
+uint32_t get_brute_force_threads(void);
+
+// Progress over the candidate buckets, numbered in candidates order, to resume an interrupted
+// brute force (job->bf_progress): the buckets flagged in done (NULL: none) are skipped, and
+// bucket_done (NULL: none) is called from the brute force threads for each bucket all of whose
+// states were tested.
+typedef struct {
+    const uint8_t *done;
+    void (*bucket_done)(void *ctx, uint32_t bucket);
+    void *ctx;
+} brute_force_progress_t;
 uint8_t trailing_zeros(uint8_t byte);
 bool verify_key(uint32_t cuid, noncelist_t *nonces, const uint8_t *best_first_bytes, uint32_t odd, uint32_t even);
 
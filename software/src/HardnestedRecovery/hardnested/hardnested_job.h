@@ -0,0 +1,97 @@
+//-----------------------------------------------------------------------------
+// State of one hardnested attack
+//-----------------------------------------------------------------------------
+// Everything an attack derives from its nonces lives in its hardnested_job_t:
+// the nonce lists and their state bitarrays, the part sum bitarrays narrowed
+// down by them, the candidate state lists and the brute force work queue over
+// them. The bitflip and sum property tables stay shared by all jobs, so a
+// driver cracking several keys keeps them and the benchmark between its jobs
+// (hardnested_begin()) and reuses one job for all of them.
+//
+// Still shared as well: the progress output, the journal and the bitsliced
+// test nonces of hardnested_bf_core.c, brute_force_bs() runs one job at a time.
+// A caller running attacks from several threads serializes them, as
+// crack_hardnested() of chameleon_crack does.
+//-----------------------------------------------------------------------------
+
+#ifndef HARDNESTED_JOB_H__
+#define HARDNESTED_JOB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "hardnested_bruteforce.h"
+
+#define NUM_PART_SUMS 9 // number of possible partial sum property values
+
+typedef enum {
+    TO_BE_DONE, WORK_IN_PROGRESS, COMPLETED
+} work_status_t;
+
+// a candidate state list of one part sum combination, built once per Sum(a8) guess
+typedef struct sl_cache_entry {
+    uint32_t *sl;
+    uint32_t len;
+    work_status_t cache_status;
+} sl_cache_entry_t;
+
+struct hardnested_job {
+    // nonces
+    uint32_t cuid;
+    noncelist_t nonces[256];
+    uint32_t num_acquired_nonces;
+    uint64_t nonces_hash;                           // identifies the nonces for the journal
+    uint16_t first_byte_Sum;
+    uint16_t first_byte_num;
+
+    // key space reduction
+    uint8_t stage;                                  // CHECK_1ST_BYTES, CHECK_2ND_BYTES
+    uint64_t last_sample_clock;
+    uint64_t sample_period;
+    uint32_t *all_bitflips_bitarray[2];
+    uint32_t num_all_bitflips_bitarray[2];
+    bool all_bitflips_bitarray_dirty[2];
+    uint32_t *part_sum_a0_bitarrays[2][NUM_PART_SUMS];
+    uint32_t *part_sum_a8_bitarrays[2][NUM_PART_SUMS];
+    uint32_t part_sum_count[2][NUM_PART_SUMS][NUM_PART_SUMS];
+    float p_K[NUM_SUMS];                            // probability of each Sum(a8), from the part sum counts
+    float reduction_queue[4];                       // last key space sizes, for the reduction rate
+    uint8_t best_first_bytes[256];
+    uint8_t best_first_byte_smallest_bitarray;
+
+    // candidate states
+    sl_cache_entry_t sl_cache[NUM_PART_SUMS][NUM_PART_SUMS][2];
+    statelist_t *candidates;
+    uint64_t maximum_states;
+    uint64_t hint_states[2];                        // states tested against the key hint since last reported
+    uint64_t hint_pruned[2];
+
+    // a known key, to trace where the reduction loses it (DEBUG_KEY_ELIMINATION)
+    uint64_t known_target_key;
+    uint32_t test_state[2];
+    uint16_t real_sum_a8;
+
+    // brute force: the test nonces of prepare_bf_test_nonces() and the work queue
+    uint32_t nonces_to_bruteforce;
+    uint32_t bf_test_nonce[256];
+    uint8_t bf_test_nonce_2nd_byte[256];
+    uint8_t bf_test_nonce_par[256];
+    statelist_t *work_items;                        // the candidate buckets, split into slices of their odd states
+    uint32_t work_item_count;
+    uint64_t next_work_item;
+    uint32_t *work_item_bucket;                     // candidates index of each work item's bucket
+    uint64_t *bucket_slices_left;                   // per candidate bucket, its work items not done yet
+    const brute_force_progress_t *bf_progress;      // NULL: none
+    uint32_t keys_found;
+    uint64_t num_keys_tested;
+    uint64_t found_bs_key;
+
+    volatile int *cancel;                           // hardnested_job_set_cancel(), kept over the attacks of the job
+};
+
+static inline bool hardnested_job_cancelled(const hardnested_job_t *job) {
+    return job->cancel != NULL && *job->cancel;
+}
+
+#endif
@@ -0,0 +1,204 @@
+//-----------------------------------------------------------------------------
+// Progress journal of the hardnested brute force, see hardnested_journal.h
+//-----------------------------------------------------------------------------
+
+#include "hardnested_journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#define sync_file(f) _commit(_fileno(f))
+#else
+#include <unistd.h>
+#define sync_file(f) fsync(fileno(f))
+#endif
+
+#define JOURNAL_LINE_LEN    1024
+#define JOURNAL_GUESSES     256
+
+typedef struct {
+    uint8_t guess;
+    uint32_t bucket;
+} bucket_record_t;
+
+static FILE *journal_file = NULL;
+static char *journal_path = NULL;
+static pthread_mutex_t journal_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// records of the resumed journal
+static int16_t guess_sum_a8[JOURNAL_GUESSES];       // -1: guess not started
+static bool guess_exhausted[JOURNAL_GUESSES];
+static bucket_record_t *bucket_records = NULL;
+static uint32_t num_bucket_records = 0;
+static uint32_t bucket_records_size = 0;
+static uint8_t *done_flags = NULL;
+
+static void format_run_line(char *buf, size_t len, uint64_t nonces_hash, const uint8_t *first_bytes, uint32_t num_first_bytes) {
+    int n = snprintf(buf, len, "run %016" PRIx64 " ", nonces_hash);
+    for (uint32_t i = 0; i < num_first_bytes && n > 0 && (size_t)n < len; i++) {
+        n += snprintf(buf + n, len - n, "%s%02x", i ? "," : "", first_bytes[i]);
+    }
+}
+
+static void forget_records(void) {
+    for (uint32_t i = 0; i < JOURNAL_GUESSES; i++) {
+        guess_sum_a8[i] = -1;
+        guess_exhausted[i] = false;
+    }
+    free(bucket_records);
+    bucket_records = NULL;
+    num_bucket_records = 0;
+    bucket_records_size = 0;
+}
+
+static bool add_bucket_record(uint8_t guess, uint32_t bucket) {
+    if (num_bucket_records == bucket_records_size) {
+        uint32_t size = bucket_records_size ? 2 * bucket_records_size : 1024;
+        bucket_record_t *records = (bucket_record_t *)realloc(bucket_records, size * sizeof(bucket_record_t));
+        if (records == NULL) {
+            return false;
+        }
+        bucket_records = records;
+        bucket_records_size = size;
+    }
+    bucket_records[num_bucket_records].guess = guess;
+    bucket_records[num_bucket_records].bucket = bucket;
+    num_bucket_records++;
+    return true;
+}
+
+// Read the records of the journal at path if its run line is run_line.
+// A line cut short by the interruption is ignored.
+static bool read_journal(const char *path, const char *run_line) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return false;
+    }
+    char line[JOURNAL_LINE_LEN];
+    char header[32];
+    snprintf(header, sizeof(header), "hardnested journal %d\n", JOURNAL_VERSION);
+    bool match = fgets(line, sizeof(line), f) != NULL && strcmp(line, header) == 0
+                 && fgets(line, sizeof(line), f) != NULL && strncmp(line, run_line, strlen(run_line)) == 0
+                 && line[strlen(run_line)] == '\n';
+    while (match && fgets(line, sizeof(line), f) != NULL) {
+        unsigned int guess, value;
+        if (strchr(line, '\n') == NULL) {
+            break;
+        }
+        if (sscanf(line, "guess %u %u", &guess, &value) == 2 && guess < JOURNAL_GUESSES) {
+            if (guess_sum_a8[guess] != (int16_t)value) {
+                // another guess under this index than before, its buckets don't count
+                guess_sum_a8[guess] = (int16_t)value;
+                guess_exhausted[guess] = false;
+                uint32_t kept = 0;
+                for (uint32_t i = 0; i < num_bucket_records; i++) {
+                    if (bucket_records[i].guess != guess) {
+                        bucket_records[kept++] = bucket_records[i];
+                    }
+                }
+                num_bucket_records = kept;
+            }
+        } else if (sscanf(line, "bucket %u %u", &guess, &value) == 2 && guess < JOURNAL_GUESSES && guess_sum_a8[guess] >= 0) {
+            match = add_bucket_record(guess, value);
+        } else if (sscanf(line, "exhausted %u", &guess) == 1 && guess < JOURNAL_GUESSES && guess_sum_a8[guess] >= 0) {
+            guess_exhausted[guess] = true;
+        }
+    }
+    fclose(f);
+    if (!match) {
+        forget_records();
+    }
+    return match;
+}
+
+static void write_record(const char *format, unsigned int a, unsigned int b) {
+    pthread_mutex_lock(&journal_mutex);
+    if (journal_file != NULL) {
+        fprintf(journal_file, format, a, b);
+        fflush(journal_file);
+        sync_file(journal_file);
+    }
+    pthread_mutex_unlock(&journal_mutex);
+}
+
+bool journal_open(const char *path, bool resume, uint64_t nonces_hash, const uint8_t *first_bytes, uint32_t num_first_bytes) {
+    journal_close(false);
+    forget_records();
+
+    char run_line[JOURNAL_LINE_LEN];
+    format_run_line(run_line, sizeof(run_line), nonces_hash, first_bytes, num_first_bytes);
+    if (resume && read_journal(path, run_line)) {
+        journal_file = fopen(path, "a");
+    } else {
+        journal_file = fopen(path, "w");
+        if (journal_file != NULL) {
+            fprintf(journal_file, "hardnested journal %d\n%s\n", JOURNAL_VERSION, run_line);
+            fflush(journal_file);
+        }
+    }
+    if (journal_file == NULL) {
+        forget_records();
+        return false;
+    }
+    journal_path = strdup(path);
+    return true;
+}
+
+bool journal_is_open(void) {
+    return journal_file != NULL;
+}
+
+bool journal_guess_exhausted(uint8_t guess, uint8_t sum_a8_idx) {
+    return guess_exhausted[guess] && guess_sum_a8[guess] == sum_a8_idx;
+}
+
+const uint8_t *journal_start_guess(uint8_t guess, uint8_t sum_a8_idx, uint32_t num_buckets) {
+    write_record("guess %u %u\n", guess, sum_a8_idx);
+
+    free(done_flags);
+    done_flags = NULL;
+    if (guess_sum_a8[guess] != sum_a8_idx) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < num_bucket_records; i++) {
+        if (bucket_records[i].guess != guess || bucket_records[i].bucket >= num_buckets) {
+            continue;
+        }
+        if (done_flags == NULL) {
+            done_flags = (uint8_t *)calloc(num_buckets, sizeof(uint8_t));
+            if (done_flags == NULL) {
+                return NULL;
+            }
+        }
+        done_flags[bucket_records[i].bucket] = 1;
+    }
+    return done_flags;
+}
+
+void journal_bucket_done(uint8_t guess, uint32_t bucket) {
+    write_record("bucket %u %u\n", guess, bucket);
+}
+
+void journal_exhaust_guess(uint8_t guess) {
+    write_record("exhausted %u\n", guess, 0);
+}
+
+void journal_close(bool finished) {
+    if (journal_file != NULL) {
+        fclose(journal_file);
+        journal_file = NULL;
+        if (finished) {
+            remove(journal_path);
+        }
+    }
+    free(journal_path);
+    journal_path = NULL;
+    free(done_flags);
+    done_flags = NULL;
+    forget_records();
+}
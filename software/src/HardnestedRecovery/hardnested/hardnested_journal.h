@@ -0,0 +1,42 @@
+//-----------------------------------------------------------------------------
+// Progress journal of the hardnested brute force, to resume an interrupted run
+//-----------------------------------------------------------------------------
+// The brute force runs over the candidate buckets of one Sum(a8) guess after
+// the other and can take hours. The journal is a small text file, appended to
+// and flushed as the brute force goes:
+//   hardnested journal 1
+//   run <nonce set and key hint hash, hex> <first bytes, hex, comma separated>
+//   guess <guess index> <sum_a8 index>     a guess is started
+//   bucket <guess index> <bucket>          all states of a bucket tested
+//   exhausted <guess index>                all buckets of a guess tested
+// Buckets are numbered in candidates order, which is the same for the same
+// nonces. A resumed run only trusts the records of a journal whose run line
+// matches its own, and only the bucket records of a guess with the same
+// sum_a8 index. The journal is removed once the attack is finished.
+//-----------------------------------------------------------------------------
+
+#ifndef HARDNESTED_JOURNAL_H__
+#define HARDNESTED_JOURNAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define JOURNAL_VERSION     1
+
+// Start the journal at path. With resume, the records of a matching journal at
+// path are kept and reported by the functions below, anything else is replaced.
+bool journal_open(const char *path, bool resume, uint64_t nonces_hash, const uint8_t *first_bytes, uint32_t num_first_bytes);
+bool journal_is_open(void);
+// Whether guess was recorded as exhausted with the same sum_a8 index
+bool journal_guess_exhausted(uint8_t guess, uint8_t sum_a8_idx);
+// Record the start of guess. Returns the done flag of each of its num_buckets
+// buckets (NULL when none are done), valid until the next journal call.
+const uint8_t *journal_start_guess(uint8_t guess, uint8_t sum_a8_idx, uint32_t num_buckets);
+// Safe to call from the brute force threads
+void journal_bucket_done(uint8_t guess, uint32_t bucket);
+void journal_exhaust_guess(uint8_t guess);
+// Close the journal, removing the file when the attack finished
+void journal_close(bool finished);
+
+#endif
@@ -0,0 +1,313 @@
+//-----------------------------------------------------------------------------
+// Compressed read-only 2^24 bit bitarrays for hosts with little memory
+//-----------------------------------------------------------------------------
+
+#include "hardnested_sparse_bitarray.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define popcount32(x) __popcnt(x)
+#else
+#define popcount32(x) __builtin_popcount(x)
+#endif
+
+#define CONTAINER_BITS  (SPARSE_CONTAINER_WORDS * 32)
+
+// masks of the bits from bit to the end of its word, and from the start of its word to bit
+#define MASK_FROM(bit)  (0xffffffffu >> ((bit) & 0x1f))
+#define MASK_TO(bit)    (0xffffffffu << (31 - ((bit) & 0x1f)))
+
+// bits [from, to) of a container
+static void clear_range(uint32_t *words, uint32_t from, uint32_t to) {
+    if (from >= to) {
+        return;
+    }
+    uint32_t first = from >> 5;
+    uint32_t last = (to - 1) >> 5;
+    if (first == last) {
+        words[first] &= ~(MASK_FROM(from) & MASK_TO(to - 1));
+        return;
+    }
+    words[first] &= ~MASK_FROM(from);
+    memset(words + first + 1, 0, sizeof(uint32_t) * (last - first - 1));
+    words[last] &= ~MASK_TO(to - 1);
+}
+
+static void set_range(uint32_t *words, uint32_t from, uint32_t to) {
+    uint32_t first = from >> 5;
+    uint32_t last = (to - 1) >> 5;
+    if (first == last) {
+        words[first] |= MASK_FROM(from) & MASK_TO(to - 1);
+        return;
+    }
+    words[first] |= MASK_FROM(from);
+    memset(words + first + 1, 0xff, sizeof(uint32_t) * (last - first - 1));
+    words[last] |= MASK_TO(to - 1);
+}
+
+static uint32_t count_range(const uint32_t *words, uint32_t from, uint32_t to) {
+    uint32_t first = from >> 5;
+    uint32_t last = (to - 1) >> 5;
+    if (first == last) {
+        return popcount32(words[first] & MASK_FROM(from) & MASK_TO(to - 1));
+    }
+    uint32_t count = popcount32(words[first] & MASK_FROM(from));
+    for (uint32_t i = first + 1; i < last; i++) {
+        count += popcount32(words[i]);
+    }
+    return count + popcount32(words[last] & MASK_TO(to - 1));
+}
+
+static void fill_runs(const uint32_t *words, uint16_t *runs) {
+    uint32_t num_runs = 0;
+    bool in_run = false;
+    for (uint32_t i = 0; i < SPARSE_CONTAINER_WORDS; i++) {
+        uint32_t line = words[i];
+        if ((line == 0 && !in_run) || (line == 0xffffffff && in_run)) {
+            continue;
+        }
+        for (uint32_t bit = i << 5; bit < (i + 1) << 5; bit++, line <<= 1) {
+            bool set = (line & 0x80000000) != 0;
+            if (set && !in_run) {
+                runs[2 * num_runs] = bit;
+            } else if (!set && in_run) {
+                runs[2 * num_runs + 1] = bit - 1 - runs[2 * num_runs];
+                num_runs++;
+            }
+            in_run = set;
+        }
+    }
+    if (in_run) {
+        runs[2 * num_runs + 1] = CONTAINER_BITS - 1 - runs[2 * num_runs];
+    }
+}
+
+static void fill_array(const uint32_t *words, uint16_t *offsets) {
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < SPARSE_CONTAINER_WORDS; i++) {
+        for (uint32_t bit = i << 5, line = words[i]; line != 0; bit++, line <<= 1) {
+            if (line & 0x80000000) {
+                offsets[len++] = bit;
+            }
+        }
+    }
+}
+
+// the smallest of the container types for 2^16 bits of dense
+static bool compress_container(const uint32_t *words, sparse_container_t *container) {
+    uint32_t count = 0;
+    uint32_t num_runs = 0;
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < SPARSE_CONTAINER_WORDS; i++) {
+        uint32_t line = words[i];
+        count += popcount32(line);
+        num_runs += popcount32(line & ~((line >> 1) | (previous << 31)));
+        previous = line;
+    }
+
+    memset(container, 0, sizeof(sparse_container_t));
+    container->count = count;
+    if (count == 0) {
+        container->type = SPARSE_EMPTY;
+        return true;
+    }
+
+    size_t run_size = sizeof(uint16_t) * 2 * num_runs;
+    size_t array_size = (count <= SPARSE_ARRAY_MAX) ? sizeof(uint16_t) * count : SIZE_MAX;
+    size_t bitmap_size = sizeof(uint32_t) * SPARSE_CONTAINER_WORDS;
+    if (run_size <= array_size && run_size < bitmap_size) {
+        container->type = SPARSE_RUN;
+        container->len = num_runs;
+        container->data = malloc(run_size);
+        if (container->data != NULL) {
+            fill_runs(words, (uint16_t *)container->data);
+        }
+    } else if (array_size < bitmap_size) {
+        container->type = SPARSE_ARRAY;
+        container->len = count;
+        container->data = malloc(array_size);
+        if (container->data != NULL) {
+            fill_array(words, (uint16_t *)container->data);
+        }
+    } else {
+        container->type = SPARSE_BITMAP;
+        container->data = malloc(bitmap_size);
+        if (container->data != NULL) {
+            memcpy(container->data, words, bitmap_size);
+        }
+    }
+    return container->data != NULL;
+}
+
+sparse_bitarray_t *sparse_bitarray_from_dense(const uint32_t *dense) {
+    sparse_bitarray_t *sparse = (sparse_bitarray_t *)calloc(1, sizeof(sparse_bitarray_t));
+    if (sparse == NULL) {
+        return NULL;
+    }
+    for (uint32_t c = 0; c < SPARSE_CONTAINERS; c++) {
+        if (!compress_container(dense + c * SPARSE_CONTAINER_WORDS, &sparse->containers[c])) {
+            sparse_bitarray_free(sparse);
+            return NULL;
+        }
+        sparse->count += sparse->containers[c].count;
+    }
+    return sparse;
+}
+
+void sparse_bitarray_free(sparse_bitarray_t *sparse) {
+    if (sparse == NULL) {
+        return;
+    }
+    for (uint32_t c = 0; c < SPARSE_CONTAINERS; c++) {
+        free(sparse->containers[c].data);
+    }
+    free(sparse);
+}
+
+size_t sparse_bitarray_size(const sparse_bitarray_t *sparse) {
+    size_t size = sizeof(sparse_bitarray_t);
+    for (uint32_t c = 0; c < SPARSE_CONTAINERS; c++) {
+        const sparse_container_t *container = &sparse->containers[c];
+        switch (container->type) {
+            case SPARSE_RUN:
+                size += sizeof(uint16_t) * 2 * container->len;
+                break;
+            case SPARSE_ARRAY:
+                size += sizeof(uint16_t) * container->len;
+                break;
+            case SPARSE_BITMAP:
+                size += sizeof(uint32_t) * SPARSE_CONTAINER_WORDS;
+                break;
+            default:
+                break;
+        }
+    }
+    return size;
+}
+
+uint32_t sparse_count_states(const sparse_bitarray_t *sparse) {
+    return sparse->count;
+}
+
+bool sparse_test_bit24(const sparse_bitarray_t *sparse, uint32_t index) {
+    const sparse_container_t *container = &sparse->containers[(index >> 16) & 0xff];
+    uint16_t bit = index & 0xffff;
+    switch (container->type) {
+        case SPARSE_RUN: {
+            // the last run starting at or before bit
+            const uint16_t *runs = (const uint16_t *)container->data;
+            int32_t lo = 0, hi = (int32_t)container->len - 1;
+            while (lo <= hi) {
+                int32_t mid = (lo + hi) / 2;
+                if (runs[2 * mid] <= bit) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid - 1;
+                }
+            }
+            return hi >= 0 && bit - runs[2 * hi] <= runs[2 * hi + 1];
+        }
+        case SPARSE_ARRAY: {
+            const uint16_t *offsets = (const uint16_t *)container->data;
+            int32_t lo = 0, hi = (int32_t)container->len - 1;
+            while (lo <= hi) {
+                int32_t mid = (lo + hi) / 2;
+                if (offsets[mid] == bit) {
+                    return true;
+                } else if (offsets[mid] < bit) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid - 1;
+                }
+            }
+            return false;
+        }
+        case SPARSE_BITMAP:
+            return (((const uint32_t *)container->data)[bit >> 5] & (0x80000000 >> (bit & 0x1f))) != 0;
+        default:
+            return false;
+    }
+}
+
+void sparse_bitarray_to_dense(const sparse_bitarray_t *sparse, uint32_t *dense) {
+    for (uint32_t c = 0; c < SPARSE_CONTAINERS; c++) {
+        const sparse_container_t *container = &sparse->containers[c];
+        uint32_t *words = dense + c * SPARSE_CONTAINER_WORDS;
+        if (container->type == SPARSE_BITMAP) {
+            memcpy(words, container->data, sizeof(uint32_t) * SPARSE_CONTAINER_WORDS);
+            continue;
+        }
+        memset(words, 0, sizeof(uint32_t) * SPARSE_CONTAINER_WORDS);
+        const uint16_t *data = (const uint16_t *)container->data;
+        if (container->type == SPARSE_RUN) {
+            for (uint32_t r = 0; r < container->len; r++) {
+                set_range(words, data[2 * r], data[2 * r] + data[2 * r + 1] + 1);
+            }
+        } else if (container->type == SPARSE_ARRAY) {
+            for (uint32_t i = 0; i < container->len; i++) {
+                words[data[i] >> 5] |= 0x80000000 >> (data[i] & 0x1f);
+            }
+        }
+    }
+}
+
+// A &= container for 2^16 bits of A, returns the bits left
+static uint32_t and_container(uint32_t *words, const sparse_container_t *container) {
+    uint32_t count = 0;
+    switch (container->type) {
+        case SPARSE_RUN: {
+            const uint16_t *runs = (const uint16_t *)container->data;
+            uint32_t pos = 0;
+            for (uint32_t r = 0; r < container->len; r++) {
+                uint32_t start = runs[2 * r];
+                uint32_t end = start + runs[2 * r + 1] + 1;
+                clear_range(words, pos, start);
+                count += count_range(words, start, end);
+                pos = end;
+            }
+            clear_range(words, pos, CONTAINER_BITS);
+            break;
+        }
+        case SPARSE_ARRAY: {
+            // gather the surviving bits, rather than building a mask for every word
+            const uint16_t *offsets = (const uint16_t *)container->data;
+            uint32_t kept[SPARSE_CONTAINER_WORDS] = {0};
+            for (uint32_t i = 0; i < container->len; i++) {
+                uint32_t bit = words[offsets[i] >> 5] & (0x80000000 >> (offsets[i] & 0x1f));
+                kept[offsets[i] >> 5] |= bit;
+                count += (bit != 0);
+            }
+            memcpy(words, kept, sizeof(kept));
+            break;
+        }
+        case SPARSE_BITMAP: {
+            const uint32_t *bitmap = (const uint32_t *)container->data;
+            for (uint32_t w = 0; w < SPARSE_CONTAINER_WORDS; w++) {
+                words[w] &= bitmap[w];
+                count += popcount32(words[w]);
+            }
+            break;
+        }
+        default:
+            memset(words, 0, sizeof(uint32_t) * SPARSE_CONTAINER_WORDS);
+            break;
+    }
+    return count;
+}
+
+void bitarray_AND_sparse(uint32_t *A, const sparse_bitarray_t *B) {
+    for (uint32_t c = 0; c < SPARSE_CONTAINERS; c++) {
+        and_container(A + c * SPARSE_CONTAINER_WORDS, &B->containers[c]);
+    }
+}
+
+uint32_t count_bitarray_AND_sparse(uint32_t *A, const sparse_bitarray_t *B) {
+    uint32_t count = 0;
+    for (uint32_t c = 0; c < SPARSE_CONTAINERS; c++) {
+        count += and_container(A + c * SPARSE_CONTAINER_WORDS, &B->containers[c]);
+    }
+    return count;
+}
@@ -0,0 +1,58 @@
+//-----------------------------------------------------------------------------
+// Compressed read-only 2^24 bit bitarrays for hosts with little memory
+//-----------------------------------------------------------------------------
+// A dense hardnested bitarray always takes 2MB. The sparse one splits the 2^24
+// bits into 256 containers of 2^16 bits, each stored in the smallest of:
+//   empty   no bit set
+//   run     sorted (start, length - 1) pairs of consecutive set bits
+//   array   sorted offsets of the set bits, at most SPARSE_ARRAY_MAX of them
+//   bitmap  2048 words in the dense layout (bit 0 is the MSB of word 0)
+// Sparse bitarrays are built from a dense one and are only ever ANDed into
+// dense ones, the way the bitflip tables are used.
+//-----------------------------------------------------------------------------
+
+#ifndef HARDNESTED_SPARSE_BITARRAY_H__
+#define HARDNESTED_SPARSE_BITARRAY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SPARSE_CONTAINERS       256
+#define SPARSE_CONTAINER_WORDS  2048        // (1 << 16) bits
+#define SPARSE_ARRAY_MAX        4096
+
+typedef enum {
+    SPARSE_EMPTY = 0,
+    SPARSE_RUN,
+    SPARSE_ARRAY,
+    SPARSE_BITMAP
+} sparse_container_type_t;
+
+typedef struct {
+    uint8_t type;           // sparse_container_type_t
+    uint16_t len;           // runs or offsets, unused for bitmaps
+    uint32_t count;         // bits set
+    void *data;             // uint16_t pairs or offsets, uint32_t words
+} sparse_container_t;
+
+typedef struct {
+    uint32_t count;
+    sparse_container_t containers[SPARSE_CONTAINERS];
+} sparse_bitarray_t;
+
+// Compress dense (1 << 19 words). NULL when out of memory.
+sparse_bitarray_t *sparse_bitarray_from_dense(const uint32_t *dense);
+void sparse_bitarray_free(sparse_bitarray_t *sparse);
+// Bytes allocated for sparse, the struct included
+size_t sparse_bitarray_size(const sparse_bitarray_t *sparse);
+uint32_t sparse_count_states(const sparse_bitarray_t *sparse);
+bool sparse_test_bit24(const sparse_bitarray_t *sparse, uint32_t index);
+// Expand sparse into dense (1 << 19 words)
+void sparse_bitarray_to_dense(const sparse_bitarray_t *sparse, uint32_t *dense);
+
+// The dense bitarray_AND() and count_bitarray_AND() with a sparse B: A &= B
+void bitarray_AND_sparse(uint32_t *A, const sparse_bitarray_t *B);
+uint32_t count_bitarray_AND_sparse(uint32_t *A, const sparse_bitarray_t *B);
+
+#endif
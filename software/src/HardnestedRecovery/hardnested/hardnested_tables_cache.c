@@ -0,0 +1,308 @@
+//-----------------------------------------------------------------------------
+// On-disk cache of the expanded hardnested bitarrays, see hardnested_tables_cache.h
+//-----------------------------------------------------------------------------
+
+#include "hardnested_tables_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define CACHE_MAGIC         "CUHT"
+#define CACHE_VERSION       2
+#define CACHE_HEADER_SIZE   32
+#define CACHE_ENTRY_SIZE    24
+#define CACHE_BOM           0x01020304
+#define CACHE_ALIGN         4096
+
+static uint8_t *cache_map = NULL;
+static size_t cache_size = 0;
+static uint32_t cache_tables = 0;
+static bool *cache_checked = NULL;     // per table, its checksum was read
+static bool cache_corrupt = false;
+static char *cache_file = NULL;
+
+uint64_t tables_cache_hash(uint64_t hash, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+// FNV-1a 64 word by word, several times faster than tables_cache_hash() over a whole table
+static uint64_t table_checksum(const uint32_t *bitarray) {
+    const uint64_t *words = (const uint64_t *)bitarray;
+    uint64_t hash = TABLES_CACHE_HASH_INIT;
+    for (size_t i = 0; i < TABLES_CACHE_BITARRAY_SIZE / sizeof(uint64_t); i++) {
+        hash = (hash ^ words[i]) * UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+static char *cache_path(const char *dir, const char *suffix) {
+    size_t len = strlen(dir) + strlen(TABLES_CACHE_FILE) + strlen(suffix) + 2;
+    char *path = (char *)malloc(len);
+    if (path != NULL) {
+        snprintf(path, len, "%s/%s%s", dir, TABLES_CACHE_FILE, suffix);
+    }
+    return path;
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// copy-on-write mapping of the whole file
+static uint8_t *map_file(const char *path, size_t *size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < CACHE_HEADER_SIZE) {
+        CloseHandle(file);
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        return NULL;
+    }
+    uint8_t *map = (uint8_t *)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    *size = (size_t)file_size.QuadPart;
+    return map;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < CACHE_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    *size = st.st_size;
+    return (uint8_t *)map;
+#endif
+}
+
+static void unmap_file(uint8_t *map, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(map);
+#else
+    munmap(map, size);
+#endif
+}
+
+static bool valid_cache(const uint8_t *map, size_t size, uint64_t fingerprint, uint32_t num_tables) {
+    if (memcmp(map, CACHE_MAGIC, 4) != 0 || get_u16(map + 4) != CACHE_VERSION ||
+            get_u16(map + 6) != CACHE_HEADER_SIZE || get_u32(map + 8) != CACHE_BOM ||
+            get_u32(map + 12) != num_tables || get_u64(map + 16) != fingerprint) {
+        return false;
+    }
+    size_t index_end = CACHE_HEADER_SIZE + (size_t)num_tables * CACHE_ENTRY_SIZE;
+    if (size < index_end) {
+        return false;
+    }
+    uint64_t zero = 0;
+    uint64_t hash = tables_cache_hash(TABLES_CACHE_HASH_INIT, map, 24);
+    hash = tables_cache_hash(hash, &zero, sizeof(zero));
+    hash = tables_cache_hash(hash, map + CACHE_HEADER_SIZE, index_end - CACHE_HEADER_SIZE);
+    if (hash != get_u64(map + 24)) {
+        return false;
+    }
+    for (uint32_t id = 0; id < num_tables; id++) {
+        uint64_t offset = get_u64(map + CACHE_HEADER_SIZE + (size_t)id * CACHE_ENTRY_SIZE);
+        if (offset != 0 && (offset % CACHE_ALIGN != 0 || offset < index_end || offset > size ||
+                            size - offset < TABLES_CACHE_BITARRAY_SIZE)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool tables_cache_open(const char *dir, uint64_t fingerprint, uint32_t num_tables) {
+    tables_cache_close();
+    char *path = cache_path(dir, "");
+    if (path == NULL) {
+        return false;
+    }
+    size_t size = 0;
+    uint8_t *map = map_file(path, &size);
+    if (map == NULL) {
+        free(path);
+        return false;
+    }
+    bool *checked = (bool *)calloc(num_tables, sizeof(bool));
+    if (checked == NULL || !valid_cache(map, size, fingerprint, num_tables)) {
+        free(checked);
+        free(path);
+        unmap_file(map, size);
+        return false;
+    }
+    cache_map = map;
+    cache_size = size;
+    cache_tables = num_tables;
+    cache_checked = checked;
+    cache_file = path;
+    return true;
+}
+
+uint32_t *tables_cache_get(uint32_t id, uint32_t *count) {
+    if (cache_map == NULL || id >= cache_tables) {
+        return NULL;
+    }
+    const uint8_t *entry = cache_map + CACHE_HEADER_SIZE + (size_t)id * CACHE_ENTRY_SIZE;
+    uint64_t offset = get_u64(entry);
+    if (count != NULL) {
+        *count = get_u32(entry + 8);
+    }
+    return (offset == 0) ? NULL : (uint32_t *)(cache_map + offset);
+}
+
+bool tables_cache_check(uint32_t id) {
+    if (cache_map == NULL || id >= cache_tables || cache_checked[id]) {
+        return true;
+    }
+    cache_checked[id] = true;
+    const uint8_t *entry = cache_map + CACHE_HEADER_SIZE + (size_t)id * CACHE_ENTRY_SIZE;
+    uint64_t offset = get_u64(entry);
+    // the index checksum doesn't cover the tables, a bad page or a truncated copy shows here
+    if (offset == 0 || table_checksum((const uint32_t *)(cache_map + offset)) == get_u64(entry + 16)) {
+        return true;
+    }
+    cache_corrupt = true;
+    return false;
+}
+
+bool tables_cache_contains(const void *bitarray) {
+    const uint8_t *p = (const uint8_t *)bitarray;
+    return cache_map != NULL && p >= cache_map && p < cache_map + cache_size;
+}
+
+void tables_cache_close(void) {
+    if (cache_map != NULL) {
+        unmap_file(cache_map, cache_size);
+    }
+    if (cache_corrupt && cache_file != NULL) {
+        remove(cache_file);
+    }
+    free(cache_checked);
+    free(cache_file);
+    cache_map = NULL;
+    cache_size = 0;
+    cache_tables = 0;
+    cache_checked = NULL;
+    cache_corrupt = false;
+    cache_file = NULL;
+}
+
+static bool write_tables(FILE *f, uint64_t fingerprint, const cached_table_t *tables, uint32_t num_tables) {
+    size_t index_end = CACHE_HEADER_SIZE + (size_t)num_tables * CACHE_ENTRY_SIZE;
+    size_t data_start = (index_end + CACHE_ALIGN - 1) / CACHE_ALIGN * CACHE_ALIGN;
+    uint8_t *head = (uint8_t *)calloc(1, data_start);
+    if (head == NULL) {
+        return false;
+    }
+
+    uint16_t version = CACHE_VERSION, header_size = CACHE_HEADER_SIZE;
+    uint32_t bom = CACHE_BOM;
+    memcpy(head, CACHE_MAGIC, 4);
+    memcpy(head + 4, &version, sizeof(version));
+    memcpy(head + 6, &header_size, sizeof(header_size));
+    memcpy(head + 8, &bom, sizeof(bom));
+    memcpy(head + 12, &num_tables, sizeof(num_tables));
+    memcpy(head + 16, &fingerprint, sizeof(fingerprint));
+    uint64_t offset = data_start;
+    for (uint32_t id = 0; id < num_tables; id++) {
+        uint8_t *entry = head + CACHE_HEADER_SIZE + (size_t)id * CACHE_ENTRY_SIZE;
+        uint64_t table_offset = (tables[id].bitarray != NULL) ? offset : 0;
+        memcpy(entry, &table_offset, sizeof(table_offset));
+        memcpy(entry + 8, &tables[id].count, sizeof(tables[id].count));
+        if (tables[id].bitarray != NULL) {
+            uint64_t checksum = table_checksum(tables[id].bitarray);
+            memcpy(entry + 16, &checksum, sizeof(checksum));
+            offset += TABLES_CACHE_BITARRAY_SIZE;
+        }
+    }
+    uint64_t hash = tables_cache_hash(TABLES_CACHE_HASH_INIT, head, index_end);
+    memcpy(head + 24, &hash, sizeof(hash));
+
+    bool ok = fwrite(head, 1, data_start, f) == data_start;
+    free(head);
+    for (uint32_t id = 0; ok && id < num_tables; id++) {
+        if (tables[id].bitarray != NULL) {
+            ok = fwrite(tables[id].bitarray, 1, TABLES_CACHE_BITARRAY_SIZE, f) == TABLES_CACHE_BITARRAY_SIZE;
+        }
+    }
+    return ok;
+}
+
+bool tables_cache_write(const char *dir, uint64_t fingerprint, const cached_table_t *tables, uint32_t num_tables) {
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+#endif
+    // written under a temporary name first, a reader never maps a half written cache
+    char suffix[24];
+    snprintf(suffix, sizeof(suffix), ".%d.tmp", (int)getpid());
+    char *tmp_path = cache_path(dir, suffix);
+    char *path = cache_path(dir, "");
+    bool ok = false;
+    if (tmp_path != NULL && path != NULL) {
+        FILE *f = fopen(tmp_path, "wb");
+        if (f != NULL) {
+            ok = write_tables(f, fingerprint, tables, num_tables);
+            ok = (fclose(f) == 0) && ok;
+            if (ok) {
+                remove(path);
+                ok = rename(tmp_path, path) == 0;
+            }
+            if (!ok) {
+                remove(tmp_path);
+            }
+        }
+    }
+    free(tmp_path);
+    free(path);
+    return ok;
+}
@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// On-disk cache of the expanded hardnested bitarrays
+//-----------------------------------------------------------------------------
+// The bitflip tables are lzma compressed and the sum property bitarrays are
+// computed on every run. The cache file keeps all of them expanded, so that a
+// later run maps the file instead: pages are only read when a table is used.
+//
+// File <dir>/hardnested_tables.bin, native byte order:
+//   0  magic "CUHT"
+//   4  version (u16)          6  header size (u16)
+//   8  byte order mark (u32, 0x01020304)
+//  12  number of tables (u32)
+//  16  fingerprint of the compressed tables it was built from (u64)
+//  24  FNV-1a 64 of the header (this field zeroed) and the index (u64)
+// followed by the index, one {offset (u64), count (u32), reserved (u32),
+// checksum (u64)} entry per table, offset 0 for a table that isn't stored. The
+// stored tables are TABLES_CACHE_BITARRAY_SIZE bytes each, at page aligned
+// offsets, their checksum is FNV-1a 64 over their 64-bit words. Opening checks
+// the header and the index only, a table is checked on its first use.
+//-----------------------------------------------------------------------------
+
+#ifndef HARDNESTED_TABLES_CACHE_H__
+#define HARDNESTED_TABLES_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TABLES_CACHE_FILE           "hardnested_tables.bin"
+#define TABLES_CACHE_BITARRAY_SIZE  (sizeof(uint32_t) * (1 << 19))
+#define TABLES_CACHE_HASH_INIT      UINT64_C(0xcbf29ce484222325)
+
+typedef struct {
+    uint32_t *bitarray;     // NULL: not stored
+    uint32_t count;
+} cached_table_t;
+
+// FNV-1a 64 of data, continuing hash (TABLES_CACHE_HASH_INIT to start)
+uint64_t tables_cache_hash(uint64_t hash, const void *data, size_t len);
+
+// Map the cache file of dir. Fails when it is missing, of another version or
+// layout, corrupt, or built from tables of another fingerprint.
+bool tables_cache_open(const char *dir, uint64_t fingerprint, uint32_t num_tables);
+// Table id of the open cache: its count, and its bitarray (NULL when not stored)
+// in a copy-on-write mapping, so callers may modify it in place.
+uint32_t *tables_cache_get(uint32_t id, uint32_t *count);
+// Whether the stored table id matches its checksum, read the first time only. It
+// returns false once for a corrupt table: the caller expands the table again in
+// place, and closing the cache removes its file for the next run to rebuild it.
+// Not thread safe.
+bool tables_cache_check(uint32_t id);
+// Whether bitarray lies in the mapping, and must not be freed then
+bool tables_cache_contains(const void *bitarray);
+void tables_cache_close(void);
+
+// Write the cache file of dir (created if needed), replacing any previous one.
+bool tables_cache_write(const char *dir, uint64_t fingerprint, const cached_table_t *tables, uint32_t num_tables);
+
+#endif
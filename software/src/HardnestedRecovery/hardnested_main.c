@@ -5,6 +5,10 @@
 #include <stdbool.h>
 #include <inttypes.h>
 #include <errno.h> // For error handling
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 #include "cmdhfmfhard.h"
 #include "crapto1.h"
@@ -16,22 +20,12 @@ typedef enum {
     KEY_B = 1  // Matches the binary file format (1 for B)
 } key_type_t;
 
+// nt_enc1 (4), nt_enc2 (4), packed parities (1)
+#define NONCE_RECORD_LEN 9
 
-bool read_uint32_le(FILE *f, uint32_t *value) {
-    uint8_t bytes[4];
-    size_t read_count = fread(bytes, 1, 4, f);
-    if (read_count != 4) {
-        if (feof(f)) {
-            return false; // Clean EOF
-        } else {
-            perror("fread uint32_le failed");
-            fprintf(stderr, "Read only %zu bytes\n", read_count);
-            return false; // Error
-        }
-    }
-    // Construct Little-Endian value
-    *value = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
-    return true;
+
+static uint32_t bytes_to_uint32_be(const uint8_t *bytes) {
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
 }
 
 bool read_uint32_be(FILE *f, uint32_t *value) {
@@ -47,7 +41,7 @@ bool read_uint32_be(FILE *f, uint32_t *value) {
         }
     }
     // Construct Big-Endian value
-    *value = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+    *value = bytes_to_uint32_be(bytes);
     return true;
 }
 
@@ -67,14 +61,123 @@ bool read_uint8(FILE *f, uint8_t *value) {
 }
 
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        // Updated usage message for the new binary input
-        fprintf(stderr, "Usage: %s <binary_nonce_file_path.bin>\n", argv[0]);
+// UID (BE), sector and key type of a nonce file or stream
+static bool read_header(FILE *f, uint32_t *uid, uint8_t *sector, key_type_t *key_type) {
+    uint8_t key_type_byte;
+
+    // Use Big-Endian reader for UID
+    if (!read_uint32_be(f, uid)) {
+        fprintf(stderr, "Error reading UID (BE) from binary file header.\n");
+        return false;
+    }
+    // Sector and KeyType are single bytes, no endianness issue
+    if (!read_uint8(f, sector)) {
+        fprintf(stderr, "Error reading Sector from binary file header.\n");
+        return false;
+    }
+    if (!read_uint8(f, &key_type_byte)) {
+        fprintf(stderr, "Error reading KeyType from binary file header.\n");
+        return false;
+    }
+
+    // Validate key_type_byte
+    if (key_type_byte != KEY_A && key_type_byte != KEY_B) {
+        fprintf(stderr, "Error: Invalid key type byte %u in header. Should be 0 or 1.\n", key_type_byte);
+        return false;
+    }
+    *key_type = (key_type_t)key_type_byte;
+    return true;
+}
+
+// Nonce records read from a pipe while the device still acquires them
+typedef struct {
+    FILE *f;
+    hardnested_nonce_t pending;     // second nonce of the last record
+    bool have_pending;
+    size_t records;
+} nonce_stream_t;
+
+static bool next_stream_nonce(void *ctx, hardnested_nonce_t *nonce) {
+    nonce_stream_t *stream = (nonce_stream_t *)ctx;
+    if (stream->have_pending) {
+        *nonce = stream->pending;
+        stream->have_pending = false;
+        return true;
+    }
+    uint8_t record[NONCE_RECORD_LEN];
+    size_t read_count = fread(record, 1, NONCE_RECORD_LEN, stream->f);
+    if (read_count != NONCE_RECORD_LEN) {
+        if (read_count != 0) {
+            fprintf(stderr, "Error: nonce stream ended within a nonce record.\n");
+        }
+        return false;
+    }
+    stream->records++;
+    nonce->nt_enc = bytes_to_uint32_be(record);
+    nonce->par_enc = record[8] >> 4;
+    stream->pending.nt_enc = bytes_to_uint32_be(record + 4);
+    stream->pending.par_enc = record[8] & 0x0F;
+    stream->have_pending = true;
+    return true;
+}
+
+// Tell the writer to stop acquiring. Closing our end makes its further writes fail instead of block.
+static void stream_done(void *ctx, uint32_t nonces_used) {
+    nonce_stream_t *stream = (nonce_stream_t *)ctx;
+    printf("Nonce acquisition complete: %u nonces used of %zu nonce pairs read\n", nonces_used, stream->records);
+    fflush(stdout);
+    fclose(stream->f);
+    stream->f = NULL;
+}
+
+static int report_result(int result, uint64_t foundkey, uint32_t uid, uint8_t sector, key_type_t key_type) {
+    if (result == 1) {
+        printf("Key found: %012" PRIx64 "\n", foundkey);
+        // Original code prints UID/Sector/KeyType here too, which is good for clarity
+        printf("Details -> UID: %08x, Sector: %u, Key type: %c\n",
+               uid, sector, (key_type == KEY_A) ? 'A' : 'B');
+    } else {
+        printf("Key not found.\n");
+        printf("Details -> UID: %08x, Sector: %u, Key type: %c\n",
+               uid, sector, (key_type == KEY_A) ? 'A' : 'B');
+    }
+    return (result == 1) ? 0 : 1; // Return 0 on success (key found), 1 otherwise
+}
+
+// Crack the key of the nonce stream on stdin, acquired while hardnested already runs
+static int crack_stream(hardnested_job_t *job) {
+    uint32_t uid;
+    uint8_t sector;
+    key_type_t key_type;
+    uint64_t foundkey = 0;
+
+#if defined(_WIN32)
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    if (!read_header(stdin, &uid, &sector, &key_type)) {
         return 1;
     }
+    printf("Read Header -> UID: %08x, Sector: %u, Key type: %c\n",
+           uid, sector, (key_type == KEY_A) ? 'A' : 'B');
+    printf("Reading nonce data from stdin as it arrives\n");
+    fflush(stdout);
 
-    char *binary_file_path = argv[1];
+    nonce_stream_t stream = {stdin, {0, 0}, false, 0};
+    hardnested_nonce_source_t source = {next_stream_nonce, stream_done, &stream};
+    int result = mfnestedhard_source(job, uid, &source, NULL, &foundkey);
+    if (stream.f != NULL) {
+        fclose(stream.f);
+    }
+    return report_result(result, foundkey, uid, sector, key_type);
+}
+
+// Crack the key of one binary nonce file
+static int crack_file(hardnested_job_t *job, const char *binary_file_path) {
+    uint32_t uid;
+    uint8_t sector;
+    key_type_t key_type;
+    uint64_t foundkey = 0;
+    int result;
 
     // --- Open binary input file ---
     FILE *bin_fp = fopen(binary_file_path, "rb"); // Open in binary read mode
@@ -84,139 +187,188 @@ int main(int argc, char *argv[]) {
     }
 
     // --- Read Header ---
-    uint32_t uid;
-    uint8_t sector;
-    uint8_t key_type_byte;
-
-    // Use Big-Endian reader for UID
-    if (!read_uint32_be(bin_fp, &uid)) {
-        fprintf(stderr, "Error reading UID (BE) from binary file header.\n");
+    if (!read_header(bin_fp, &uid, &sector, &key_type)) {
         fclose(bin_fp);
         return 1;
     }
-    // Sector and KeyType are single bytes, no endianness issue
-    if (!read_uint8(bin_fp, &sector)) {
-        fprintf(stderr, "Error reading Sector from binary file header.\n");
+
+    printf("Read Header -> UID: %08x, Sector: %u, Key type: %c\n",
+           uid, sector, (key_type == KEY_A) ? 'A' : 'B');
+    printf("Reading nonce data from binary file: %s\n", binary_file_path);
+
+    // --- Read the nonce data into memory ---
+    // Every record holds nt_enc1 (BE), nt_enc2 (BE) and their packed parities, 4 bits each
+    long header_end = ftell(bin_fp);
+    if (header_end < 0 || fseek(bin_fp, 0, SEEK_END) != 0) {
+        perror("Error seeking in binary nonce file");
         fclose(bin_fp);
         return 1;
     }
-    if (!read_uint8(bin_fp, &key_type_byte)) {
-        fprintf(stderr, "Error reading KeyType from binary file header.\n");
+    long body_len = ftell(bin_fp) - header_end;
+    if (body_len < 0 || fseek(bin_fp, header_end, SEEK_SET) != 0) {
+        perror("Error seeking in binary nonce file");
         fclose(bin_fp);
         return 1;
     }
+    if (body_len % NONCE_RECORD_LEN != 0) {
+        // a dump cut short while writing, the whole records before it are still good
+        fprintf(stderr, "Warning: ignoring the last %ld bytes of the binary file, a partial nonce record (truncated file?).\n",
+                body_len % NONCE_RECORD_LEN);
+        body_len -= body_len % NONCE_RECORD_LEN;
+    }
+    size_t nonces_processed = body_len / NONCE_RECORD_LEN; // Counts pairs of nonces (nt1, nt2)
 
-    // Validate key_type_byte
-    if (key_type_byte != KEY_A && key_type_byte != KEY_B) {
-        fprintf(stderr, "Error: Invalid key type byte %u in header. Should be 0 or 1.\n", key_type_byte);
+    if (nonces_processed == 0) {
+        fprintf(stderr, "Error: No nonce data chunks found in the binary file after the header.\n");
+        fclose(bin_fp);
+        return 1;
+    }
+    if (nonces_processed > UINT32_MAX / 2) {
+        fprintf(stderr, "Error: Too many nonces in the binary file.\n");
         fclose(bin_fp);
         return 1;
     }
-    key_type_t key_type = (key_type_t)key_type_byte;
 
-    // --- Create and open temporary text file ---
-    char temp_file[] = "temp_nonces.txt";
-    FILE *temp_fp = fopen(temp_file, "w");
-    if (temp_fp == NULL) {
-        perror("Error creating temporary file");
+    uint8_t *body = malloc(body_len);
+    hardnested_nonce_t *nonce_list = calloc(nonces_processed * 2, sizeof(hardnested_nonce_t));
+    if (body == NULL || nonce_list == NULL) {
+        fprintf(stderr, "Error: Out of memory reading %zu nonce pairs.\n", nonces_processed);
+        free(body);
+        free(nonce_list);
+        fclose(bin_fp);
+        return 1;
+    }
+    if (fread(body, 1, body_len, bin_fp) != (size_t)body_len) {
+        perror("Error reading nonce data from binary file body");
+        free(body);
+        free(nonce_list);
         fclose(bin_fp);
         return 1;
     }
+    fclose(bin_fp);
 
-    printf("Read Header -> UID: %08x, Sector: %u, Key type: %c\n",
-           uid, sector, (key_type == KEY_A) ? 'A' : 'B');
-    printf("Reading nonce data from binary file: %s\n", binary_file_path);
+    for (size_t i = 0; i < nonces_processed; i++) {
+        const uint8_t *record = body + i * NONCE_RECORD_LEN;
+        nonce_list[2 * i].nt_enc = bytes_to_uint32_be(record);
+        nonce_list[2 * i].par_enc = record[8] >> 4;
+        nonce_list[2 * i + 1].nt_enc = bytes_to_uint32_be(record + 4);
+        nonce_list[2 * i + 1].par_enc = record[8] & 0x0F;
+    }
+    free(body);
 
-    // --- Read binary file (nonce data) and write to temp text file ---
-    uint32_t nt_enc1, nt_enc2;
-    uint8_t par_packed;
-    uint8_t par_enc1, par_enc2;
-    size_t nonces_processed = 0; // Counts pairs of nonces (nt1, nt2)
-
-    while (true) {
-        // *** Use Big-Endian reader for nonces ***
-        if (!read_uint32_be(bin_fp, &nt_enc1)) {
-            if (feof(bin_fp)) break; // Expected EOF after last full chunk
-            fprintf(stderr, "Error reading nt_enc1 (BE) from binary file body.\n");
-            fclose(bin_fp);
-            fclose(temp_fp);
-            remove(temp_file);
-            return 1;
-        }
+    printf("Processed %zu nonce pairs (total %zu nonces) from binary file.\n", nonces_processed, nonces_processed * 2);
 
-        // *** Use Big-Endian reader for nonces ***
-        if (!read_uint32_be(bin_fp, &nt_enc2)) {
-            // Should not happen if nt_enc1 read succeeded, unless file is truncated
-            fprintf(stderr, "Error reading nt_enc2 (BE) from binary file body (truncated file?).\n");
-            fclose(bin_fp);
-            fclose(temp_fp);
-            remove(temp_file);
-            return 1;
-        }
+    // --- Call the core attack function ---
+    result = mfnestedhard_list(job, uid, nonce_list, (uint32_t)(nonces_processed * 2), NULL, &foundkey);
 
-        // Read packed parity byte (single byte, no endianness issue)
-        if (!read_uint8(bin_fp, &par_packed)) {
-            // Should not happen if nt_enc2 read succeeded, unless file is truncated
-            fprintf(stderr, "Error reading packed parity from binary file body (truncated file?).\n");
-            fclose(bin_fp);
-            fclose(temp_fp);
-            remove(temp_file);
-            return 1;
-        }
+    // --- Cleanup ---
+    free(nonce_list);
 
-        // Extract individual parities
-        par_enc1 = par_packed >> 4;
-        par_enc2 = par_packed & 0x0F;
-
-        // Write both nonce/parity pairs to temp file in expected text format
-        if (fprintf(temp_fp, "%u|%u\n", nt_enc1, par_enc1) < 0) {
-            perror("Error writing nt_enc1 pair to temporary file");
-            fclose(bin_fp);
-            fclose(temp_fp);
-            remove(temp_file);
-            return 1;
-        }
-        if (fprintf(temp_fp, "%u|%u\n", nt_enc2, par_enc2) < 0) {
-            perror("Error writing nt_enc2 pair to temporary file");
-            fclose(bin_fp);
-            fclose(temp_fp);
-            remove(temp_file);
-            return 1;
-        }
+    return report_result(result, foundkey, uid, sector, key_type);
+}
 
-        nonces_processed++;
+int main(int argc, char *argv[]) {
+    const char **binary_file_paths = (const char **)calloc(argc, sizeof(char *));
+    int num_files = 0;
+    bool usage = binary_file_paths == NULL;
+    const char *journal_path = NULL;
+    bool resume = false;
+    bool benchmark_only = false;
+    key_hint_t key_hint = KEY_HINT_INIT;
+    for (int i = 1; i < argc && !usage; i++) {
+        if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--cache") == 0) && i + 1 < argc) {
+            hardnested_set_cache_dir(argv[++i]);
+        } else if (strcmp(argv[i], "--rebenchmark") == 0) {
+            hardnested_set_rebenchmark(true);
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            journal_path = argv[++i];
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            resume = true;
+        } else if (strcmp(argv[i], "--low-memory") == 0) {
+            hardnested_set_low_memory(true);
+        } else if (strcmp(argv[i], "--key-hint") == 0 && i + 1 < argc) {
+            usage = !key_hint_parse(&key_hint, argv[++i]);
+        } else if (strcmp(argv[i], "--benchmark") == 0) {
+            benchmark_only = true;
+        } else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+            binary_file_paths[num_files++] = argv[i];
+        } else {
+            usage = true;
+        }
     }
-
-    fclose(bin_fp);
-    fclose(temp_fp); // Close temp file so mfnestedhard can read it
-
-    printf("Processed %zu nonce pairs (total %zu nonces) from binary file.\n", nonces_processed, nonces_processed * 2);
-
-    if (nonces_processed == 0) {
-        fprintf(stderr, "Error: No nonce data chunks found in the binary file after the header.\n");
-        remove(temp_file);
+    if (benchmark_only && !usage) {
+        printf("Brute force benchmark: %.0f keys/s\n", hardnested_benchmark(true));
+        free(binary_file_paths);
+        return 0;
+    }
+    // stdin is read while acquired, it can't wait for other keys
+    for (int i = 0; i < num_files && num_files > 1; i++) {
+        usage |= strcmp(binary_file_paths[i], "-") == 0;
+    }
+    if (num_files == 0 || usage || (resume && journal_path == NULL)) {
+        fprintf(stderr, "Usage: %s [--cache <dir>] [--rebenchmark] [--low-memory] [--journal <file> [--resume]] [--key-hint <hint>] <binary_nonce_file_path.bin ... | ->\n", argv[0]);
+        fprintf(stderr, "       %s [--cache <dir>] --benchmark\n", argv[0]);
+        fprintf(stderr, "  --cache <dir>  keep the expanded bitflip and sum tables in <dir>, later runs map them instead of decompressing\n");
+        fprintf(stderr, "  --rebenchmark  measure the brute force speed again instead of using the stored benchmark\n");
+        fprintf(stderr, "  --low-memory   keep the bitflip and sum tables compressed, for hosts with little memory (slower, no --cache)\n");
+        fprintf(stderr, "  --journal <file>\n");
+        fprintf(stderr, "                 record the brute force progress in <file>, removed once the attack is finished.\n");
+        fprintf(stderr, "                 With several nonce files, the n-th one has its progress in <file>.<n>\n");
+        fprintf(stderr, "  --resume       skip the brute force work <file> has as done by an interrupted run on the same nonces\n");
+        fprintf(stderr, "  --key-hint <hint>\n");
+        fprintf(stderr, "                 only search keys matching <hint>: hex digits, '?' for unknown ones, a shorter\n");
+        fprintf(stderr, "                 one is a prefix (a0a1a2, ????????ff00), ',' between alternatives, @<file> for\n");
+        fprintf(stderr, "                 one per line. Bits of the first key byte don't shrink the search\n");
+        fprintf(stderr, "  --benchmark    only measure and store the brute force speed\n");
+        fprintf(stderr, "  -              read the nonce file from stdin while it is written, print a line starting with\n");
+        fprintf(stderr, "                 \"Nonce acquisition complete\" and stop reading once there are enough nonces\n");
+        fprintf(stderr, "Several nonce files (one per sector and key type) are cracked one after the other, with the\n");
+        fprintf(stderr, "tables expanded and the benchmark taken once.\n");
+        free(binary_file_paths);
+        key_hint_free(&key_hint);
         return 1;
     }
+    hardnested_set_journal(journal_path, resume);
+    hardnested_set_key_hint(&key_hint);
+    key_hint_free(&key_hint);
 
-    // --- Call the core attack function ---
-    uint64_t foundkey = 0;
-    // mfnestedhard expects keyType as 0 for A, 1 for B, which matches our enum/byte value
-    int result = mfnestedhard(sector, key_type, NULL, 0, 0, NULL, false, false, false, &foundkey, NULL, uid, temp_file);
-
-    // --- Report result ---
-    if (result == 1) {
-        printf("Key found: %012" PRIx64 "\n", foundkey);
-        // Original code prints UID/Sector/KeyType here too, which is good for clarity
-        printf("Details -> UID: %08x, Sector: %u, Key type: %c\n",
-               uid, sector, (key_type == KEY_A) ? 'A' : 'B');
-    } else {
-        printf("Key not found.\n");
-        printf("Details -> UID: %08x, Sector: %u, Key type: %c\n",
-               uid, sector, (key_type == KEY_A) ? 'A' : 'B');
+    hardnested_job_t *job = hardnested_job_new();
+    if (job == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        free(binary_file_paths);
+        return 1;
     }
 
-    // --- Cleanup ---
-    remove(temp_file);
+    if (num_files == 1) {
+        int result = (strcmp(binary_file_paths[0], "-") == 0) ? crack_stream(job) : crack_file(job, binary_file_paths[0]);
+        hardnested_job_free(job);
+        free(binary_file_paths);
+        return result;
+    }
 
-    return (result == 1) ? 0 : 1; // Return 0 on success (key found), 1 otherwise
+    // each file has its own journal, <file>.<n> for the n-th one: a journal only keeps the
+    // progress of one nonce set and is removed once its attack is finished
+    char *file_journal_path = (journal_path != NULL) ? (char *)malloc(strlen(journal_path) + 16) : NULL;
+    if (journal_path != NULL && file_journal_path == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        hardnested_job_free(job);
+        free(binary_file_paths);
+        return 1;
+    }
+    hardnested_begin();
+    int keys_found = 0;
+    for (int i = 0; i < num_files; i++) {
+        printf("\n[%d/%d] %s\n", i + 1, num_files, binary_file_paths[i]);
+        if (file_journal_path != NULL) {
+            sprintf(file_journal_path, "%s.%d", journal_path, i + 1);
+            hardnested_set_journal(file_journal_path, resume);
+        }
+        keys_found += (crack_file(job, binary_file_paths[i]) == 0);
+    }
+    hardnested_end();
+    free(file_journal_path);
+    hardnested_job_free(job);
+    printf("\nKeys found: %d of %d\n", keys_found, num_files);
+    free(binary_file_paths);
+    return (keys_found == num_files) ? 0 : 1;
 }
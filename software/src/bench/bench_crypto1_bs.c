@@ -0,0 +1,258 @@
+// Benchmark and equivalence check of the bitsliced Crypto1 in crypto1_bs.c.
+//
+// Runs crypto1_bs_init/load/store/get_lfsr/word/rollback_word/match_word on random
+// blocks of every size from 1 to CRYPTO1_BS_MAX_STATES states, random inputs and both
+// feedback modes, and compares every state, keystream word and key with the scalar
+// crypto1_init(), crypto1_word(), lfsr_rollback_word() and crypto1_get_lfsr(). Checks that the
+// parity filter of staticnested_1nt_keys() keeps the keys a cipher run from each key keeps.
+// Then times the rollback and key extraction of a state list, the loop of nested and
+// staticnested_1nt, both ways. Any mismatch fails the run.
+//
+// Usage: bench_crypto1_bs [states]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "crapto1.h"
+#include "crypto1_bs.h"
+#include "parity.h"
+#include "staticnested_util.h"
+#include "common.h"
+#include "bench_util.h"
+
+#define BENCH_STATES    (1 << 20)
+#define HALF_MASK       0xffffff
+
+static uint64_t rand_key(uint32_t *seed) {
+    uint64_t key = bench_rand(seed);
+    return (key << 16 ^ bench_rand(seed)) & 0xffffffffffffULL;
+}
+
+static bool same_state(const struct Crypto1State *a, const struct Crypto1State *b) {
+    return ((a->odd ^ b->odd) & HALF_MASK) == 0 && ((a->even ^ b->even) & HALF_MASK) == 0;
+}
+
+static bool check_states(const char *what, const crypto1_bs_t *b, const struct Crypto1State *ref) {
+    struct Crypto1State out[CRYPTO1_BS_MAX_STATES];
+    crypto1_bs_store(b, out);
+    for (uint32_t i = 0; i < b->count; i++) {
+        if (!same_state(&out[i], &ref[i])) {
+            printf("%s: state %u of %u is %06x %06x instead of %06x %06x\n", what, i, b->count,
+                   out[i].odd, out[i].even, ref[i].odd & HALF_MASK, ref[i].even & HALF_MASK);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool check_words(const char *what, const uint32_t *ks, const uint32_t *ref, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (ks[i] != ref[i]) {
+            printf("%s: keystream %u of %u is %08x instead of %08x\n", what, i, count, ks[i], ref[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// One block of count states through every function
+static bool check_block(uint32_t count, uint32_t *seed) {
+    static struct Crypto1State ref[CRYPTO1_BS_MAX_STATES + 1];
+    static uint64_t keys[CRYPTO1_BS_MAX_STATES], out_keys[CRYPTO1_BS_MAX_STATES];
+    static uint32_t ks[CRYPTO1_BS_MAX_STATES], ref_ks[CRYPTO1_BS_MAX_STATES];
+    crypto1_bs_t b;
+
+    for (uint32_t i = 0; i < count; i++) {
+        keys[i] = rand_key(seed);
+        crypto1_init(&ref[i], keys[i]);
+    }
+    crypto1_bs_init(&b, keys, count);
+    if (!check_states("crypto1_bs_init", &b, ref)) {
+        return false;
+    }
+
+    // clocked states carry bits above the 24 of each half, load must drop them
+    for (uint32_t round = 0; round < 4; round++) {
+        uint32_t in = bench_rand(seed);
+        int enc = round & 1;
+        for (uint32_t i = 0; i < count; i++) {
+            ref_ks[i] = crypto1_word(&ref[i], in, enc);
+        }
+        crypto1_bs_word(&b, in, enc, ks);
+        if (!check_words("crypto1_bs_word", ks, ref_ks, count) || !check_states("crypto1_bs_word", &b, ref)) {
+            return false;
+        }
+    }
+    crypto1_bs_load(&b, ref, count);
+    if (!check_states("crypto1_bs_load", &b, ref)) {
+        return false;
+    }
+
+    for (uint32_t round = 0; round < 4; round++) {
+        uint32_t in = bench_rand(seed);
+        int fb = round >> 1;
+        for (uint32_t i = 0; i < count; i++) {
+            ref_ks[i] = lfsr_rollback_word(&ref[i], in, fb);
+        }
+        crypto1_bs_rollback_word(&b, in, fb, ks);
+        if (!check_words("crypto1_bs_rollback_word", ks, ref_ks, count) || !check_states("crypto1_bs_rollback_word", &b, ref)) {
+            return false;
+        }
+    }
+
+    crypto1_bs_get_lfsr(&b, out_keys);
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t key;
+        crypto1_get_lfsr(&ref[i], &key);
+        if (out_keys[i] != key) {
+            printf("crypto1_bs_get_lfsr: key %u of %u is %012" PRIx64 " instead of %012" PRIx64 "\n", i, count, out_keys[i], key);
+            return false;
+        }
+    }
+
+    // the keystream of one state, every other state matching by chance only
+    uint32_t in = bench_rand(seed);
+    struct Crypto1State probe = ref[bench_rand(seed) % count];
+    uint32_t expected = crypto1_word(&probe, in, 1);
+    uint64_t match[CRYPTO1_BS_COLUMNS];
+    uint32_t matches = crypto1_bs_match_word(&b, in, 1, expected, match), ref_matches = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        bool ref_match = crypto1_word(&ref[i], in, 1) == expected;
+        ref_matches += ref_match;
+        if (ref_match != (bool)(match[i / CRYPTO1_BS_LANES] >> (i % CRYPTO1_BS_LANES) & 1)) {
+            printf("crypto1_bs_match_word: state %u of %u wrongly %s\n", i, count, ref_match ? "unmatched" : "matched");
+            return false;
+        }
+    }
+    for (uint32_t c = (count + CRYPTO1_BS_LANES - 1) / CRYPTO1_BS_LANES; c < CRYPTO1_BS_COLUMNS; c++) {
+        if (match[c] != 0) {
+            printf("crypto1_bs_match_word: match past the %u states\n", count);
+            return false;
+        }
+    }
+    if (matches != ref_matches || !check_states("crypto1_bs_match_word", &b, ref)) {
+        printf("crypto1_bs_match_word: %u matches instead of %u\n", matches, ref_matches);
+        return false;
+    }
+
+    // a list ending with a zero state stops the load there
+    ref[count].odd = ref[count].even = 0;
+    if (crypto1_bs_load_list(&b, ref) != count || !check_states("crypto1_bs_load_list", &b, ref)) {
+        printf("crypto1_bs_load_list: %u states instead of %u\n", b.count, count);
+        return false;
+    }
+    return true;
+}
+
+// staticnested_1nt_keys() reads the parity bit it filters on off the recovered states. The
+// reference reruns the cipher from every key, as staticnested_1nt did: same keys, same order.
+static bool check_1nt_filter(uint32_t *seed) {
+    uint32_t uid = bench_rand(seed), nt = bench_rand(seed), nt_enc = bench_rand(seed);
+    uint8_t nt_par_enc = bench_rand(seed) & 0xf;
+    uint32_t count = 0;
+    uint64_t *keys = staticnested_1nt_keys(uid, nt, nt_enc, nt_par_enc, NULL, 1, &count, NULL);
+    struct Crypto1State *list = lfsr_recovery32(nt ^ nt_enc, nt ^ uid);
+    if (keys == NULL || list == NULL) {
+        printf("Memory allocation error\n");
+        free(keys);
+        free(list);
+        return false;
+    }
+
+    uint8_t lastpar1 = oddparity8(nt & 0xFF);
+    uint32_t ref_count = 0;
+    bool ok = true;
+    for (struct Crypto1State *t = list; ok && (t->odd | t->even); t++) {
+        struct Crypto1State s = *t;
+        uint64_t key;
+        lfsr_rollback_word(&s, nt ^ uid, 0);
+        crypto1_get_lfsr(&s, &key);
+        crypto1_init(&s, key);
+        crypto1_word(&s, nt ^ uid, 0);
+        uint32_t ks2 = crypto1_word(&s, 0, 0);
+        if (lastpar1 != ((nt_par_enc & 1) ^ ((ks2 >> 24) & 1))) {
+            continue;
+        }
+        if (ref_count >= count || keys[ref_count] != key) {
+            printf("staticnested_1nt_keys: key %u is %012" PRIx64 " instead of %012" PRIx64 "\n",
+                   ref_count, (ref_count < count) ? keys[ref_count] : 0, key);
+            ok = false;
+        }
+        ref_count++;
+    }
+    if (ok && ref_count != count) {
+        printf("staticnested_1nt_keys: %u keys instead of %u\n", count, ref_count);
+        ok = false;
+    }
+    free(keys);
+    free(list);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t num_states = (argc > 1) ? (uint32_t)atoui(argv[1]) : BENCH_STATES;
+    if (num_states == 0) {
+        printf("Usage: %s [states]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t seed = 0x2545F491;
+    bool ok = true;
+    for (uint32_t count = 1; count <= CRYPTO1_BS_MAX_STATES && ok; count++) {
+        ok = check_block(count, &seed);
+    }
+    printf("equivalence with the scalar functions, blocks of 1 to %u states: %s\n", CRYPTO1_BS_MAX_STATES, ok ? "ok" : "MISMATCH");
+    if (!ok) {
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < 4 && ok; i++) {
+        ok = check_1nt_filter(&seed);
+    }
+    printf("staticnested_1nt parity filter against a cipher run from each key, 4 nonces: %s\n", ok ? "ok" : "MISMATCH");
+    if (!ok) {
+        return EXIT_FAILURE;
+    }
+
+    // list of random states, as lfsr_recovery32() returns them
+    struct Crypto1State *list = calloc(num_states + 1, sizeof(struct Crypto1State));
+    uint64_t *ref_keys = calloc(num_states, sizeof(uint64_t));
+    uint64_t *keys = calloc(num_states, sizeof(uint64_t));
+    if (list == NULL || ref_keys == NULL || keys == NULL) {
+        printf("Memory allocation error\n");
+        return EXIT_FAILURE;
+    }
+    for (uint32_t i = 0; i < num_states; i++) {
+        list[i].odd = bench_rand(&seed) & HALF_MASK;
+        list[i].even = (bench_rand(&seed) & HALF_MASK) | 1;
+    }
+    uint32_t in = bench_rand(&seed);
+
+    double start = bench_msclock();
+    for (uint32_t i = 0; i < num_states; i++) {
+        struct Crypto1State s = list[i];
+        lfsr_rollback_word(&s, in, 0);
+        crypto1_get_lfsr(&s, &ref_keys[i]);
+    }
+    double scalar_ms = bench_msclock() - start;
+
+    start = bench_msclock();
+    crypto1_bs_t b;
+    uint32_t n;
+    for (uint32_t i = 0; (n = crypto1_bs_load_list(&b, list + i)) != 0; i += n) {
+        crypto1_bs_rollback_word(&b, in, 0, NULL);
+        crypto1_bs_get_lfsr(&b, keys + i);
+    }
+    double bs_ms = bench_msclock() - start;
+
+    ok = memcmp(keys, ref_keys, num_states * sizeof(uint64_t)) == 0;
+    printf("rollback word and key of %u states: scalar %.1f ms, bitsliced %.1f ms (x%.1f) %s\n",
+           num_states, scalar_ms, bs_ms, scalar_ms / bs_ms, ok ? "ok" : "MISMATCH");
+
+    free(keys);
+    free(ref_keys);
+    free(list);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
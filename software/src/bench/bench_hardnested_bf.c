@@ -0,0 +1,61 @@
+// Benchmark for the hardnested bitsliced brute force across thread counts.
+//
+// Runs brute_force_benchmark(), the embedded test buckets hardnested times itself
+// with, for 1, 2, 4, ... threads up to max_threads (default: twice the logical CPUs)
+// and reports the throughput and the scaling against one thread. Each thread count
+// gets one test bucket per thread, the best of rounds runs is kept.
+//
+// Usage: bench_hardnested_bf [max_threads] [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "common.h"
+#include "hardnested_bruteforce.h"
+#include "util.h"
+
+#define BENCH_ROUNDS    3
+
+// the brute force reports found keys through the attack's progress output,
+// which this benchmark doesn't link
+void hardnested_print_progress(uint32_t nonces, const char *activity, float brute_force, uint64_t min_diff_print_time) {
+    (void)nonces;
+    (void)activity;
+    (void)brute_force;
+    (void)min_diff_print_time;
+}
+
+static void bench_threads(uint32_t threads, uint32_t rounds, float *single_rate) {
+    float rate = 0;
+    set_brute_force_threads(threads);
+    for (uint32_t r = 0; r < rounds; r++) {
+        float round_rate = brute_force_benchmark();
+        if (round_rate > rate) {
+            rate = round_rate;
+        }
+    }
+    if (threads == 1) {
+        *single_rate = rate;
+    }
+    printf("%7u  %14.0f  %14.0f  %6.2fx\n", threads, rate, rate / threads, (*single_rate > 0) ? rate / *single_rate : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t max_threads = (argc > 1) ? (uint32_t)atoui(argv[1]) : 2 * (uint32_t)num_CPUs();
+    uint32_t rounds = (argc > 2) ? (uint32_t)atoui(argv[2]) : BENCH_ROUNDS;
+    if (max_threads == 0 || rounds == 0) {
+        printf("Usage: %s [max_threads] [rounds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%u logical CPUs, best of %u rounds\n", num_CPUs(), rounds);
+    printf("threads          keys/s  keys/s/thread  scaling\n");
+    float single_rate = 0;
+    for (uint32_t threads = 1; threads <= max_threads; threads *= 2) {
+        bench_threads(threads, rounds, &single_rate);
+        if (threads < (uint32_t)num_CPUs() && threads * 2 > (uint32_t)num_CPUs() && (uint32_t)num_CPUs() <= max_threads) {
+            bench_threads(num_CPUs(), rounds, &single_rate);
+        }
+    }
+    return EXIT_SUCCESS;
+}
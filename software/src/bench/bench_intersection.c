@@ -0,0 +1,106 @@
+// Benchmark for the key list intersection of the darkside parity zero attack.
+//
+// Builds two -1 terminated lists of random 48-bit keys sharing a few keys, like
+// the keylists of two darkside rounds, and intersects them with the former
+// qsort + comparator walk and with radixsort48() + intersection(). Both results must match.
+//
+// Usage: bench_intersection [keys]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "common.h"
+#include "mfkey.h"
+#include "radixsort.h"
+#include "bench_util.h"
+
+#define BENCH_KEYS      (1 << 22)
+#define BENCH_COMMON    64
+
+// the intersection darkside used before, walking both lists through compare_uint64()
+static uint32_t intersection_walk(uint64_t *listA, uint64_t *listB) {
+    uint64_t *p1, *p2, *p3;
+    p1 = p3 = listA;
+    p2 = listB;
+
+    while (*p1 != UINT64_C(-1) && *p2 != UINT64_C(-1)) {
+        if (compare_uint64(p1, p2) == 0) {
+            *p3++ = *p1++;
+            p2++;
+        } else {
+            while (compare_uint64(p1, p2) < 0) ++p1;
+            while (compare_uint64(p1, p2) > 0) ++p2;
+        }
+    }
+    *p3 = UINT64_C(-1);
+    return p3 - listA;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t size = (argc > 1) ? (uint32_t)atoui(argv[1]) : BENCH_KEYS;
+    if (size < BENCH_COMMON) {
+        printf("Usage: %s [keys >= %u]\n", argv[0], BENCH_COMMON);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t *src[2], *work[2];
+    for (int l = 0; l < 2; l++) {
+        src[l] = malloc(((size_t)size + 1) * sizeof(uint64_t));
+        work[l] = malloc(((size_t)size + 1) * sizeof(uint64_t));
+        if (src[l] == NULL || work[l] == NULL) {
+            printf("Memory allocation error\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint32_t seed = 0x5eed;
+    for (int l = 0; l < 2; l++) {
+        for (uint32_t i = 0; i < size; i++) {
+            src[l][i] = (((uint64_t)bench_rand(&seed) << 16) ^ bench_rand(&seed)) & 0xffffffffffff;
+        }
+        src[l][size] = UINT64_C(-1);
+    }
+    // spread the shared keys over both lists
+    for (uint32_t i = 0; i < BENCH_COMMON; i++) {
+        src[1][(uint64_t)i * size / BENCH_COMMON] = src[0][i * 7];
+    }
+
+    for (int l = 0; l < 2; l++) {
+        memcpy(work[l], src[l], ((size_t)size + 1) * sizeof(uint64_t));
+    }
+    double start = bench_msclock();
+    qsort(work[0], size, sizeof(uint64_t), compare_uint64);
+    qsort(work[1], size, sizeof(uint64_t), compare_uint64);
+    uint32_t ref_n = intersection_walk(work[0], work[1]);
+    double walk_ms = bench_msclock() - start;
+    uint64_t *ref = malloc(((size_t)ref_n + 1) * sizeof(uint64_t));
+    if (ref == NULL) {
+        printf("Memory allocation error\n");
+        return EXIT_FAILURE;
+    }
+    memcpy(ref, work[0], ((size_t)ref_n + 1) * sizeof(uint64_t));
+
+    for (int l = 0; l < 2; l++) {
+        memcpy(work[l], src[l], ((size_t)size + 1) * sizeof(uint64_t));
+    }
+    start = bench_msclock();
+    radixsort48(work[0], size, 1);
+    radixsort48(work[1], size, 1);
+    uint32_t n = intersection(work[0], work[1]);
+    double gallop_ms = bench_msclock() - start;
+
+    bool same = (ref_n == n) && memcmp(ref, work[0], ((size_t)n + 1) * sizeof(uint64_t)) == 0;
+
+    printf("intersecting 2 x %u keys, %u common\n", size, n);
+    printf("   qsort + walk   | %8.0f ms\n", walk_ms);
+    printf("   radix + gallop | %8.0f ms | %6.2fx | %s\n", gallop_ms, walk_ms / gallop_ms, same ? "same result" : "MISMATCH");
+
+    free(ref);
+    for (int l = 0; l < 2; l++) {
+        free(src[l]);
+        free(work[l]);
+    }
+    return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
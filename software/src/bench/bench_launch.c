@@ -0,0 +1,58 @@
+// Runs one tool for bench_suite.py and reports the tool's peak RSS.
+//
+// A child of the Python suite keeps the pages it shares with the interpreter until its exec,
+// and wait4() counts them: every tool seemed to take at least the interpreter's RSS. Forked
+// from this launcher, the tool carries only the launcher's few hundred KB.
+//
+// Usage: bench_launch <rss file> <tool> [args...]
+// Writes the peak RSS of the tool in KB to <rss file> and exits with the exit code of the tool,
+// 128 + the signal number when a signal killed it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <rss file> <tool> [args...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        execv(argv[2], argv + 2);
+        perror(argv[2]);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        perror("wait4");
+        return EXIT_FAILURE;
+    }
+#if defined(__APPLE__)
+    long rss_kb = usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    long rss_kb = usage.ru_maxrss;
+#endif
+
+    FILE *f = fopen(argv[1], "w");
+    if (f == NULL) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    int written = fprintf(f, "%ld\n", rss_kb);
+    if (fclose(f) != 0 || written < 0) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
@@ -0,0 +1,64 @@
+// Benchmark for the nested() key recovery.
+//
+// Builds a fixed set of NtpKs1 entries for a known key and times the recovery
+// with 1, 2, 4, ... worker threads up to the number of online CPUs.
+//
+// Usage: bench_nested [entries] [max_threads]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "common.h"
+#include "nested_util.h"
+#include "thread_pool.h"
+#include "bench_util.h"
+
+#define BENCH_KEY       0xa0a1a2a3a4a5
+#define BENCH_UID       0x11223344
+#define BENCH_ENTRIES   16
+
+int main(int argc, char *argv[]) {
+    uint32_t entries = (argc > 1) ? (uint32_t)atoui(argv[1]) : BENCH_ENTRIES;
+    uint32_t max_threads = (argc > 2) ? (uint32_t)atoui(argv[2]) : thread_pool_cpus();
+    if (entries == 0 || max_threads == 0) {
+        printf("Usage: %s [entries] [max_threads]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    NtpKs1 *pNK = calloc(entries, sizeof(NtpKs1));
+    if (pNK == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    uint32_t seed = 0x5eed;
+    for (uint32_t i = 0; i < entries; i++) {
+        struct Crypto1State s;
+        uint32_t ntp = prng_successor(bench_rand(&seed), 0);
+        crypto1_init(&s, BENCH_KEY);
+        pNK[i].ntp = ntp;
+        pNK[i].ks1 = crypto1_word(&s, ntp ^ BENCH_UID, 0);
+    }
+
+    printf("nested(): %u entries, key %012" PRIx64 "\n", entries, (uint64_t)BENCH_KEY);
+    printf(" threads |  time ms | speedup | key found\n");
+
+    double base = 0;
+    for (uint32_t threads = 1; ; threads = (threads * 2 > max_threads && threads < max_threads) ? max_threads : threads * 2) {
+        uint32_t keyCount = 0;
+        double start = bench_msclock();
+        uint64_t *keys = nested(pNK, entries, BENCH_UID, threads, &keyCount, NULL, NULL, NULL);
+        double elapsed = bench_msclock() - start;
+        if (threads == 1) {
+            base = elapsed;
+        }
+        printf(" %7u | %8.0f | %6.2fx | %s\n", threads, elapsed, base / elapsed,
+               (keyCount > 0 && keys[0] == BENCH_KEY) ? "yes" : "no");
+        free(keys);
+        if (threads >= max_threads) {
+            break;
+        }
+    }
+
+    free(pNK);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+// Benchmark for lfsr_recovery32_mt().
+//
+// Recovers the states of a fixed set of keystreams with the serial
+// lfsr_recovery32() and with lfsr_recovery32_mt() on 2, 4, ... threads up to
+// the number of online CPUs. Every statelist must match the serial one.
+//
+// Usage: bench_recovery32 [rounds] [max_threads]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crapto1.h"
+#include "common.h"
+#include "thread_pool.h"
+#include "bench_util.h"
+
+#define BENCH_ROUNDS    8
+
+static size_t statelist_len(const struct Crypto1State *sl) {
+    size_t n = 0;
+    while (sl[n].odd | sl[n].even) {
+        n++;
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t rounds = (argc > 1) ? (uint32_t)atoui(argv[1]) : BENCH_ROUNDS;
+    uint32_t max_threads = (argc > 2) ? (uint32_t)atoui(argv[2]) : thread_pool_cpus();
+    if (rounds == 0 || max_threads == 0) {
+        printf("Usage: %s [rounds] [max_threads]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t *ks2 = calloc(rounds, sizeof(uint32_t));
+    uint32_t *in = calloc(rounds, sizeof(uint32_t));
+    struct Crypto1State **ref = calloc(rounds, sizeof(struct Crypto1State *));
+    if (ks2 == NULL || in == NULL || ref == NULL) {
+        printf("Memory allocation error\n");
+        return EXIT_FAILURE;
+    }
+
+    uint32_t seed = 0x5eed;
+    for (uint32_t r = 0; r < rounds; r++) {
+        ks2[r] = bench_rand(&seed);
+        in[r] = (r & 1) ? bench_rand(&seed) : 0;
+    }
+
+    printf("lfsr_recovery32(): %u keystreams\n", rounds);
+    printf(" threads |  time ms | speedup | statelists\n");
+
+    double start = bench_msclock();
+    for (uint32_t r = 0; r < rounds; r++) {
+        ref[r] = lfsr_recovery32(ks2[r], in[r]);
+    }
+    double base = bench_msclock() - start;
+    printf("  serial | %8.0f | %6.2fx | reference\n", base, 1.0);
+
+    bool all_same = true;
+    for (uint32_t threads = 2; threads <= max_threads; threads = (threads * 2 > max_threads && threads < max_threads) ? max_threads : threads * 2) {
+        bool same = true;
+        double elapsed = 0;
+        for (uint32_t r = 0; r < rounds; r++) {
+            start = bench_msclock();
+            struct Crypto1State *sl = lfsr_recovery32_mt(ks2[r], in[r], threads, NULL);
+            elapsed += bench_msclock() - start;
+
+            size_t n = statelist_len(ref[r]);
+            same &= (sl != NULL) && (statelist_len(sl) == n) && (memcmp(sl, ref[r], n * sizeof(struct Crypto1State)) == 0);
+            free(sl);
+        }
+        printf(" %7u | %8.0f | %6.2fx | %s\n", threads, elapsed, base / elapsed, same ? "same" : "MISMATCH");
+        all_same &= same;
+        if (threads >= max_threads) {
+            break;
+        }
+    }
+
+    for (uint32_t r = 0; r < rounds; r++) {
+        free(ref[r]);
+    }
+    free(ref);
+    free(ks2);
+    free(in);
+    return all_same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
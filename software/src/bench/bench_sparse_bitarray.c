@@ -0,0 +1,125 @@
+// Benchmark for the sparse bitarrays hardnested keeps its bitflip tables in with --low-memory.
+//
+// Builds 2^24 bit tables of several densities and layouts, compresses them with
+// sparse_bitarray_from_dense() and ANDs each into a half full state bitarray, once
+// with the dense count_bitarray_AND() and once with count_bitarray_AND_sparse().
+// Reports the memory of both forms and the time per AND. Both results must match.
+//
+// Usage: bench_sparse_bitarray [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "hardnested_bitarray_core.h"
+#include "hardnested_sparse_bitarray.h"
+#include "bench_util.h"
+
+#define BENCH_ROUNDS    20
+#define BITARRAY_WORDS  (1 << 19)
+#define BITARRAY_SIZE   (sizeof(uint32_t) * BITARRAY_WORDS)
+
+typedef struct {
+    const char *name;
+    uint32_t one_in;        // each bit (or block) set with probability 1 / one_in
+    uint32_t block_bits;    // bits set or cleared together, 1 for independent bits
+} bench_table_t;
+
+static const bench_table_t bench_tables[] = {
+    {"random 1/2", 2, 1},
+    {"random 1/8", 8, 1},
+    {"random 1/64", 64, 1},
+    {"random 1/1024", 1024, 1},
+    {"random 1/65536", 65536, 1},
+    {"blocks of 2^8, 1/4", 4, 1 << 8},
+    {"blocks of 2^12, 1/16", 16, 1 << 12},
+    {"blocks of 2^16, 1/2", 2, 1 << 16},
+    {"empty", 0, 1},
+};
+
+static void fill_table(uint32_t *bitarray, const bench_table_t *table, uint32_t *seed) {
+    memset(bitarray, 0, BITARRAY_SIZE);
+    if (table->one_in == 0) {
+        return;
+    }
+    for (uint32_t block = 0; block < (1 << 24); block += table->block_bits) {
+        if (bench_rand(seed) % table->one_in != 0) {
+            continue;
+        }
+        for (uint32_t bit = block; bit < block + table->block_bits; bit++) {
+            bitarray[bit >> 5] |= 0x80000000 >> (bit & 0x1f);
+        }
+    }
+}
+
+static bool bench_table(const bench_table_t *table, const uint32_t *states, uint32_t *work, uint32_t *expected, uint32_t rounds, uint32_t *seed) {
+    uint32_t *dense = malloc_bitarray(BITARRAY_SIZE);
+    if (dense == NULL) {
+        printf("Memory allocation error\n");
+        return false;
+    }
+    fill_table(dense, table, seed);
+    sparse_bitarray_t *sparse = sparse_bitarray_from_dense(dense);
+    if (sparse == NULL) {
+        printf("Memory allocation error\n");
+        free_bitarray(dense);
+        return false;
+    }
+
+    double dense_ms = 0, sparse_ms = 0;
+    uint32_t dense_count = 0, sparse_count = 0;
+    for (uint32_t r = 0; r < rounds; r++) {
+        memcpy(expected, states, BITARRAY_SIZE);
+        double start = bench_msclock();
+        dense_count = count_bitarray_AND(expected, dense);
+        dense_ms += bench_msclock() - start;
+
+        memcpy(work, states, BITARRAY_SIZE);
+        start = bench_msclock();
+        sparse_count = count_bitarray_AND_sparse(work, sparse);
+        sparse_ms += bench_msclock() - start;
+    }
+
+    bool ok = dense_count == sparse_count && memcmp(expected, work, BITARRAY_SIZE) == 0
+              && sparse_count_states(sparse) == count_states(dense);
+    printf("%-22s %9u  %9zu  %5.1f%%  %8.3f  %8.3f  %s\n", table->name, sparse_count_states(sparse),
+           sparse_bitarray_size(sparse), 100.0 * sparse_bitarray_size(sparse) / BITARRAY_SIZE,
+           dense_ms / rounds, sparse_ms / rounds, ok ? "ok" : "MISMATCH");
+
+    sparse_bitarray_free(sparse);
+    free_bitarray(dense);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t rounds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : BENCH_ROUNDS;
+    if (rounds == 0) {
+        printf("Usage: %s [rounds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t *states = malloc_bitarray(BITARRAY_SIZE);
+    uint32_t *work = malloc_bitarray(BITARRAY_SIZE);
+    uint32_t *expected = malloc_bitarray(BITARRAY_SIZE);
+    if (states == NULL || work == NULL || expected == NULL) {
+        printf("Memory allocation error\n");
+        return EXIT_FAILURE;
+    }
+    uint32_t seed = 0x2545F491;
+    for (uint32_t i = 0; i < BITARRAY_WORDS; i++) {
+        states[i] = bench_rand(&seed);
+    }
+
+    printf("dense: %zu bytes per table, average of %u rounds\n", BITARRAY_SIZE, rounds);
+    printf("%-22s %9s  %9s  %6s  %8s  %8s\n", "table", "states", "sparse B", "ratio", "dense ms", "sparse ms");
+    bool ok = true;
+    for (size_t t = 0; t < sizeof(bench_tables) / sizeof(bench_tables[0]); t++) {
+        ok &= bench_table(&bench_tables[t], states, work, expected, rounds, &seed);
+    }
+
+    free_bitarray(expected);
+    free_bitarray(work);
+    free_bitarray(states);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
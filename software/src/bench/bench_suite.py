@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""
+Benchmark suite of the recovery tools, the `bench` build target runs it.
+
+Runs every tool on the fixed vectors of fixtures/suite.json and checks it recovers the known key.
+Reports the wall time, keys/s and peak RSS of each as JSON, to track regressions and compare CPUs.
+
+A fixture is
+    name     what the result is reported under
+    tool     executable in --bin
+    args     its arguments, {threads} is replaced by --threads, {fixtures} by the fixtures directory
+    setup    commands run before the tool and not timed, e.g. the dictionaries a tool reads
+    expect   key (or list of keys) that must be in the output or in a file the tool wrote
+    keys     candidates the tool goes through, for keys/s (optional)
+Each fixture runs in a fresh temporary directory, the tools writing their dictionaries into it.
+
+The peak RSS is measured by bench_launch (built with the bench target) forking the tool. Without
+it the suite waits for the tool itself, and the figure also counts the interpreter pages the tool
+had until its exec: it is then at least the RSS of the suite, reported as rss.floor_kb.
+
+Usage: bench_suite.py [--bin <dir>] [--threads <n>] [--repeat <n>] [--only <name,...>] [--output <file>]
+"""
+import argparse
+import json
+import os
+import platform
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+from typing import List, Optional, Tuple
+
+BENCH_DIR = Path(__file__).resolve().parent
+FIXTURES_DIR = BENCH_DIR / "fixtures"
+DEFAULT_BIN_DIR = BENCH_DIR.parent.parent / "script" / "bin"
+
+
+def cpu_model() -> str:
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or platform.machine()
+
+
+def executable(bin_dir: Path, tool: str) -> str:
+    path = bin_dir / (tool + ".exe" if sys.platform == "win32" else tool)
+    if not path.is_file():
+        raise FileNotFoundError(f"{path} not found, build the tools first")
+    return str(path)
+
+
+def expand(args: List[str], threads: int) -> List[str]:
+    return [a.replace("{threads}", str(threads)).replace("{fixtures}", str(FIXTURES_DIR)) for a in args]
+
+
+def find_launcher(bin_dir: Path) -> Optional[str]:
+    """bench_launch in bin_dir, None when it isn't built"""
+    if sys.platform == "win32":
+        return None
+    try:
+        return executable(bin_dir, "bench_launch")
+    except FileNotFoundError:
+        return None
+
+
+def own_peak_rss_kb() -> Optional[int]:
+    try:
+        import resource
+    except ImportError:
+        return None
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return rss // 1024 if sys.platform == "darwin" else rss
+
+
+def run_timed(cmd: List[str], cwd: str, log, launcher: Optional[str]) -> Tuple[int, float, Optional[int]]:
+    """Run cmd with its output to log, returns its exit code, wall time in s and peak RSS in KB"""
+    start = time.perf_counter()
+    if launcher is not None:
+        fd, rss_path = tempfile.mkstemp(prefix="bench_rss_")
+        os.close(fd)
+        try:
+            code = subprocess.run([launcher, rss_path] + cmd, cwd=cwd, stdout=log, stderr=subprocess.STDOUT,
+                                  stdin=subprocess.DEVNULL).returncode
+            wall = time.perf_counter() - start
+            rss = Path(rss_path).read_text().strip()
+        finally:
+            os.unlink(rss_path)
+        return code, wall, int(rss) if rss else None
+    proc = subprocess.Popen(cmd, cwd=cwd, stdout=log, stderr=subprocess.STDOUT, stdin=subprocess.DEVNULL)
+    if hasattr(os, "wait4"):
+        _, status, usage = os.wait4(proc.pid, 0)
+        wall = time.perf_counter() - start
+        proc.returncode = os.waitstatus_to_exitcode(status)
+        # ru_maxrss is in bytes on macOS and KB elsewhere
+        rss = usage.ru_maxrss // 1024 if sys.platform == "darwin" else usage.ru_maxrss
+        return proc.returncode, wall, rss
+    proc.wait()
+    return proc.returncode, time.perf_counter() - start, None
+
+
+def found_keys(expect: List[str], work_dir: Path) -> bool:
+    """Whether every expected key is in the tool output or in a file it wrote"""
+    missing = {k.lower() for k in expect}
+    for path in work_dir.iterdir():
+        if not path.is_file() or not missing:
+            continue
+        text = path.read_bytes().decode(errors="replace").lower()
+        missing = {k for k in missing if k not in text}
+    return not missing
+
+
+def run_fixture(fixture: dict, bin_dir: Path, threads: int, repeat: int, launcher: Optional[str]) -> dict:
+    expect = fixture["expect"]
+    expect = [expect] if isinstance(expect, str) else expect
+    result = {"name": fixture["name"], "tool": fixture["tool"], "ok": True, "runs": []}
+    for _ in range(repeat):
+        with tempfile.TemporaryDirectory(prefix="bench_") as work:
+            work_dir = Path(work)
+            with open(work_dir / "setup.log", "wb") as log:
+                for setup in fixture.get("setup", []):
+                    cmd = [executable(bin_dir, setup[0])] + expand(setup[1:], threads)
+                    if subprocess.run(cmd, cwd=work, stdout=log, stderr=subprocess.STDOUT).returncode != 0:
+                        raise RuntimeError(f"{fixture['name']}: setup {' '.join(setup)} failed")
+            (work_dir / "setup.log").unlink()
+            cmd = [executable(bin_dir, fixture["tool"])] + expand(fixture["args"], threads)
+            with open(work_dir / "output.log", "wb") as log:
+                code, wall, rss = run_timed(cmd, work, log, launcher)
+            ok = code == 0 and found_keys(expect, work_dir)
+            if not ok:
+                output = (work_dir / "output.log").read_text(errors="replace")
+                print(f"{fixture['name']}: exit code {code}, expected key(s) {', '.join(expect)} not found\n{output}",
+                      file=sys.stderr)
+        result["ok"] &= ok
+        result["runs"].append({"wall_s": round(wall, 4), "peak_rss_kb": rss})
+
+    result["wall_s"] = round(statistics.median(r["wall_s"] for r in result["runs"]), 4)
+    rss = [r["peak_rss_kb"] for r in result["runs"] if r["peak_rss_kb"] is not None]
+    result["peak_rss_kb"] = max(rss) if rss else None
+    result["keys"] = fixture.get("keys")
+    result["keys_per_s"] = round(result["keys"] / result["wall_s"]) if result["keys"] and result["wall_s"] else None
+    return result
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Benchmark the recovery tools on fixed vectors")
+    parser.add_argument("--bin", type=Path, default=DEFAULT_BIN_DIR, help="directory of the tools")
+    parser.add_argument("--threads", type=int, default=os.cpu_count() or 1, help="threads of the tools taking -j")
+    parser.add_argument("--repeat", type=int, default=1, help="runs per fixture, the median wall time is reported")
+    parser.add_argument("--only", help="comma separated fixture names")
+    parser.add_argument("--output", type=Path, help="write the JSON report here instead of stdout")
+    args = parser.parse_args()
+    if args.threads < 1 or args.repeat < 1:
+        parser.error("--threads and --repeat must be at least 1")
+
+    with open(FIXTURES_DIR / "suite.json") as f:
+        fixtures = json.load(f)["fixtures"]
+    if args.only:
+        names = set(args.only.split(","))
+        unknown = names - {f["name"] for f in fixtures}
+        if unknown:
+            parser.error(f"unknown fixture(s): {', '.join(sorted(unknown))}")
+        fixtures = [f for f in fixtures if f["name"] in names]
+
+    launcher = find_launcher(args.bin)
+    results = []
+    for fixture in fixtures:
+        try:
+            result = run_fixture(fixture, args.bin, args.threads, args.repeat, launcher)
+        except (OSError, RuntimeError) as e:
+            print(f"{fixture['name']}: {e}", file=sys.stderr)
+            result = {"name": fixture["name"], "tool": fixture["tool"], "ok": False, "error": str(e)}
+        print(f"{result['name']:32} {'ok' if result['ok'] else 'FAILED':6} {result.get('wall_s', 0):9.3f} s",
+              file=sys.stderr)
+        results.append(result)
+
+    report = {
+        "host": {
+            "platform": platform.platform(),
+            "cpu": cpu_model(),
+            "cpu_count": os.cpu_count(),
+        },
+        "threads": args.threads,
+        "repeat": args.repeat,
+        "rss": {
+            "method": "bench_launch" if launcher else ("wait4" if hasattr(os, "wait4") else None),
+            "floor_kb": None if launcher else own_peak_rss_kb(),
+        },
+        "results": results,
+    }
+    text = json.dumps(report, indent=2)
+    if args.output:
+        args.output.write_text(text + "\n")
+    else:
+        print(text)
+    return 0 if all(r["ok"] for r in results) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
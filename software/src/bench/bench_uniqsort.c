@@ -0,0 +1,108 @@
+// Benchmark for the candidate ranking at the end of nested().
+//
+// Fills a buffer with random 48-bit keys where a few keys repeat, like the
+// candidates of a real nested run, and ranks them with the former
+// qsort + qsort approach and with uniqsort(). Both results must match.
+//
+// Usage: bench_uniqsort [keys] [threads]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "common.h"
+#include "nested_util.h"
+#include "bench_util.h"
+
+#define BENCH_KEYS      (1 << 24)
+#define BENCH_TOP       50
+
+static int compar_key(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compar_count(const void *a, const void *b) {
+    const countKeys *x = (const countKeys *)a, *y = (const countKeys *)b;
+    if (x->count != y->count) {
+        return (x->count < y->count) ? 1 : -1;
+    }
+    return (x->key > y->key) - (x->key < y->key);
+}
+
+// the ranking nested() used before: sort all keys, count, sort all counts
+static uint32_t rank_qsort(uint64_t *keys, uint32_t size, countKeys *top, uint32_t max_keys) {
+    countKeys *counts = calloc(size, sizeof(countKeys));
+    uint32_t n = 0;
+    if (counts == NULL) {
+        return 0;
+    }
+    qsort(keys, size, sizeof(uint64_t), compar_key);
+    for (uint32_t i = 0; i < size; i++) {
+        if (n > 0 && counts[n - 1].key == keys[i]) {
+            counts[n - 1].count++;
+        } else {
+            counts[n].key = keys[i];
+            counts[n].count = 1;
+            n++;
+        }
+    }
+    qsort(counts, n, sizeof(countKeys), compar_count);
+    if (n > max_keys) {
+        n = max_keys;
+    }
+    memcpy(top, counts, n * sizeof(countKeys));
+    free(counts);
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t size = (argc > 1) ? (uint32_t)atoui(argv[1]) : BENCH_KEYS;
+    uint32_t threads = (argc > 2) ? (uint32_t)atoui(argv[2]) : 0;
+    if (size == 0) {
+        printf("Usage: %s [keys] [threads]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t *src = malloc((size_t)size * sizeof(uint64_t));
+    uint64_t *work = malloc((size_t)size * sizeof(uint64_t));
+    if (src == NULL || work == NULL) {
+        printf("Memory allocation error\n");
+        return EXIT_FAILURE;
+    }
+
+    // every 64th key is drawn from a small pool so the top of the ranking is populated
+    uint32_t seed = 0x5eed;
+    for (uint32_t i = 0; i < size; i++) {
+        uint64_t key = ((uint64_t)bench_rand(&seed) << 16) ^ bench_rand(&seed);
+        if ((i & 63) == 0) {
+            key = 0xa0a1a2a30000 | (bench_rand(&seed) & 0x3ff);
+        }
+        src[i] = key & 0xffffffffffff;
+    }
+
+    countKeys ref[BENCH_TOP], top[BENCH_TOP];
+
+    memcpy(work, src, (size_t)size * sizeof(uint64_t));
+    double start = bench_msclock();
+    uint32_t ref_n = rank_qsort(work, size, ref, BENCH_TOP);
+    double qsort_ms = bench_msclock() - start;
+
+    memcpy(work, src, (size_t)size * sizeof(uint64_t));
+    start = bench_msclock();
+    uint32_t top_n = uniqsort(work, size, threads, top, BENCH_TOP);
+    double radix_ms = bench_msclock() - start;
+
+    bool same = (ref_n == top_n);
+    for (uint32_t i = 0; same && i < top_n; i++) {
+        same = (ref[i].key == top[i].key) && (ref[i].count == top[i].count);
+    }
+
+    printf("ranking %u keys, top %u\n", size, BENCH_TOP);
+    printf("   qsort | %8.0f ms\n", qsort_ms);
+    printf("   radix | %8.0f ms | %6.2fx | %s\n", radix_ms, qsort_ms / radix_ms, same ? "same result" : "MISMATCH");
+
+    free(src);
+    free(work);
+    return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
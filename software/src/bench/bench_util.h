@@ -0,0 +1,38 @@
+#ifndef BENCH_UTIL_H__
+#define BENCH_UTIL_H__
+
+#include <stdint.h>
+
+#if WIN32
+#include "windows.h"
+#else
+#include <time.h>
+#endif
+
+// monotonic milliseconds clock for the benchmarks
+static inline double bench_msclock(void) {
+#if WIN32
+    static LARGE_INTEGER frequency = {0};
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+#endif
+}
+
+// small deterministic PRNG so every run works on the same vectors
+static inline uint32_t bench_rand(uint32_t *seed) {
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *seed = x;
+}
+
+#endif
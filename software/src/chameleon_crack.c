@@ -0,0 +1,386 @@
+// C API of the chameleon_crack shared library, see chameleon_crack.h
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "chameleon_crack.h"
+#include "cmdhfmfhard.h"
+#include "key_hint.h"
+#include "mfkey.h"
+#include "nested_util.h"
+#include "staticnested_util.h"
+#include "thread_pool.h"
+
+// keys per thread pool item when filtering rf08s dictionaries, and between two cancel checks
+#define SEED_CHUNK 4096
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+static pthread_once_t rf08s_once = PTHREAD_ONCE_INIT;
+// hardnested keeps its tables, journal and settings in globals, one attack at a time
+static pthread_mutex_t hardnested_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool cancelled(volatile int *cancel) {
+    return cancel != NULL && *cancel;
+}
+
+// keys of the last call of a thread that didn't fit the caller's buffer, for crack_take_keys()
+static THREAD_LOCAL uint64_t *kept_keys = NULL;
+static THREAD_LOCAL uint32_t kept_count = 0;
+
+static void drop_kept_keys(void) {
+    free(kept_keys);
+    kept_keys = NULL;
+    kept_count = 0;
+}
+
+// found is taken over when it doesn't fit, else the caller still frees it
+static int copy_keys(uint64_t **found, uint32_t count, uint64_t *keys, uint32_t max_keys, uint32_t *key_count) {
+    *key_count = count;
+    if (count == 0) {
+        return CRACK_NOT_FOUND;
+    }
+    if (keys != NULL) {
+        memcpy(keys, *found, (count < max_keys ? count : max_keys) * sizeof(uint64_t));
+    }
+    if (count <= max_keys) {
+        return CRACK_OK;
+    }
+    kept_keys = *found;
+    kept_count = count;
+    *found = NULL;
+    return CRACK_BUFFER_TOO_SMALL;
+}
+
+int crack_api_version(void) {
+    return CRACK_API_VERSION;
+}
+
+int crack_take_keys(uint64_t *keys, uint32_t max_keys, uint32_t *key_count) {
+    if (key_count == NULL) {
+        return CRACK_ERROR_ARGS;
+    }
+    *key_count = kept_count;
+    if (kept_count == 0) {
+        return CRACK_NOT_FOUND;
+    }
+    if (keys != NULL) {
+        memcpy(keys, kept_keys, (kept_count < max_keys ? kept_count : max_keys) * sizeof(uint64_t));
+    }
+    if (kept_count > max_keys) {
+        return CRACK_BUFFER_TOO_SMALL;
+    }
+    drop_kept_keys();
+    return CRACK_OK;
+}
+
+static int crack_nested_entries(NtpKs1 *pNK, uint32_t size, uint32_t uid, uint32_t threads,
+                                uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel) {
+    uint32_t count = 0;
+    uint64_t *found = nested(pNK, size, uid, threads, &count, cancel, NULL, NULL);
+    int ret;
+
+    if (cancelled(cancel)) {
+        ret = CRACK_CANCELLED;
+    } else if (found == NULL && count > 0) {
+        ret = CRACK_ERROR_MEMORY;
+    } else {
+        ret = copy_keys(&found, count, keys, max_keys, key_count);
+    }
+    free(found);
+    return ret;
+}
+
+int crack_nested(uint32_t uid, uint32_t dist, const uint32_t *nonces, uint32_t count, uint32_t threads,
+                 uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel) {
+    NtpKs1 *pNK = NULL;
+    uint32_t size = 0;
+
+    if (key_count == NULL || (nonces == NULL && count > 0)) {
+        return CRACK_ERROR_ARGS;
+    }
+    *key_count = 0;
+    drop_kept_keys();
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t *n = nonces + 3 * i;
+        if (!nested_add_nonce(&pNK, &size, n[0], n[1], (uint8_t)n[2], dist)) {
+            free(pNK);
+            return CRACK_ERROR_MEMORY;
+        }
+    }
+    int ret = crack_nested_entries(pNK, size, uid, threads, keys, max_keys, key_count, cancel);
+    free(pNK);
+    return ret;
+}
+
+int crack_staticnested(uint32_t uid, uint8_t type, const uint32_t *nonces, uint32_t count, uint32_t threads,
+                       uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel) {
+    NtpKs1 *pNK = NULL;
+    uint32_t size = 0, dist = 0;
+
+    if (key_count == NULL || (nonces == NULL && count > 0)) {
+        return CRACK_ERROR_ARGS;
+    }
+    *key_count = 0;
+    drop_kept_keys();
+    if (count > 0 && !staticnested_dist(nonces[0], type, &dist)) {
+        return CRACK_ERROR_ARGS;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!staticnested_add_nonce(&pNK, &size, nonces[2 * i], nonces[2 * i + 1], dist + 160 * size)) {
+            free(pNK);
+            return CRACK_ERROR_MEMORY;
+        }
+    }
+    int ret = crack_nested_entries(pNK, size, uid, threads, keys, max_keys, key_count, cancel);
+    free(pNK);
+    return ret;
+}
+
+int crack_darkside(uint32_t uid, const uint64_t *nonces, uint32_t count, uint32_t threads,
+                   uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel) {
+    if (key_count == NULL || nonces == NULL || count == 0) {
+        return CRACK_ERROR_ARGS;
+    }
+    *key_count = 0;
+    drop_kept_keys();
+
+    DarksideParam *dps = (DarksideParam *)calloc(count, sizeof(DarksideParam));
+    if (dps == NULL) {
+        return CRACK_ERROR_MEMORY;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const uint64_t *n = nonces + 5 * i;
+        dps[i].nt = (uint32_t)n[0];
+        dps[i].ks_list = n[1];
+        dps[i].par_list = n[2];
+        dps[i].nr = (uint32_t)n[3];
+        dps[i].ar = (uint32_t)n[4];
+    }
+
+    uint32_t total = darkside_recover(uid, dps, count, threads, cancel);
+    int ret = CRACK_ERROR_MEMORY;
+
+    // the keys of every param in order, like the darkside tool prints them
+    uint64_t *found = (uint64_t *)malloc((total ? total : 1) * sizeof(uint64_t));
+    if (found != NULL) {
+        for (uint32_t i = 0, n = 0; i < count; i++) {
+            if (dps[i].keycount > 0) {
+                memcpy(found + n, dps[i].keylist, dps[i].keycount * sizeof(uint64_t));
+                n += dps[i].keycount;
+            }
+        }
+        if (cancelled(cancel)) {
+            ret = CRACK_CANCELLED;
+        } else {
+            ret = copy_keys(&found, total, keys, max_keys, key_count);
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        free(dps[i].keylist);
+    }
+    free(dps);
+    free(found);
+    return ret;
+}
+
+int crack_mfkey32(uint32_t uid, uint32_t nt, uint32_t nr0_enc, uint32_t ar0_enc,
+                  uint32_t nr1_enc, uint32_t ar1_enc, uint32_t threads, uint64_t *key, volatile int *cancel) {
+    return crack_mfkey32v2(uid, nt, nr0_enc, ar0_enc, nt, nr1_enc, ar1_enc, threads, key, cancel);
+}
+
+int crack_mfkey32v2(uint32_t uid, uint32_t nt0, uint32_t nr0_enc, uint32_t ar0_enc,
+                    uint32_t nt1, uint32_t nr1_enc, uint32_t ar1_enc, uint32_t threads, uint64_t *key,
+                    volatile int *cancel) {
+    if (key == NULL) {
+        return CRACK_ERROR_ARGS;
+    }
+    bool found = mfkey32_recover(uid, nt0, nr0_enc, ar0_enc, nt1, nr1_enc, ar1_enc, threads, key, cancel);
+    if (cancelled(cancel)) {
+        return CRACK_CANCELLED;
+    }
+    return found ? CRACK_OK : CRACK_NOT_FOUND;
+}
+
+int crack_mfkey64(uint32_t uid, uint32_t nt, uint32_t nr_enc, uint32_t ar_enc, uint32_t at_enc, uint64_t *key) {
+    if (key == NULL) {
+        return CRACK_ERROR_ARGS;
+    }
+    return mfkey64_recover(uid, nt, nr_enc, ar_enc, at_enc, key) ? CRACK_OK : CRACK_ERROR_MEMORY;
+}
+
+int crack_staticnested_1nt(uint32_t uid, uint32_t nt, uint32_t nt_enc, uint8_t nt_par_err, uint32_t threads,
+                           uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel) {
+    if (key_count == NULL) {
+        return CRACK_ERROR_ARGS;
+    }
+    *key_count = 0;
+    drop_kept_keys();
+
+    uint32_t count = 0;
+    uint64_t *found = staticnested_1nt_keys(uid, nt, nt_enc, staticnested_par_enc(nt_enc, nt_par_err), NULL, threads, &count, cancel);
+    int ret;
+    if (cancelled(cancel)) {
+        ret = CRACK_CANCELLED;
+    } else if (found == NULL) {
+        ret = CRACK_ERROR_MEMORY;
+    } else {
+        ret = copy_keys(&found, count, keys, max_keys, key_count);
+    }
+    free(found);
+    return ret;
+}
+
+typedef struct {
+    uint32_t nt;
+    const uint64_t *keys;
+    uint32_t count;
+    uint16_t *seeds;
+} SeedJob;
+
+static void compute_seeds(void *ctx, uint32_t item, uint32_t thread_id) {
+    (void)thread_id;
+    SeedJob *job = (SeedJob *)ctx;
+    uint32_t end = (item + 1) * SEED_CHUNK;
+    if (end > job->count) {
+        end = job->count;
+    }
+    for (uint32_t i = item * SEED_CHUNK; i < end; i++) {
+        job->seeds[i] = rf08s_seed(job->nt, job->keys[i]);
+    }
+}
+
+int crack_rf08s_filter(uint32_t nt1, const uint64_t *keys1, uint32_t count1,
+                       uint32_t nt2, const uint64_t *keys2, uint32_t count2,
+                       uint8_t *keep1, uint8_t *keep2, uint32_t threads, volatile int *cancel) {
+    if ((keys1 == NULL && count1 > 0) || (keys2 == NULL && count2 > 0) ||
+            (keep1 == NULL && count1 > 0) || (keep2 == NULL && count2 > 0) || nt1 == nt2) {
+        return CRACK_ERROR_ARGS;
+    }
+    pthread_once(&rf08s_once, rf08s_init);
+
+    uint16_t *seeds1 = (uint16_t *)calloc(count1 + 1, sizeof(uint16_t));
+    uint16_t *seeds2 = (uint16_t *)calloc(count2 + 1, sizeof(uint16_t));
+    uint8_t *seen1 = (uint8_t *)calloc(1 << 16, sizeof(uint8_t));
+    uint8_t *seen2 = (uint8_t *)calloc(1 << 16, sizeof(uint8_t));
+    int ret = CRACK_ERROR_MEMORY;
+    if ((seeds1 == NULL) || (seeds2 == NULL) || (seen1 == NULL) || (seen2 == NULL)) {
+        goto end;
+    }
+
+    SeedJob job1 = { .nt = nt1, .keys = keys1, .count = count1, .seeds = seeds1 };
+    thread_pool_run_cancel((count1 + SEED_CHUNK - 1) / SEED_CHUNK, threads, compute_seeds, &job1, cancel);
+    SeedJob job2 = { .nt = nt2, .keys = keys2, .count = count2, .seeds = seeds2 };
+    thread_pool_run_cancel((count2 + SEED_CHUNK - 1) / SEED_CHUNK, threads, compute_seeds, &job2, cancel);
+    if (cancelled(cancel)) {
+        ret = CRACK_CANCELLED;
+        goto end;
+    }
+
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count1; i++) {
+        seen1[seeds1[i]] = 1;
+    }
+    for (uint32_t j = 0; j < count2; j++) {
+        seen2[seeds2[j]] = 1;
+    }
+    for (uint32_t i = 0; i < count1; i++) {
+        keep1[i] = seen2[seeds1[i]];
+        kept += keep1[i];
+    }
+    for (uint32_t j = 0; j < count2; j++) {
+        keep2[j] = seen1[seeds2[j]];
+    }
+    ret = (kept == 0) ? CRACK_NOT_FOUND : CRACK_OK;
+
+end:
+    free(seeds1);
+    free(seeds2);
+    free(seen1);
+    free(seen2);
+    return ret;
+}
+
+int crack_rf08s_1key(uint32_t nt1, uint64_t key1, uint32_t nt2, const uint64_t *keys2, uint32_t count2,
+                     uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel) {
+    if (key_count == NULL || (keys2 == NULL && count2 > 0) || nt1 == nt2) {
+        return CRACK_ERROR_ARGS;
+    }
+    *key_count = 0;
+    drop_kept_keys();
+    pthread_once(&rf08s_once, rf08s_init);
+
+    uint64_t *found = (uint64_t *)malloc((count2 ? count2 : 1) * sizeof(uint64_t));
+    if (found == NULL) {
+        return CRACK_ERROR_MEMORY;
+    }
+    uint32_t n = 0;
+    uint16_t seednt1 = rf08s_seed(nt1, key1);
+    for (uint32_t i = 0; i < count2; i++) {
+        if (i % SEED_CHUNK == 0 && cancelled(cancel)) {
+            free(found);
+            return CRACK_CANCELLED;
+        }
+        if (seednt1 == rf08s_seed(nt2, keys2[i])) {
+            found[n++] = keys2[i];
+        }
+    }
+    int ret = copy_keys(&found, n, keys, max_keys, key_count);
+    free(found);
+    return ret;
+}
+
+int crack_hardnested(uint32_t uid, const uint32_t *nonces, uint32_t count, const char *cache_dir,
+                     const char *key_hint, const char *journal, uint32_t flags, uint64_t *key,
+                     volatile int *cancel) {
+    if (key == NULL || (nonces == NULL && count > 0)) {
+        return CRACK_ERROR_ARGS;
+    }
+    key_hint_t hint = KEY_HINT_INIT;
+    if (key_hint != NULL && !key_hint_parse(&hint, key_hint)) {
+        key_hint_free(&hint);
+        return CRACK_ERROR_ARGS;
+    }
+
+    hardnested_nonce_t *list = (hardnested_nonce_t *)malloc((count ? count : 1) * sizeof(hardnested_nonce_t));
+    hardnested_job_t *job = hardnested_job_new();
+    if (list == NULL || job == NULL) {
+        free(list);
+        hardnested_job_free(job);
+        key_hint_free(&hint);
+        return CRACK_ERROR_MEMORY;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        list[i].nt_enc = nonces[2 * i];
+        list[i].par_enc = nonces[2 * i + 1] & 0x0F;
+    }
+    hardnested_job_set_cancel(job, cancel);
+
+    int res = 0;
+    pthread_mutex_lock(&hardnested_mutex);
+    if (!cancelled(cancel)) {
+        hardnested_set_cache_dir(cache_dir);
+        hardnested_set_rebenchmark((flags & CRACK_HARDNESTED_REBENCHMARK) != 0);
+        hardnested_set_low_memory((flags & CRACK_HARDNESTED_LOW_MEMORY) != 0);
+        hardnested_set_journal(journal, (flags & CRACK_HARDNESTED_RESUME) != 0);
+        hardnested_set_key_hint(&hint);
+        res = mfnestedhard_list(job, uid, list, count, NULL, key);
+        hardnested_set_key_hint(NULL);
+        hardnested_set_journal(NULL, false);
+        hardnested_set_cache_dir(NULL);
+    }
+    pthread_mutex_unlock(&hardnested_mutex);
+
+    free(list);
+    hardnested_job_free(job);
+    key_hint_free(&hint);
+    if (res == 1) {
+        return CRACK_OK;
+    }
+    return cancelled(cancel) ? CRACK_CANCELLED : CRACK_NOT_FOUND;
+}
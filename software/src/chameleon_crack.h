@@ -0,0 +1,104 @@
+#ifndef CHAMELEON_CRACK_H__
+#define CHAMELEON_CRACK_H__
+
+#include <stdint.h>
+
+// Key recovery cores of the nested, staticnested, staticnested_1nt, staticnested_2x1nt_rf08s(_1key),
+// darkside, mfkey32/32v2/64 and hardnested tools as the chameleon_crack shared library, for the CLI
+// to call in process instead of spawning a tool and parsing its output.
+//
+// Keys are 48-bit values in uint64_t. Every call writes into caller provided buffers: when
+// max_keys is too small the first max_keys keys are written, *key_count tells how many there
+// are and CRACK_BUFFER_TOO_SMALL is returned. All the keys are then kept for crack_take_keys()
+// on the same thread, so the recovery doesn't have to run again with a larger buffer.
+// threads == 0 uses one thread per online CPU.
+// Every call but crack_mfkey64() takes a cancel flag: once *cancel is non zero, no new work is
+// started and CRACK_CANCELLED is returned. cancel may be NULL. Calls may run concurrently from
+// several threads.
+//
+// The API is stable within a CRACK_API_VERSION: arguments are only added by a new version.
+
+#define CRACK_API_VERSION       3
+
+#define CRACK_OK                0
+#define CRACK_NOT_FOUND         1   // ran fine, no key
+#define CRACK_BUFFER_TOO_SMALL  2
+#define CRACK_CANCELLED         3
+#define CRACK_ERROR_ARGS        (-1)
+#define CRACK_ERROR_MEMORY      (-2)
+
+// most keys crack_nested() and crack_staticnested() return
+#define CRACK_NESTED_MAX_KEYS   50
+
+// crack_hardnested() flags
+#define CRACK_HARDNESTED_REBENCHMARK    0x01    // measure the brute force speed again
+#define CRACK_HARDNESTED_LOW_MEMORY     0x02    // keep the bitflip tables compressed, no tables cache
+#define CRACK_HARDNESTED_RESUME         0x04    // skip what the journal has as tested on the same nonces
+
+#if defined(_WIN32)
+#define CRACK_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#define CRACK_API __attribute__((visibility("default")))
+#else
+#define CRACK_API
+#endif
+
+CRACK_API int crack_api_version(void);
+
+// The keys of the last call of this thread that returned CRACK_BUFFER_TOO_SMALL, same return
+// values. They stay kept while max_keys is still too small, until the next call of the thread
+// returning keys otherwise. CRACK_NOT_FOUND when none are kept.
+CRACK_API int crack_take_keys(uint64_t *keys, uint32_t max_keys, uint32_t *key_count);
+
+// nested: nonces holds count {nt, nt_enc, par} triples as given to the nested tool.
+// The keys are the candidates found at least twice, most frequent first, at most CRACK_NESTED_MAX_KEYS.
+CRACK_API int crack_nested(uint32_t uid, uint32_t dist, const uint32_t *nonces, uint32_t count, uint32_t threads,
+                           uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel);
+
+// staticnested: nonces holds count {nt, nt_enc} pairs, type is 0x60 or 0x61.
+CRACK_API int crack_staticnested(uint32_t uid, uint8_t type, const uint32_t *nonces, uint32_t count, uint32_t threads,
+                                 uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel);
+
+// darkside: nonces holds count {nt, ks_list, par_list, nr, ar} entries as given to the darkside tool.
+CRACK_API int crack_darkside(uint32_t uid, const uint64_t *nonces, uint32_t count, uint32_t threads,
+                             uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel);
+
+// mfkey32: two reader authentications on the same nt.
+CRACK_API int crack_mfkey32(uint32_t uid, uint32_t nt, uint32_t nr0_enc, uint32_t ar0_enc,
+                            uint32_t nr1_enc, uint32_t ar1_enc, uint32_t threads, uint64_t *key, volatile int *cancel);
+
+// mfkey32v2: two reader authentications on different nonces.
+CRACK_API int crack_mfkey32v2(uint32_t uid, uint32_t nt0, uint32_t nr0_enc, uint32_t ar0_enc,
+                              uint32_t nt1, uint32_t nr1_enc, uint32_t ar1_enc, uint32_t threads, uint64_t *key,
+                              volatile int *cancel);
+
+// mfkey64: one complete authentication.
+CRACK_API int crack_mfkey64(uint32_t uid, uint32_t nt, uint32_t nr_enc, uint32_t ar_enc, uint32_t at_enc, uint64_t *key);
+
+// staticnested_1nt: key candidates of one static encrypted nonce, at most STATICNESTED_KEY_SPACE_SIZE
+// (1 << 18). nt_par_err holds the 4 parity error bits of the trace, first byte MSB.
+CRACK_API int crack_staticnested_1nt(uint32_t uid, uint32_t nt, uint32_t nt_enc, uint8_t nt_par_err, uint32_t threads,
+                                     uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel);
+
+// staticnested_2x1nt_rf08s: flags in keep1/keep2 (count1/count2 bytes) the candidates of the keyA
+// and keyB dictionaries of a sector that have a partner on the other side.
+CRACK_API int crack_rf08s_filter(uint32_t nt1, const uint64_t *keys1, uint32_t count1,
+                                 uint32_t nt2, const uint64_t *keys2, uint32_t count2,
+                                 uint8_t *keep1, uint8_t *keep2, uint32_t threads, volatile int *cancel);
+
+// staticnested_2x1nt_rf08s_1key: the candidates of keys2 (nonce nt2) matching key1 found on nt1.
+CRACK_API int crack_rf08s_1key(uint32_t nt1, uint64_t key1, uint32_t nt2, const uint64_t *keys2, uint32_t count2,
+                               uint64_t *keys, uint32_t max_keys, uint32_t *key_count, volatile int *cancel);
+
+// hardnested: nonces holds count {nt_enc, par_enc} pairs in acquisition order, par_enc the 4
+// encrypted parity bits of nt_enc (first byte MSB). They are taken until the key space is small
+// enough, too few or broken nonces give CRACK_NOT_FOUND. cache_dir keeps the expanded tables,
+// key_hint is a hardnested --key-hint spec and journal records the brute force progress, each
+// NULL for none. The progress goes to stdout like the tool's.
+// The expanded tables, the journal and the progress output are shared by all hardnested attacks
+// of the process: concurrent calls run one after the other. The tables are freed after each call.
+CRACK_API int crack_hardnested(uint32_t uid, const uint32_t *nonces, uint32_t count, const char *cache_dir,
+                               const char *key_hint, const char *journal, uint32_t flags, uint64_t *key,
+                               volatile int *cancel);
+
+#endif
@@ -18,10 +18,12 @@
     Copyright (C) 2008-2014 bla <blapost@gmail.com>
 */
 #include <stdlib.h>
+#include <string.h>
 #include "parity.h"
 
 #include "crapto1.h"
 #include "bucketsort.h"
+#include "thread_pool.h"
 
 #if !defined LOWMEM && defined __GNUC__
 static uint8_t filterlut[1 << 20];
@@ -79,6 +81,25 @@ static inline void extend_table_simple(uint32_t *tbl, uint32_t **end, int bit) {
         }
     }
 }
+/** recover_extend
+ * extend both tables by up to 4 bits of keystream, false once a table runs empty
+ */
+static inline bool recover_extend(uint32_t *o_head, uint32_t **o_tail, uint32_t *oks,
+                                  uint32_t *e_head, uint32_t **e_tail, uint32_t *eks, int *rem, uint32_t *in) {
+    for (uint32_t i = 0; i < 4 && (*rem)--; i++) {
+        *oks >>= 1;
+        *eks >>= 1;
+        *in >>= 2;
+        extend_table(o_head, o_tail, *oks & 1, LF_POLY_EVEN << 1 | 1, LF_POLY_ODD << 1, 0);
+        if (o_head > *o_tail)
+            return false;
+
+        extend_table(e_head, e_tail, *eks & 1, LF_POLY_ODD, LF_POLY_EVEN << 1 | 1, *in & 3);
+        if (e_head > *e_tail)
+            return false;
+    }
+    return true;
+}
 /** recover
  * recursively narrow down the search space, 4 bits of keystream at a time
  */
@@ -100,18 +121,8 @@ recover(uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
         return sl;
     }
 
-    for (uint32_t i = 0; i < 4 && rem--; i++) {
-        oks >>= 1;
-        eks >>= 1;
-        in >>= 2;
-        extend_table(o_head, &o_tail, oks & 1, LF_POLY_EVEN << 1 | 1, LF_POLY_ODD << 1, 0);
-        if (o_head > o_tail)
-            return sl;
-
-        extend_table(e_head, &e_tail, eks & 1, LF_POLY_ODD, LF_POLY_EVEN << 1 | 1, in & 3);
-        if (e_head > e_tail)
-            return sl;
-    }
+    if (!recover_extend(o_head, &o_tail, &oks, e_head, &e_tail, &eks, &rem, &in))
+        return sl;
 
     bucket_sort_intersect(e_head, e_tail, o_head, o_tail, &bucket_info, bucket);
 
@@ -126,6 +137,59 @@ recover(uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
 
 
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
+/** lfsr_recovery32_prepare
+ * fill odd_head/even_head with all states matching the last 10 bits of the keystream
+ */
+static void lfsr_recovery32_prepare(uint32_t ks2, uint32_t *odd_head, uint32_t **odd_tail, uint32_t *oks,
+                                    uint32_t *even_head, uint32_t **even_tail, uint32_t *eks) {
+    int i;
+
+    *odd_tail = odd_head - 1;
+    *even_tail = even_head - 1;
+    *oks = *eks = 0;
+
+    // split the keystream into an odd and even part
+    for (i = 31; i >= 0; i -= 2)
+        *oks = *oks << 1 | BEBIT(ks2, i);
+    for (i = 30; i >= 0; i -= 2)
+        *eks = *eks << 1 | BEBIT(ks2, i);
+
+    // initialize statelists: add all possible states which would result into the rightmost 2 bits of the keystream
+    for (i = 1 << 20; i >= 0; --i) {
+        if (filter(i) == (*oks & 1))
+            *++*odd_tail = i;
+        if (filter(i) == (*eks & 1))
+            *++*even_tail = i;
+    }
+
+    // extend the statelists. Look at the next 8 Bits of the keystream (4 Bit each odd and even):
+    for (i = 0; i < 4; i++) {
+        extend_table_simple(odd_head,  odd_tail, (*oks >>= 1) & 1);
+        extend_table_simple(even_head, even_tail, (*eks >>= 1) & 1);
+    }
+}
+
+/** lfsr_recovery32_tables
+ * core of lfsr_recovery32, working on caller provided tables:
+ * odd_head/even_head hold 1 << 21 entries, statelist 1 << 18 states
+ * and every bucket 1 << 14 entries.
+ */
+static void lfsr_recovery32_tables(uint32_t ks2, uint32_t in, uint32_t *odd_head, uint32_t *even_head,
+                                   struct Crypto1State *statelist, bucket_array_t bucket) {
+    uint32_t *odd_tail, oks;
+    uint32_t *even_tail, eks;
+
+    statelist->odd = statelist->even = 0;
+
+    lfsr_recovery32_prepare(ks2, odd_head, &odd_tail, &oks, even_head, &even_tail, &eks);
+
+    // the statelists now contain all states which could have generated the last 10 Bits of the keystream.
+    // 22 bits to go to recover 32 bits in total. From now on, we need to take the "in"
+    // parameter into account.
+    in = (in >> 16 & 0xff) | (in << 16) | (in & 0xff00); // Byte swapping
+    recover(odd_head, odd_tail, oks, even_head, even_tail, eks, 11, statelist, in << 1, bucket);
+}
+
 /** lfsr_recovery
  * recover the state of the lfsr given 32 bits of the keystream
  * additionally you can use the in parameter to specify the value
@@ -133,58 +197,31 @@ recover(uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
  */
 struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
     struct Crypto1State *statelist;
-    uint32_t *odd_head = 0, *odd_tail = 0, oks = 0;
-    uint32_t *even_head = 0, *even_tail = 0, eks = 0;
+    uint32_t *odd_head, *even_head;
+    bucket_array_t bucket = {{{0}}};
     int i;
 
-    // split the keystream into an odd and even part
-    for (i = 31; i >= 0; i -= 2)
-        oks = oks << 1 | BEBIT(ks2, i);
-    for (i = 30; i >= 0; i -= 2)
-        eks = eks << 1 | BEBIT(ks2, i);
-
-    odd_head = odd_tail = malloc(sizeof(uint32_t) << 21);
-    even_head = even_tail = malloc(sizeof(uint32_t) << 21);
+    odd_head = malloc(sizeof(uint32_t) << 21);
+    even_head = malloc(sizeof(uint32_t) << 21);
     statelist =  malloc(sizeof(struct Crypto1State) << 18);
-    if (!odd_tail-- || !even_tail-- || !statelist) {
+    if (!odd_head || !even_head || !statelist) {
         free(statelist);
         statelist = 0;
         goto out;
     }
 
-    statelist->odd = statelist->even = 0;
-
     // allocate memory for out of place bucket_sort
-    bucket_array_t bucket;
-
     for (i = 0; i < 2; i++) {
         for (uint32_t j = 0; j <= 0xff; j++) {
             bucket[i][j].head = malloc(sizeof(uint32_t) << 14);
             if (!bucket[i][j].head) {
+                statelist->odd = statelist->even = 0;
                 goto out;
             }
         }
     }
 
-    // initialize statelists: add all possible states which would result into the rightmost 2 bits of the keystream
-    for (i = 1 << 20; i >= 0; --i) {
-        if (filter(i) == (oks & 1))
-            *++odd_tail = i;
-        if (filter(i) == (eks & 1))
-            *++even_tail = i;
-    }
-
-    // extend the statelists. Look at the next 8 Bits of the keystream (4 Bit each odd and even):
-    for (i = 0; i < 4; i++) {
-        extend_table_simple(odd_head,  &odd_tail, (oks >>= 1) & 1);
-        extend_table_simple(even_head, &even_tail, (eks >>= 1) & 1);
-    }
-
-    // the statelists now contain all states which could have generated the last 10 Bits of the keystream.
-    // 22 bits to go to recover 32 bits in total. From now on, we need to take the "in"
-    // parameter into account.
-    in = (in >> 16 & 0xff) | (in << 16) | (in & 0xff00); // Byte swapping
-    recover(odd_head, odd_tail, oks, even_head, even_tail, eks, 11, statelist, in << 1, bucket);
+    lfsr_recovery32_tables(ks2, in, odd_head, even_head, statelist, bucket);
 
 out:
     for (i = 0; i < 2; i++)
@@ -195,6 +232,175 @@ out:
     return statelist;
 }
 
+struct Crypto1Workspace {
+    uint32_t *odd;
+    uint32_t *even;
+    struct Crypto1State *statelist;
+    bucket_array_t bucket;
+};
+
+/** crypto1_workspace_create
+ * allocate all tables used by lfsr_recovery32 once, so repeated recoveries
+ * on the same thread can reuse them instead of allocating ~50MB every call
+ */
+struct Crypto1Workspace *crypto1_workspace_create(void) {
+    struct Crypto1Workspace *ws = calloc(1, sizeof(struct Crypto1Workspace));
+    if (!ws)
+        return 0;
+
+    ws->odd = malloc(sizeof(uint32_t) << 21);
+    ws->even = malloc(sizeof(uint32_t) << 21);
+    ws->statelist = malloc(sizeof(struct Crypto1State) << 18);
+    if (!ws->odd || !ws->even || !ws->statelist)
+        goto fail;
+
+    for (int i = 0; i < 2; i++) {
+        for (uint32_t j = 0; j <= 0xff; j++) {
+            ws->bucket[i][j].head = malloc(sizeof(uint32_t) << 14);
+            if (!ws->bucket[i][j].head)
+                goto fail;
+        }
+    }
+    return ws;
+
+fail:
+    crypto1_workspace_destroy(ws);
+    return 0;
+}
+
+void crypto1_workspace_destroy(struct Crypto1Workspace *ws) {
+    if (!ws)
+        return;
+    for (int i = 0; i < 2; i++)
+        for (uint32_t j = 0; j <= 0xff; j++)
+            free(ws->bucket[i][j].head);
+    free(ws->odd);
+    free(ws->even);
+    free(ws->statelist);
+    free(ws);
+}
+
+/** lfsr_recovery32_ws
+ * same as lfsr_recovery32, but all tables live in the workspace.
+ * The returned zero terminated statelist belongs to the workspace and
+ * stays valid until the next recovery with it, don't free it.
+ */
+struct Crypto1State *lfsr_recovery32_ws(struct Crypto1Workspace *ws, uint32_t ks2, uint32_t in) {
+    if (!ws)
+        return 0;
+    lfsr_recovery32_tables(ks2, in, ws->odd, ws->even, ws->statelist, ws->bucket);
+    return ws->statelist;
+}
+
+typedef struct {
+    bucket_info_t info;                 // top level buckets, shared read only
+    uint32_t oks, eks, in;
+    int rem;
+    struct Crypto1Workspace **ws;       // one per thread, created on its first branch
+    uint32_t *fill;                     // states already in the statelist of each thread
+    struct {
+        uint32_t thread;
+        uint32_t start;
+        uint32_t count;
+    } *branch;
+    volatile bool failed;
+} RecoverJob;
+
+static void recover_branch(void *ctx, uint32_t item, uint32_t thread_id) {
+    RecoverJob *job = (RecoverJob *)ctx;
+    struct Crypto1Workspace *ws = job->ws[thread_id];
+
+    if (ws == NULL) {
+        ws = job->ws[thread_id] = crypto1_workspace_create();
+        if (ws == NULL) {
+            job->failed = true;
+            return;
+        }
+    }
+
+    // the serial recursion lets a branch grow into its already processed neighbours,
+    // here every branch gets a private copy of its two sublists instead
+    size_t olen = job->info.bucket_info[1][item].tail - job->info.bucket_info[1][item].head + 1;
+    size_t elen = job->info.bucket_info[0][item].tail - job->info.bucket_info[0][item].head + 1;
+    memcpy(ws->odd, job->info.bucket_info[1][item].head, olen * sizeof(uint32_t));
+    memcpy(ws->even, job->info.bucket_info[0][item].head, elen * sizeof(uint32_t));
+
+    struct Crypto1State *sl = ws->statelist + job->fill[thread_id];
+    struct Crypto1State *end = recover(ws->odd, ws->odd + olen - 1, job->oks, ws->even, ws->even + elen - 1, job->eks,
+                                       job->rem, sl, job->in, ws->bucket);
+
+    job->branch[item].thread = thread_id;
+    job->branch[item].start = job->fill[thread_id];
+    job->branch[item].count = end - sl;
+    job->fill[thread_id] += end - sl;
+}
+
+/** lfsr_recovery32_mt
+ * same as lfsr_recovery32, but the top level buckets are recovered on
+ * threads (0 = one per online CPU). Each thread needs a workspace of its
+ * own (~50MB). The statelist holds the same states in the same order as
+ * the one of lfsr_recovery32. No branch is started anymore once *cancel is
+ * non zero (cancel may be NULL), 0 is returned then.
+ */
+struct Crypto1State *lfsr_recovery32_mt(uint32_t ks2, uint32_t in, uint32_t threads, volatile int *cancel) {
+    if (threads == 0)
+        threads = thread_pool_cpus();
+    if (threads == 1)
+        return lfsr_recovery32(ks2, in);
+
+    struct Crypto1State *statelist = malloc(sizeof(struct Crypto1State) << 18);
+    struct Crypto1Workspace *top = crypto1_workspace_create();
+    RecoverJob job = {
+        .ws = calloc(threads, sizeof(struct Crypto1Workspace *)),
+        .fill = calloc(threads, sizeof(uint32_t)),
+        .branch = calloc(0x100, sizeof(*job.branch)),
+    };
+    if (!statelist || !top || !job.ws || !job.fill || !job.branch) {
+        free(statelist);
+        statelist = 0;
+        goto out;
+    }
+
+    statelist->odd = statelist->even = 0;
+
+    uint32_t *odd_tail, *even_tail;
+    lfsr_recovery32_prepare(ks2, top->odd, &odd_tail, &job.oks, top->even, &even_tail, &job.eks);
+
+    // first level of recover() on this thread, its buckets are the branches
+    in = (in >> 16 & 0xff) | (in << 16) | (in & 0xff00); // Byte swapping
+    job.in = in << 1;
+    job.rem = 11;
+    if (!recover_extend(top->odd, &odd_tail, &job.oks, top->even, &even_tail, &job.eks, &job.rem, &job.in))
+        goto out;
+    bucket_sort_intersect(top->even, even_tail, top->odd, odd_tail, &job.info, top->bucket);
+
+    thread_pool_run_cancel(job.info.numbuckets, threads, recover_branch, &job, cancel);
+    if (job.failed || (cancel != NULL && *cancel)) {
+        free(statelist);
+        statelist = 0;
+        goto out;
+    }
+
+    // merge in the order of the serial recursion
+    struct Crypto1State *sl = statelist;
+    for (int i = job.info.numbuckets - 1; i >= 0; i--) {
+        memcpy(sl, job.ws[job.branch[i].thread]->statelist + job.branch[i].start,
+               job.branch[i].count * sizeof(struct Crypto1State));
+        sl += job.branch[i].count;
+    }
+    sl->odd = sl->even = 0;
+
+out:
+    if (job.ws)
+        for (uint32_t i = 0; i < threads; i++)
+            crypto1_workspace_destroy(job.ws[i]);
+    free(job.ws);
+    free(job.fill);
+    free(job.branch);
+    crypto1_workspace_destroy(top);
+    return statelist;
+}
+
 static const uint32_t S1[] = {     0x62141, 0x310A0, 0x18850, 0x0C428, 0x06214,
                                    0x0310A, 0x85E30, 0xC69AD, 0x634D6, 0xB5CDE, 0xDE8DA, 0x6F46D, 0xB3C83,
                                    0x59E41, 0xA8995, 0xD027F, 0x6813F, 0x3409F, 0x9E6FA
@@ -0,0 +1,220 @@
+// Bitsliced Crypto1, see crypto1_bs.h
+
+#include <string.h>
+
+#include "crypto1_bs.h"
+
+#define LFSR_BITS       48
+#define HALF_MASK       0xffffff
+
+// all lanes set when bit is 1
+#define BS_BIT(bit)     ((uint64_t)0 - (uint64_t)(bit))
+
+// The filter functions of 'Dismantling MIFARE Classic': fa and fb on the nibbles of the odd
+// half, fc on their five outputs. The same truth tables as the constants of filter().
+#define BS_FA(a, b, c, d)       ((((a) | (b)) ^ ((a) & (d))) ^ ((c) & (((a) ^ (b)) | (d))))
+#define BS_FB(a, b, c, d)       ((((a) & (b)) | (c)) ^ (((a) ^ (b)) & ((c) | (d))))
+#define BS_FC(a, b, c, d, e)    (((a) | (((b) | (e)) & ((d) ^ (e)))) ^ (((a) ^ ((b) & (d))) & (((c) ^ (d)) | ((b) & (e)))))
+
+// filter() of the register at w, odd bit i being w[47 - 2i]
+static inline uint64_t bs_filter(const uint64_t *w) {
+    uint64_t n0 = BS_FB(w[41], w[43], w[45], w[47]);
+    uint64_t n1 = BS_FA(w[33], w[35], w[37], w[39]);
+    uint64_t n2 = BS_FB(w[25], w[27], w[29], w[31]);
+    uint64_t n3 = BS_FB(w[17], w[19], w[21], w[23]);
+    uint64_t n4 = BS_FA(w[9], w[11], w[13], w[15]);
+    return BS_FC(n4, n3, n2, n1, n0);
+}
+
+// Feedback taps of the register at w (LF_POLY_ODD and LF_POLY_EVEN), but for w[0]
+static inline uint64_t bs_taps(const uint64_t *w) {
+    return w[5] ^ w[9] ^ w[10] ^ w[12] ^ w[14] ^ w[15] ^ w[17] ^ w[19] ^ w[24]
+           ^ w[25] ^ w[27] ^ w[29] ^ w[35] ^ w[39] ^ w[41] ^ w[42] ^ w[43];
+}
+
+// Register bit of key bit i, see crypto1_get_lfsr()
+static inline uint32_t key_lfsr_bit(uint32_t i) {
+    uint32_t half_bit = (i >> 1) ^ 3;
+    return (i & 1) ? 47 - 2 * half_bit : 46 - 2 * half_bit;
+}
+
+static inline uint32_t bs_columns(uint32_t count) {
+    return (count + CRYPTO1_BS_LANES - 1) / CRYPTO1_BS_LANES;
+}
+
+// States of column c, the last one may be partial
+static inline uint32_t bs_lanes(uint32_t count, uint32_t c) {
+    uint32_t left = count - c * CRYPTO1_BS_LANES;
+    return (left < CRYPTO1_BS_LANES) ? left : CRYPTO1_BS_LANES;
+}
+
+// In place transpose of a 64x64 bit matrix, bit c of a[r] trades places with bit r of a[c]
+static void transpose64(uint64_t a[64]) {
+    uint64_t m = 0x00000000ffffffffULL;
+    for (uint32_t j = 32; j != 0; j >>= 1, m ^= m << j) {
+        for (uint32_t k = 0; k < 64; k = (k + j + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k + j]) & m;
+            a[k + j] ^= t;
+            a[k] ^= t << j;
+        }
+    }
+}
+
+void crypto1_bs_load(crypto1_bs_t *b, const struct Crypto1State *states, uint32_t count) {
+    uint64_t a[64];
+
+    b->count = count;
+    for (uint32_t c = 0; c < bs_columns(count); c++) {
+        uint32_t lanes = bs_lanes(count, c);
+        const struct Crypto1State *s = states + c * CRYPTO1_BS_LANES;
+        for (uint32_t l = 0; l < lanes; l++) {
+            a[l] = (uint64_t)(s[l].odd & HALF_MASK) | (uint64_t)(s[l].even & HALF_MASK) << 24;
+        }
+        memset(a + lanes, 0, (64 - lanes) * sizeof(uint64_t));
+        transpose64(a);
+        for (uint32_t i = 0; i < 24; i++) {
+            b->lfsr[c][47 - 2 * i] = a[i];
+            b->lfsr[c][46 - 2 * i] = a[24 + i];
+        }
+    }
+}
+
+uint32_t crypto1_bs_load_list(crypto1_bs_t *b, const struct Crypto1State *list) {
+    uint32_t count = 0;
+    while (count < CRYPTO1_BS_MAX_STATES && (list[count].odd | list[count].even)) {
+        count++;
+    }
+    crypto1_bs_load(b, list, count);
+    return count;
+}
+
+void crypto1_bs_init(crypto1_bs_t *b, const uint64_t *keys, uint32_t count) {
+    uint64_t a[64];
+
+    b->count = count;
+    for (uint32_t c = 0; c < bs_columns(count); c++) {
+        uint32_t lanes = bs_lanes(count, c);
+        const uint64_t *k = keys + c * CRYPTO1_BS_LANES;
+        for (uint32_t l = 0; l < lanes; l++) {
+            a[l] = k[l] & ((1ULL << LFSR_BITS) - 1);
+        }
+        memset(a + lanes, 0, (64 - lanes) * sizeof(uint64_t));
+        transpose64(a);
+        for (uint32_t i = 0; i < LFSR_BITS; i++) {
+            b->lfsr[c][key_lfsr_bit(i)] = a[i];
+        }
+    }
+}
+
+void crypto1_bs_store(const crypto1_bs_t *b, struct Crypto1State *states) {
+    uint64_t a[64];
+
+    for (uint32_t c = 0; c < bs_columns(b->count); c++) {
+        for (uint32_t i = 0; i < 24; i++) {
+            a[i] = b->lfsr[c][47 - 2 * i];
+            a[24 + i] = b->lfsr[c][46 - 2 * i];
+        }
+        memset(a + LFSR_BITS, 0, (64 - LFSR_BITS) * sizeof(uint64_t));
+        transpose64(a);
+        struct Crypto1State *s = states + c * CRYPTO1_BS_LANES;
+        for (uint32_t l = 0; l < bs_lanes(b->count, c); l++) {
+            s[l].odd = (uint32_t)(a[l] & HALF_MASK);
+            s[l].even = (uint32_t)(a[l] >> 24 & HALF_MASK);
+        }
+    }
+}
+
+void crypto1_bs_get_lfsr(const crypto1_bs_t *b, uint64_t *keys) {
+    uint64_t a[64];
+
+    for (uint32_t c = 0; c < bs_columns(b->count); c++) {
+        for (uint32_t i = 0; i < LFSR_BITS; i++) {
+            a[i] = b->lfsr[c][key_lfsr_bit(i)];
+        }
+        memset(a + LFSR_BITS, 0, (64 - LFSR_BITS) * sizeof(uint64_t));
+        transpose64(a);
+        memcpy(keys + c * CRYPTO1_BS_LANES, a, bs_lanes(b->count, c) * sizeof(uint64_t));
+    }
+}
+
+// crypto1_word() on one column, ks[k] getting keystream bit k ^ 24 of every state
+static void clock_column(uint64_t lfsr[48], uint32_t in, uint64_t is_encrypted, uint64_t ks[32]) {
+    uint64_t x[LFSR_BITS + 32];
+
+    memcpy(x, lfsr, LFSR_BITS * sizeof(uint64_t));
+    for (uint32_t k = 0; k < 32; k++) {
+        const uint64_t *w = x + k;
+        ks[k] = bs_filter(w);
+        x[k + LFSR_BITS] = w[0] ^ bs_taps(w) ^ (ks[k] & is_encrypted) ^ BS_BIT(BEBIT(in, k));
+    }
+    memcpy(lfsr, x + 32, LFSR_BITS * sizeof(uint64_t));
+}
+
+// lfsr_rollback_word() on one column, ks as above
+static void rollback_column(uint64_t lfsr[48], uint32_t in, uint64_t fb, uint64_t ks[32]) {
+    uint64_t x[LFSR_BITS + 32];
+
+    memcpy(x + 32, lfsr, LFSR_BITS * sizeof(uint64_t));
+    for (int k = 31; k >= 0; k--) {
+        uint64_t *w = x + k;
+        // the filter doesn't see w[0], the bit that fell out
+        ks[k] = bs_filter(w);
+        w[0] = w[LFSR_BITS] ^ bs_taps(w) ^ (ks[k] & fb) ^ BS_BIT(BEBIT(in, k));
+    }
+    memcpy(lfsr, x, LFSR_BITS * sizeof(uint64_t));
+}
+
+static void ks_words(const uint64_t ks[32], uint32_t *words, uint32_t lanes) {
+    uint64_t a[64];
+
+    for (uint32_t k = 0; k < 32; k++) {
+        a[k ^ 24] = ks[k];
+    }
+    memset(a + 32, 0, 32 * sizeof(uint64_t));
+    transpose64(a);
+    for (uint32_t l = 0; l < lanes; l++) {
+        words[l] = (uint32_t)a[l];
+    }
+}
+
+void crypto1_bs_word(crypto1_bs_t *b, uint32_t in, int is_encrypted, uint32_t *ks) {
+    uint64_t slices[32];
+
+    for (uint32_t c = 0; c < bs_columns(b->count); c++) {
+        clock_column(b->lfsr[c], in, BS_BIT(!!is_encrypted), slices);
+        if (ks != NULL) {
+            ks_words(slices, ks + c * CRYPTO1_BS_LANES, bs_lanes(b->count, c));
+        }
+    }
+}
+
+void crypto1_bs_rollback_word(crypto1_bs_t *b, uint32_t in, int fb, uint32_t *ks) {
+    uint64_t slices[32];
+
+    for (uint32_t c = 0; c < bs_columns(b->count); c++) {
+        rollback_column(b->lfsr[c], in, BS_BIT(!!fb), slices);
+        if (ks != NULL) {
+            ks_words(slices, ks + c * CRYPTO1_BS_LANES, bs_lanes(b->count, c));
+        }
+    }
+}
+
+uint32_t crypto1_bs_match_word(crypto1_bs_t *b, uint32_t in, int is_encrypted, uint32_t ks, uint64_t match[CRYPTO1_BS_COLUMNS]) {
+    uint64_t slices[32];
+    uint32_t matches = 0;
+
+    memset(match, 0, CRYPTO1_BS_COLUMNS * sizeof(uint64_t));
+    for (uint32_t c = 0; c < bs_columns(b->count); c++) {
+        clock_column(b->lfsr[c], in, BS_BIT(!!is_encrypted), slices);
+        uint64_t diff = 0;
+        for (uint32_t k = 0; k < 32; k++) {
+            diff |= slices[k] ^ BS_BIT(BEBIT(ks, k));
+        }
+        uint32_t lanes = bs_lanes(b->count, c);
+        match[c] = ~diff & ((lanes < CRYPTO1_BS_LANES) ? (1ULL << lanes) - 1 : ~0ULL);
+        for (uint64_t m = match[c]; m != 0; m &= m - 1) {
+            matches++;
+        }
+    }
+    return matches;
+}
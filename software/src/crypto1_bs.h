@@ -0,0 +1,53 @@
+#ifndef CRYPTO1_BS_H__
+#define CRYPTO1_BS_H__
+
+#include <stdint.h>
+
+#include "crapto1.h"
+
+// Bitsliced Crypto1 over blocks of up to CRYPTO1_BS_MAX_STATES states, for the loops
+// that roll back, clock or turn into keys a whole state list from lfsr_recovery32().
+//
+// A block holds the 48 LFSR bits of its states as structure of arrays: for each column of
+// 64 states, one word per LFSR bit, bit l of a word belonging to state 64 * column + l.
+// One clock of the cipher is then a few dozen word operations for 64 states instead of
+// the same count for one. The functions give the same results as crypto1_word(),
+// lfsr_rollback_word(), crypto1_init() and crypto1_get_lfsr() on every state of the block
+// (bench_crypto1_bs checks that), the input word being the same for all states.
+//
+// Loading and storing transposes the states, so it pays off from a word or two of
+// clocking per load.
+
+#define CRYPTO1_BS_LANES        64
+#define CRYPTO1_BS_COLUMNS      8
+#define CRYPTO1_BS_MAX_STATES   (CRYPTO1_BS_LANES * CRYPTO1_BS_COLUMNS)
+
+typedef struct {
+    uint32_t count;     // states in the block, lanes past it are zero
+    // lfsr[c][k]: bit k of the shift register of the states of column c, k = 47 the last
+    // one shifted in, odd bit i of a Crypto1State being 47 - 2i and even bit i 46 - 2i
+    uint64_t lfsr[CRYPTO1_BS_COLUMNS][48];
+} crypto1_bs_t;
+
+// Load count states, at most CRYPTO1_BS_MAX_STATES.
+void crypto1_bs_load(crypto1_bs_t *b, const struct Crypto1State *states, uint32_t count);
+// Load the next states of a list ending with a zero state, like the lfsr_recovery32()
+// ones. Returns how many were loaded, 0 at the end of the list.
+uint32_t crypto1_bs_load_list(crypto1_bs_t *b, const struct Crypto1State *list);
+// Load the states of count keys, like crypto1_init().
+void crypto1_bs_init(crypto1_bs_t *b, const uint64_t *keys, uint32_t count);
+// Store the b->count states, with no bits above the 24 of each half.
+void crypto1_bs_store(const crypto1_bs_t *b, struct Crypto1State *states);
+// Keys of the b->count states, like crypto1_get_lfsr().
+void crypto1_bs_get_lfsr(const crypto1_bs_t *b, uint64_t *keys);
+
+// Clock all states by the 32 bits of in, like crypto1_word(). ks gets the keystream word
+// of each state, NULL to skip it.
+void crypto1_bs_word(crypto1_bs_t *b, uint32_t in, int is_encrypted, uint32_t *ks);
+// Roll back all states by the 32 bits of in, like lfsr_rollback_word(). ks as above.
+void crypto1_bs_rollback_word(crypto1_bs_t *b, uint32_t in, int fb, uint32_t *ks);
+// crypto1_bs_word() checking the keystream against ks instead of returning it: bit l of
+// match[c] is set when state 64 * c + l gave ks. Returns the number of such states.
+uint32_t crypto1_bs_match_word(crypto1_bs_t *b, uint32_t in, int is_encrypted, uint32_t ks, uint64_t match[CRYPTO1_BS_COLUMNS]);
+
+#endif
@@ -0,0 +1,192 @@
+#include <string.h>
+
+#include "des_bs.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DES_BS_AVX2 1
+#else
+#define DES_BS_AVX2 0
+#endif
+
+#define DES_BS_BIT(bytes, i)    (((bytes)[(i) >> 3] >> (7 - ((i) & 7))) & 1)
+
+// FIPS 46-3 tables, bits numbered from 1 (MSB of the first byte)
+static const uint8_t des_ip[64] = {
+    58, 50, 42, 34, 26, 18, 10, 2, 60, 52, 44, 36, 28, 20, 12, 4,
+    62, 54, 46, 38, 30, 22, 14, 6, 64, 56, 48, 40, 32, 24, 16, 8,
+    57, 49, 41, 33, 25, 17, 9, 1, 59, 51, 43, 35, 27, 19, 11, 3,
+    61, 53, 45, 37, 29, 21, 13, 5, 63, 55, 47, 39, 31, 23, 15, 7,
+};
+
+static const uint8_t des_e[48] = {
+    32, 1, 2, 3, 4, 5, 4, 5, 6, 7, 8, 9,
+    8, 9, 10, 11, 12, 13, 12, 13, 14, 15, 16, 17,
+    16, 17, 18, 19, 20, 21, 20, 21, 22, 23, 24, 25,
+    24, 25, 26, 27, 28, 29, 28, 29, 30, 31, 32, 1,
+};
+
+static const uint8_t des_p[32] = {
+    16, 7, 20, 21, 29, 12, 28, 17, 1, 15, 23, 26, 5, 18, 31, 10,
+    2, 8, 24, 14, 32, 27, 3, 9, 19, 13, 30, 6, 22, 11, 4, 25,
+};
+
+static const uint8_t des_pc1[56] = {
+    57, 49, 41, 33, 25, 17, 9, 1, 58, 50, 42, 34, 26, 18,
+    10, 2, 59, 51, 43, 35, 27, 19, 11, 3, 60, 52, 44, 36,
+    63, 55, 47, 39, 31, 23, 15, 7, 62, 54, 46, 38, 30, 22,
+    14, 6, 61, 53, 45, 37, 29, 21, 13, 5, 28, 20, 12, 4,
+};
+
+static const uint8_t des_pc2[48] = {
+    14, 17, 11, 24, 1, 5, 3, 28, 15, 6, 21, 10,
+    23, 19, 12, 4, 26, 8, 16, 7, 27, 20, 13, 2,
+    41, 52, 31, 37, 47, 55, 30, 40, 51, 45, 33, 48,
+    44, 49, 39, 56, 34, 53, 46, 42, 50, 36, 29, 32,
+};
+
+static const uint8_t des_shifts[16] = { 1, 1, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 1 };
+
+// The whole cipher as 0 based bit indexes: block bit of every IP output, R bit of every
+// E output, S-box output of every P output, block bit of every FP output and key bit
+// of every subkey bit.
+typedef struct {
+    uint8_t ip[64];
+    uint8_t e[48];
+    uint8_t p[32];
+    uint8_t fp[64];
+    uint8_t ks[16][48];
+} des_bs_wiring_t;
+
+static void des_bs_wiring(des_bs_wiring_t *w) {
+    uint8_t cd[56], c0, d0;
+
+    for (int i = 0; i < 64; i++) {
+        w->ip[i] = des_ip[i] - 1;
+        w->fp[des_ip[i] - 1] = i;
+    }
+    for (int i = 0; i < 48; i++) {
+        w->e[i] = des_e[i] - 1;
+    }
+    for (int i = 0; i < 32; i++) {
+        w->p[i] = des_p[i] - 1;
+    }
+    for (int i = 0; i < 56; i++) {
+        cd[i] = des_pc1[i] - 1;
+    }
+    for (int round = 0; round < 16; round++) {
+        for (int n = 0; n < des_shifts[round]; n++) {
+            c0 = cd[0];
+            d0 = cd[28];
+            memmove(cd, cd + 1, 27);
+            memmove(cd + 28, cd + 29, 27);
+            cd[27] = c0;
+            cd[55] = d0;
+        }
+        for (int i = 0; i < 48; i++) {
+            w->ks[round][i] = cd[des_pc2[i] - 1];
+        }
+    }
+}
+
+#define bs_t            uint64_t
+#define BS_FN           static inline
+#define BS_NAME(x)      x##_64
+#define BS_WORDS        1
+#define BS_LANE_BITS    6
+#define BS_ONES         (~0ULL)
+#define BS_ZERO         0ULL
+#include "des_bs_impl.h"
+#undef bs_t
+#undef BS_FN
+#undef BS_NAME
+#undef BS_WORDS
+#undef BS_LANE_BITS
+#undef BS_ONES
+#undef BS_ZERO
+
+#if DES_BS_AVX2
+typedef uint64_t des_bs256_t __attribute__((vector_size(32)));
+
+#define bs_t            des_bs256_t
+#define BS_FN           static inline __attribute__((target("avx2")))
+#define BS_NAME(x)      x##_avx2
+#define BS_WORDS        4
+#define BS_LANE_BITS    8
+#define BS_ONES         ((des_bs256_t){ ~0ULL, ~0ULL, ~0ULL, ~0ULL })
+#define BS_ZERO         ((des_bs256_t){ 0, 0, 0, 0 })
+#include "des_bs_impl.h"
+#undef bs_t
+#undef BS_FN
+#undef BS_NAME
+#undef BS_WORDS
+#undef BS_LANE_BITS
+#undef BS_ONES
+#undef BS_ZERO
+
+static bool des_bs_have_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+static bool des_bs_have_any(void) {
+    return true;
+}
+
+typedef struct {
+    const char *name;
+    uint32_t lanes;
+    bool (*supported)(void);
+    bool (*search)(const des_bs_search_t *s, const des_bs_wiring_t *w, uint32_t start, uint32_t end, uint32_t *idx, volatile int *stop);
+} des_bs_kernel_t;
+
+// widest first
+static const des_bs_kernel_t des_bs_kernels[] = {
+#if DES_BS_AVX2
+    { "AVX2", 256, des_bs_have_avx2, search_avx2 },
+#endif
+    { "64-bit", 64, des_bs_have_any, search_64 },
+};
+
+static const des_bs_kernel_t *des_bs_kernel = NULL;
+
+bool des_bs_select(uint32_t lanes) {
+    for (size_t i = 0; i < sizeof(des_bs_kernels) / sizeof(des_bs_kernels[0]); i++) {
+        if ((lanes == 0 || lanes == des_bs_kernels[i].lanes) && des_bs_kernels[i].supported()) {
+            des_bs_kernel = &des_bs_kernels[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t des_bs_lanes(void) {
+    if (des_bs_kernel == NULL) {
+        des_bs_select(0);
+    }
+    return des_bs_kernel->lanes;
+}
+
+const char *des_bs_name(void) {
+    if (des_bs_kernel == NULL) {
+        des_bs_select(0);
+    }
+    return des_bs_kernel->name;
+}
+
+bool des_bs_search(const des_bs_search_t *s, uint32_t start, uint32_t end, uint32_t *idx, volatile int *stop) {
+    des_bs_wiring_t w;
+
+    if (des_bs_kernel == NULL) {
+        des_bs_select(0);
+    }
+    des_bs_wiring(&w);
+    return des_bs_kernel->search(s, &w, start, end, idx, stop);
+}
+
+void des_bs_candidate_key(const des_bs_search_t *s, uint32_t idx, uint8_t *key) {
+    memcpy(key, s->base_key, 16);
+    for (int k = 0; k < 4; k++) {
+        key[s->segment * 4 + k] = ((idx >> (7 * k)) & 0x7F) << 1;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef DES_BS_H__
+#define DES_BS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Bitsliced 2TDEA key search over one 4 byte segment of a 16 byte key.
+//
+// Candidate idx (28 bits) sets the 4 bytes at base_key[segment * 4] to
+// ((idx >> 7 * k) & 0x7F) << 1, k = 0..3, the DES parity bits being ignored.
+// Every block is decrypted as D_K1(E_K2(D_K1(c))), like DES_ecb3_encrypt(.., DES_DECRYPT)
+// with K1, K2, K1, and a candidate matches when all relations hold on the plaintexts.
+//
+// One pass evaluates des_bs_lanes() candidates, 64 with the portable kernel or 256 with
+// the AVX2 one, selected at runtime. The key schedule is only a wiring of key bits, so
+// the fixed 124 key bits cost nothing and only the 28 candidate bits change per pass.
+
+#define DES_BS_BLOCKS           2
+#define DES_BS_MAX_TERMS        24
+#define DES_BS_MAX_RELATIONS    128
+
+// The XOR of the plaintext bits in terms must equal value. A term is block * 64 + bit,
+// bit 0 being the MSB of the first byte of the block.
+typedef struct {
+    uint8_t value;
+    uint8_t nterms;
+    uint8_t terms[DES_BS_MAX_TERMS];
+} des_bs_relation_t;
+
+typedef struct {
+    uint8_t base_key[16];
+    int segment;                // 0..3
+    int nblocks;                // 1..DES_BS_BLOCKS
+    uint8_t blocks[DES_BS_BLOCKS][8];
+    uint32_t nrelations;
+    des_bs_relation_t relations[DES_BS_MAX_RELATIONS];
+} des_bs_search_t;
+
+// Candidates per pass of the selected kernel.
+uint32_t des_bs_lanes(void);
+
+// Name of the selected kernel ("64-bit" or "AVX2").
+const char *des_bs_name(void);
+
+// Select the kernel with the given lane count, 0 selects the widest one this CPU runs.
+// Returns false if that width isn't available. Not thread safe, call before searching.
+bool des_bs_select(uint32_t lanes);
+
+// Search the candidates in [start, end). Returns true and the lowest matching candidate
+// in idx, or false if there is none or *stop became non zero (checked once per pass).
+bool des_bs_search(const des_bs_search_t *s, uint32_t start, uint32_t end, uint32_t *idx, volatile int *stop);
+
+// Full 16 byte key of candidate idx.
+void des_bs_candidate_key(const des_bs_search_t *s, uint32_t idx, uint8_t *key);
+
+#endif
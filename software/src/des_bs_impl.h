@@ -0,0 +1,144 @@
+// One lane width of the bitsliced 2TDEA search, included by des_bs.c with
+// bs_t, BS_FN, BS_NAME, BS_WORDS, BS_LANE_BITS, BS_ONES and BS_ZERO defined.
+// A bs_t carries one bit of 64 * BS_WORDS candidates, lane l being bit l % 64 of word l / 64.
+
+#include "des_bs_sbox.h"
+
+BS_FN bs_t BS_NAME(bs_bit)(int bit) {
+    return bit ? BS_ONES : BS_ZERO;
+}
+
+// One DES block, in place. data holds the 64 block bits and key the 64 key bits.
+BS_FN void BS_NAME(des)(bs_t *data, const bs_t *key, const des_bs_wiring_t *w, int decrypt) {
+    bs_t lr[64], o[32];
+    bs_t *l = lr, *r = lr + 32, *tmp;
+
+    for (int i = 0; i < 64; i++) {
+        lr[i] = data[w->ip[i]];
+    }
+    for (int round = 0; round < 16; round++) {
+        const uint8_t *k = w->ks[decrypt ? 15 - round : round];
+        const uint8_t *e = w->e;
+#define BS_SBOX(n) BS_NAME(sbox##n)( \
+            r[e[6 * (n - 1)    ]] ^ key[k[6 * (n - 1)    ]], r[e[6 * (n - 1) + 1]] ^ key[k[6 * (n - 1) + 1]], \
+            r[e[6 * (n - 1) + 2]] ^ key[k[6 * (n - 1) + 2]], r[e[6 * (n - 1) + 3]] ^ key[k[6 * (n - 1) + 3]], \
+            r[e[6 * (n - 1) + 4]] ^ key[k[6 * (n - 1) + 4]], r[e[6 * (n - 1) + 5]] ^ key[k[6 * (n - 1) + 5]], \
+            o + 4 * (n - 1))
+        BS_SBOX(1);
+        BS_SBOX(2);
+        BS_SBOX(3);
+        BS_SBOX(4);
+        BS_SBOX(5);
+        BS_SBOX(6);
+        BS_SBOX(7);
+        BS_SBOX(8);
+#undef BS_SBOX
+        for (int i = 0; i < 32; i++) {
+            l[i] ^= o[w->p[i]];
+        }
+        tmp = l;
+        l = r;
+        r = tmp;
+    }
+    // the output of the last round is R16 || L16
+    for (int i = 0; i < 64; i++) {
+        data[i] = (w->fp[i] < 32) ? r[w->fp[i]] : l[w->fp[i] - 32];
+    }
+}
+
+BS_FN bool BS_NAME(search)(const des_bs_search_t *s, const des_bs_wiring_t *w, uint32_t start, uint32_t end, uint32_t *idx, volatile int *stop) {
+    const uint32_t lanes = 64 * BS_WORDS;
+    static const uint64_t lane_pattern[6] = {
+        0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+        0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL,
+    };
+    bs_t fixed[64], cand[64], pre[DES_BS_BLOCKS][64], out[64 * DES_BS_BLOCKS];
+    uint64_t words[BS_WORDS];
+    uint8_t var_pos[28];
+
+    int in_k1 = s->segment < 2;
+    const uint8_t *fixed_half = s->base_key + (in_k1 ? 8 : 0);
+    const uint8_t *cand_half = s->base_key + (in_k1 ? 0 : 8);
+    int offset = (s->segment % 2) * 4;
+
+    for (int i = 0; i < 64; i++) {
+        fixed[i] = BS_NAME(bs_bit)(DES_BS_BIT(fixed_half, i));
+        cand[i] = BS_NAME(bs_bit)(DES_BS_BIT(cand_half, i));
+    }
+    // key bit of every candidate index bit, the candidate bytes have a zero parity bit
+    for (int k = 0; k < 4; k++) {
+        for (int j = 0; j < 7; j++) {
+            var_pos[7 * k + 6 - j] = (offset + k) * 8 + j;
+        }
+        cand[(offset + k) * 8 + 7] = BS_ZERO;
+    }
+    // the low index bits are the lane number
+    for (int t = 0; t < BS_LANE_BITS; t++) {
+        for (int i = 0; i < BS_WORDS; i++) {
+            words[i] = (t < 6) ? lane_pattern[t] : ((i >> (t - 6)) & 1) ? ~0ULL : 0;
+        }
+        memcpy(&cand[var_pos[t]], words, sizeof(bs_t));
+    }
+
+    // with the candidate in K2 the first decryption only depends on K1
+    for (int b = 0; b < s->nblocks; b++) {
+        for (int i = 0; i < 64; i++) {
+            pre[b][i] = BS_NAME(bs_bit)(DES_BS_BIT(s->blocks[b], i));
+        }
+        if (!in_k1) {
+            BS_NAME(des)(pre[b], fixed, w, 1);
+        }
+    }
+
+    for (uint32_t base = start & ~(lanes - 1); base < end; base += lanes) {
+        if (stop != NULL && *stop) {
+            return false;
+        }
+        for (int t = BS_LANE_BITS; t < 28; t++) {
+            cand[var_pos[t]] = BS_NAME(bs_bit)((base >> t) & 1);
+        }
+
+        for (int b = 0; b < s->nblocks; b++) {
+            bs_t *x = out + 64 * b;
+            memcpy(x, pre[b], sizeof(pre[b]));
+            if (in_k1) {
+                BS_NAME(des)(x, cand, w, 1);
+                BS_NAME(des)(x, fixed, w, 0);
+                BS_NAME(des)(x, cand, w, 1);
+            } else {
+                BS_NAME(des)(x, cand, w, 0);
+                BS_NAME(des)(x, fixed, w, 1);
+            }
+        }
+
+        bs_t bad = BS_ZERO;
+        for (uint32_t i = 0; i < s->nrelations; i++) {
+            const des_bs_relation_t *rel = &s->relations[i];
+            bs_t t = BS_NAME(bs_bit)(rel->value);
+            for (int j = 0; j < rel->nterms; j++) {
+                t ^= out[rel->terms[j]];
+            }
+            bad |= t;
+        }
+        bad = ~bad;
+        memcpy(words, &bad, sizeof(words));
+
+        for (uint32_t i = 0; i < BS_WORDS; i++) {
+            // lanes outside of [start, end) on the first and last pass
+            for (uint32_t lane = 64 * i; words[i] && lane < 64 * (i + 1); lane++) {
+                if (base + lane < start || base + lane >= end) {
+                    words[i] &= ~(1ULL << (lane % 64));
+                }
+            }
+            if (words[i]) {
+                uint32_t lane = 0;
+                while (((words[i] >> lane) & 1) == 0) {
+                    lane++;
+                }
+                *idx = base + 64 * i + lane;
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,881 @@
+// Bitsliced DES S-boxes, included by des_bs_impl.h for every lane width.
+//
+// Every output bit is a Shannon decomposition (multiplexer tree) of the S-box truth
+// table, with identical sub-functions of all four outputs computed once. The split
+// variable order was chosen per S-box, by exhaustive search, for the lowest gate count:
+//   S1: a1 a6 a4 a3 a2 a5
+//   S2: a2 a1 a4 a6 a3 a5
+//   S3: a1 a4 a3 a2 a5 a6
+//   S4: a6 a1 a2 a5 a3 a4
+//   S5: a4 a5 a2 a6 a1 a3
+//   S6: a1 a4 a3 a6 a5 a2
+//   S7: a6 a1 a3 a4 a5 a2
+//   S8: a1 a6 a3 a4 a5 a2
+// Inputs a1..a6 are the S-box input bits, a1 being the first one (row MSB), and out[0..3]
+// the output bits, out[0] being the first one (MSB).
+
+// S1, 107 gates
+BS_FN void BS_NAME(sbox1)(bs_t a1, bs_t a2, bs_t a3, bs_t a4, bs_t a5, bs_t a6, bs_t *out) {
+    bs_t ones = BS_ONES;
+    bs_t t0 = ones ^ a5;
+    bs_t t1 = t0 ^ a2;
+    bs_t t2 = t1 ^ a5;
+    bs_t t3 = t2 & a3;
+    bs_t t4 = t1 ^ t3;
+    bs_t t5 = a5 & a3;
+    bs_t t6 = t1 ^ t5;
+    bs_t t7 = t4 ^ t6;
+    bs_t t8 = t7 & a4;
+    bs_t t9 = t4 ^ t8;
+    bs_t t10 = a5 ^ a2;
+    bs_t t11 = t10 ^ t3;
+    bs_t t12 = t0 & a3;
+    bs_t t13 = a2 ^ t12;
+    bs_t t14 = t11 ^ t13;
+    bs_t t15 = t14 & a4;
+    bs_t t16 = t11 ^ t15;
+    bs_t t17 = t9 ^ t16;
+    bs_t t18 = t17 & a6;
+    bs_t t19 = t9 ^ t18;
+    bs_t t20 = a5 & a2;
+    bs_t t21 = ones ^ t20;
+    bs_t t22 = a5 ^ t20;
+    bs_t t23 = t21 ^ t12;
+    bs_t t24 = t13 ^ t23;
+    bs_t t25 = t24 & a4;
+    bs_t t26 = t13 ^ t25;
+    bs_t t27 = t24 ^ t10;
+    bs_t t28 = t27 & a3;
+    bs_t t29 = t24 ^ t28;
+    bs_t t30 = t1 ^ t20;
+    bs_t t31 = t30 & a3;
+    bs_t t32 = t1 ^ t31;
+    bs_t t33 = t29 ^ t32;
+    bs_t t34 = t33 & a4;
+    bs_t t35 = t29 ^ t34;
+    bs_t t36 = t26 ^ t35;
+    bs_t t37 = t36 & a6;
+    bs_t t38 = t26 ^ t37;
+    bs_t t39 = t19 ^ t38;
+    bs_t t40 = t39 & a1;
+    bs_t t41 = t19 ^ t40;
+    bs_t t42 = t2 ^ t12;
+    bs_t t43 = t27 ^ t12;
+    bs_t t44 = t42 ^ t43;
+    bs_t t45 = t44 & a4;
+    bs_t t46 = t42 ^ t45;
+    bs_t t47 = a5 ^ t3;
+    bs_t t48 = t10 & a3;
+    bs_t t49 = t21 ^ t48;
+    bs_t t50 = t43 & a4;
+    bs_t t51 = t47 ^ t50;
+    bs_t t52 = t46 ^ t51;
+    bs_t t53 = t52 & a6;
+    bs_t t54 = t46 ^ t53;
+    bs_t t55 = t44 & a3;
+    bs_t t56 = t27 ^ t55;
+    bs_t t57 = t0 ^ t30;
+    bs_t t58 = t1 ^ t28;
+    bs_t t59 = t56 ^ t58;
+    bs_t t60 = t59 & a4;
+    bs_t t61 = t56 ^ t60;
+    bs_t t62 = t49 ^ a4;
+    bs_t t63 = t61 ^ t62;
+    bs_t t64 = t63 & a6;
+    bs_t t65 = t61 ^ t64;
+    bs_t t66 = t54 ^ t65;
+    bs_t t67 = t66 & a1;
+    bs_t t68 = t54 ^ t67;
+    bs_t t69 = t4 & a4;
+    bs_t t70 = t56 ^ t69;
+    bs_t t71 = t44 ^ t28;
+    bs_t t72 = t21 & a4;
+    bs_t t73 = t71 ^ t72;
+    bs_t t74 = t70 ^ t73;
+    bs_t t75 = t74 & a6;
+    bs_t t76 = t70 ^ t75;
+    bs_t t77 = t57 ^ t5;
+    bs_t t78 = t27 & a4;
+    bs_t t79 = t77 ^ t78;
+    bs_t t80 = t23 & a4;
+    bs_t t81 = t58 ^ t80;
+    bs_t t82 = t79 ^ t81;
+    bs_t t83 = t82 & a6;
+    bs_t t84 = t79 ^ t83;
+    bs_t t85 = t76 ^ t84;
+    bs_t t86 = t85 & a1;
+    bs_t t87 = t76 ^ t86;
+    bs_t t88 = t77 ^ t72;
+    bs_t t89 = t22 ^ t55;
+    bs_t t90 = t89 ^ t25;
+    bs_t t91 = t88 ^ t90;
+    bs_t t92 = t91 & a6;
+    bs_t t93 = t88 ^ t92;
+    bs_t t94 = a2 ^ t5;
+    bs_t t95 = t11 ^ t94;
+    bs_t t96 = t95 & a4;
+    bs_t t97 = t11 ^ t96;
+    bs_t t98 = t27 ^ a3;
+    bs_t t99 = t1 & a4;
+    bs_t t100 = t98 ^ t99;
+    bs_t t101 = t97 ^ t100;
+    bs_t t102 = t101 & a6;
+    bs_t t103 = t97 ^ t102;
+    bs_t t104 = t93 ^ t103;
+    bs_t t105 = t104 & a1;
+    bs_t t106 = t93 ^ t105;
+    out[0] = t41;
+    out[1] = t68;
+    out[2] = t87;
+    out[3] = t106;
+}
+
+// S2, 100 gates
+BS_FN void BS_NAME(sbox2)(bs_t a1, bs_t a2, bs_t a3, bs_t a4, bs_t a5, bs_t a6, bs_t *out) {
+    bs_t ones = BS_ONES;
+    bs_t t0 = ones ^ a5;
+    bs_t t1 = t0 ^ a3;
+    bs_t t2 = a5 ^ a3;
+    bs_t t3 = t1 ^ a6;
+    bs_t t4 = ones ^ a3;
+    bs_t t5 = a5 & a4;
+    bs_t t6 = t3 ^ t5;
+    bs_t t7 = t0 & a3;
+    bs_t t8 = ones ^ t7;
+    bs_t t9 = t2 ^ t8;
+    bs_t t10 = t9 & a6;
+    bs_t t11 = t2 ^ t10;
+    bs_t t12 = t0 ^ t7;
+    bs_t t13 = t2 ^ t12;
+    bs_t t14 = t13 & a6;
+    bs_t t15 = t2 ^ t14;
+    bs_t t16 = t11 ^ t15;
+    bs_t t17 = t16 & a4;
+    bs_t t18 = t11 ^ t17;
+    bs_t t19 = t6 ^ t18;
+    bs_t t20 = t19 & a1;
+    bs_t t21 = t6 ^ t20;
+    bs_t t22 = a3 & a6;
+    bs_t t23 = t0 ^ t22;
+    bs_t t24 = t23 ^ a4;
+    bs_t t25 = t15 ^ a4;
+    bs_t t26 = t24 ^ t25;
+    bs_t t27 = t26 & a1;
+    bs_t t28 = t24 ^ t27;
+    bs_t t29 = t21 ^ t28;
+    bs_t t30 = t29 & a2;
+    bs_t t31 = t21 ^ t30;
+    bs_t t32 = t4 & a6;
+    bs_t t33 = t0 ^ t32;
+    bs_t t34 = t12 & a6;
+    bs_t t35 = a5 ^ t34;
+    bs_t t36 = t33 ^ t35;
+    bs_t t37 = t36 & a4;
+    bs_t t38 = t33 ^ t37;
+    bs_t t39 = t38 ^ a1;
+    bs_t t40 = t2 ^ t32;
+    bs_t t41 = a5 & a3;
+    bs_t t42 = t10 & a4;
+    bs_t t43 = t40 ^ t42;
+    bs_t t44 = t8 & a6;
+    bs_t t45 = t12 ^ t44;
+    bs_t t46 = t8 ^ t22;
+    bs_t t47 = t45 ^ t46;
+    bs_t t48 = t47 & a4;
+    bs_t t49 = t45 ^ t48;
+    bs_t t50 = t43 ^ t49;
+    bs_t t51 = t50 & a1;
+    bs_t t52 = t43 ^ t51;
+    bs_t t53 = t39 ^ t52;
+    bs_t t54 = t53 & a2;
+    bs_t t55 = t39 ^ t54;
+    bs_t t56 = t46 & a4;
+    bs_t t57 = t9 ^ t56;
+    bs_t t58 = t2 ^ t16;
+    bs_t t59 = t0 & a4;
+    bs_t t60 = t58 ^ t59;
+    bs_t t61 = t57 ^ t60;
+    bs_t t62 = t61 & a1;
+    bs_t t63 = t57 ^ t62;
+    bs_t t64 = a5 ^ t41;
+    bs_t t65 = t2 & a6;
+    bs_t t66 = t64 ^ t65;
+    bs_t t67 = t66 ^ t3;
+    bs_t t68 = t67 & a4;
+    bs_t t69 = t66 ^ t68;
+    bs_t t70 = t41 ^ t44;
+    bs_t t71 = t2 & a4;
+    bs_t t72 = t70 ^ t71;
+    bs_t t73 = t69 ^ t72;
+    bs_t t74 = t73 & a1;
+    bs_t t75 = t69 ^ t74;
+    bs_t t76 = t63 ^ t75;
+    bs_t t77 = t76 & a2;
+    bs_t t78 = t63 ^ t77;
+    bs_t t79 = t7 ^ t65;
+    bs_t t80 = t46 ^ t79;
+    bs_t t81 = t80 & a4;
+    bs_t t82 = t46 ^ t81;
+    bs_t t83 = t10 ^ a4;
+    bs_t t84 = t82 ^ t83;
+    bs_t t85 = t84 & a1;
+    bs_t t86 = t82 ^ t85;
+    bs_t t87 = t26 ^ t59;
+    bs_t t88 = t7 & a6;
+    bs_t t89 = t9 ^ t88;
+    bs_t t90 = t41 ^ t34;
+    bs_t t91 = t89 ^ t90;
+    bs_t t92 = t91 & a4;
+    bs_t t93 = t89 ^ t92;
+    bs_t t94 = t87 ^ t93;
+    bs_t t95 = t94 & a1;
+    bs_t t96 = t87 ^ t95;
+    bs_t t97 = t86 ^ t96;
+    bs_t t98 = t97 & a2;
+    bs_t t99 = t86 ^ t98;
+    out[0] = t31;
+    out[1] = t55;
+    out[2] = t78;
+    out[3] = t99;
+}
+
+// S3, 102 gates
+BS_FN void BS_NAME(sbox3)(bs_t a1, bs_t a2, bs_t a3, bs_t a4, bs_t a5, bs_t a6, bs_t *out) {
+    bs_t ones = BS_ONES;
+    bs_t t0 = ones ^ a5;
+    bs_t t1 = t0 ^ a2;
+    bs_t t2 = a6 & a5;
+    bs_t t3 = t0 | t2;
+    bs_t t4 = t3 & a2;
+    bs_t t5 = t1 ^ t4;
+    bs_t t6 = t5 & a3;
+    bs_t t7 = t1 ^ t6;
+    bs_t t8 = ones ^ a6;
+    bs_t t9 = t8 ^ t2;
+    bs_t t10 = t8 ^ a5;
+    bs_t t11 = t9 ^ t10;
+    bs_t t12 = t11 & a2;
+    bs_t t13 = t9 ^ t12;
+    bs_t t14 = a6 ^ a5;
+    bs_t t15 = t10 ^ a2;
+    bs_t t16 = t13 ^ t15;
+    bs_t t17 = t16 & a3;
+    bs_t t18 = t13 ^ t17;
+    bs_t t19 = t7 ^ t18;
+    bs_t t20 = t19 & a4;
+    bs_t t21 = t7 ^ t20;
+    bs_t t22 = t10 ^ t17;
+    bs_t t23 = t22 ^ a4;
+    bs_t t24 = t21 ^ t23;
+    bs_t t25 = t24 & a1;
+    bs_t t26 = t21 ^ t25;
+    bs_t t27 = a6 & ~a2;
+    bs_t t28 = t27 | t12;
+    bs_t t29 = t28 ^ t15;
+    bs_t t30 = t29 & a3;
+    bs_t t31 = t28 ^ t30;
+    bs_t t32 = ones ^ t2;
+    bs_t t33 = t8 & a2;
+    bs_t t34 = t32 ^ t33;
+    bs_t t35 = t16 ^ t34;
+    bs_t t36 = t35 & a3;
+    bs_t t37 = t16 ^ t36;
+    bs_t t38 = t31 ^ t37;
+    bs_t t39 = t38 & a4;
+    bs_t t40 = t31 ^ t39;
+    bs_t t41 = t8 ^ a2;
+    bs_t t42 = t0 & a3;
+    bs_t t43 = t41 ^ t42;
+    bs_t t44 = t0 ^ t33;
+    bs_t t45 = t3 & a3;
+    bs_t t46 = t44 ^ t45;
+    bs_t t47 = t43 ^ t46;
+    bs_t t48 = t47 & a4;
+    bs_t t49 = t43 ^ t48;
+    bs_t t50 = t40 ^ t49;
+    bs_t t51 = t50 & a1;
+    bs_t t52 = t40 ^ t51;
+    bs_t t53 = t10 ^ t4;
+    bs_t t54 = t32 ^ t10;
+    bs_t t55 = t54 & a2;
+    bs_t t56 = t32 ^ t55;
+    bs_t t57 = t53 ^ t56;
+    bs_t t58 = t57 & a3;
+    bs_t t59 = t53 ^ t58;
+    bs_t t60 = t2 & a2;
+    bs_t t61 = t11 ^ t60;
+    bs_t t62 = t61 ^ a3;
+    bs_t t63 = t59 ^ t62;
+    bs_t t64 = t63 & a4;
+    bs_t t65 = t59 ^ t64;
+    bs_t t66 = a5 ^ t33;
+    bs_t t67 = t66 ^ t14;
+    bs_t t68 = t67 & a3;
+    bs_t t69 = t66 ^ t68;
+    bs_t t70 = t10 ^ t55;
+    bs_t t71 = t4 ^ t70;
+    bs_t t72 = t71 & a3;
+    bs_t t73 = t4 ^ t72;
+    bs_t t74 = t69 ^ t73;
+    bs_t t75 = t74 & a4;
+    bs_t t76 = t69 ^ t75;
+    bs_t t77 = t65 ^ t76;
+    bs_t t78 = t77 & a1;
+    bs_t t79 = t65 ^ t78;
+    bs_t t80 = a6 ^ a2;
+    bs_t t81 = a5 & a3;
+    bs_t t82 = t80 ^ t81;
+    bs_t t83 = t0 & a4;
+    bs_t t84 = t82 ^ t83;
+    bs_t t85 = t32 & a2;
+    bs_t t86 = a5 ^ t85;
+    bs_t t87 = t35 ^ t86;
+    bs_t t88 = t87 & a3;
+    bs_t t89 = t35 ^ t88;
+    bs_t t90 = t14 ^ t55;
+    bs_t t91 = t9 & a2;
+    bs_t t92 = t10 ^ t91;
+    bs_t t93 = t90 ^ t92;
+    bs_t t94 = t93 & a3;
+    bs_t t95 = t90 ^ t94;
+    bs_t t96 = t89 ^ t95;
+    bs_t t97 = t96 & a4;
+    bs_t t98 = t89 ^ t97;
+    bs_t t99 = t84 ^ t98;
+    bs_t t100 = t99 & a1;
+    bs_t t101 = t84 ^ t100;
+    out[0] = t26;
+    out[1] = t52;
+    out[2] = t79;
+    out[3] = t101;
+}
+
+// S4, 75 gates
+BS_FN void BS_NAME(sbox4)(bs_t a1, bs_t a2, bs_t a3, bs_t a4, bs_t a5, bs_t a6, bs_t *out) {
+    bs_t ones = BS_ONES;
+    bs_t t0 = ones ^ a4;
+    bs_t t1 = t0 ^ a3;
+    bs_t t2 = a4 ^ t1;
+    bs_t t3 = t2 & a5;
+    bs_t t4 = a4 ^ t3;
+    bs_t t5 = a4 ^ a3;
+    bs_t t6 = a4 & a5;
+    bs_t t7 = t5 ^ t6;
+    bs_t t8 = t4 ^ t7;
+    bs_t t9 = t8 & a2;
+    bs_t t10 = t4 ^ t9;
+    bs_t t11 = a4 & a3;
+    bs_t t12 = ones ^ t11;
+    bs_t t13 = t12 ^ a3;
+    bs_t t14 = t13 & a5;
+    bs_t t15 = t12 ^ t14;
+    bs_t t16 = t1 ^ t14;
+    bs_t t17 = t15 ^ t16;
+    bs_t t18 = t17 & a2;
+    bs_t t19 = t15 ^ t18;
+    bs_t t20 = t10 ^ t19;
+    bs_t t21 = t20 & a1;
+    bs_t t22 = t10 ^ t21;
+    bs_t t23 = t5 & a5;
+    bs_t t24 = t2 ^ t23;
+    bs_t t25 = t13 & a2;
+    bs_t t26 = t24 ^ t25;
+    bs_t t27 = t0 & a5;
+    bs_t t28 = a3 ^ t27;
+    bs_t t29 = t0 ^ a5;
+    bs_t t30 = t28 ^ t29;
+    bs_t t31 = t30 & a2;
+    bs_t t32 = t28 ^ t31;
+    bs_t t33 = t26 ^ t32;
+    bs_t t34 = t33 & a1;
+    bs_t t35 = t26 ^ t34;
+    bs_t t36 = t22 ^ t35;
+    bs_t t37 = t36 & a6;
+    bs_t t38 = t22 ^ t37;
+    bs_t t39 = t0 ^ t3;
+    bs_t t40 = t39 ^ t9;
+    bs_t t41 = t0 ^ t11;
+    bs_t t42 = t40 ^ t21;
+    bs_t t43 = t35 ^ t42;
+    bs_t t44 = t43 & a6;
+    bs_t t45 = t35 ^ t44;
+    bs_t t46 = t41 & a5;
+    bs_t t47 = t2 ^ t46;
+    bs_t t48 = t12 & a2;
+    bs_t t49 = t47 ^ t48;
+    bs_t t50 = a3 & a5;
+    bs_t t51 = t1 ^ t50;
+    bs_t t52 = t2 ^ t27;
+    bs_t t53 = t51 ^ t52;
+    bs_t t54 = t53 & a2;
+    bs_t t55 = t51 ^ t54;
+    bs_t t56 = t49 ^ t55;
+    bs_t t57 = t56 & a1;
+    bs_t t58 = t49 ^ t57;
+    bs_t t59 = t28 & a2;
+    bs_t t60 = t7 ^ t59;
+    bs_t t61 = t0 ^ t23;
+    bs_t t62 = t41 & a2;
+    bs_t t63 = t61 ^ t62;
+    bs_t t64 = t60 ^ t63;
+    bs_t t65 = t64 & a1;
+    bs_t t66 = t60 ^ t65;
+    bs_t t67 = t58 ^ t66;
+    bs_t t68 = t67 & a6;
+    bs_t t69 = t58 ^ t68;
+    bs_t t70 = t30 ^ t59;
+    bs_t t71 = t70 ^ t65;
+    bs_t t72 = t71 ^ t58;
+    bs_t t73 = t72 & a6;
+    bs_t t74 = t71 ^ t73;
+    out[0] = t38;
+    out[1] = t45;
+    out[2] = t69;
+    out[3] = t74;
+}
+
+// S5, 110 gates
+BS_FN void BS_NAME(sbox5)(bs_t a1, bs_t a2, bs_t a3, bs_t a4, bs_t a5, bs_t a6, bs_t *out) {
+    bs_t ones = BS_ONES;
+    bs_t t0 = a3 & a1;
+    bs_t t1 = ones ^ a3;
+    bs_t t2 = t0 ^ t1;
+    bs_t t3 = t2 & a6;
+    bs_t t4 = t0 ^ t3;
+    bs_t t5 = ones ^ t0;
+    bs_t t6 = t5 ^ a6;
+    bs_t t7 = t4 ^ t6;
+    bs_t t8 = t7 & a2;
+    bs_t t9 = t4 ^ t8;
+    bs_t t10 = t1 & a1;
+    bs_t t11 = ones ^ t10;
+    bs_t t12 = t11 & ~a6;
+    bs_t t13 = t12 | t3;
+    bs_t t14 = a3 ^ a1;
+    bs_t t15 = t10 ^ t14;
+    bs_t t16 = t15 & a6;
+    bs_t t17 = t10 ^ t16;
+    bs_t t18 = t13 ^ t17;
+    bs_t t19 = t18 & a2;
+    bs_t t20 = t13 ^ t19;
+    bs_t t21 = t9 ^ t20;
+    bs_t t22 = t21 & a5;
+    bs_t t23 = t9 ^ t22;
+    bs_t t24 = t10 & a6;
+    bs_t t25 = t15 ^ t24;
+    bs_t t26 = ones ^ a1;
+    bs_t t27 = t1 & a6;
+    bs_t t28 = t14 ^ t27;
+    bs_t t29 = t25 ^ t28;
+    bs_t t30 = t29 & a2;
+    bs_t t31 = t25 ^ t30;
+    bs_t t32 = t1 ^ a1;
+    bs_t t33 = a1 ^ t27;
+    bs_t t34 = t12 | t27;
+    bs_t t35 = t33 ^ t34;
+    bs_t t36 = t35 & a2;
+    bs_t t37 = t33 ^ t36;
+    bs_t t38 = t31 ^ t37;
+    bs_t t39 = t38 & a5;
+    bs_t t40 = t31 ^ t39;
+    bs_t t41 = t23 ^ t40;
+    bs_t t42 = t41 & a4;
+    bs_t t43 = t23 ^ t42;
+    bs_t t44 = a3 ^ t10;
+    bs_t t45 = t1 ^ t12;
+    bs_t t46 = t28 ^ t45;
+    bs_t t47 = t46 & a2;
+    bs_t t48 = t28 ^ t47;
+    bs_t t49 = t26 & a6;
+    bs_t t50 = t32 ^ t49;
+    bs_t t51 = t50 ^ t47;
+    bs_t t52 = t48 ^ t51;
+    bs_t t53 = t52 & a5;
+    bs_t t54 = t48 ^ t53;
+    bs_t t55 = t32 ^ a6;
+    bs_t t56 = t55 ^ a2;
+    bs_t t57 = t11 & a5;
+    bs_t t58 = t56 ^ t57;
+    bs_t t59 = t54 ^ t58;
+    bs_t t60 = t59 & a4;
+    bs_t t61 = t54 ^ t60;
+    bs_t t62 = a1 ^ t16;
+    bs_t t63 = t34 ^ t62;
+    bs_t t64 = t63 & a2;
+    bs_t t65 = t34 ^ t64;
+    bs_t t66 = t14 ^ t3;
+    bs_t t67 = a1 & a6;
+    bs_t t68 = t0 ^ t67;
+    bs_t t69 = t66 ^ t68;
+    bs_t t70 = t69 & a2;
+    bs_t t71 = t66 ^ t70;
+    bs_t t72 = t65 ^ t71;
+    bs_t t73 = t72 & a5;
+    bs_t t74 = t65 ^ t73;
+    bs_t t75 = a3 ^ t49;
+    bs_t t76 = t26 ^ t16;
+    bs_t t77 = t75 ^ t76;
+    bs_t t78 = t77 & a2;
+    bs_t t79 = t75 ^ t78;
+    bs_t t80 = t14 ^ t16;
+    bs_t t81 = t80 ^ a2;
+    bs_t t82 = t79 ^ t81;
+    bs_t t83 = t82 & a5;
+    bs_t t84 = t79 ^ t83;
+    bs_t t85 = t74 ^ t84;
+    bs_t t86 = t85 & a4;
+    bs_t t87 = t74 ^ t86;
+    bs_t t88 = t44 & a6;
+    bs_t t89 = t15 ^ t88;
+    bs_t t90 = t89 ^ t28;
+    bs_t t91 = t90 & a2;
+    bs_t t92 = t89 ^ t91;
+    bs_t t93 = t26 ^ t12;
+    bs_t t94 = t1 & a2;
+    bs_t t95 = t93 ^ t94;
+    bs_t t96 = t92 ^ t95;
+    bs_t t97 = t96 & a5;
+    bs_t t98 = t92 ^ t97;
+    bs_t t99 = t44 ^ t67;
+    bs_t t100 = t99 ^ t19;
+    bs_t t101 = t44 ^ t12;
+    bs_t t102 = t15 & a2;
+    bs_t t103 = t101 ^ t102;
+    bs_t t104 = t100 ^ t103;
+    bs_t t105 = t104 & a5;
+    bs_t t106 = t100 ^ t105;
+    bs_t t107 = t98 ^ t106;
+    bs_t t108 = t107 & a4;
+    bs_t t109 = t98 ^ t108;
+    out[0] = t43;
+    out[1] = t61;
+    out[2] = t87;
+    out[3] = t109;
+}
+
+// S6, 105 gates
+BS_FN void BS_NAME(sbox6)(bs_t a1, bs_t a2, bs_t a3, bs_t a4, bs_t a5, bs_t a6, bs_t *out) {
+    bs_t ones = BS_ONES;
+    bs_t t0 = ones ^ a2;
+    bs_t t1 = t0 ^ a5;
+    bs_t t2 = a5 & a6;
+    bs_t t3 = t1 ^ t2;
+    bs_t t4 = ones ^ a5;
+    bs_t t5 = t4 ^ a6;
+    bs_t t6 = t3 ^ t5;
+    bs_t t7 = t6 & a3;
+    bs_t t8 = t3 ^ t7;
+    bs_t t9 = t0 ^ a6;
+    bs_t t10 = t0 & a6;
+    bs_t t11 = a5 ^ t10;
+    bs_t t12 = t9 ^ t11;
+    bs_t t13 = t12 & a3;
+    bs_t t14 = t9 ^ t13;
+    bs_t t15 = t8 ^ t14;
+    bs_t t16 = t15 & a4;
+    bs_t t17 = t8 ^ t16;
+    bs_t t18 = t0 & a5;
+    bs_t t19 = t0 ^ t18;
+    bs_t t20 = a5 ^ t19;
+    bs_t t21 = t20 & a6;
+    bs_t t22 = a5 ^ t21;
+    bs_t t23 = t9 ^ t22;
+    bs_t t24 = t23 & a3;
+    bs_t t25 = t9 ^ t24;
+    bs_t t26 = t1 ^ t21;
+    bs_t t27 = t4 ^ t2;
+    bs_t t28 = t26 ^ t27;
+    bs_t t29 = t28 & a3;
+    bs_t t30 = t26 ^ t29;
+    bs_t t31 = t25 ^ t30;
+    bs_t t32 = t31 & a4;
+    bs_t t33 = t25 ^ t32;
+    bs_t t34 = t17 ^ t33;
+    bs_t t35 = t34 & a1;
+    bs_t t36 = t17 ^ t35;
+    bs_t t37 = a2 ^ a5;
+    bs_t t38 = t1 ^ a6;
+    bs_t t39 = t4 & a3;
+    bs_t t40 = t38 ^ t39;
+    bs_t t41 = ones ^ t18;
+    bs_t t42 = a5 ^ t41;
+    bs_t t43 = t42 & a6;
+    bs_t t44 = a5 ^ t43;
+    bs_t t45 = t44 ^ a3;
+    bs_t t46 = t40 ^ t45;
+    bs_t t47 = t46 & a4;
+    bs_t t48 = t40 ^ t47;
+    bs_t t49 = t37 ^ a6;
+    bs_t t50 = a2 & a5;
+    bs_t t51 = t50 ^ t37;
+    bs_t t52 = t51 & a6;
+    bs_t t53 = t50 ^ t52;
+    bs_t t54 = t49 ^ t53;
+    bs_t t55 = t54 & a3;
+    bs_t t56 = t49 ^ t55;
+    bs_t t57 = t41 & a6;
+    bs_t t58 = t42 ^ t57;
+    bs_t t59 = t58 ^ t1;
+    bs_t t60 = t59 & a3;
+    bs_t t61 = t58 ^ t60;
+    bs_t t62 = t56 ^ t61;
+    bs_t t63 = t62 & a4;
+    bs_t t64 = t56 ^ t63;
+    bs_t t65 = t48 ^ t64;
+    bs_t t66 = t65 & a1;
+    bs_t t67 = t48 ^ t66;
+    bs_t t68 = t51 & a3;
+    bs_t t69 = t43 ^ t68;
+    bs_t t70 = t58 ^ t68;
+    bs_t t71 = t69 ^ t70;
+    bs_t t72 = t71 & a4;
+    bs_t t73 = t69 ^ t72;
+    bs_t t74 = t50 & a6;
+    bs_t t75 = t37 ^ t74;
+    bs_t t76 = t58 & a3;
+    bs_t t77 = t75 ^ t76;
+    bs_t t78 = t1 ^ t76;
+    bs_t t79 = t77 ^ t78;
+    bs_t t80 = t79 & a4;
+    bs_t t81 = t77 ^ t80;
+    bs_t t82 = t73 ^ t81;
+    bs_t t83 = t82 & a1;
+    bs_t t84 = t73 ^ t83;
+    bs_t t85 = t0 & a3;
+    bs_t t86 = a5 ^ t85;
+    bs_t t87 = t18 & a6;
+    bs_t t88 = t37 ^ t87;
+    bs_t t89 = a2 ^ t21;
+    bs_t t90 = t88 ^ t89;
+    bs_t t91 = t90 & a3;
+    bs_t t92 = t88 ^ t91;
+    bs_t t93 = t86 ^ t92;
+    bs_t t94 = t93 & a4;
+    bs_t t95 = t86 ^ t94;
+    bs_t t96 = t4 ^ t10;
+    bs_t t97 = t96 ^ t13;
+    bs_t t98 = t9 ^ t39;
+    bs_t t99 = t97 ^ t98;
+    bs_t t100 = t99 & a4;
+    bs_t t101 = t97 ^ t100;
+    bs_t t102 = t95 ^ t101;
+    bs_t t103 = t102 & a1;
+    bs_t t104 = t95 ^ t103;
+    out[0] = t36;
+    out[1] = t67;
+    out[2] = t84;
+    out[3] = t104;
+}
+
+// S7, 98 gates
+BS_FN void BS_NAME(sbox7)(bs_t a1, bs_t a2, bs_t a3, bs_t a4, bs_t a5, bs_t a6, bs_t *out) {
+    bs_t ones = BS_ONES;
+    bs_t t0 = ones ^ a2;
+    bs_t t1 = a2 ^ a5;
+    bs_t t2 = a2 & a4;
+    bs_t t3 = a5 ^ t2;
+    bs_t t4 = t0 ^ a5;
+    bs_t t5 = a5 & a4;
+    bs_t t6 = t4 ^ t5;
+    bs_t t7 = t3 ^ t6;
+    bs_t t8 = t7 & a3;
+    bs_t t9 = t3 ^ t8;
+    bs_t t10 = a2 & a5;
+    bs_t t11 = t0 ^ t10;
+    bs_t t12 = a2 ^ t11;
+    bs_t t13 = t12 & a4;
+    bs_t t14 = a2 ^ t13;
+    bs_t t15 = t0 & a5;
+    bs_t t16 = t0 ^ t15;
+    bs_t t17 = t16 ^ t13;
+    bs_t t18 = t14 ^ t17;
+    bs_t t19 = t18 & a3;
+    bs_t t20 = t14 ^ t19;
+    bs_t t21 = t9 ^ t20;
+    bs_t t22 = t21 & a1;
+    bs_t t23 = t9 ^ t22;
+    bs_t t24 = ones ^ a5;
+    bs_t t25 = t24 ^ t2;
+    bs_t t26 = t25 ^ a3;
+    bs_t t27 = t18 & a4;
+    bs_t t28 = t1 ^ t27;
+    bs_t t29 = t15 & a3;
+    bs_t t30 = t28 ^ t29;
+    bs_t t31 = t26 ^ t30;
+    bs_t t32 = t31 & a1;
+    bs_t t33 = t26 ^ t32;
+    bs_t t34 = t23 ^ t33;
+    bs_t t35 = t34 & a6;
+    bs_t t36 = t23 ^ t35;
+    bs_t t37 = t0 & a4;
+    bs_t t38 = t4 ^ t37;
+    bs_t t39 = a2 & a3;
+    bs_t t40 = t38 ^ t39;
+    bs_t t41 = t40 ^ t9;
+    bs_t t42 = t41 & a1;
+    bs_t t43 = t40 ^ t42;
+    bs_t t44 = a2 ^ t15;
+    bs_t t45 = t11 & a4;
+    bs_t t46 = t24 ^ t45;
+    bs_t t47 = t16 & a4;
+    bs_t t48 = t4 ^ t47;
+    bs_t t49 = t46 ^ t48;
+    bs_t t50 = t49 & a3;
+    bs_t t51 = t46 ^ t50;
+    bs_t t52 = t1 ^ t2;
+    bs_t t53 = t4 ^ t52;
+    bs_t t54 = t53 & a3;
+    bs_t t55 = t4 ^ t54;
+    bs_t t56 = t51 ^ t55;
+    bs_t t57 = t56 & a1;
+    bs_t t58 = t51 ^ t57;
+    bs_t t59 = t43 ^ t58;
+    bs_t t60 = t59 & a6;
+    bs_t t61 = t43 ^ t60;
+    bs_t t62 = t28 ^ a3;
+    bs_t t63 = t4 & a4;
+    bs_t t64 = a2 ^ t63;
+    bs_t t65 = t44 & a3;
+    bs_t t66 = t64 ^ t65;
+    bs_t t67 = t62 ^ t66;
+    bs_t t68 = t67 & a1;
+    bs_t t69 = t62 ^ t68;
+    bs_t t70 = a2 ^ a4;
+    bs_t t71 = t63 & a3;
+    bs_t t72 = t70 ^ t71;
+    bs_t t73 = t0 ^ t45;
+    bs_t t74 = t73 ^ a3;
+    bs_t t75 = t72 ^ t74;
+    bs_t t76 = t75 & a1;
+    bs_t t77 = t72 ^ t76;
+    bs_t t78 = t69 ^ t77;
+    bs_t t79 = t78 & a6;
+    bs_t t80 = t69 ^ t79;
+    bs_t t81 = t1 ^ t5;
+    bs_t t82 = t24 ^ a4;
+    bs_t t83 = t81 ^ t82;
+    bs_t t84 = t83 & a3;
+    bs_t t85 = t81 ^ t84;
+    bs_t t86 = t85 ^ a1;
+    bs_t t87 = t44 & a4;
+    bs_t t88 = t4 ^ t87;
+    bs_t t89 = t88 ^ t84;
+    bs_t t90 = t44 ^ t13;
+    bs_t t91 = t90 ^ a3;
+    bs_t t92 = t89 ^ t91;
+    bs_t t93 = t92 & a1;
+    bs_t t94 = t89 ^ t93;
+    bs_t t95 = t86 ^ t94;
+    bs_t t96 = t95 & a6;
+    bs_t t97 = t86 ^ t96;
+    out[0] = t36;
+    out[1] = t61;
+    out[2] = t80;
+    out[3] = t97;
+}
+
+// S8, 97 gates
+BS_FN void BS_NAME(sbox8)(bs_t a1, bs_t a2, bs_t a3, bs_t a4, bs_t a5, bs_t a6, bs_t *out) {
+    bs_t ones = BS_ONES;
+    bs_t t0 = ones ^ a2;
+    bs_t t1 = t0 & a5;
+    bs_t t2 = ones ^ t1;
+    bs_t t3 = t0 ^ a5;
+    bs_t t4 = t2 ^ t3;
+    bs_t t5 = t4 & a4;
+    bs_t t6 = t2 ^ t5;
+    bs_t t7 = ones ^ a5;
+    bs_t t8 = t1 ^ t7;
+    bs_t t9 = t8 & a4;
+    bs_t t10 = t1 ^ t9;
+    bs_t t11 = t6 ^ t10;
+    bs_t t12 = t11 & a3;
+    bs_t t13 = t6 ^ t12;
+    bs_t t14 = a2 ^ a5;
+    bs_t t15 = ones ^ t4;
+    bs_t t16 = t2 & a4;
+    bs_t t17 = t14 ^ t16;
+    bs_t t18 = t3 ^ t16;
+    bs_t t19 = t17 ^ a3;
+    bs_t t20 = t13 ^ t19;
+    bs_t t21 = t20 & a6;
+    bs_t t22 = t13 ^ t21;
+    bs_t t23 = t1 ^ a2;
+    bs_t t24 = t23 & a4;
+    bs_t t25 = t1 ^ t24;
+    bs_t t26 = t7 & a3;
+    bs_t t27 = t25 ^ t26;
+    bs_t t28 = t3 & a4;
+    bs_t t29 = a2 ^ t28;
+    bs_t t30 = t23 & a3;
+    bs_t t31 = t29 ^ t30;
+    bs_t t32 = t27 ^ t31;
+    bs_t t33 = t32 & a6;
+    bs_t t34 = t27 ^ t33;
+    bs_t t35 = t22 ^ t34;
+    bs_t t36 = t35 & a1;
+    bs_t t37 = t22 ^ t36;
+    bs_t t38 = t0 ^ t1;
+    bs_t t39 = t15 & a4;
+    bs_t t40 = t38 ^ t39;
+    bs_t t41 = t14 & a3;
+    bs_t t42 = t40 ^ t41;
+    bs_t t43 = t42 ^ a6;
+    bs_t t44 = t3 ^ t12;
+    bs_t t45 = a2 ^ a4;
+    bs_t t46 = t45 ^ t26;
+    bs_t t47 = t44 ^ t46;
+    bs_t t48 = t47 & a6;
+    bs_t t49 = t44 ^ t48;
+    bs_t t50 = t43 ^ t49;
+    bs_t t51 = t50 & a1;
+    bs_t t52 = t43 ^ t51;
+    bs_t t53 = a5 & a4;
+    bs_t t54 = t14 ^ t53;
+    bs_t t55 = t54 ^ t26;
+    bs_t t56 = t1 & a4;
+    bs_t t57 = t15 ^ t56;
+    bs_t t58 = t25 ^ t57;
+    bs_t t59 = t58 & a3;
+    bs_t t60 = t25 ^ t59;
+    bs_t t61 = t55 ^ t60;
+    bs_t t62 = t61 & a6;
+    bs_t t63 = t55 ^ t62;
+    bs_t t64 = t15 ^ a4;
+    bs_t t65 = t8 & a3;
+    bs_t t66 = t64 ^ t65;
+    bs_t t67 = t14 & a4;
+    bs_t t68 = t7 ^ t67;
+    bs_t t69 = t68 ^ t54;
+    bs_t t70 = t69 & a3;
+    bs_t t71 = t68 ^ t70;
+    bs_t t72 = t66 ^ t71;
+    bs_t t73 = t72 & a6;
+    bs_t t74 = t66 ^ t73;
+    bs_t t75 = t63 ^ t74;
+    bs_t t76 = t75 & a1;
+    bs_t t77 = t63 ^ t76;
+    bs_t t78 = t18 ^ a3;
+    bs_t t79 = t57 ^ t10;
+    bs_t t80 = t79 & a3;
+    bs_t t81 = t57 ^ t80;
+    bs_t t82 = t78 ^ t81;
+    bs_t t83 = t82 & a6;
+    bs_t t84 = t78 ^ t83;
+    bs_t t85 = t0 ^ t28;
+    bs_t t86 = t85 ^ t30;
+    bs_t t87 = a2 ^ t67;
+    bs_t t88 = t14 ^ t87;
+    bs_t t89 = t88 & a3;
+    bs_t t90 = t14 ^ t89;
+    bs_t t91 = t86 ^ t90;
+    bs_t t92 = t91 & a6;
+    bs_t t93 = t86 ^ t92;
+    bs_t t94 = t84 ^ t93;
+    bs_t t95 = t94 & a1;
+    bs_t t96 = t84 ^ t95;
+    out[0] = t37;
+    out[1] = t52;
+    out[2] = t77;
+    out[3] = t96;
+}
@@ -0,0 +1,219 @@
+// Partial key knowledge, see key_hint.h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "key_hint.h"
+
+#define KEY_BITS        48
+#define KEY_DIGITS      (KEY_BITS / 4)
+#define KEY_MASK        ((1ULL << KEY_BITS) - 1)
+#define HINT_LINE_LEN   256
+
+bool key_hint_add(key_hint_t *hint, uint64_t mask, uint64_t value) {
+    if (hint->count == hint->size) {
+        uint32_t size = hint->size ? 2 * hint->size : 16;
+        key_pattern_t *patterns = (key_pattern_t *)realloc(hint->patterns, size * sizeof(key_pattern_t));
+        if (patterns == NULL) {
+            return false;
+        }
+        hint->patterns = patterns;
+        hint->size = size;
+    }
+    hint->patterns[hint->count].mask = mask;
+    hint->patterns[hint->count].value = value & mask;
+    hint->count++;
+    return true;
+}
+
+static int compare_patterns(const void *a, const void *b) {
+    const key_pattern_t *pa = (const key_pattern_t *)a;
+    const key_pattern_t *pb = (const key_pattern_t *)b;
+    if (pa->mask != pb->mask) {
+        return (pa->mask < pb->mask) ? -1 : 1;
+    }
+    if (pa->value != pb->value) {
+        return (pa->value < pb->value) ? -1 : 1;
+    }
+    return 0;
+}
+
+void key_hint_finish(key_hint_t *hint) {
+    if (hint->count == 0) {
+        return;
+    }
+    qsort(hint->patterns, hint->count, sizeof(key_pattern_t), compare_patterns);
+    uint32_t n = 1;
+    for (uint32_t i = 1; i < hint->count; i++) {
+        if (compare_patterns(&hint->patterns[i], &hint->patterns[n - 1]) != 0) {
+            hint->patterns[n++] = hint->patterns[i];
+        }
+    }
+    hint->count = n;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = (char)tolower((unsigned char)c);
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// up to 12 hex digits of [s, end)
+static bool parse_hex48(const char *s, const char *end, uint64_t *n) {
+    if (s == end || end - s > KEY_DIGITS) {
+        return false;
+    }
+    for (*n = 0; s < end; s++) {
+        int d = hex_digit(*s);
+        if (d < 0) {
+            return false;
+        }
+        *n = *n << 4 | (uint64_t)d;
+    }
+    return true;
+}
+
+// one pattern of [s, end), blanks around it ignored
+static bool parse_pattern(key_hint_t *hint, const char *s, const char *end) {
+    while (s < end && isspace((unsigned char)*s)) {
+        s++;
+    }
+    while (end > s && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    if (s == end) {
+        return false;
+    }
+
+    uint64_t mask = 0, value = 0;
+    const char *slash = memchr(s, '/', end - s);
+    if (slash != NULL) {
+        if (!parse_hex48(s, slash, &value) || !parse_hex48(slash + 1, end, &mask)) {
+            return false;
+        }
+    } else {
+        if (end - s > KEY_DIGITS) {
+            return false;
+        }
+        for (uint32_t i = 0; s < end; s++, i++) {
+            uint32_t shift = KEY_BITS - 4 * (i + 1);
+            if (*s == '?') {
+                continue;
+            }
+            int d = hex_digit(*s);
+            if (d < 0) {
+                return false;
+            }
+            mask |= 0xfULL << shift;
+            value |= (uint64_t)d << shift;
+        }
+    }
+    return key_hint_add(hint, mask & KEY_MASK, value & KEY_MASK);
+}
+
+// ',' separated patterns of [s, end)
+static bool parse_patterns(key_hint_t *hint, const char *s, const char *end) {
+    while (s < end) {
+        const char *comma = memchr(s, ',', end - s);
+        const char *next = (comma != NULL) ? comma : end;
+        if (!parse_pattern(hint, s, next)) {
+            return false;
+        }
+        s = (comma != NULL) ? comma + 1 : end;
+    }
+    return true;
+}
+
+static bool parse_file(key_hint_t *hint, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return false;
+    }
+    char line[HINT_LINE_LEN];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        char *end = strpbrk(line, "#\r\n");
+        if (end == NULL) {
+            end = line + strlen(line);
+        }
+        const char *s = line;
+        while (s < end && isspace((unsigned char)*s)) {
+            s++;
+        }
+        if (s < end) {
+            ok = parse_patterns(hint, s, end);
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+bool key_hint_parse(key_hint_t *hint, const char *spec) {
+    bool ok = (spec[0] == '@') ? parse_file(hint, spec + 1) : parse_patterns(hint, spec, spec + strlen(spec));
+    key_hint_finish(hint);
+    return ok && hint->count > 0;
+}
+
+bool key_hint_match(const key_hint_t *hint, uint64_t key) {
+    if (hint == NULL || hint->count == 0) {
+        return true;
+    }
+    // one binary search per distinct mask, there is mostly just one
+    const key_pattern_t *p = hint->patterns;
+    const key_pattern_t *last = p + hint->count;
+    while (p < last) {
+        uint64_t mask = p->mask;
+        uint64_t value = key & mask;
+        const key_pattern_t *lo = p, *hi = p;
+        while (hi < last && hi->mask == mask) {
+            hi++;
+        }
+        const key_pattern_t *group_end = hi;
+        while (lo < hi) {
+            const key_pattern_t *mid = lo + (hi - lo) / 2;
+            if (mid->value < value) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo < group_end && lo->value == value) {
+            return true;
+        }
+        p = group_end;
+    }
+    return false;
+}
+
+double key_hint_fraction(const key_hint_t *hint, uint32_t bits) {
+    if (hint == NULL || hint->count == 0) {
+        return 1.0;
+    }
+    double fraction = 0.0;
+    for (uint32_t i = 0; i < hint->count; i++) {
+        uint64_t mask = hint->patterns[i].mask;
+        if (bits < 64) {
+            mask &= (1ULL << bits) - 1;
+        }
+        uint32_t known = 0;
+        for (; mask != 0; mask &= mask - 1) {
+            known++;
+        }
+        fraction += 1.0 / (double)(1ULL << known);
+    }
+    return (fraction < 1.0) ? fraction : 1.0;
+}
+
+void key_hint_free(key_hint_t *hint) {
+    free(hint->patterns);
+    hint->patterns = NULL;
+    hint->count = 0;
+    hint->size = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef KEY_HINT_H__
+#define KEY_HINT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// What is known about a key before it is recovered: the key matches at least one pattern,
+// (key & mask) == value. Vendor keys with fixed bytes are one pattern, a list of possible
+// key prefixes is one pattern per prefix. Keys are 48-bit, the first key byte is bits 40..47.
+//
+// Patterns are written as up to 12 hex digits, '?' for an unknown digit. A shorter pattern
+// is a prefix, the digits after it are unknown. <value>/<mask> (12 hex digits each) gives
+// single bits. Several patterns are separated by ',' or come from a file as @<path>, one
+// per line, '#' starting a comment. Examples: a0a1a2, ????????ff??, 123456789abc/ff00000000f0
+
+typedef struct {
+    uint64_t mask;
+    uint64_t value;     // no bits outside mask
+} key_pattern_t;
+
+typedef struct {
+    key_pattern_t *patterns;    // sorted by mask and value after key_hint_finish()
+    uint32_t count;
+    uint32_t size;
+} key_hint_t;
+
+#define KEY_HINT_INIT   { NULL, 0, 0 }
+
+// Append a pattern, call key_hint_finish() after the last one. Returns false when out of memory.
+bool key_hint_add(key_hint_t *hint, uint64_t mask, uint64_t value);
+// Sort the patterns and drop the duplicates, for key_hint_match()
+void key_hint_finish(key_hint_t *hint);
+// Add the patterns of spec, see above. Returns false on a malformed spec or an unreadable file.
+bool key_hint_parse(key_hint_t *hint, const char *spec);
+// Whether key matches a pattern. A hint without patterns matches every key.
+bool key_hint_match(const key_hint_t *hint, uint64_t key);
+// Share of the 2^bits keys the hint keeps, overlapping patterns counted once each
+double key_hint_fraction(const key_hint_t *hint, uint32_t bits);
+void key_hint_free(key_hint_t *hint);
+
+#endif
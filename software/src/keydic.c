@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#if WIN32
+#include "windows.h"
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "keydic.h"
+
+static uint32_t get_le(const uint8_t *p, uint32_t len) {
+    uint32_t v = 0;
+    while (len--) {
+        v = v << 8 | p[len];
+    }
+    return v;
+}
+
+static void put_le(uint8_t *p, uint64_t v, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++, v >>= 8) {
+        p[i] = (uint8_t)v;
+    }
+}
+
+static int compar_key(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static char empty_file[1];
+
+// whole file in memory: mapped where possible, read otherwise
+static void *map_file(const char *filename, size_t *size) {
+    *size = 0;
+#if WIN32
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    rewind(f);
+    if (len <= 0) {
+        fclose(f);
+        return (len == 0) ? empty_file : NULL;
+    }
+    void *buf = malloc(len);
+    if (buf == NULL || fread(buf, 1, len, f) != (size_t)len) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = len;
+    return buf;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return empty_file;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    *size = st.st_size;
+    return map;
+#endif
+}
+
+static void unmap_file(void *map, size_t size) {
+    if (map == empty_file) {
+        return;
+    }
+#if WIN32
+    (void)size;
+    free(map);
+#else
+    munmap(map, size);
+#endif
+}
+
+static int load_binary(const char *filename, keydic_t *dic) {
+    const uint8_t *p = dic->map;
+    uint32_t header_size = get_le(p + 6, 2);
+
+    if (get_le(p + 4, 2) != KEYDIC_VERSION || header_size < KEYDIC_HEADER_SIZE || dic->map_size < header_size) {
+        fprintf(stderr, "Error: %s has an unsupported dictionary version or header.\n", filename);
+        return 1;
+    }
+    dic->binary = true;
+    dic->uid = get_le(p + 8, 4);
+    dic->nt = get_le(p + 12, 4);
+    dic->sector = p[16];
+    dic->count = get_le(p + 20, 4);
+    dic->packed = p + header_size;
+    if ((dic->map_size - header_size) / KEYDIC_KEY_SIZE < dic->count) {
+        fprintf(stderr, "Error: %s is truncated.\n", filename);
+        return 1;
+    }
+    return 0;
+}
+
+static int load_text(const char *filename, keydic_t *dic) {
+    const char *base = strrchr(filename, '/');
+#if WIN32
+    const char *bs = strrchr(filename, '\\');
+    if (bs != NULL && (base == NULL || bs > base)) {
+        base = bs;
+    }
+#endif
+    base = (base == NULL) ? filename : base + 1;
+
+    uint32_t sector;
+    if (sscanf(base, "keys_%8x_%2u_%8x", &dic->uid, &sector, &dic->nt) != 3) {
+        fprintf(stderr, "Error: Failed to parse the filename %s.\n", filename);
+        return 1;
+    }
+    dic->sector = sector;
+
+    // a key line takes at least 13 bytes, so this bounds the key count in a single pass
+    dic->keys = malloc((dic->map_size / 13 + 1) * sizeof(uint64_t));
+    if (dic->keys == NULL) {
+        perror("Failed to allocate memory");
+        return 1;
+    }
+
+    const char *c = dic->map, *end = c + dic->map_size;
+    while (c < end) {
+        uint64_t key = 0;
+        uint32_t digits = 0;
+        for (; c < end && *c != '\n'; c++) {
+            uint8_t v = (uint8_t) * c;
+            if (v >= '0' && v <= '9') {
+                v -= '0';
+            } else if ((v | 0x20) >= 'a' && (v | 0x20) <= 'f') {
+                v = (v | 0x20) - 'a' + 10;
+            } else {
+                continue;
+            }
+            key = key << 4 | v;
+            digits++;
+        }
+        c++;
+        if (digits == 12) {
+            dic->keys[dic->count++] = key;
+        } else if (digits != 0) {
+            fprintf(stderr, "Error: Failed to read key %u of %s.\n", dic->count + 1, filename);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int keydic_load(const char *filename, keydic_t *dic) {
+    memset(dic, 0, sizeof(keydic_t));
+
+    dic->map = map_file(filename, &dic->map_size);
+    if (dic->map == NULL) {
+        fprintf(stderr, "Warning: Cannot open %s\n", filename);
+        return 1;
+    }
+
+    int ret;
+    if (dic->map_size >= KEYDIC_HEADER_SIZE && memcmp(dic->map, KEYDIC_MAGIC, 4) == 0) {
+        ret = load_binary(filename, dic);
+    } else {
+        ret = load_text(filename, dic);
+        // the text isn't needed once parsed
+        unmap_file(dic->map, dic->map_size);
+        dic->map = NULL;
+    }
+    if (ret != 0) {
+        keydic_free(dic);
+    }
+    return ret;
+}
+
+void keydic_free(keydic_t *dic) {
+    if (dic->map != NULL) {
+        unmap_file(dic->map, dic->map_size);
+    }
+    free(dic->keys);
+    memset(dic, 0, sizeof(keydic_t));
+}
+
+int keydic_save(const char *filename, uint32_t uid, uint8_t sector, uint32_t nt,
+                uint64_t *keys, uint32_t count, bool binary) {
+    FILE *f = fopen(filename, binary ? "wb" : "w");
+    if (f == NULL) {
+        fprintf(stderr, "Warning: Cannot save keys in %s\n", filename);
+        return 1;
+    }
+
+    if (!binary) {
+        for (uint32_t i = 0; i < count; i++) {
+            fprintf(f, "%012" PRIx64 "\n", keys[i]);
+        }
+        fclose(f);
+        return 0;
+    }
+
+    uint8_t header[KEYDIC_HEADER_SIZE] = {0};
+    memcpy(header, KEYDIC_MAGIC, 4);
+    put_le(header + 4, KEYDIC_VERSION, 2);
+    put_le(header + 6, KEYDIC_HEADER_SIZE, 2);
+    put_le(header + 8, uid, 4);
+    put_le(header + 12, nt, 4);
+    header[16] = sector;
+    put_le(header + 20, count, 4);
+
+    qsort(keys, count, sizeof(uint64_t), compar_key);
+
+    uint8_t *packed = malloc((size_t)count * KEYDIC_KEY_SIZE + 1);
+    if (packed == NULL) {
+        perror("Failed to allocate memory");
+        fclose(f);
+        return 1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        put_le(packed + (size_t)i * KEYDIC_KEY_SIZE, keys[i], KEYDIC_KEY_SIZE);
+    }
+
+    int ret = 0;
+    if (fwrite(header, 1, sizeof(header), f) != sizeof(header) ||
+            fwrite(packed, KEYDIC_KEY_SIZE, count, f) != count) {
+        fprintf(stderr, "Warning: Cannot save keys in %s\n", filename);
+        ret = 1;
+    }
+    free(packed);
+    fclose(f);
+    return ret;
+}
+
+void keydic_filename(char *buf, size_t len, uint32_t uid, uint8_t sector, uint32_t nt, const char *suffix, bool binary) {
+    snprintf(buf, len, "keys_%08x_%02u_%08x%s.%s", uid, sector, nt, suffix, binary ? "bdic" : "dic");
+}
@@ -0,0 +1,59 @@
+#ifndef KEYDIC_H__
+#define KEYDIC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Key dictionaries of the staticnested_* tools.
+//
+// Text:   keys_<uid:08x>_<sector:02>_<nt:08x>.dic, one %012x key per line,
+//         uid, sector and nt only come from the file name.
+// Binary: keys_<uid:08x>_<sector:02>_<nt:08x>.bdic, a KEYDIC_HEADER_SIZE byte
+//         header followed by count sorted 48-bit keys, 6 bytes each.
+//         All fields are little endian:
+//           0  magic "CUKD"
+//           4  version (u16)    6  header size (u16)
+//           8  uid (u32)       12  nt (u32)
+//          16  sector (u8)     17  reserved (3 bytes, 0)
+//          20  count (u32)
+#define KEYDIC_MAGIC        "CUKD"
+#define KEYDIC_VERSION      1
+#define KEYDIC_HEADER_SIZE  24
+#define KEYDIC_KEY_SIZE     6
+
+typedef struct {
+    uint32_t uid;
+    uint32_t nt;
+    uint8_t sector;
+    uint32_t count;
+    bool binary;
+    // binary: packed keys inside the mapping, text: keys parsed into an array
+    const uint8_t *packed;
+    uint64_t *keys;
+    void *map;
+    size_t map_size;
+} keydic_t;
+
+// Load a dictionary in either format, the format is told by the magic.
+// Binary files are mapped, not read. Returns 0 on success.
+int keydic_load(const char *filename, keydic_t *dic);
+void keydic_free(keydic_t *dic);
+
+static inline uint64_t keydic_key(const keydic_t *dic, uint32_t i) {
+    if (!dic->binary) {
+        return dic->keys[i];
+    }
+    const uint8_t *p = dic->packed + (size_t)i * KEYDIC_KEY_SIZE;
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 |
+           (uint64_t)p[3] << 24 | (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40;
+}
+
+// Write keys as text, or as binary (keys are sorted in place then). Returns 0 on success.
+int keydic_save(const char *filename, uint32_t uid, uint8_t sector, uint32_t nt,
+                uint64_t *keys, uint32_t count, bool binary);
+
+// Dictionary file name of uid/sector/nt in the given format, suffix (e.g. "_filtered") goes before the extension
+void keydic_filename(char *buf, size_t len, uint32_t uid, uint8_t sector, uint32_t nt, const char *suffix, bool binary);
+
+#endif
@@ -0,0 +1,45 @@
+// Converts staticnested_* key dictionaries between the text (.dic) and the
+// binary (.bdic) format, see keydic.h. The output format follows the
+// extension of the output file.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "keydic.h"
+
+int main(int argc, char *const argv[]) {
+
+    if (argc != 3) {
+        printf("Usage:\n  %s <in.dic|in.bdic> <out.dic|out.bdic>\n"
+               "  a text input must keep its keys_<uid:08x>_<sector:02>_<nt:08x>.dic name\n",
+               argv[0]);
+        return 1;
+    }
+
+    keydic_t dic;
+    if (keydic_load(argv[1], &dic) != 0) {
+        return 1;
+    }
+
+    size_t len = strlen(argv[2]);
+    bool binary = (len > 5) && (strcmp(argv[2] + len - 5, ".bdic") == 0);
+
+    uint64_t *keys = (uint64_t *)calloc(dic.count + 1, sizeof(uint64_t));
+    if (keys == NULL) {
+        perror("Failed to allocate memory");
+        keydic_free(&dic);
+        return 1;
+    }
+    for (uint32_t i = 0; i < dic.count; i++) {
+        keys[i] = keydic_key(&dic, i);
+    }
+
+    int ret = keydic_save(argv[2], dic.uid, dic.sector, dic.nt, keys, dic.count, binary);
+    if (ret == 0) {
+        printf("%s: %u keys saved\n", argv[2], dic.count);
+    }
+
+    free(keys);
+    keydic_free(&dic);
+    return ret;
+}
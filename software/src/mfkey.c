@@ -9,8 +9,14 @@
 //-----------------------------------------------------------------------------
 // MIFARE Darkside hack
 //-----------------------------------------------------------------------------
+#include <stdlib.h>
+#include <string.h>
+
 #include "mfkey.h"
 #include "crapto1.h"
+#include "crypto1_bs.h"
+#include "radixsort.h"
+#include "thread_pool.h"
 
 // MIFARE
 extern int compare_uint64(const void *a, const void *b);
@@ -20,26 +26,60 @@ int inline compare_uint64(const void *a, const void *b) {
     return -1;
 }
 
+// First index in [from, n) with list[index] >= key: doubling steps, then a binary search
+// over the last step, so short skips cost a compare or two and long ones stay logarithmic.
+static uint32_t gallop(const uint64_t *list, uint32_t from, uint32_t n, uint64_t key) {
+    uint32_t lo = from, step = 1, hi = from;
+
+    while (hi < n && list[hi] < key) {
+        lo = hi + 1;
+        hi += step;
+        step <<= 1;
+    }
+    if (hi > n) {
+        hi = n;
+    }
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (list[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Common members of the sorted lists listA (nA entries) and listB (nB entries), written to listA.
+// Equal entries are paired one to one. Number of elements is returned.
+uint32_t intersection_n(uint64_t *listA, uint32_t nA, const uint64_t *listB, uint32_t nB) {
+    uint32_t a = 0, b = 0, out = 0;
+
+    while (a < nA && b < nB) {
+        if (listA[a] == listB[b]) {
+            listA[out++] = listA[a++];
+            b++;
+        } else if (listA[a] < listB[b]) {
+            a = gallop(listA, a + 1, nA, listB[b]);
+        } else {
+            b = gallop(listB, b + 1, nB, listA[a]);
+        }
+    }
+    return out;
+}
+
 // create the intersection (common members) of two sorted lists. Lists are terminated by -1. Result will be in list1. Number of elements is returned.
 uint32_t intersection(uint64_t *listA, uint64_t *listB) {
     if (listA == NULL || listB == NULL)
         return 0;
 
-    uint64_t *p1, *p2, *p3;
-    p1 = p3 = listA;
-    p2 = listB;
+    uint32_t nA = 0, nB = 0;
+    while (listA[nA] != UINT64_C(-1)) nA++;
+    while (listB[nB] != UINT64_C(-1)) nB++;
 
-    while (*p1 != UINT64_C(-1) && *p2 != UINT64_C(-1)) {
-        if (compare_uint64(p1, p2) == 0) {
-            *p3++ = *p1++;
-            p2++;
-        } else {
-            while (compare_uint64(p1, p2) < 0) ++p1;
-            while (compare_uint64(p1, p2) > 0) ++p2;
-        }
-    }
-    *p3 = UINT64_C(-1);
-    return p3 - listA;
+    uint32_t n = intersection_n(listA, nA, listB, nB);
+    listA[n] = UINT64_C(-1);
+    return n;
 }
 
 // Darkside attack (hf mf mifare)
@@ -52,7 +92,6 @@ uint32_t nonce2key(uint32_t uid, uint32_t nt, uint32_t nr, uint32_t ar, uint64_t
 
     uint32_t i, pos;
     uint8_t ks3x[8], par[8][8];
-    uint64_t key_recovered;
 
     // Reset the last three significant bits of the reader nonce
     nr &= 0xFFFFFF1F;
@@ -78,13 +117,126 @@ uint32_t nonce2key(uint32_t uid, uint32_t nt, uint32_t nr, uint32_t ar, uint64_t
         return 0;
     }
 
-    for (i = 0; unionstate.keylist[i]; i++) {
-        lfsr_rollback_word(unionstate.states + i, uid ^ nt, 0);
-        crypto1_get_lfsr(unionstate.states + i, &key_recovered);
-        unionstate.keylist[i] = key_recovered;
+    // the keys overwrite the states they come from, a block is a copy of them
+    crypto1_bs_t block;
+    uint32_t count;
+    for (i = 0; (count = crypto1_bs_load_list(&block, unionstate.states + i)) != 0; i += count) {
+        crypto1_bs_rollback_word(&block, uid ^ nt, 0, NULL);
+        crypto1_bs_get_lfsr(&block, unionstate.keylist + i);
     }
     unionstate.keylist[i] = -1;
 
     *keys = unionstate.keylist;
     return i;
 }
+
+typedef struct {
+    uint32_t uid;
+    DarksideParam *dps;
+} DarksideJob;
+
+// The common prefix recoveries of the params don't depend on each other, one task each
+static void darkside_recover_one(void *ctx, uint32_t item, uint32_t thread_id) {
+    (void)thread_id;
+    DarksideJob *job = (DarksideJob *)ctx;
+    DarksideParam *dp = &job->dps[item];
+
+    // start decrypting
+    dp->keycount = nonce2key(job->uid, dp->nt, dp->nr, dp->ar, dp->par_list, dp->ks_list, &dp->keylist);
+
+    // only parity zero attack
+    if (dp->keycount > 0 && dp->par_list == 0) {
+        radixsort48(dp->keylist, dp->keycount, 1);
+    }
+}
+
+uint32_t darkside_recover(uint32_t uid, DarksideParam *dps, uint32_t count, uint32_t threads, volatile int *cancel) {
+    DarksideJob job = { .uid = uid, .dps = dps };
+    uint64_t *last_keylist = NULL;
+    uint32_t total = 0;
+
+    thread_pool_run_cancel(count, threads, darkside_recover_one, &job, cancel);
+
+    for (uint32_t i = 0; i < count; i++) {
+        DarksideParam *dp = &dps[i];
+
+        if (dp->keycount == 0 || (cancel != NULL && *cancel)) {
+            free(dp->keylist);
+            dp->keylist = NULL;
+            dp->keycount = 0;
+            continue;
+        }
+
+        // only parity zero attack
+        if (dp->par_list == 0) {
+            uint32_t keycount = intersection(last_keylist, dp->keylist);
+            if (keycount == 0) {
+                free(last_keylist);
+                last_keylist = dp->keylist;
+                dp->keylist = NULL;
+                dp->keycount = 0;
+                continue;
+            }
+            // the intersection stays the reference of the next params, keycount <= dp->keycount
+            memcpy(dp->keylist, last_keylist, (keycount + 1) * sizeof(uint64_t));
+            dp->keycount = keycount;
+        }
+        total += dp->keycount;
+    }
+
+    free(last_keylist);
+    return total;
+}
+
+bool mfkey32_recover(uint32_t uid, uint32_t nt0, uint32_t nr0_enc, uint32_t ar0_enc,
+                     uint32_t nt1, uint32_t nr1_enc, uint32_t ar1_enc, uint32_t threads, uint64_t *key, volatile int *cancel) {
+    struct Crypto1State *s, *t;
+    uint32_t p64 = prng_successor(nt0, 64);
+    uint32_t p64b = prng_successor(nt1, 64);
+    bool found = false;
+
+    s = lfsr_recovery32_mt(ar0_enc ^ p64, 0, threads, cancel);
+    if (s == NULL) {
+        return false;
+    }
+    // roll back to the key and replay the second authentication a block of candidates at a time
+    crypto1_bs_t block;
+    uint64_t keys[CRYPTO1_BS_MAX_STATES];
+    uint64_t match[CRYPTO1_BS_COLUMNS];
+    uint32_t count;
+    for (t = s; !found && (cancel == NULL || !*cancel) && (count = crypto1_bs_load_list(&block, t)) != 0; t += count) {
+        crypto1_bs_rollback_word(&block, 0, 0, NULL);
+        crypto1_bs_rollback_word(&block, nr0_enc, 1, NULL);
+        crypto1_bs_rollback_word(&block, uid ^ nt0, 0, NULL);
+        crypto1_bs_get_lfsr(&block, keys);
+
+        crypto1_bs_word(&block, uid ^ nt1, 0, NULL);
+        crypto1_bs_word(&block, nr1_enc, 1, NULL);
+        if (crypto1_bs_match_word(&block, 0, 0, ar1_enc ^ p64b, match) != 0) {
+            // the first candidate in list order, like a state at a time
+            uint32_t i = 0;
+            while (!(match[i / CRYPTO1_BS_LANES] >> (i % CRYPTO1_BS_LANES) & 1)) {
+                i++;
+            }
+            *key = keys[i];
+            found = true;
+        }
+    }
+    free(s);
+    return found;
+}
+
+bool mfkey64_recover(uint32_t uid, uint32_t nt, uint32_t nr_enc, uint32_t ar_enc, uint32_t at_enc, uint64_t *key) {
+    uint32_t p64 = prng_successor(nt, 64);
+    struct Crypto1State *revstate = lfsr_recovery64(ar_enc ^ p64, at_enc ^ prng_successor(p64, 32));
+    if (revstate == NULL) {
+        return false;
+    }
+    lfsr_rollback_word(revstate, 0, 0);
+    lfsr_rollback_word(revstate, 0, 0);
+    lfsr_rollback_word(revstate, nr_enc, 1);
+    lfsr_rollback_word(revstate, uid ^ nt, 0);
+    crypto1_get_lfsr(revstate, key);
+    crypto1_destroy(revstate);
+    return true;
+}
@@ -14,10 +14,37 @@
 #define MFKEY_H
 
 #include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint32_t nt;
+    uint32_t nr;
+    uint32_t ar;
+
+    uint64_t par_list;
+    uint64_t ks_list;
+
+    uint64_t *keylist;      // recovered keys, -1 terminated
+    uint32_t keycount;
+} DarksideParam;
 
 uint32_t nonce2key(uint32_t uid, uint32_t nt, uint32_t nr, uint32_t ar, uint64_t par_info, uint64_t ks_info, uint64_t **keys);
 
 int compare_uint64(const void *a, const void *b);
 uint32_t intersection(uint64_t *listA, uint64_t *listB);
+uint32_t intersection_n(uint64_t *listA, uint32_t nA, const uint64_t *listB, uint32_t nB);
+
+// Recover the keys of all params on threads (0 = one per online CPU). Afterwards keylist and
+// keycount of every param hold the keys it yields: its candidates for the parity attack, the ones
+// common with the previous params for the parity zero attack. Returns the total key count,
+// 0 when *cancel became non zero (cancel may be NULL).
+uint32_t darkside_recover(uint32_t uid, DarksideParam *dps, uint32_t count, uint32_t threads, volatile int *cancel);
+
+// Key of two reader authentications, nt0 == nt1 for the single nonce variant (mfkey32).
+// false as well once *cancel became non zero (cancel may be NULL).
+bool mfkey32_recover(uint32_t uid, uint32_t nt0, uint32_t nr0_enc, uint32_t ar0_enc,
+                     uint32_t nt1, uint32_t nr1_enc, uint32_t ar1_enc, uint32_t threads, uint64_t *key, volatile int *cancel);
+// Key of one complete authentication.
+bool mfkey64_recover(uint32_t uid, uint32_t nt, uint32_t nr_enc, uint32_t ar_enc, uint32_t at_enc, uint64_t *key);
 
 #endif
@@ -3,10 +3,11 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "crapto1.h"
+#include "mfkey.h"
 
 int main(int argc, char *argv[]) {
-    struct Crypto1State *s, *t;
     uint64_t key;     // recovered key
     uint32_t uid;     // serial number
     uint32_t nt;      // tag challenge
@@ -19,8 +20,17 @@ int main(int argc, char *argv[]) {
     printf("MIFARE Classic key recovery - based on 32 bits of keystream\n");
     printf("Recover key from two 32-bit reader authentication answers only!\n\n");
 
+    // optional recovery thread count, 0 = one per online CPU
+    const char *prog = argv[0];
+    uint32_t threads = 1;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        sscanf(argv[2], "%u", &threads);
+        argv += 2;
+        argc -= 2;
+    }
+
     if (argc < 7) {
-        printf(" syntax: %s <uid> <nt> <nr_0> <ar_0> <nr_1> <ar_1>\n\n", argv[0]);
+        printf(" syntax: %s [-j <threads>] <uid> <nt> <nr_0> <ar_0> <nr_1> <ar_1>\n\n", prog);
         return 1;
     }
 
@@ -50,20 +60,8 @@ int main(int argc, char *argv[]) {
     ks2 = ar0_enc ^ p64;
     printf("  ks2: %08x\n", ks2);
 
-    s = lfsr_recovery32(ar0_enc ^ p64, 0);
-
-    for (t = s; t->odd | t->even; ++t) {
-        lfsr_rollback_word(t, 0, 0);
-        lfsr_rollback_word(t, nr0_enc, 1);
-        lfsr_rollback_word(t, uid ^ nt, 0);
-        crypto1_get_lfsr(t, &key);
-        crypto1_word(t, uid ^ nt, 0);
-        crypto1_word(t, nr1_enc, 1);
-        if (ar1_enc == (crypto1_word(t, 0, 0) ^ p64)) {
-            printf("\nFound Key: [%012" PRIx64 "]\n\n", key);
-            break;
-        }
+    if (mfkey32_recover(uid, nt, nr0_enc, ar0_enc, nt, nr1_enc, ar1_enc, threads, &key, NULL)) {
+        printf("\nFound Key: [%012" PRIx64 "]\n\n", key);
     }
-    free(s);
     return 0;
 }
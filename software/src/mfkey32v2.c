@@ -3,10 +3,357 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "crapto1.h"
+#include "crypto1_bs.h"
+#include "mfkey.h"
+#include "radixsort.h"
+#include "thread_pool.h"
 
-int main(int argc, char *argv[]) {
+typedef struct {
+    uint32_t uid;
+    uint32_t nt;
+    uint32_t nr_enc;
+    uint32_t ar_enc;
+    uint32_t group;
+    uint64_t *keys;     // sorted key candidates once recovered
+    uint32_t keyCount;
+    bool recovered;
+    bool found;
+    uint64_t key;
+} AuthRecord;
+
+// records with the same uid, block and key type, the last two are only compared as text
+typedef struct {
+    uint32_t uid;
+    char block[16];
+    char type[16];
+    uint32_t count;
+    uint32_t start;     // first member in BatchJob.members
+} AuthGroup;
+
+typedef struct {
+    AuthRecord *records;
+    uint32_t *members;  // record indexes, grouped, in input order inside a group
+    uint32_t *pending;  // records recovered by the current thread_pool_run
+    struct Crypto1Workspace **ws;   // one per thread, created on its first record
+    uint64_t *known;    // keys found so far, at most one per record
+    uint32_t *known_uid;
+    uint32_t known_count;
+} BatchJob;
+
+// records of a group whose candidates are kept while the later ones are paired with them
+#define BATCH_WINDOW    64
+
+// same check as Crypto1.mfkey32_is_reader_has_key() of the CLI
+static bool reader_has_key(const AuthRecord *r, uint64_t key) {
+    struct Crypto1State s;
+    crypto1_init(&s, key);
+    crypto1_word(&s, r->uid ^ r->nt, 0);
+    crypto1_word(&s, r->nr_enc, 1);
+    return r->ar_enc == (crypto1_word(&s, 0, 0) ^ prng_successor(r->nt, 64));
+}
+
+static void batch_recover(void *ctx, uint32_t item, uint32_t thread_id) {
+    BatchJob *job = (BatchJob *)ctx;
+    AuthRecord *r = &job->records[job->pending[item]];
     struct Crypto1State *s, *t;
+    uint32_t n = 0;
+
+    r->recovered = true;
+    r->keyCount = 0;
+    if (job->ws[thread_id] == NULL) {
+        job->ws[thread_id] = crypto1_workspace_create();
+        if (job->ws[thread_id] == NULL) {
+            fprintf(stderr, "Failed to allocate memory\n");
+            return;
+        }
+    }
+    s = lfsr_recovery32_ws(job->ws[thread_id], r->ar_enc ^ prng_successor(r->nt, 64), 0);
+    if (s == NULL) {
+        fprintf(stderr, "Failed to allocate memory\n");
+        return;
+    }
+    for (t = s; t->odd | t->even; ++t) {
+        n++;
+    }
+    r->keys = malloc((n ? n : 1) * sizeof(uint64_t));
+    if (r->keys == NULL) {
+        fprintf(stderr, "Failed to allocate memory\n");
+        return;
+    }
+    // roll back to the keys a block of states at a time
+    crypto1_bs_t block;
+    uint32_t count;
+    for (t = s; (count = crypto1_bs_load_list(&block, t)) != 0; t += count) {
+        crypto1_bs_rollback_word(&block, 0, 0, NULL);
+        crypto1_bs_rollback_word(&block, r->nr_enc, 1, NULL);
+        crypto1_bs_rollback_word(&block, r->uid ^ r->nt, 0, NULL);
+        crypto1_bs_get_lfsr(&block, r->keys + r->keyCount);
+        r->keyCount += count;
+    }
+    radixsort48(r->keys, r->keyCount, 1);
+}
+
+// recover the key candidates of the next records still needing them, one per thread.
+// Returns how many were recovered, 0 once all records of members have their candidates.
+static uint32_t batch_recover_next(BatchJob *job, const uint32_t *members, uint32_t count, uint32_t threads) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < count && n < threads; i++) {
+        AuthRecord *r = &job->records[members[i]];
+        if (!r->found && !r->recovered) {
+            job->pending[n++] = members[i];
+        }
+    }
+    thread_pool_run(n, threads, batch_recover, job);
+    return n;
+}
+
+// drop the candidates of a record, they are recovered again when needed
+static void batch_release(AuthRecord *r) {
+    free(r->keys);
+    r->keys = NULL;
+    r->keyCount = 0;
+    r->recovered = false;
+}
+
+// smallest key in both sorted candidate lists
+static bool common_key(const AuthRecord *a, const AuthRecord *b, uint64_t *key) {
+    uint32_t i = 0, j = 0;
+    while (i < a->keyCount && j < b->keyCount) {
+        if (a->keys[i] < b->keys[j]) {
+            i++;
+        } else if (a->keys[i] > b->keys[j]) {
+            j++;
+        } else {
+            *key = a->keys[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void batch_mark_key(BatchJob *job, const uint32_t *members, uint32_t count, uint64_t key) {
+    for (uint32_t i = 0; i < count; i++) {
+        AuthRecord *r = &job->records[members[i]];
+        if (!r->found && reader_has_key(r, key)) {
+            r->found = true;
+            r->key = key;
+            batch_release(r);
+        }
+    }
+}
+
+static bool batch_unsolved(const BatchJob *job, const uint32_t *members, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (!job->records[members[i]].found) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void batch_try_pair(BatchJob *job, const AuthGroup *g, const AuthRecord *ra, const AuthRecord *rb) {
+    uint64_t key;
+    if (ra->found || rb->found || !common_key(ra, rb, &key)) {
+        return;
+    }
+    batch_mark_key(job, job->members + g->start, g->count, key);
+    job->known[job->known_count] = key;
+    job->known_uid[job->known_count++] = g->uid;
+}
+
+// Pairs the unsolved records of one group in input order like the CLI used to do with one
+// process per pair, except that the candidates of a record are recovered once per window:
+// two records share their key when their sorted candidate lists intersect.
+// A window of BATCH_WINDOW records is paired with itself, then with every later record,
+// those being recovered a few at a time and dropped once tested against the window. At most
+// the lists of a window and of one record per thread are kept, about 0.5MB each, however
+// large the group is and whether or not its records match each other.
+static void batch_crack_group(BatchJob *job, const AuthGroup *g, uint32_t threads) {
+    const uint32_t *m = job->members + g->start;
+    uint32_t window = (threads > BATCH_WINDOW) ? threads : BATCH_WINDOW;
+
+    // keys already found for this card are likely to be used on other sectors as well
+    for (uint32_t k = 0; k < job->known_count; k++) {
+        if (job->known_uid[k] == g->uid) {
+            batch_mark_key(job, m, g->count, job->known[k]);
+        }
+    }
+
+    for (uint32_t w = 0; w < g->count; w += window) {
+        uint32_t wend = (g->count - w < window) ? g->count : w + window;
+
+        for (uint32_t a = w; a < wend; a++) {
+            AuthRecord *ra = &job->records[m[a]];
+            for (uint32_t b = a + 1; b < wend && !ra->found; b++) {
+                AuthRecord *rb = &job->records[m[b]];
+                if (rb->found) {
+                    continue;
+                }
+                while (!ra->recovered || !rb->recovered) {
+                    batch_recover_next(job, m + a, wend - a, threads);
+                }
+                batch_try_pair(job, g, ra, rb);
+            }
+        }
+
+        // the unsolved records of the window against all the later ones
+        while (wend < g->count && batch_recover_next(job, m + w, wend - w, threads) != 0) {
+        }
+        for (uint32_t b = wend; b < g->count && batch_unsolved(job, m + w, wend - w); b++) {
+            AuthRecord *rb = &job->records[m[b]];
+            if (rb->found) {
+                continue;
+            }
+            if (!rb->recovered) {
+                batch_recover_next(job, m + b, g->count - b, threads);
+            }
+            for (uint32_t a = w; a < wend && !rb->found; a++) {
+                batch_try_pair(job, g, &job->records[m[a]], rb);
+            }
+            batch_release(rb);
+        }
+        // records recovered ahead of a window solved early, and the window itself
+        for (uint32_t i = w; i < g->count; i++) {
+            if (job->records[m[i]].recovered) {
+                batch_release(&job->records[m[i]]);
+            }
+        }
+    }
+}
+
+// one "<uid:hex> <block> <type> <nt:hex> <{nr}:hex> <{ar}:hex>" line per authentication, # starts
+// a comment. Groups are cracked in order of first appearance and "<record index> <key|->" is written
+// for every record of a group once it is done, records being numbered from 0 in input order.
+static int run_batch(const char *listname, uint32_t threads) {
+    FILE *f = (strcmp(listname, "-") == 0) ? stdin : fopen(listname, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Error: Cannot open %s\n", listname);
+        return 1;
+    }
+
+    BatchJob job = { 0 };
+    AuthGroup *groups = NULL;
+    uint32_t count = 0, size = 0, ngroups = 0, gsize = 0;
+    char line[256];
+    uint32_t lineno = 0;
+    int ret = 1;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        char *args[6];
+        uint32_t n = 0;
+        for (char *tok = strtok(line, " \t\r\n"); tok != NULL && tok[0] != '#' && n < 6; tok = strtok(NULL, " \t\r\n")) {
+            args[n++] = tok;
+        }
+        if (n == 0) {
+            continue;
+        }
+        if (count == size) {
+            size = size ? size * 2 : 64;
+            AuthRecord *tmp = realloc(job.records, size * sizeof(AuthRecord));
+            if (tmp == NULL) {
+                perror("Failed to allocate memory");
+                goto out;
+            }
+            job.records = tmp;
+        }
+        AuthRecord *r = &job.records[count];
+        memset(r, 0, sizeof(AuthRecord));
+        if (n != 6 || strlen(args[1]) >= sizeof(groups->block) || strlen(args[2]) >= sizeof(groups->type)
+                || sscanf(args[0], "%x", &r->uid) != 1 || sscanf(args[3], "%x", &r->nt) != 1
+                || sscanf(args[4], "%x", &r->nr_enc) != 1 || sscanf(args[5], "%x", &r->ar_enc) != 1) {
+            fprintf(stderr, "Error: Line %u of %s doesn't hold 6 valid fields.\n", lineno, listname);
+            goto out;
+        }
+        for (r->group = 0; r->group < ngroups; r->group++) {
+            AuthGroup *g = &groups[r->group];
+            if (g->uid == r->uid && strcmp(g->block, args[1]) == 0 && strcmp(g->type, args[2]) == 0) {
+                break;
+            }
+        }
+        if (r->group == ngroups) {
+            if (ngroups == gsize) {
+                gsize = gsize ? gsize * 2 : 16;
+                AuthGroup *tmp = realloc(groups, gsize * sizeof(AuthGroup));
+                if (tmp == NULL) {
+                    perror("Failed to allocate memory");
+                    goto out;
+                }
+                groups = tmp;
+            }
+            memset(&groups[ngroups], 0, sizeof(AuthGroup));
+            groups[ngroups].uid = r->uid;
+            strcpy(groups[ngroups].block, args[1]);
+            strcpy(groups[ngroups].type, args[2]);
+            ngroups++;
+        }
+        groups[r->group].count++;
+        count++;
+    }
+
+    if (threads == 0) {
+        threads = thread_pool_cpus();
+    }
+
+    job.members = malloc((count ? count : 1) * sizeof(uint32_t));
+    job.pending = malloc(threads * sizeof(uint32_t));
+    job.ws = calloc(threads, sizeof(struct Crypto1Workspace *));
+    job.known = malloc((count ? count : 1) * sizeof(uint64_t));
+    job.known_uid = malloc((count ? count : 1) * sizeof(uint32_t));
+    if (job.members == NULL || job.pending == NULL || job.ws == NULL || job.known == NULL || job.known_uid == NULL) {
+        perror("Failed to allocate memory");
+        goto out;
+    }
+    for (uint32_t g = 1; g < ngroups; g++) {
+        groups[g].start = groups[g - 1].start + groups[g - 1].count;
+    }
+    for (uint32_t g = 0; g < ngroups; g++) {
+        groups[g].count = 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        AuthGroup *g = &groups[job.records[i].group];
+        job.members[g->start + g->count++] = i;
+    }
+
+    for (uint32_t g = 0; g < ngroups; g++) {
+        batch_crack_group(&job, &groups[g], threads);
+        for (uint32_t i = 0; i < groups[g].count; i++) {
+            const AuthRecord *r = &job.records[job.members[groups[g].start + i]];
+            if (r->found) {
+                printf("%u %012" PRIx64 "\n", job.members[groups[g].start + i], r->key);
+            } else {
+                printf("%u -\n", job.members[groups[g].start + i]);
+            }
+        }
+        fflush(stdout);
+    }
+    ret = 0;
+
+out:
+    if (f != stdin) {
+        fclose(f);
+    }
+    if (job.ws != NULL) {
+        for (uint32_t i = 0; i < threads; i++) {
+            crypto1_workspace_destroy(job.ws[i]);
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        free(job.records[i].keys);
+    }
+    free(job.records);
+    free(job.members);
+    free(job.pending);
+    free(job.ws);
+    free(job.known);
+    free(job.known_uid);
+    free(groups);
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
     uint64_t key;     // recovered key
     uint32_t uid;     // serial number
     uint32_t nt0;      // tag challenge first
@@ -17,12 +364,33 @@ int main(int argc, char *argv[]) {
     uint32_t ar1_enc; // second encrypted reader response
     uint32_t ks2;     // keystream used to encrypt reader response
 
+    // optional recovery thread count, 0 = one per online CPU
+    const char *prog = argv[0];
+    uint32_t threads = 1, batch_threads = 0;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        sscanf(argv[2], "%u", &threads);
+        batch_threads = threads;
+        argv += 2;
+        argc -= 2;
+    }
+
+    // batch output is meant to be parsed, no banner
+    if (argc == 3 && strcmp(argv[1], "-f") == 0) {
+        return run_batch(argv[2], batch_threads);
+    }
+
     printf("MIFARE Classic key recovery - based 32 bits of keystream  VERSION2\n");
     printf("Recover key from two 32-bit reader authentication answers only\n");
     printf("This version implements Moebius two different nonce solution (like the supercard)\n\n");
 
     if (argc < 8) {
-        printf("syntax: %s <uid> <nt> <nr_0> <ar_0> <nt1> <nr_1> <ar_1>\n\n", argv[0]);
+        printf("syntax: %s [-j <threads>] <uid> <nt> <nr_0> <ar_0> <nt1> <nr_1> <ar_1>\n", prog);
+        printf("        %s [-j <threads>] -f <file|->\n\n", prog);
+        printf("  -j <threads>:  recover on several threads, 0 = one per CPU\n");
+        printf("                 with -f: records recovered at once, defaults to one per CPU\n");
+        printf("  -f <file|->:   batch mode, one \"<uid> <block> <type> <nt> <nr> <ar>\" line per\n");
+        printf("                 authentication read from file or stdin. Records are cracked per\n");
+        printf("                 uid, block and type and \"<record index> <key|->\" is written for each\n\n");
         return 1;
     }
 
@@ -46,7 +414,6 @@ int main(int argc, char *argv[]) {
     // Generate lfsr successors of the tag challenge
     printf("\nLFSR successors of the tag challenge:\n");
     uint32_t p64 = prng_successor(nt0, 64);
-    uint32_t p64b = prng_successor(nt1, 64);
 
     printf("  nt': %08x\n", p64);
     printf(" nt'': %08x\n", prng_successor(p64, 32));
@@ -56,21 +423,8 @@ int main(int argc, char *argv[]) {
     ks2 = ar0_enc ^ p64;
     printf("  ks2: %08x\n", ks2);
 
-    s = lfsr_recovery32(ar0_enc ^ p64, 0);
-
-    for (t = s; t->odd | t->even; ++t) {
-        lfsr_rollback_word(t, 0, 0);
-        lfsr_rollback_word(t, nr0_enc, 1);
-        lfsr_rollback_word(t, uid ^ nt0, 0);
-        crypto1_get_lfsr(t, &key);
-
-        crypto1_word(t, uid ^ nt1, 0);
-        crypto1_word(t, nr1_enc, 1);
-        if (ar1_enc == (crypto1_word(t, 0, 0) ^ p64b)) {
-            printf("\nFound Key: [%012" PRIx64 "]\n\n", key);
-            break;
-        }
+    if (mfkey32_recover(uid, nt0, nr0_enc, ar0_enc, nt1, nr1_enc, ar1_enc, threads, &key, NULL)) {
+        printf("\nFound Key: [%012" PRIx64 "]\n\n", key);
     }
-    free(s);
     return 0;
 }
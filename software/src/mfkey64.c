@@ -5,6 +5,95 @@
 #include <string.h>
 #include <stdlib.h>
 #include "crapto1.h"
+#include "mfkey.h"
+#include "thread_pool.h"
+
+// records read and cracked at once in batch mode
+#define BATCH_CHUNK 1024
+
+typedef struct {
+    uint32_t uid;
+    uint32_t nt;
+    uint32_t nr_enc;
+    uint32_t ar_enc;
+    uint32_t at_enc;
+    uint64_t key;
+    bool found;
+} AuthRecord;
+
+static void batch_recover(void *ctx, uint32_t item, uint32_t thread_id) {
+    (void)thread_id;
+    AuthRecord *r = &((AuthRecord *)ctx)[item];
+    r->found = mfkey64_recover(r->uid, r->nt, r->nr_enc, r->ar_enc, r->at_enc, &r->key);
+}
+
+// one "<uid:hex> <nt:hex> <{nr}:hex> <{ar}:hex> <{at}:hex>" line per authentication, # starts a
+// comment. "<record index> <key|->" is written for every record in input order, records being
+// numbered from 0, by chunks of BATCH_CHUNK so results stream while the input is still read.
+static int run_batch(const char *listname, uint32_t threads) {
+    FILE *f = (strcmp(listname, "-") == 0) ? stdin : fopen(listname, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Error: Cannot open %s\n", listname);
+        return 1;
+    }
+
+    AuthRecord *records = malloc(BATCH_CHUNK * sizeof(AuthRecord));
+    if (records == NULL) {
+        perror("Failed to allocate memory");
+        if (f != stdin) {
+            fclose(f);
+        }
+        return 1;
+    }
+
+    char line[256];
+    uint32_t lineno = 0, index = 0, count = 0;
+    bool eof = false;
+    int ret = 0;
+
+    while (!eof) {
+        eof = (fgets(line, sizeof(line), f) == NULL);
+        if (!eof) {
+            lineno++;
+            char *args[5];
+            uint32_t n = 0;
+            for (char *tok = strtok(line, " \t\r\n"); tok != NULL && tok[0] != '#' && n < 5; tok = strtok(NULL, " \t\r\n")) {
+                args[n++] = tok;
+            }
+            if (n == 0) {
+                continue;
+            }
+            AuthRecord *r = &records[count];
+            memset(r, 0, sizeof(AuthRecord));
+            if (n != 5 || sscanf(args[0], "%x", &r->uid) != 1 || sscanf(args[1], "%x", &r->nt) != 1
+                    || sscanf(args[2], "%x", &r->nr_enc) != 1 || sscanf(args[3], "%x", &r->ar_enc) != 1
+                    || sscanf(args[4], "%x", &r->at_enc) != 1) {
+                fprintf(stderr, "Error: Line %u of %s doesn't hold 5 valid fields.\n", lineno, listname);
+                ret = 1;
+                break;
+            }
+            count++;
+        }
+        if (count == BATCH_CHUNK || (eof && count > 0)) {
+            thread_pool_run(count, threads, batch_recover, records);
+            for (uint32_t i = 0; i < count; i++, index++) {
+                if (records[i].found) {
+                    printf("%u %012" PRIx64 "\n", index, records[i].key);
+                } else {
+                    printf("%u -\n", index);
+                }
+            }
+            fflush(stdout);
+            count = 0;
+        }
+    }
+
+    if (f != stdin) {
+        fclose(f);
+    }
+    free(records);
+    return ret;
+}
 
 int main(int argc, char *argv[]) {
     struct Crypto1State *revstate;
@@ -17,11 +106,30 @@ int main(int argc, char *argv[]) {
     uint32_t ks2;     // keystream used to encrypt reader response
     uint32_t ks3;     // keystream used to encrypt tag response
 
+    // batch mode thread count, 0 = one per online CPU
+    const char *prog = argv[0];
+    uint32_t threads = 0;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        sscanf(argv[2], "%u", &threads);
+        argv += 2;
+        argc -= 2;
+    }
+
+    // batch output is meant to be parsed, no banner
+    if (argc == 3 && strcmp(argv[1], "-f") == 0) {
+        return run_batch(argv[2], threads);
+    }
+
     printf("MIFARE Classic key recovery - based 64 bits of keystream\n");
     printf("Recover key from only one complete authentication!\n\n");
 
     if (argc < 6) {
-        printf(" syntax: %s <uid> <nt> <{nr}> <{ar}> <{at}> [enc...]\n\n", argv[0]);
+        printf(" syntax: %s <uid> <nt> <{nr}> <{ar}> <{at}> [enc...]\n", prog);
+        printf("         %s [-j <threads>] -f <file|->\n\n", prog);
+        printf("  -f <file|->:   batch mode, one \"<uid> <nt> <{nr}> <{ar}> <{at}>\" line per\n");
+        printf("                 authentication read from file or stdin, \"<record index> <key|->\"\n");
+        printf("                 is written for each\n");
+        printf("  -j <threads>:  with -f: records cracked at once, 0 = one per CPU (default)\n\n");
         return 1;
     }
 
@@ -7,9 +7,18 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <signal.h>
+#include <time.h>
 #include <pthread.h>
 #include <openssl/des.h>
 
+#if WIN32
+#include "windows.h"
+#endif
+
+#include "des_bs.h"
+#include "thread_pool.h"
+
 #ifdef _MSC_VER
 # define bswap64 _byteswap_uint64
 #else
@@ -20,8 +29,15 @@
 #define KEY_SIZE   16  // Full 2TDEA key size (K1 || K2)
 #define BENCHMARK_FULL_KEYSPACE 0
 
+#define CHUNK_BITS        18    // candidates per work chunk, as a power of 2
+#define NUM_CHUNKS        (1UL << (28 - CHUNK_BITS))
+#define REPORT_INTERVAL   5     // seconds between progress reports and checkpoint saves
+
 // Global flag to signal that a key has been found.
 volatile int key_found = 0;
+// Set when a key was found or on SIGINT/SIGTERM, stops the search at the next pass.
+volatile int stop_search = 0;
+volatile int interrupted = 0;
 
 typedef enum {
     LFSR_UNDEF = 0,
@@ -30,17 +46,29 @@ typedef enum {
 } lfsr_t;
 
 typedef struct {
-    uint32_t start;               // starting candidate (inclusive)
-    uint32_t end;                 // ending candidate (exclusive)
     int key_mode;                 // 0 to 3 (i.e. brute force segment 1-4 as 0-indexed)
     unsigned char init_ciphertext[BLOCK_SIZE];
     unsigned char prev_ciphertext[BLOCK_SIZE];  // "IV" of ciphertext for CBC mode in reader mode
     unsigned char ciphertext[BLOCK_SIZE];
     unsigned char base_key[KEY_SIZE];  // the 3DES base key provided by the user
-    int thread_id;
     lfsr_t lfsr_type;
     bool is_reader_mode;          // true for -r mode, false for -c mode
-} thread_args_t;
+    des_bs_search_t search;       // the above as a bitsliced search
+} search_args_t;
+
+typedef struct {
+    const search_args_t *args;
+    const uint32_t *chunks;       // chunks left to search by this run
+    uint32_t num_chunks;
+    uint32_t shard_chunks;        // chunks of the shard, searched before or not
+    uint32_t searched;            // chunks completed by this run
+    uint8_t done[NUM_CHUNKS / 8]; // completed chunks, as saved in the checkpoint
+    const char *checkpoint;       // NULL without checkpoint file
+    char job_id[128];             // identifies the search in the checkpoint
+    double start_time;
+    double last_report;
+    pthread_mutex_t lock;
+} brute_job_t;
 
 // Converts a hex string to bytes. The hex string must be exactly 2*len hex digits long.
 static int hex_to_bytes(const char *hex, unsigned char *buf, size_t len) {
@@ -62,14 +90,23 @@ static void print_hex(const unsigned char *buf, size_t len) {
     printf("\n");
 }
 
+static uint16_t lfsr_next_ulcg(uint16_t x16) {
+    return x16 << 15 | ((x16 >> 1) ^ ((x16 >> 3 ^ x16 >> 4 ^ x16 >> 6) & 1));
+}
+
+static uint16_t lfsr_next_uscuidul(uint16_t x16) {
+    for (int i = 0; i < 16; i++) x16 = x16 >> 1 | (x16 ^ x16 >> 2 ^ x16 >> 3 ^ x16 >> 5) << 15;
+    return x16;
+}
+
 static bool valid_lfsr_ulcg(uint64_t x64) {
     x64 = bswap64(x64);
     uint16_t x16 = x64 >> 48;
-    x16 = x16 << 15 | ((x16 >> 1) ^ ((x16 >> 3 ^ x16 >> 4 ^ x16 >> 6) & 1));
+    x16 = lfsr_next_ulcg(x16);
     if (x16 != ((x64 >> 32) & 0xFFFF)) return false;
-    x16 = x16 << 15 | ((x16 >> 1) ^ ((x16 >> 3 ^ x16 >> 4 ^ x16 >> 6) & 1));
+    x16 = lfsr_next_ulcg(x16);
     if (x16 != ((x64 >> 16) & 0xFFFF)) return false;
-    x16 = x16 << 15 | ((x16 >> 1) ^ ((x16 >> 3 ^ x16 >> 4 ^ x16 >> 6) & 1));
+    x16 = lfsr_next_ulcg(x16);
     if (x16 != (x64 & 0xFFFF)) return false;
     return true;
 }
@@ -77,16 +114,15 @@ static bool valid_lfsr_ulcg(uint64_t x64) {
 static bool valid_lfsr_uscuidul(uint64_t x64) {
     x64 = bswap64(x64);
     uint16_t x16 = x64 & 0xFFFF;
-    for (int i = 0; i < 16; i++) x16 = x16 >> 1 | (x16 ^ x16 >> 2 ^ x16 >> 3 ^ x16 >> 5) << 15;
+    x16 = lfsr_next_uscuidul(x16);
     if (x16 != ((x64 >> 16) & 0xFFFF)) return false;
-    for (int i = 0; i < 16; i++) x16 = x16 >> 1 | (x16 ^ x16 >> 2 ^ x16 >> 3 ^ x16 >> 5) << 15;
+    x16 = lfsr_next_uscuidul(x16);
     if (x16 != ((x64 >> 32) & 0xFFFF)) return false;
-    for (int i = 0; i < 16; i++) x16 = x16 >> 1 | (x16 ^ x16 >> 2 ^ x16 >> 3 ^ x16 >> 5) << 15;
+    x16 = lfsr_next_uscuidul(x16);
     if (x16 != ((x64 >> 48) & 0xFFFF)) return false;
     return true;
 }
 
-
 static bool valid_lfsr(uint64_t x64, lfsr_t lfsr_type) {
     switch (lfsr_type) {
         case LFSR_ULCG:
@@ -113,120 +149,279 @@ static lfsr_t detect_lfsr_type(unsigned char *init_ciphertext) {
     return LFSR_UNDEF;
 }
 
-// Worker thread function using low-level DES functions.
-static void *worker(void *arg) {
-    thread_args_t *targs = (thread_args_t *) arg;
-    uint32_t start = targs->start;
-    uint32_t end   = targs->end;
-    int key_mode   = targs->key_mode;
-
-    // Determine which half is being brute forced.
-    // For key_mode 0 or 1 the candidate is in K1; for key_mode 2 or 3 the candidate is in K2.
-    int candidate_in_K1 = (key_mode < 2) ? 1 : 0;
-
-    // Determine the 4-byte offset within the variable half:
-    // For K1, key_mode 0 means segment1 (offset 0), key_mode 1 means segment2 (offset 4).
-    // For K2, key_mode 2 means segment3 (offset 0), key_mode 3 means segment4 (offset 4).
-    int var_offset = candidate_in_K1 ? ((key_mode % 2) * 4) : (((key_mode - 2) % 2) * 4);
-
-    // Precompute the fixed half's DES key schedule.
-    DES_cblock fixed_key;
-    if (candidate_in_K1) {
-        // Fixed half is K2: bytes 8..15 of base_key.
-        memcpy(fixed_key, targs->base_key + 8, 8);
-    } else {
-        // Candidate in K2; fixed half is K1: bytes 0..7 of base_key.
-        memcpy(fixed_key, targs->base_key, 8);
-    }
-    DES_key_schedule fixed_schedule;
-    DES_set_key_unchecked(&fixed_key, &fixed_schedule);
+// Reference check of one candidate with OpenSSL, confirms every match of the bitsliced search.
+static bool check_candidate(const search_args_t *targs, uint32_t idx) {
+    unsigned char key[KEY_SIZE];
+    DES_key_schedule ks1, ks2;
     uint64_t out;
     uint64_t init_out;
 
-    // For the candidate half, start with the corresponding half from the base key.
-    unsigned char base_half[8];
-    if (candidate_in_K1)
-        memcpy(base_half, targs->base_key, 8);
-    else
-        memcpy(base_half, targs->base_key + 8, 8);
-
-    // Loop over the candidate key indices in this thread's range.
-    for (uint32_t idx = start; idx < end; idx++) {
-        if (key_found && !BENCHMARK_FULL_KEYSPACE)
-            break;  // Some other thread already found the key.
-        // Convert the candidate index (28 bits) into 4 bytes.
-        // Each candidate byte is constructed from a 7-bit chunk shifted left by 1 so that the LSB is zero.
-        uint8_t b0 = ((idx) & 0x7F) << 1;
-        uint8_t b1 = ((idx >> 7) & 0x7F) << 1;
-        uint8_t b2 = ((idx >> 14) & 0x7F) << 1;
-        uint8_t b3 = ((idx >> 21) & 0x7F) << 1;
-        // Build the candidate half key by starting with the fixed base half and substituting candidate bytes.
-        DES_cblock candidate_half;
-        memcpy(candidate_half, base_half, 8);
-        candidate_half[var_offset    ] = b0;
-        candidate_half[var_offset + 1] = b1;
-        candidate_half[var_offset + 2] = b2;
-        candidate_half[var_offset + 3] = b3;
-
-        // Compute the candidate half's DES key schedule.
-        DES_key_schedule candidate_schedule;
-        DES_set_key_unchecked(&candidate_half, &candidate_schedule);
-
-        // Perform 2-key triple DES decryption on the ciphertext.
-        // If candidate is in K1: decryption = DES_ecb3_encrypt(cipher, out, candidate, fixed, candidate, DES_DECRYPT)
-        // If candidate is in K2: decryption = DES_ecb3_encrypt(cipher, out, fixed, candidate, fixed, DES_DECRYPT)
-        if (candidate_in_K1) {
-            DES_ecb3_encrypt((DES_cblock *)targs->ciphertext, (DES_cblock *)&out,
-                             &candidate_schedule, &fixed_schedule, &candidate_schedule, DES_DECRYPT);
-        } else {
-            DES_ecb3_encrypt((DES_cblock *)targs->ciphertext, (DES_cblock *)&out,
-                             &fixed_schedule, &candidate_schedule, &fixed_schedule, DES_DECRYPT);
+    des_bs_candidate_key(&targs->search, idx, key);
+    DES_set_key_unchecked((DES_cblock *)key, &ks1);
+    DES_set_key_unchecked((DES_cblock *)(key + 8), &ks2);
+
+    // 2-key triple DES decryption on the ciphertext
+    DES_ecb3_encrypt((DES_cblock *)targs->ciphertext, (DES_cblock *)&out, &ks1, &ks2, &ks1, DES_DECRYPT);
+
+    if (targs->is_reader_mode) {
+        // In reader mode, also decrypt init_ciphertext and check for rotation relationship
+        DES_ecb3_encrypt((DES_cblock *)targs->init_ciphertext, (DES_cblock *)&init_out, &ks1, &ks2, &ks1, DES_DECRYPT);
+        // Apply XOR block to the second decrypted block (for CBC mode)
+        uint64_t prev;
+        memcpy(&prev, targs->prev_ciphertext, BLOCK_SIZE);
+        out ^= prev;
+
+        // Check if out is 8-bit (1-byte) left rotated version of init_out
+        // Need to convert to big-endian for byte rotation, then back to little-endian
+        uint64_t init_be = bswap64(init_out);
+        uint64_t rotated_be = (init_be << 8) | (init_be >> 56);
+        uint64_t rotated = bswap64(rotated_be);
+        return out == rotated;
+    }
+    // In counterfeit mode, check the resulting plaintext against LFSR
+    return valid_lfsr(out, targs->lfsr_type);
+}
+
+// Bit b (0 = LSB) of the 16-bit big-endian word w of a block, as a des_bs term
+static uint8_t lfsr_term(int block, int w, int b) {
+    return block * 64 + 16 * w + 15 - b;
+}
+
+// word dst == next(word src), next being linear the relations are read from its matrix
+static void add_lfsr_relations(des_bs_search_t *s, uint16_t (*next)(uint16_t), int src, int dst) {
+    for (int ob = 0; ob < 16; ob++) {
+        des_bs_relation_t *rel = &s->relations[s->nrelations++];
+        rel->value = 0;
+        rel->nterms = 0;
+        rel->terms[rel->nterms++] = lfsr_term(0, dst, ob);
+        for (int ib = 0; ib < 16; ib++) {
+            if ((next(1 << ib) >> ob) & 1) {
+                rel->terms[rel->nterms++] = lfsr_term(0, src, ib);
+            }
         }
+    }
+}
 
-        bool match = false;
-        if (targs->is_reader_mode) {
-            // In reader mode, also decrypt init_ciphertext and check for rotation relationship
-            // Apply XOR block to the second decrypted block (for CBC mode)
-            if (candidate_in_K1) {
-                DES_ecb3_encrypt((DES_cblock *)targs->init_ciphertext, (DES_cblock *)&init_out,
-                                 &candidate_schedule, &fixed_schedule, &candidate_schedule, DES_DECRYPT);
-            } else {
-                DES_ecb3_encrypt((DES_cblock *)targs->init_ciphertext, (DES_cblock *)&init_out,
-                                 &fixed_schedule, &candidate_schedule, &fixed_schedule, DES_DECRYPT);
+// Express the match condition of the mode as relations on the plaintext bits
+static void setup_search(des_bs_search_t *s, const search_args_t *targs) {
+    memcpy(s->base_key, targs->base_key, KEY_SIZE);
+    s->segment = targs->key_mode;
+    s->nrelations = 0;
+    memcpy(s->blocks[0], targs->ciphertext, BLOCK_SIZE);
+    if (targs->is_reader_mode) {
+        // byte i of the first plaintext XOR prev_ciphertext is byte i + 1 of the second one
+        s->nblocks = 2;
+        memcpy(s->blocks[1], targs->init_ciphertext, BLOCK_SIZE);
+        for (int i = 0; i < 64; i++) {
+            des_bs_relation_t *rel = &s->relations[s->nrelations++];
+            rel->value = (targs->prev_ciphertext[i / 8] >> (7 - i % 8)) & 1;
+            rel->nterms = 2;
+            rel->terms[0] = i;
+            rel->terms[1] = 64 + ((i / 8 + 1) % 8) * 8 + i % 8;
+        }
+    } else {
+        s->nblocks = 1;
+        if (targs->lfsr_type == LFSR_ULCG) {
+            for (int w = 0; w < 3; w++) {
+                add_lfsr_relations(s, lfsr_next_ulcg, w, w + 1);
             }
-            // Apply XOR block to the second decrypted block (for CBC mode)
-            out ^= *(uint64_t *)targs->prev_ciphertext;
-
-            // Check if out is 8-bit (1-byte) left rotated version of init_out
-            // Need to convert to big-endian for byte rotation, then back to little-endian
-            uint64_t init_be = bswap64(init_out);
-            uint64_t rotated_be = (init_be << 8) | (init_be >> 56);
-            uint64_t rotated = bswap64(rotated_be);
-            match = (out == rotated);
         } else {
-            // In counterfeit mode, check the resulting plaintext against LFSR
-            match = valid_lfsr(out, targs->lfsr_type);
+            for (int w = 3; w > 0; w--) {
+                add_lfsr_relations(s, lfsr_next_uscuidul, w, w - 1);
+            }
         }
+    }
+}
 
-        if (match) {
-            key_found = 1;  // signal to other threads
-
-            // Build the full 16-byte key: start with the base key and substitute the candidate 4 bytes.
-            unsigned char full_key[KEY_SIZE];
-            memcpy(full_key, targs->base_key, KEY_SIZE);
-            int seg_offset = key_mode * 4;  // key_mode: 0->bytes0, 1->bytes4, 2->bytes8, 3->bytes12.
-            full_key[seg_offset]     = b0;
-            full_key[seg_offset + 1] = b1;
-            full_key[seg_offset + 2] = b2;
-            full_key[seg_offset + 3] = b3;
-            printf("Thread %d: Found key index: %u\n", targs->thread_id, idx);
-            printf("Full key (hex): ");
-            print_hex(full_key, KEY_SIZE);
-            if (!BENCHMARK_FULL_KEYSPACE)
-                break;
+// Check every bitsliced kernel this CPU runs against OpenSSL: random keys and blocks,
+// the only match of a search for the exact plaintexts must be the candidate they came from.
+static bool des_bs_selftest(void) {
+    static const uint32_t widths[] = { 64, 256 };
+    bool ok = true;
+
+    srand(0x2DEA);
+    for (size_t n = 0; n < sizeof(widths) / sizeof(widths[0]); n++) {
+        if (!des_bs_select(widths[n])) {
+            continue;
+        }
+        for (int seg = 0; seg < 4; seg++) {
+            des_bs_search_t s;
+            unsigned char key[KEY_SIZE];
+            DES_key_schedule ks1, ks2;
+            uint64_t out[2];
+
+            for (int i = 0; i < KEY_SIZE; i++) s.base_key[i] = rand() & 0xFF;
+            for (int i = 0; i < 2 * BLOCK_SIZE; i++) s.blocks[i / 8][i % 8] = rand() & 0xFF;
+            s.segment = seg;
+            s.nblocks = 2;
+            uint32_t idx = ((uint32_t)rand() << 12 ^ (uint32_t)rand()) & ((1UL << 28) - 1);
+            des_bs_candidate_key(&s, idx, key);
+            DES_set_key_unchecked((DES_cblock *)key, &ks1);
+            DES_set_key_unchecked((DES_cblock *)(key + 8), &ks2);
+            DES_ecb3_encrypt((DES_cblock *)s.blocks[0], (DES_cblock *)&out[0], &ks1, &ks2, &ks1, DES_DECRYPT);
+            DES_ecb3_encrypt((DES_cblock *)s.blocks[1], (DES_cblock *)&out[1], &ks1, &ks2, &ks1, DES_DECRYPT);
+
+            s.nrelations = 0;
+            for (int i = 0; i < 128; i++) {
+                des_bs_relation_t *rel = &s.relations[s.nrelations++];
+                rel->value = (((unsigned char *)out)[i / 8] >> (7 - i % 8)) & 1;
+                rel->nterms = 1;
+                rel->terms[0] = i;
+            }
+
+            uint32_t start = (idx > 700) ? idx - 700 : 0;
+            uint32_t found = 0;
+            if (!des_bs_search(&s, start, idx + 300, &found, NULL) || found != idx) {
+                fprintf(stderr, "Self-test of the %s DES kernel failed for key segment %d.\n", des_bs_name(), seg + 1);
+                ok = false;
+            }
+        }
+    }
+    des_bs_select(0);
+    return ok;
+}
+
+static double now_seconds(void) {
+#if WIN32
+    return GetTickCount64() / 1000.0;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+static void on_signal(int sig) {
+    (void)sig;
+    interrupted = 1;
+    stop_search = 1;
+}
+
+// Checkpoint file: the job line of the search and the bitmap of completed chunks.
+// Chunks are numbered over the whole key space, whatever the shard.
+static bool load_checkpoint(brute_job_t *job) {
+    char line[512];
+    bool job_ok = false;
+
+    FILE *f = fopen(job->checkpoint, "r");
+    if (f == NULL) {
+        return true;    // new search
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strncmp(line, "job ", 4) == 0) {
+            job_ok = strcmp(line + 4, job->job_id) == 0;
+        } else if (strncmp(line, "done ", 5) == 0) {
+            if (!hex_to_bytes(line + 5, job->done, sizeof(job->done))) {
+                fprintf(stderr, "Error: corrupted checkpoint file %s.\n", job->checkpoint);
+                fclose(f);
+                return false;
+            }
+        }
+    }
+    fclose(f);
+    if (!job_ok) {
+        fprintf(stderr, "Error: checkpoint file %s belongs to another search.\n", job->checkpoint);
+        return false;
+    }
+    return true;
+}
+
+// Written to a temporary file first, a kill while saving leaves the previous checkpoint intact.
+static void save_checkpoint(const brute_job_t *job) {
+    char tmp_name[1024];
+
+    if (job->checkpoint == NULL) {
+        return;
+    }
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", job->checkpoint);
+    FILE *f = fopen(tmp_name, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Cannot write checkpoint file %s.\n", tmp_name);
+        return;
+    }
+    fprintf(f, "# mfulc_des_brute checkpoint, %u chunks of 2^%d keys\n", (uint32_t)NUM_CHUNKS, CHUNK_BITS);
+    fprintf(f, "job %s\n", job->job_id);
+    fprintf(f, "done ");
+    for (size_t i = 0; i < sizeof(job->done); i++) {
+        fprintf(f, "%02X", job->done[i]);
+    }
+    fprintf(f, "\n");
+    if (fclose(f) != 0) {
+        fprintf(stderr, "Cannot write checkpoint file %s.\n", tmp_name);
+        return;
+    }
+#if WIN32
+    remove(job->checkpoint);
+#endif
+    if (rename(tmp_name, job->checkpoint) != 0) {
+        fprintf(stderr, "Cannot write checkpoint file %s.\n", job->checkpoint);
+    }
+}
+
+// Called with the lock held.
+static void report_progress(brute_job_t *job, double now) {
+    double elapsed = now - job->start_time;
+    double rate = (elapsed > 0) ? job->searched * (double)(1UL << CHUNK_BITS) / elapsed : 0;
+    uint32_t left = job->num_chunks - job->searched;
+    uint32_t done = job->shard_chunks - left;
+    uint32_t eta = (rate > 0) ? (uint32_t)(left * (double)(1UL << CHUNK_BITS) / rate) : 0;
+
+    fprintf(stderr, "Progress: %5.1f%%, %.2f Mkeys/s, ETA %uh%02um%02us\n",
+            100.0 * done / job->shard_chunks, rate / 1e6, eta / 3600, eta / 60 % 60, eta % 60);
+    job->last_report = now;
+    save_checkpoint(job);
+}
+
+// Thread pool job: search one chunk with the bitsliced kernel and confirm its matches with OpenSSL.
+static void search_chunk(void *ctx, uint32_t item, uint32_t thread_id) {
+    brute_job_t *job = (brute_job_t *)ctx;
+    const search_args_t *targs = job->args;
+    uint32_t chunk = job->chunks[item];
+    uint32_t idx = chunk << CHUNK_BITS;
+    uint32_t end = idx + (1UL << CHUNK_BITS);
+    bool complete = true;
+
+    if (stop_search && !BENCHMARK_FULL_KEYSPACE) {
+        return;
+    }
+    while (idx < end) {
+        if (!des_bs_search(&targs->search, idx, end, &idx, BENCHMARK_FULL_KEYSPACE ? NULL : &stop_search)) {
+            // stopped, or nothing left in the chunk
+            complete = !stop_search || BENCHMARK_FULL_KEYSPACE;
+            break;
+        }
+        if (!check_candidate(targs, idx)) {
+            fprintf(stderr, "Thread %u: bitsliced match %u rejected by OpenSSL\n", thread_id, idx);
+            idx++;
+            continue;
+        }
+        key_found = 1;  // signal to other threads
+        stop_search = 1;
+
+        // Build the full 16-byte key: start with the base key and substitute the candidate 4 bytes.
+        unsigned char full_key[KEY_SIZE];
+        des_bs_candidate_key(&targs->search, idx, full_key);
+        printf("Thread %u: Found key index: %u\n", thread_id, idx);
+        printf("Full key (hex): ");
+        print_hex(full_key, KEY_SIZE);
+        if (!BENCHMARK_FULL_KEYSPACE) {
+            complete = false;
+            break;
         }
+        idx++;
     }
-    return NULL;
+
+    pthread_mutex_lock(&job->lock);
+    if (complete) {
+        job->done[chunk / 8] |= 1 << (chunk % 8);
+        job->searched++;
+    }
+    double now = now_seconds();
+    if (now - job->last_report >= REPORT_INTERVAL) {
+        report_progress(job, now);
+    }
+    pthread_mutex_unlock(&job->lock);
 }
 
 static void print_help_and_exit(const char *cmd_name) {
@@ -235,7 +430,10 @@ static void print_help_and_exit(const char *cmd_name) {
             "   * Counterfeit key recovery:\n"
             "       %s -c <null key ERndB (8 hex digits)> <target key ERndB (8 hex digits)> <3DES base key hex (32 hex digits)> <key segment (1-4)> <num threads>\n"
             "   * Reader nonce key recovery:\n"
-            "       %s -r <ERndB (8 hex digits)> <ERndARndB' (16 hex digits)> <3DES base key hex (32 hex digits)> <key segment (1-4)> <num threads>\n",
+            "       %s -r <ERndB (8 hex digits)> <ERndARndB' (16 hex digits)> <3DES base key hex (32 hex digits)> <key segment (1-4)> <num threads>\n"
+            "   * Options, after the arguments above:\n"
+            "       --checkpoint <file>  record the searched chunks in <file> and resume from it\n"
+            "       --shard <i>/<N>      only search the i-th of N interleaved parts of the key space (1 <= i <= N)\n",
             cmd_name,
             cmd_name);
     exit(1);
@@ -249,14 +447,14 @@ int main(int argc, char **argv) {
     bool is_reader_mode = false;
     if (strcmp(argv[1], "-c") == 0) {
         is_reader_mode = false;
-        if (argc != 7) {
-            fprintf(stderr, "Error: -c mode requires exactly 6 arguments\n");
+        if (argc < 7) {
+            fprintf(stderr, "Error: -c mode requires 6 arguments\n");
             print_help_and_exit(argv[0]);
         }
     } else if (strcmp(argv[1], "-r") == 0) {
         is_reader_mode = true;
-        if (argc != 7) {
-            fprintf(stderr, "Error: -r mode requires exactly 6 arguments\n");
+        if (argc < 7) {
+            fprintf(stderr, "Error: -r mode requires 6 arguments\n");
             print_help_and_exit(argv[0]);
         }
     } else {
@@ -306,6 +504,22 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    const char *checkpoint = NULL;
+    uint32_t shard = 1, num_shards = 1;
+    for (int i = 7; i < argc; i++) {
+        if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpoint = argv[++i];
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u/%u", &shard, &num_shards) != 2 || num_shards < 1 || num_shards > NUM_CHUNKS || shard < 1 || shard > num_shards) {
+                fprintf(stderr, "Error: shard must be <i>/<N> with 1 <= i <= N <= %u.\n", (uint32_t)NUM_CHUNKS);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Error: unknown option %s\n", argv[i]);
+            print_help_and_exit(argv[0]);
+        }
+    }
+
     lfsr_t lfsr_type = LFSR_UNDEF;
     if (!is_reader_mode) {
         // Only detect LFSR type in counterfeit mode
@@ -324,51 +538,76 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (!des_bs_selftest()) {
+        return 1;
+    }
+    printf("DES kernel: %s, %u keys per pass\n", des_bs_name(), des_bs_lanes());
+
     // key_mode is zero-indexed (0,1,2,3)
     int key_mode = seg - 1;
 
-    // Total candidate space: 2^28 keys.
-    uint32_t total = (1UL << 28);
-    uint32_t chunk = total / num_threads;
-    uint32_t remainder = total % num_threads;
-
-    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
-    thread_args_t *targs = malloc(num_threads * sizeof(thread_args_t));
-    if (!threads || !targs) {
+    search_args_t *targs = malloc(sizeof(search_args_t));
+    brute_job_t *job = calloc(1, sizeof(brute_job_t));
+    uint32_t *chunks = malloc(NUM_CHUNKS * sizeof(uint32_t));
+    if (!targs || !job || !chunks) {
         fprintf(stderr, "Allocation error.\n");
         return 1;
     }
+    targs->key_mode = key_mode;
+    targs->lfsr_type = lfsr_type;
+    targs->is_reader_mode = is_reader_mode;
+    memcpy(targs->init_ciphertext, init_ciphertext, BLOCK_SIZE);
+    if (is_reader_mode) {
+        memcpy(targs->prev_ciphertext, tmp_blocks, BLOCK_SIZE);
+        memcpy(targs->ciphertext, tmp_blocks + BLOCK_SIZE, BLOCK_SIZE);
+    } else {
+        memcpy(targs->ciphertext, ciphertext, BLOCK_SIZE);
+    }
+    memcpy(targs->base_key, base_key, KEY_SIZE);
+    setup_search(&targs->search, targs);
+
+    job->args = targs;
+    job->checkpoint = checkpoint;
+    snprintf(job->job_id, sizeof(job->job_id), "%s %s %s %s %d", argv[1], argv[2], argv[3], argv[4], seg);
+    for (char *c = job->job_id; *c; c++) {
+        if (*c >= 'a' && *c <= 'f') *c -= 'a' - 'A';
+    }
+    if (checkpoint != NULL && !load_checkpoint(job)) {
+        return 1;
+    }
 
-    // Divide the candidate space as equally as possible among threads.
-    uint32_t current = 0;
-    for (int i = 0; i < num_threads; i++) {
-        targs[i].start = current;
-        targs[i].end   = current + chunk;
-        if (i == num_threads - 1)
-            targs[i].end += remainder;
-        targs[i].key_mode = key_mode;
-        targs[i].lfsr_type = lfsr_type;
-        targs[i].is_reader_mode = is_reader_mode;
-        memcpy(targs[i].init_ciphertext, init_ciphertext, BLOCK_SIZE);
-        if (is_reader_mode) {
-            memcpy(targs[i].prev_ciphertext, tmp_blocks, BLOCK_SIZE);
-            memcpy(targs[i].ciphertext, tmp_blocks + BLOCK_SIZE, BLOCK_SIZE);
-        } else {
-            memcpy(targs[i].ciphertext, ciphertext, BLOCK_SIZE);
+    // The 2^28 candidates are cut in chunks handed out one at a time to the threads,
+    // the chunks of a shard are interleaved over the whole key space.
+    for (uint32_t chunk = shard - 1; chunk < NUM_CHUNKS; chunk += num_shards) {
+        job->shard_chunks++;
+        if (!((job->done[chunk / 8] >> (chunk % 8)) & 1)) {
+            chunks[job->num_chunks++] = chunk;
         }
-        memcpy(targs[i].base_key, base_key, KEY_SIZE);
-        targs[i].thread_id = i;
-        current = targs[i].end;
-        pthread_create(&threads[i], NULL, worker, &targs[i]);
+    }
+    job->chunks = chunks;
+    if (job->num_chunks < job->shard_chunks) {
+        printf("Resuming from %s: %u of %u chunks left\n", checkpoint, job->num_chunks, job->shard_chunks);
     }
 
-    for (int i = 0; i < num_threads; i++)
-        pthread_join(threads[i], NULL);
-
-    if (!key_found)
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    pthread_mutex_init(&job->lock, NULL);
+    job->start_time = job->last_report = now_seconds();
+    thread_pool_run(job->num_chunks, num_threads, search_chunk, job);
+    pthread_mutex_destroy(&job->lock);
+    save_checkpoint(job);
+
+    int ret = 0;
+    if (interrupted && !key_found) {
+        fprintf(stderr, "Interrupted, %u of %u chunks left%s\n", job->num_chunks - job->searched, job->shard_chunks,
+                checkpoint ? ", run again with the same checkpoint file to resume" : "");
+        ret = 1;
+    } else if (!key_found) {
         printf("No matching key was found.\n");
+    }
 
-    free(threads);
+    free(chunks);
+    free(job);
     free(targs);
-    return 0;
+    return ret;
 }
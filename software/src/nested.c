@@ -7,48 +7,43 @@
 
 int main(int argc, char *const argv[]) {
     NtpKs1 *pNK = NULL;
-    uint32_t i, j, m;
-    uint32_t nt1, nt2, nttest, ks1, dist;
-    uint8_t par_int;
-    uint8_t par_arr[3] = { 0x00 };
+    uint32_t i, j;
+    uint32_t dist;
 
-    uint32_t authuid = atoui(argv[1]);   // uid
-    dist = atoui(argv[2]);  // dist
-
-    // process all args.
-    for (i = 3, j = 0; i < argc; i += 3) {
-        // nt + par
-        nt1 = atoui(argv[i]);
-        nt2 = atoui(argv[i + 1]);
-        par_int = atoui(argv[i + 2]);
-        if (par_int != 0) {
-            for (m = 0; m < 3; m++) {
-                par_arr[m] = (par_int >> m) & 0x01;
+    // optional worker thread count (-j, defaults to the number of online CPUs) and key hint (-k, see key_hint.h)
+    uint32_t threads = 0;
+    key_hint_t hint = KEY_HINT_INIT;
+    int argi = 1;
+    for (; argi + 1 < argc; argi += 2) {
+        if (strcmp(argv[argi], "-j") == 0) {
+            threads = atoui(argv[argi + 1]);
+        } else if (strcmp(argv[argi], "-k") == 0) {
+            if (!key_hint_parse(&hint, argv[argi + 1])) {
+                printf("Invalid key hint %s\r\n", argv[argi + 1]);
+                goto error;
             }
         } else {
-            memset(par_arr, 0, 3);
+            break;
         }
-        // Try to recover the keystream1
-        nttest = prng_successor(nt1, dist - 14);
-        for (m = dist - 14; m <= dist + 14; m += 1) {
-            ks1 = nt2 ^ nttest;
-            if (valid_nonce(nttest, nt2, ks1, par_arr)) {
-                ++j;
-                // append to list
-                void *tmp = realloc(pNK, sizeof(NtpKs1) * j);
-                if (tmp == NULL) {
-                    goto error;
-                }
-                pNK = tmp;
-                pNK[j - 1].ntp = nttest;
-                pNK[j - 1].ks1 = ks1;
-            }
-            nttest = prng_successor(nttest, 1);
+    }
+
+    uint32_t authuid = atoui(argv[argi]);   // uid
+    dist = atoui(argv[argi + 1]);  // dist
+
+    // process all args: nt + nt_enc + par
+    for (i = argi + 2, j = 0; i + 2 < argc; i += 3) {
+        if (!nested_add_nonce(&pNK, &j, atoui(argv[i]), atoui(argv[i + 1]), atoui(argv[i + 2]), dist)) {
+            goto error;
         }
     }
 
     uint32_t keyCount = 0;
-    uint64_t *keys = nested(pNK, j, authuid, &keyCount);
+    NestedStats stats;
+    uint64_t *keys = nested(pNK, j, authuid, threads, &keyCount, NULL, &hint, &stats);
+
+    if (hint.count > 0) {
+        printf("Key hint pruned %" PRIu64 " of %" PRIu64 " candidates\r\n", stats.pruned, stats.recovered);
+    }
 
     if (keyCount > 0) {
         for (i = 0; i < keyCount; i++) {
@@ -58,6 +53,7 @@ int main(int argc, char *const argv[]) {
     }
     fflush(stdout);
     free(keys);
+    key_hint_free(&hint);
     exit(EXIT_SUCCESS);
 error:
     exit(EXIT_FAILURE);
@@ -12,8 +12,10 @@
 #include "unistd.h"
 #endif
 
-#include "pthread.h"
 #include "nested_util.h"
+#include "crypto1_bs.h"
+#include "thread_pool.h"
+#include "radixsort.h"
 
 
 #define MEM_CHUNK               10000
@@ -21,182 +23,154 @@
 
 
 typedef struct {
-    uint64_t       key;
-    int            count;
-} countKeys;
-
-typedef struct {
-    NtpKs1 *pNK;
-    uint32_t authuid;
-
+    struct Crypto1Workspace *ws;    // lfsr_recovery32 tables, reused for every entry of this thread
     uint64_t *keys;
     uint32_t keyCount;
-
-    uint32_t startPos;
-    uint32_t endPos;
+    uint32_t keySize;
+    uint64_t recovered;
+    uint64_t pruned;
+    bool is_ok;
 } RecPar;
 
+typedef struct {
+    NtpKs1 *pNK;
+    uint32_t authuid;
+    const key_hint_t *hint;
+    RecPar *pRPs;
+} RecJob;
 
-inline static int compar_int(const void *a, const void *b) {
-    if (*(uint64_t *)b == *(uint64_t *)a) return 0;
-    if (*(uint64_t *)b < * (uint64_t *)a) return 1;
-    return -1;
-}
-
-// Compare countKeys structure
-int compar_special_int(const void *a, const void *b) {
-    return (((countKeys *)b)->count - ((countKeys *)a)->count);
-}
-
-// keys qsort and unique.
-countKeys *uniqsort(uint64_t *possibleKeys, uint32_t size) {
-    unsigned int i, j = 0;
-    int count = 0;
-    countKeys *our_counts;
 
-    qsort(possibleKeys, size, sizeof(uint64_t), compar_int);
+// keys radix sort and unique. Only the max_keys most frequent keys are kept, in top,
+// ordered by count and then by key; the full list of counts is never built.
+uint32_t uniqsort(uint64_t *possibleKeys, uint32_t size, uint32_t threads, countKeys *top, uint32_t max_keys) {
+    uint32_t n = 0;
 
-    our_counts = calloc(size, sizeof(countKeys));
-    if (our_counts == NULL) {
-        printf("Memory allocation error for our_counts");
-        exit(EXIT_FAILURE);
+    if (size == 0 || max_keys == 0) {
+        return 0;
     }
 
-    for (i = 0; i < size; i++) {
-        if (possibleKeys[i + 1] == possibleKeys[i]) {
+    radixsort48(possibleKeys, size, threads);
+
+    for (uint32_t i = 0; i < size;) {
+        uint64_t key = possibleKeys[i];
+        uint32_t count = 1;
+        while (++i < size && possibleKeys[i] == key) {
             count++;
-        } else {
-            our_counts[j].key = possibleKeys[i];
-            our_counts[j].count = count;
-            j++;
-            count = 0;
         }
+
+        // keys come in ascending order, so on equal counts the one already kept stays ahead
+        if (n == max_keys && count <= top[n - 1].count) {
+            continue;
+        }
+        uint32_t j = (n < max_keys) ? n++ : n - 1;
+        while (j > 0 && top[j - 1].count < count) {
+            top[j] = top[j - 1];
+            j--;
+        }
+        top[j].key = key;
+        top[j].count = count;
     }
-    qsort(our_counts, j, sizeof(countKeys), compar_special_int);
-    return (our_counts);
+    return n;
 }
 
-// nested decrypt
-static void *nested_revover(void *args) {
-    struct Crypto1State *revstate, *revstate_start = NULL;
-    uint64_t lfsr = 0;
-    uint32_t i, kcount = 0;
-    bool is_ok = true;
-
-    RecPar *rp = (RecPar *)args;
+// nested decrypt, recover the key candidates of one NtpKs1 entry into the buffer of this thread
+static void nested_revover(void *args, uint32_t item, uint32_t thread_id) {
+    struct Crypto1State *revstate;
 
-    rp->keyCount = 0;
-    rp->keys = NULL;
+    RecJob *job = (RecJob *)args;
+    RecPar *rp = &job->pRPs[thread_id];
 
-    //printf("Start pos is %d, End pos is %d\r\n", rp->startPos, rp->endPos);
-
-    for (i = rp->startPos; i < rp->endPos; i++) {
-        uint32_t nt_probe = rp->pNK[i].ntp ^ rp->authuid;
-        uint32_t ks1 = rp->pNK[i].ks1;
+    if (!rp->is_ok) {
+        return;
+    }
 
-        /*
-        printf("     ntp = %"PRIu32"\r\n", nt_probe);
-        printf("     ks1 = %"PRIu32"\r\n", ks1);
-        printf("\r\n");
-        */
+    uint32_t nt_probe = job->pNK[item].ntp ^ job->authuid;
+    uint32_t ks1 = job->pNK[item].ks1;
 
-        // And finally recover the first 32 bits of the key
-        revstate = lfsr_recovery32(ks1, nt_probe);
-        if (revstate_start == NULL) {
-            revstate_start = revstate;
+    // The ~50MB of recovery tables are allocated on the first entry of a thread only
+    if (rp->ws == NULL) {
+        rp->ws = crypto1_workspace_create();
+        if (rp->ws == NULL) {
+            printf("Memory allocation error for lfsr_recovery32");
+            rp->is_ok = false;
+            return;
         }
+    }
 
-        while ((revstate->odd != 0x0) || (revstate->even != 0x0)) {
-            lfsr_rollback_word(revstate, nt_probe, 0);
-            crypto1_get_lfsr(revstate, &lfsr);
-            if (((kcount % MEM_CHUNK) == 0) || (kcount >= rp->keyCount)) {
-                rp->keyCount += MEM_CHUNK;
-                // printf("New chunk by %d, sizeof %lu\n", kcount, rp->keyCount * sizeof(uint64_t));
-                void *tmp = realloc(rp->keys, rp->keyCount * sizeof(uint64_t));
+    // And finally recover the first 32 bits of the key, rolling back a block of states at a time
+    revstate = lfsr_recovery32_ws(rp->ws, ks1, nt_probe);
+
+    crypto1_bs_t block;
+    uint64_t lfsr[CRYPTO1_BS_MAX_STATES];
+    uint32_t count;
+    while (rp->is_ok && (count = crypto1_bs_load_list(&block, revstate)) != 0) {
+        crypto1_bs_rollback_word(&block, nt_probe, 0, NULL);
+        crypto1_bs_get_lfsr(&block, lfsr);
+        rp->recovered += count;
+        for (uint32_t i = 0; i < count; i++) {
+            if (!key_hint_match(job->hint, lfsr[i])) {
+                rp->pruned++;
+                continue;
+            }
+            if (rp->keyCount >= rp->keySize) {
+                // grow geometrically, a single entry can yield a few hundred thousand candidates
+                uint32_t newSize = (rp->keySize == 0) ? MEM_CHUNK : rp->keySize * 2;
+                void *tmp = realloc(rp->keys, newSize * sizeof(uint64_t));
                 if (tmp == NULL) {
                     printf("Memory allocation error for pk->possibleKeys");
-                    rp->keyCount = 0;
-                    is_ok = false;
+                    rp->is_ok = false;
                     break;
                 }
                 rp->keys = (uint64_t *)tmp;
+                rp->keySize = newSize;
             }
-            rp->keys[kcount] = lfsr;
-            kcount++;
-            revstate++;
-        }
-        --kcount;
-        free(revstate_start);
-        revstate_start = NULL;
-        if (!is_ok) {
-            break;
+            rp->keys[rp->keyCount++] = lfsr[i];
         }
+        revstate += count;
     }
-    if (is_ok) {
-        if (kcount != 0) {
-            rp->keyCount = kcount;
-            void *tmp = (uint64_t *)realloc(rp->keys, rp->keyCount * sizeof(uint64_t));
-            if (tmp == NULL) {
-                printf("Memory allocation error for pk->possibleKeys");
-                rp->keyCount = 0;
-                free(rp->keys);
-            } else {
-                rp->keys = tmp;
-            }
-        }
-    } else {
-        rp->keyCount = 0;
-        free(rp->keys);
-    }
-    return NULL;
 }
 
-uint64_t *nested(NtpKs1 *pNK, uint32_t sizePNK, uint32_t authuid, uint32_t *keyCount) {
-#define THREAD_MAX 4
-
+uint64_t *nested(NtpKs1 *pNK, uint32_t sizePNK, uint32_t authuid, uint32_t threads, uint32_t *keyCount, volatile int *cancel,
+                 const key_hint_t *hint, NestedStats *stats) {
     *keyCount = 0;
+    if (stats != NULL) {
+        stats->recovered = 0;
+        stats->pruned = 0;
+    }
     uint32_t i, j, manyThread;
     uint64_t *keys = (uint64_t *)NULL;
 
-    manyThread = THREAD_MAX;
+    manyThread = (threads == 0) ? thread_pool_cpus() : threads;
     if (manyThread > sizePNK) {
         manyThread = sizePNK;
     }
+    if (manyThread == 0) {
+        return NULL;
+    }
 
-    // pthread handle
-    pthread_t *threads = calloc(sizePNK, sizeof(pthread_t));
-    if (threads == NULL)  return NULL;
-
-    // Param
-    RecPar *pRPs = calloc(sizePNK, sizeof(RecPar));
+    // Per thread candidate buffers
+    RecPar *pRPs = calloc(manyThread, sizeof(RecPar));
     if (pRPs == NULL) {
-        free(threads);
         return NULL;
     }
-
-    uint32_t average = sizePNK / manyThread;
-    uint32_t modules = sizePNK % manyThread;
-
-    // Assign tasks
-    for (i = 0, j = 0; i < manyThread; i++, j += average) {
-        pRPs[i].pNK = pNK;
-        pRPs[i].authuid = authuid;
-        pRPs[i].startPos = j;
-        pRPs[i].endPos = j + average;
-        pRPs[i].keys = NULL;
-        // last thread can decrypt more pNK
-        if (i == (manyThread - 1) && modules > 0) {
-            (pRPs[i].endPos) += modules;
-        }
-        pthread_create(&threads[i], NULL, nested_revover, &(pRPs[i]));
+    for (i = 0; i < manyThread; i++) {
+        pRPs[i].is_ok = true;
     }
 
+    // Every NtpKs1 entry is a task of its own, so the expensive entries don't pile up on one thread
+    RecJob job = { .pNK = pNK, .authuid = authuid, .hint = hint, .pRPs = pRPs };
+    thread_pool_run_cancel(sizePNK, manyThread, nested_revover, &job, cancel);
+
     for (i = 0; i < manyThread; i++) {
-        // wait thread exit...
-        pthread_join(threads[i], NULL);
+        if (!pRPs[i].is_ok || (cancel != NULL && *cancel)) {
+            pRPs[i].keyCount = 0;
+        }
         *keyCount += pRPs[i].keyCount;
+        if (stats != NULL) {
+            stats->recovered += pRPs[i].recovered;
+            stats->pruned += pRPs[i].pruned;
+        }
     }
-    free(threads);
 
     if (*keyCount != 0) {
         keys = malloc((*keyCount) * sizeof(uint64_t));
@@ -204,51 +178,95 @@ uint64_t *nested(NtpKs1 *pNK, uint32_t sizePNK, uint32_t authuid, uint32_t *keyC
             for (i = 0, j = 0; i < manyThread; i++) {
                 if (pRPs[i].keyCount > 0) {
                     // printf("The thread %d recover %d keys.\r\n", i, pRPs[i].keyCount);
-                    if (pRPs[i].keys != NULL) {
-                        memcpy(
-                            keys + j,
-                            pRPs[i].keys,
-                            pRPs[i].keyCount * sizeof(uint64_t)
-                        );
-                        j += pRPs[i].keyCount;
-                        free(pRPs[i].keys);
-                    }
+                    memcpy(
+                        keys + j,
+                        pRPs[i].keys,
+                        pRPs[i].keyCount * sizeof(uint64_t)
+                    );
+                    j += pRPs[i].keyCount;
                 }
             }
 
-            countKeys *ck = uniqsort(keys, *keyCount);
-            free(keys);
-            keys = (uint64_t *)NULL;
+            countKeys ck[TRY_KEYS];
+            uint32_t found = uniqsort(keys, *keyCount, threads, ck, TRY_KEYS);
             *keyCount = 0;
 
-            if (ck != NULL) {
-                for (i = 0; i < TRY_KEYS; i++) {
-                    // We don't known this key, try to break it
-                    // This key can be found here two or more times
-                    if (ck[i].count > 0) {
-                        *keyCount += 1;
-                        void *tmp = realloc(keys, sizeof(uint64_t) * (*keyCount));
-                        if (tmp != NULL) {
-                            keys = tmp;
-                            keys[*keyCount - 1] = ck[i].key;
-                        } else {
-                            printf("Cannot allocate memory for keys on merge.");
-                            free(keys);
-                            break;
-                        }
-                    }
-                }
-            } else {
-                printf("Cannot allocate memory for ck on uniqsort.");
+            // We don't known this key, try to break it
+            // This key can be found here two or more times
+            for (i = 0; i < found && ck[i].count > 1; i++) {
+                keys[(*keyCount)++] = ck[i].key;
+            }
+            if (*keyCount == 0) {
+                free(keys);
+                keys = (uint64_t *)NULL;
             }
         } else {
             printf("Cannot allocate memory to merge keys.\r\n");
         }
     }
+    for (i = 0; i < manyThread; i++) {
+        crypto1_workspace_destroy(pRPs[i].ws);
+        free(pRPs[i].keys);
+    }
     free(pRPs);
     return keys;
 }
 
+static bool append_ntpks1(NtpKs1 **pNK, uint32_t *sizePNK, uint32_t ntp, uint32_t ks1) {
+    void *tmp = realloc(*pNK, sizeof(NtpKs1) * (*sizePNK + 1));
+    if (tmp == NULL) {
+        return false;
+    }
+    *pNK = tmp;
+    (*pNK)[*sizePNK].ntp = ntp;
+    (*pNK)[*sizePNK].ks1 = ks1;
+    (*sizePNK)++;
+    return true;
+}
+
+bool nested_add_nonce(NtpKs1 **pNK, uint32_t *sizePNK, uint32_t nt1, uint32_t nt2, uint8_t par, uint32_t dist) {
+    uint8_t par_arr[3];
+    for (uint32_t m = 0; m < 3; m++) {
+        par_arr[m] = (par >> m) & 0x01;
+    }
+    // Try to recover the keystream1
+    uint32_t nttest = prng_successor(nt1, dist - 14);
+    for (uint32_t m = dist - 14; m <= dist + 14; m += 1) {
+        uint32_t ks1 = nt2 ^ nttest;
+        if (valid_nonce(nttest, nt2, ks1, par_arr) && !append_ntpks1(pNK, sizePNK, nttest, ks1)) {
+            return false;
+        }
+        nttest = prng_successor(nttest, 1);
+    }
+    return true;
+}
+
+bool staticnested_dist(uint32_t nt1, uint8_t type, uint32_t *dist) {
+    if (nt1 == 0x01200145) {
+        // There is no loophole in this generation.
+        // This tag can be decrypted with the default parameter value 160!
+        *dist = 160; // st gen1
+        return true;
+    }
+    if (nt1 == 0x009080A2) {   // st gen2
+        // We found that the gen2 tag is vulnerable too but parameter must be adapted depending on the attacked key
+        if (type == 0x61) {
+            *dist = 161;
+            return true;
+        }
+        if (type == 0x60) {
+            *dist = 160;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool staticnested_add_nonce(NtpKs1 **pNK, uint32_t *sizePNK, uint32_t nt1, uint32_t nt2, uint32_t dist) {
+    uint32_t nttest = prng_successor(nt1, dist);
+    return append_ntpks1(pNK, sizePNK, nttest, nt2 ^ nttest);
+}
+
 // Return 1 if the nonce is invalid else return 0
 uint8_t valid_nonce(uint32_t Nt, uint32_t NtEnc, uint32_t Ks1, uint8_t *parity) {
     return (
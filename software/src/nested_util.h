@@ -2,13 +2,37 @@
 #define NESTED_H__
 
 #include "crapto1.h"
+#include "key_hint.h"
 
 typedef struct {
     uint32_t ntp;
     uint32_t ks1;
 } NtpKs1;
 
+typedef struct {
+    uint64_t key;
+    uint32_t count;
+} countKeys;
+
+typedef struct {
+    uint64_t recovered;     // key candidates of all entries
+    uint64_t pruned;        // of those, dropped for not matching the key hint
+} NestedStats;
+
 uint8_t valid_nonce(uint32_t Nt, uint32_t NtEnc, uint32_t Ks1, uint8_t *parity);
-uint64_t *nested(NtpKs1 *pNK, uint32_t sizePNK, uint32_t authuid, uint32_t *keyCount);
+// Append the entries of one nested nonce: every nt at dist +/- 14 steps from nt1 whose parity
+// bits (par, 3 bits) match nt2. Returns false when out of memory.
+bool nested_add_nonce(NtpKs1 **pNK, uint32_t *sizePNK, uint32_t nt1, uint32_t nt2, uint8_t par, uint32_t dist);
+// Distance of the first static nested nonce, from its nt1 (the tag generation) and the key type
+// (0x60/0x61). The nonces after it are 160 steps further each. Returns false for an unknown tag.
+bool staticnested_dist(uint32_t nt1, uint8_t type, uint32_t *dist);
+bool staticnested_add_nonce(NtpKs1 **pNK, uint32_t *sizePNK, uint32_t nt1, uint32_t nt2, uint32_t dist);
+// threads == 0 uses one worker thread per online CPU
+uint32_t uniqsort(uint64_t *possibleKeys, uint32_t size, uint32_t threads, countKeys *top, uint32_t max_keys);
+// cancel may be NULL, once *cancel is non zero no entry is started anymore and NULL is returned.
+// The candidates not matching hint (NULL: none) are dropped as they are rolled back, before they
+// are counted; stats (may be NULL) tells how many.
+uint64_t *nested(NtpKs1 *pNK, uint32_t sizePNK, uint32_t authuid, uint32_t threads, uint32_t *keyCount, volatile int *cancel,
+                 const key_hint_t *hint, NestedStats *stats);
 
 #endif
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "radixsort.h"
+#include "thread_pool.h"
+
+#define RADIX_BITS      16
+#define RADIX_SIZE      (1 << RADIX_BITS)
+#define RADIX_PASSES    3
+// below this a thread isn't worth its 256KB histogram
+#define RADIX_MIN_CHUNK (1 << 16)
+// below this clearing the histograms costs more than a plain qsort
+#define RADIX_MIN_SIZE  (1 << 12)
+
+typedef struct {
+    const uint64_t *src;
+    uint64_t *dst;
+    uint32_t size;
+    uint32_t chunks;
+    uint32_t shift;
+    uint32_t *hist;     // chunks * RADIX_SIZE, counts then write offsets
+} RadixPass;
+
+static int compar_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void chunk_range(const RadixPass *p, uint32_t chunk, uint32_t *start, uint32_t *end) {
+    *start = (uint32_t)(((uint64_t)p->size * chunk) / p->chunks);
+    *end = (uint32_t)(((uint64_t)p->size * (chunk + 1)) / p->chunks);
+}
+
+static void radix_count(void *ctx, uint32_t chunk, uint32_t thread_id) {
+    (void)thread_id;
+    RadixPass *p = (RadixPass *)ctx;
+    uint32_t *hist = p->hist + (size_t)chunk * RADIX_SIZE;
+    uint32_t start, end;
+
+    chunk_range(p, chunk, &start, &end);
+    memset(hist, 0, RADIX_SIZE * sizeof(uint32_t));
+    for (uint32_t i = start; i < end; i++) {
+        hist[(p->src[i] >> p->shift) & (RADIX_SIZE - 1)]++;
+    }
+}
+
+static void radix_scatter(void *ctx, uint32_t chunk, uint32_t thread_id) {
+    (void)thread_id;
+    RadixPass *p = (RadixPass *)ctx;
+    uint32_t *offset = p->hist + (size_t)chunk * RADIX_SIZE;
+    uint32_t start, end;
+
+    chunk_range(p, chunk, &start, &end);
+    for (uint32_t i = start; i < end; i++) {
+        uint64_t key = p->src[i];
+        p->dst[offset[(key >> p->shift) & (RADIX_SIZE - 1)]++] = key;
+    }
+}
+
+void radixsort48(uint64_t *keys, uint32_t size, uint32_t threads) {
+    if (size < RADIX_MIN_SIZE) {
+        qsort(keys, size, sizeof(uint64_t), compar_u64);
+        return;
+    }
+
+    uint32_t chunks = (threads == 0) ? thread_pool_cpus() : threads;
+    if (chunks > size / RADIX_MIN_CHUNK) {
+        chunks = size / RADIX_MIN_CHUNK;
+    }
+    if (chunks == 0) {
+        chunks = 1;
+    }
+
+    uint64_t *tmp = malloc((size_t)size * sizeof(uint64_t));
+    uint32_t *hist = malloc((size_t)chunks * RADIX_SIZE * sizeof(uint32_t));
+    if (tmp == NULL || hist == NULL) {
+        free(tmp);
+        free(hist);
+        qsort(keys, size, sizeof(uint64_t), compar_u64);
+        return;
+    }
+
+    RadixPass p = { .src = keys, .dst = tmp, .size = size, .chunks = chunks, .hist = hist };
+
+    for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+        p.shift = pass * RADIX_BITS;
+        thread_pool_run(chunks, chunks, radix_count, &p);
+
+        // turn the per chunk counts into write offsets: digit major, chunk minor keeps the sort stable
+        uint32_t sum = 0;
+        for (uint32_t d = 0; d < RADIX_SIZE; d++) {
+            uint32_t digit_total = 0;
+            for (uint32_t c = 0; c < chunks; c++) {
+                uint32_t n = hist[(size_t)c * RADIX_SIZE + d];
+                hist[(size_t)c * RADIX_SIZE + d] = sum + digit_total;
+                digit_total += n;
+            }
+            if (digit_total == size) {
+                // every key has this digit, the pass wouldn't move anything
+                break;
+            }
+            sum += digit_total;
+        }
+        if (sum == 0) {
+            continue;
+        }
+
+        thread_pool_run(chunks, chunks, radix_scatter, &p);
+        uint64_t *swap = (uint64_t *)p.src;
+        p.src = p.dst;
+        p.dst = swap;
+    }
+
+    if (p.src != keys) {
+        memcpy(keys, p.src, (size_t)size * sizeof(uint64_t));
+    }
+    free(tmp);
+    free(hist);
+}
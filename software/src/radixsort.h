@@ -0,0 +1,12 @@
+#ifndef RADIXSORT_H__
+#define RADIXSORT_H__
+
+#include <stdint.h>
+
+// Sort 48-bit keys (the upper 16 bits must be zero) in ascending order with a
+// LSD radix sort of three 16-bit digits. Histogram and scatter of every pass
+// are split over threads (0 = one per online CPU); digits that are the same for
+// all keys are skipped. Falls back to qsort when the scratch buffer can't be allocated.
+void radixsort48(uint64_t *keys, uint32_t size, uint32_t threads);
+
+#endif
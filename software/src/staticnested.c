@@ -7,58 +7,51 @@
 
 int main(int argc, char *const argv[]) {
     NtpKs1 *pNK = NULL;
-    uint32_t i, j, m;
-    uint32_t nt1, nt2, nttest, ks1, dist;
+    uint32_t i, j;
+    uint32_t nt1, nt2, dist = 0;
 
-    uint32_t authuid = atoui(argv[1]);   // uid
-    uint8_t type = (uint8_t)atoui(argv[2]); // target key type
+    // optional worker thread count (-j, defaults to the number of online CPUs) and key hint (-k, see key_hint.h)
+    uint32_t threads = 0;
+    key_hint_t hint = KEY_HINT_INIT;
+    int argi = 1;
+    for (; argi + 1 < argc; argi += 2) {
+        if (strcmp(argv[argi], "-j") == 0) {
+            threads = atoui(argv[argi + 1]);
+        } else if (strcmp(argv[argi], "-k") == 0) {
+            if (!key_hint_parse(&hint, argv[argi + 1])) {
+                printf("Invalid key hint %s\r\n", argv[argi + 1]);
+                goto error;
+            }
+        } else {
+            break;
+        }
+    }
+
+    uint32_t authuid = atoui(argv[argi]);   // uid
+    uint8_t type = (uint8_t)atoui(argv[argi + 1]); // target key type
 
     // process all args.
-    bool check_st_level_at_first_run = false;
-    for (i = 3, j = 0; i < argc; i += 2) {
+    for (i = argi + 2, j = 0; i + 1 < argc; i += 2) {
         // nt + par
         nt1 = atoui(argv[i]);
         nt2 = atoui(argv[i + 1]);
 
         // Which generation of static tag is detected.
-        if (!check_st_level_at_first_run) {
-            if (nt1 == 0x01200145) {
-                // There is no loophole in this generation.
-                // This tag can be decrypted with the default parameter value 160!
-                dist = 160; // st gen1
-            } else if (nt1 == 0x009080A2) {   // st gen2
-                // We found that the gen2 tag is vulnerable too but parameter must be adapted depending on the attacked key
-                if (type == 0x61) {
-                    dist = 161;
-                } else if (type == 0x60) {
-                    dist = 160;
-                } else {
-                    // can't be here!!!
-                    goto error;
-                }
-            } else {
-                // can't be here!!!
-                goto error;
-            }
-            check_st_level_at_first_run = true;
+        if (j == 0 && !staticnested_dist(nt1, type, &dist)) {
+            // can't be here!!!
+            goto error;
         }
-
-        nttest = prng_successor(nt1, dist);
-        ks1 = nt2 ^ nttest;
-        ++j;
-        dist += 160;
-
-        void *tmp = realloc(pNK, sizeof(NtpKs1) * j);
-        if (tmp == NULL) {
+        if (!staticnested_add_nonce(&pNK, &j, nt1, nt2, dist + 160 * j)) {
             goto error;
         }
-
-        pNK = tmp;
-        pNK[j - 1].ntp = nttest;
-        pNK[j - 1].ks1 = ks1;
     }
     uint32_t keyCount = 0;
-    uint64_t *keys = nested(pNK, j, authuid, &keyCount);
+    NestedStats stats;
+    uint64_t *keys = nested(pNK, j, authuid, threads, &keyCount, NULL, &hint, &stats);
+
+    if (hint.count > 0) {
+        printf("Key hint pruned %" PRIu64 " of %" PRIu64 " candidates\r\n", stats.pruned, stats.recovered);
+    }
 
     if (keyCount > 0) {
         for (i = 0; i < keyCount; i++) {
@@ -68,6 +61,7 @@ int main(int argc, char *const argv[]) {
     }
     fflush(stdout);
     free(keys);
+    key_hint_free(&hint);
     exit(EXIT_SUCCESS);
 error:
     exit(EXIT_FAILURE);
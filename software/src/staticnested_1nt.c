@@ -16,15 +16,18 @@
 #include <inttypes.h>
 #include "common.h"
 #include "crapto1.h"
-#include "parity.h"
-
-#define KEY_SPACE_SIZE (1 << 18)
+#include "keydic.h"
+#include "staticnested_util.h"
+#include "thread_pool.h"
 
 typedef struct {
     uint32_t authuid;
     uint32_t nt;
     uint32_t nt_enc;
     uint8_t nt_par_enc;
+    uint8_t sector;
+    uint32_t keyCount;  // batch mode result
+    bool ok;
 } NtData;
 
 static uint32_t hex_to_uint32(const char *hex_str) {
@@ -50,132 +53,217 @@ static int bin_to_uint8_arr(const char *bin_str, uint8_t bit_arr[], uint8_t arr_
     return 0;
 }
 
-static uint64_t *generate_keys(uint64_t authuid, uint32_t nt, uint32_t nt_enc, uint32_t nt_par_enc, uint32_t *keyCount) {
-
-    uint64_t *result_keys = (uint64_t *)calloc(1, KEY_SPACE_SIZE * sizeof(uint64_t));
-    if (result_keys == NULL) {
-        fprintf(stderr, "\nCalloc error in generate_and_intersect_keys!\n");
-        return NULL;
-    }
-
-    struct Crypto1State *revstate, *revstate_start = NULL, *s = NULL;
-    uint64_t lfsr = 0;
-    uint32_t ks1 = nt ^ nt_enc;
-
-    revstate = lfsr_recovery32(ks1, nt ^ authuid);
-    if (revstate == NULL) {
-        fprintf(stderr, "\nCalloc error in generate_keys!\n");
-        free(result_keys);
-        return NULL;
-    }
-
-    revstate_start = revstate;
-
-    s = crypto1_create(0);
-    if (s == NULL) {
-        fprintf(stderr, "\nCalloc error in generate_keys!\n");
-        free(result_keys);
-        crypto1_destroy(revstate_start);
-        return 0;
-    }
-
-    while ((revstate->odd != 0x0) || (revstate->even != 0x0)) {
-        lfsr_rollback_word(revstate, nt ^ authuid, 0);
-        crypto1_get_lfsr(revstate, &lfsr);
-
-        // only filtering possibility: last parity bit ks in ks2
-        uint32_t ks2;
-        uint8_t lastpar1, lastpar2, kslastp;
-        crypto1_init(s, lfsr);
-        crypto1_word(s, nt ^ authuid, 0);
-        ks2 = crypto1_word(s, 0, 0);
-        lastpar1 = oddparity8(nt & 0xFF);
-        kslastp = (ks2 >> 24) & 1;
-        lastpar2 = (nt_par_enc & 1) ^ kslastp;
-        if (lastpar1 == lastpar2) {
-            result_keys[(*keyCount)++] = lfsr;
-            if (*keyCount == KEY_SPACE_SIZE) {
-                fprintf(stderr, "No space left on result_keys, abort! Increase KEY_SPACE_SIZE\n");
-                break;
+static int parse_nt_data(char *const args[5], NtData *d, uint8_t nt_par_err_arr[4]) {
+    d->authuid = hex_to_uint32(args[0]);
+    d->sector = atoi(args[1]);
+    d->nt = hex_to_uint32(args[2]);
+    d->nt_enc = hex_to_uint32(args[3]);
+
+    if (bin_to_uint8_arr(args[4], nt_par_err_arr, 4)) {
+        return 1;
+    }
+
+    d->nt_par_enc = staticnested_par_enc(d->nt_enc, (nt_par_err_arr[0] << 3) | (nt_par_err_arr[1] << 2) |
+                                         (nt_par_err_arr[2] << 1) | nt_par_err_arr[3]);
+    return 0;
+}
+
+typedef struct {
+    NtData *data;
+    struct Crypto1Workspace **ws;   // one per thread, created on its first tuple
+    bool binary;
+} BatchJob;
+
+static void batch_generate(void *ctx, uint32_t item, uint32_t thread_id) {
+    BatchJob *job = (BatchJob *)ctx;
+    NtData *d = &job->data[item];
+
+    if (job->ws[thread_id] == NULL) {
+        job->ws[thread_id] = crypto1_workspace_create();
+        if (job->ws[thread_id] == NULL) {
+            fprintf(stderr, "\nCalloc error in staticnested_1nt_keys!\n");
+            return;
+        }
+    }
+
+    d->keyCount = 0;
+    uint64_t *keys = staticnested_1nt_keys(d->authuid, d->nt, d->nt_enc, d->nt_par_enc, job->ws[thread_id], 1, &d->keyCount, NULL);
+    if (keys == NULL) {
+        return;
+    }
+
+    char filename[40];
+    keydic_filename(filename, sizeof(filename), d->authuid, d->sector, d->nt, "", job->binary);
+    d->ok = (keydic_save(filename, d->authuid, d->sector, d->nt, keys, d->keyCount, job->binary) == 0);
+    free(keys);
+}
+
+// one "<uid:hex> <sector:dec> <nt:hex> <nt_enc:hex> <nt_par_err:bin>" line per tuple, # starts a comment
+static int run_batch(const char *listname, uint32_t threads, bool binary) {
+    FILE *f = (strcmp(listname, "-") == 0) ? stdin : fopen(listname, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Error: Cannot open %s\n", listname);
+        return 1;
+    }
+
+    NtData *data = NULL;
+    uint32_t count = 0, size = 0;
+    char line[256];
+    uint32_t lineno = 0;
+    int ret = 1;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        char *args[5];
+        uint32_t n = 0;
+        for (char *tok = strtok(line, " \t\r\n"); tok != NULL && tok[0] != '#' && n < 5; tok = strtok(NULL, " \t\r\n")) {
+            args[n++] = tok;
+        }
+        if (n == 0) {
+            continue;
+        }
+        if (n != 5) {
+            fprintf(stderr, "Error: Line %u of %s doesn't hold 5 fields.\n", lineno, listname);
+            goto out;
+        }
+        if (count == size) {
+            size = size ? size * 2 : 64;
+            NtData *tmp = realloc(data, size * sizeof(NtData));
+            if (tmp == NULL) {
+                perror("Failed to allocate memory");
+                goto out;
             }
+            data = tmp;
         }
-        revstate++;
+        uint8_t nt_par_err_arr[4];
+        memset(&data[count], 0, sizeof(NtData));
+        if (parse_nt_data(args, &data[count], nt_par_err_arr)) {
+            fprintf(stderr, "Error: Line %u of %s.\n", lineno, listname);
+            goto out;
+        }
+        count++;
+    }
+
+    if (threads == 0) {
+        threads = thread_pool_cpus();
+    }
+    if (threads > count) {
+        threads = count;
     }
 
-    crypto1_destroy(s);
-    crypto1_destroy(revstate_start);
-    revstate_start = NULL;
-    return result_keys;
+    printf("Finding key candidates of %u nonces...\n", count);
+
+    // the recovery tables stay allocated per thread across all the tuples it gets
+    BatchJob job = {
+        .data = data,
+        .ws = calloc(threads ? threads : 1, sizeof(struct Crypto1Workspace *)),
+        .binary = binary,
+    };
+    if (job.ws == NULL) {
+        perror("Failed to allocate memory");
+        goto out;
+    }
+    thread_pool_run(count, threads, batch_generate, &job);
+    for (uint32_t i = 0; i < threads; i++) {
+        crypto1_workspace_destroy(job.ws[i]);
+    }
+    free(job.ws);
+
+    ret = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        char filename[40];
+        keydic_filename(filename, sizeof(filename), data[i].authuid, data[i].sector, data[i].nt, "", binary);
+        if (data[i].ok) {
+            printf("%s: %u keys saved\n", filename, data[i].keyCount);
+        } else {
+            fprintf(stderr, "Error: %s failed\n", filename);
+            ret = 1;
+        }
+    }
+
+out:
+    if (f != stdin) {
+        fclose(f);
+    }
+    free(data);
+    return ret;
 }
 
 int main(int argc, char *const argv[]) {
 
+    // options: recovery thread count (0 = one per online CPU), binary dictionary
+    const char *prog = argv[0];
+    uint32_t threads = 1, batch_threads = 0;
+    bool binary = false;
+    while (argc > 1 && argv[1][0] == '-' && strcmp(argv[1], "-f") != 0) {
+        if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+            threads = batch_threads = atoi(argv[2]);
+            argv += 2;
+            argc -= 2;
+        } else if (strcmp(argv[1], "-b") == 0) {
+            binary = true;
+            argv++;
+            argc--;
+        } else {
+            break;
+        }
+    }
+
+    if (argc == 3 && strcmp(argv[1], "-f") == 0) {
+        return run_batch(argv[2], batch_threads, binary);
+    }
+
     if (argc != 6) {
-        int cmdlen = strlen(argv[0]);
-        printf("Usage:\n  %s <uid:hex> <sector:dec> <nt:hex> <nt_enc:hex> <nt_par_err:bin>\n"
+        int cmdlen = strlen(prog);
+        printf("Usage:\n  %s [-j <threads>] [-b] <uid:hex> <sector:dec> <nt:hex> <nt_enc:hex> <nt_par_err:bin>\n"
+               "  %s [-j <threads>] [-b] -f <file|->\n"
                "  parity example:  if for block 63 == sector 15, nt in trace is 7b! fc! 7a! 5b\n"
                "                   then nt_enc is 7bfc7a5b and nt_par_err is 1110\n"
+               "  -j <threads>:    recover on several threads, 0 = one per CPU\n"
+               "                   with -f: nonces handled at once, defaults to one per CPU\n"
+               "  -b:              write a binary keys_<uid>_<sector>_<nt>.bdic dictionary\n"
+               "  -f <file|->:     batch mode, one line per nonce with the 5 arguments above,\n"
+               "                   read from file or stdin, writes every dictionary\n"
                "Example:\n"
                "  %*s a13e4902 15 d14191b3 2e9e49fc 1111\n"
                "  %*s +uid     +s +nt      +nt_enc  +nt_par_err\n",
-               argv[0], cmdlen, argv[0], cmdlen, "");
+               prog, prog, cmdlen, prog, cmdlen, "");
         return 1;
     }
 
     uint64_t *keys = NULL;
     uint32_t keyCount = 0;
 
-    uint32_t authuid = hex_to_uint32(argv[1]);
-    uint32_t sector = atoi(argv[2]);
-    uint32_t nt = hex_to_uint32(argv[3]);
-    uint32_t nt_enc = hex_to_uint32(argv[4]);
-
+    NtData d;
     uint8_t nt_par_err_arr[4];
-    if (bin_to_uint8_arr(argv[5], nt_par_err_arr, 4)) {
+    if (parse_nt_data(&argv[1], &d, nt_par_err_arr)) {
         return 1;
     }
 
-    uint8_t nt_par_enc = ((nt_par_err_arr[0] ^ oddparity8((nt_enc >> 24) & 0xFF)) << 3) |
-                         ((nt_par_err_arr[1] ^ oddparity8((nt_enc >> 16) & 0xFF)) << 2) |
-                         ((nt_par_err_arr[2] ^ oddparity8((nt_enc >>  8) & 0xFF)) << 1) |
-                         ((nt_par_err_arr[3] ^ oddparity8((nt_enc >>  0) & 0xFF)) << 0);
-
     printf("uid=%08x nt=%08x nt_enc=%08x nt_par_err=%u%u%u%u nt_par_enc=%u%u%u%u ks1=%08x\n"
-           , authuid
-           , nt
-           , nt_enc
+           , d.authuid
+           , d.nt
+           , d.nt_enc
            , nt_par_err_arr[0]
            , nt_par_err_arr[1]
            , nt_par_err_arr[2]
            , nt_par_err_arr[3]
-           , (uint8_t)((nt_par_enc >> 3) & 1)
-           , (uint8_t)((nt_par_enc >> 2) & 1)
-           , (uint8_t)((nt_par_enc >> 1) & 1)
-           , (uint8_t)(nt_par_enc & 1)
-           , nt ^ nt_enc
+           , (uint8_t)((d.nt_par_enc >> 3) & 1)
+           , (uint8_t)((d.nt_par_enc >> 2) & 1)
+           , (uint8_t)((d.nt_par_enc >> 1) & 1)
+           , (uint8_t)(d.nt_par_enc & 1)
+           , d.nt ^ d.nt_enc
           );
 
 
     printf("Finding key candidates...\n");
-    keys = generate_keys(authuid, nt, nt_enc, nt_par_enc, &keyCount);
+    keys = staticnested_1nt_keys(d.authuid, d.nt, d.nt_enc, d.nt_par_enc, NULL, threads, &keyCount, NULL);
 
     printf("Finding phase complete, found %u keys\n", keyCount);
 
-    FILE *fptr;
-    char filename[30];
-    snprintf(filename, sizeof(filename), "keys_%08x_%02u_%08x.dic", authuid, sector, nt);
-
-    fptr = fopen(filename, "w");
-    if (fptr != NULL) {
-        if (keyCount > 0) {
-            for (uint32_t j = 0; j < keyCount; j++) {
-                fprintf(fptr, "%012" PRIx64 "\n", keys[j]);
-            }
-        }
-        fclose(fptr);
-    } else {
-        fprintf(stderr, "Warning: Cannot save keys in %s\n", filename);
-    }
+    char filename[40];
+    keydic_filename(filename, sizeof(filename), d.authuid, d.sector, d.nt, "", binary);
+    keydic_save(filename, d.authuid, d.sector, d.nt, keys, keyCount, binary);
 
     if (keys != NULL) {
         free(keys);
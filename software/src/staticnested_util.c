@@ -0,0 +1,130 @@
+// Shared cores of the staticnested_1nt and staticnested_2x1nt_rf08s* tools
+//
+//  Doegox, 2024, cf https://eprint.iacr.org/2024/1275 for more info
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "parity.h"
+#include "staticnested_util.h"
+#include "crypto1_bs.h"
+
+static uint16_t i_lfsr16[1 << 16] = {0};
+static uint16_t s_lfsr16[1 << 16] = {0};
+static bool lfsr16_ready = false;
+
+uint8_t staticnested_par_enc(uint32_t nt_enc, uint8_t nt_par_err) {
+    return ((((nt_par_err >> 3) & 1) ^ oddparity8((nt_enc >> 24) & 0xFF)) << 3) |
+           ((((nt_par_err >> 2) & 1) ^ oddparity8((nt_enc >> 16) & 0xFF)) << 2) |
+           ((((nt_par_err >> 1) & 1) ^ oddparity8((nt_enc >>  8) & 0xFF)) << 1) |
+           ((((nt_par_err >> 0) & 1) ^ oddparity8((nt_enc >>  0) & 0xFF)) << 0);
+}
+
+uint64_t *staticnested_1nt_keys(uint32_t authuid, uint32_t nt, uint32_t nt_enc, uint8_t nt_par_enc,
+                                struct Crypto1Workspace *ws, uint32_t threads, uint32_t *keyCount, volatile int *cancel) {
+
+    uint64_t *result_keys = (uint64_t *)calloc(1, STATICNESTED_KEY_SPACE_SIZE * sizeof(uint64_t));
+    if (result_keys == NULL) {
+        fprintf(stderr, "\nCalloc error in staticnested_1nt_keys!\n");
+        return NULL;
+    }
+
+    struct Crypto1State *revstate, *revstate_start = NULL;
+    uint32_t ks1 = nt ^ nt_enc;
+
+    if (ws != NULL) {
+        revstate = lfsr_recovery32_ws(ws, ks1, nt ^ authuid);
+    } else {
+        revstate = lfsr_recovery32_mt(ks1, nt ^ authuid, threads, cancel);
+    }
+    if (revstate == NULL) {
+        if (cancel == NULL || !*cancel) {
+            fprintf(stderr, "\nCalloc error in staticnested_1nt_keys!\n");
+        }
+        free(result_keys);
+        return NULL;
+    }
+
+    revstate_start = revstate;
+
+    // only filtering possibility: last parity bit ks in ks2.
+    // The recovered states are the ones right after nt ^ uid was fed, so the first bit of ks2
+    // (the one at position 24) is just the filter output of that state: no need to reload and
+    // clock the cipher again, bench_crypto1_bs checks this against a cipher run from each key.
+    // The states are rolled back a block at a time, the dropped ones included, which costs less
+    // than picking the kept ones out first.
+    uint8_t lastpar1 = oddparity8(nt & 0xFF);
+    uint8_t kslastp_keep = lastpar1 ^ (nt_par_enc & 1);
+
+    crypto1_bs_t block;
+    uint64_t lfsr[CRYPTO1_BS_MAX_STATES];
+    uint32_t count;
+    bool full = false;
+    while (!full && (cancel == NULL || !*cancel) && (count = crypto1_bs_load_list(&block, revstate)) != 0) {
+        crypto1_bs_rollback_word(&block, nt ^ authuid, 0, NULL);
+        crypto1_bs_get_lfsr(&block, lfsr);
+
+        for (uint32_t i = 0; i < count && !full; i++) {
+            uint8_t kslastp = filter(revstate[i].odd);
+            if (kslastp == kslastp_keep) {
+                result_keys[(*keyCount)++] = lfsr[i];
+                if (*keyCount == STATICNESTED_KEY_SPACE_SIZE) {
+                    fprintf(stderr, "No space left on result_keys, abort! Increase STATICNESTED_KEY_SPACE_SIZE\n");
+                    full = true;
+                }
+            }
+        }
+        revstate += count;
+    }
+
+    if (ws == NULL) {
+        crypto1_destroy(revstate_start);
+    }
+    revstate_start = NULL;
+    return result_keys;
+}
+
+void rf08s_init(void) {
+    if (lfsr16_ready) {
+        return;
+    }
+    uint16_t x = 1;
+    for (uint16_t i = 1; i; ++i) {
+        i_lfsr16[(x & 0xff) << 8 | x >> 8] = i;
+        s_lfsr16[i] = (x & 0xff) << 8 | x >> 8;
+        x = x >> 1 | (x ^ x >> 2 ^ x >> 3 ^ x >> 5) << 15;
+    }
+    lfsr16_ready = true;
+}
+
+// step the nonce n times back, the table indexes run from 1 to 0xffff.
+// 0 isn't in the sequence, stepping back from it lands where stepping back from index 1 does
+static uint16_t prev_lfsr16_n(uint16_t nonce, uint16_t n) {
+    uint32_t i = (i_lfsr16[nonce] == 0) ? 0 : i_lfsr16[nonce] - 1;
+    return s_lfsr16[(i + 0xffff - n % 0xffff) % 0xffff + 1];
+}
+
+uint16_t rf08s_seed(uint32_t nt32, uint64_t key) {
+    uint8_t a[] = {0, 8, 9, 4, 6, 11, 1, 15, 12, 5, 2, 13, 10, 14, 3, 7};
+    uint8_t b[] = {0, 13, 1, 14, 4, 10, 15, 7, 5, 3, 8, 6, 9, 2, 12, 11};
+    uint16_t nt = nt32 >> 16;
+    uint8_t prev = 14;
+    nt = prev_lfsr16_n(nt, prev);
+    uint8_t prevoff = 8;
+    bool odd = 1;
+
+    for (uint8_t i = 0; i < 6 * 8; i += 8) {
+        if (odd) {
+            nt ^= (a[(key >> i) & 0xF]);
+            nt ^= (b[(key >> i >> 4) & 0xF]) << 4;
+        } else {
+            nt ^= (b[(key >> i) & 0xF]);
+            nt ^= (a[(key >> i >> 4) & 0xF]) << 4;
+        }
+        odd ^= 1;
+        prev += prevoff;
+        nt = prev_lfsr16_n(nt, prevoff);
+    }
+    return nt;
+}
@@ -0,0 +1,25 @@
+#ifndef STATICNESTED_UTIL_H__
+#define STATICNESTED_UTIL_H__
+
+#include <stdint.h>
+#include "crapto1.h"
+
+// Most key candidates one static encrypted nonce can yield
+#define STATICNESTED_KEY_SPACE_SIZE (1 << 18)
+
+// Encrypted parity bits of nt_enc (4 bits, first byte MSB) from the parity error bits of the trace
+uint8_t staticnested_par_enc(uint32_t nt_enc, uint8_t nt_par_err);
+
+// Key candidates of one static encrypted nonce, NULL on error. ws != NULL recovers inside that
+// workspace, else on threads (0 = one per online CPU). The caller frees the keys.
+// Once *cancel is non zero (cancel may be NULL) the keys found so far are returned, or NULL.
+uint64_t *staticnested_1nt_keys(uint32_t authuid, uint32_t nt, uint32_t nt_enc, uint8_t nt_par_enc,
+                                struct Crypto1Workspace *ws, uint32_t threads, uint32_t *keyCount, volatile int *cancel);
+
+// FM11RF08S: 16-bit seed of the nonce key produces on nt. The keyA and keyB of a sector
+// give the same seed on their own nonce, which is how staticnested_2x1nt_rf08s pairs them.
+// rf08s_init() fills the LFSR tables once, before any rf08s_seed() call.
+void rf08s_init(void);
+uint16_t rf08s_seed(uint32_t nt, uint64_t key);
+
+#endif
@@ -0,0 +1,118 @@
+#include <stdlib.h>
+
+#if WIN32
+#include "windows.h"
+#else
+#include "unistd.h"
+#endif
+
+#include "pthread.h"
+#include "thread_pool.h"
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t next_item;
+    uint32_t num_items;
+    volatile int *cancel;
+    thread_pool_job_t job;
+    void *ctx;
+} PoolQueue;
+
+typedef struct {
+    PoolQueue *queue;
+    uint32_t thread_id;
+} PoolWorker;
+
+uint32_t thread_pool_cpus(void) {
+#if WIN32
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    return sysinfo.dwNumberOfProcessors ? sysinfo.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (uint32_t)count : 1;
+#endif
+}
+
+static void *thread_pool_worker(void *args) {
+    PoolWorker *w = (PoolWorker *)args;
+    PoolQueue *q = w->queue;
+
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        if (q->cancel != NULL && *q->cancel) {
+            q->next_item = q->num_items;
+        }
+        uint32_t item = q->next_item;
+        if (item < q->num_items) {
+            q->next_item++;
+        }
+        pthread_mutex_unlock(&q->lock);
+
+        if (item >= q->num_items) {
+            break;
+        }
+        q->job(q->ctx, item, w->thread_id);
+    }
+    return NULL;
+}
+
+uint32_t thread_pool_run(uint32_t num_items, uint32_t num_threads, thread_pool_job_t job, void *ctx) {
+    return thread_pool_run_cancel(num_items, num_threads, job, ctx, NULL);
+}
+
+uint32_t thread_pool_run_cancel(uint32_t num_items, uint32_t num_threads, thread_pool_job_t job, void *ctx, volatile int *cancel) {
+    if (num_threads == 0) {
+        num_threads = thread_pool_cpus();
+    }
+    if (num_threads > num_items) {
+        num_threads = num_items;
+    }
+    if (num_threads == 0) {
+        return 0;
+    }
+
+    PoolQueue queue = {
+        .next_item = 0,
+        .num_items = num_items,
+        .cancel = cancel,
+        .job = job,
+        .ctx = ctx,
+    };
+
+    pthread_t *threads = calloc(num_threads, sizeof(pthread_t));
+    PoolWorker *workers = calloc(num_threads, sizeof(PoolWorker));
+    if (threads == NULL || workers == NULL) {
+        // no memory for the workers, do the job on the calling thread
+        free(threads);
+        free(workers);
+        for (uint32_t i = 0; i < num_items && (cancel == NULL || !*cancel); i++) {
+            job(ctx, i, 0);
+        }
+        return 1;
+    }
+
+    pthread_mutex_init(&queue.lock, NULL);
+
+    // the calling thread works as thread 0
+    uint32_t started = 1;
+    for (uint32_t i = 1; i < num_threads; i++, started++) {
+        workers[i].queue = &queue;
+        workers[i].thread_id = i;
+        if (pthread_create(&threads[i], NULL, thread_pool_worker, &workers[i]) != 0) {
+            break;
+        }
+    }
+    workers[0].queue = &queue;
+    workers[0].thread_id = 0;
+    thread_pool_worker(&workers[0]);
+
+    for (uint32_t i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&queue.lock);
+    free(threads);
+    free(workers);
+    return started;
+}
@@ -0,0 +1,23 @@
+#ifndef THREAD_POOL_H__
+#define THREAD_POOL_H__
+
+#include <stdint.h>
+
+// Called once for every item index in [0, num_items). thread_id is in [0, num_threads)
+// and can be used to index per-thread scratch data owned by the caller.
+typedef void (*thread_pool_job_t)(void *ctx, uint32_t item, uint32_t thread_id);
+
+// Number of online logical CPUs (at least 1).
+uint32_t thread_pool_cpus(void);
+
+// Run job over all items. Items are handed out one at a time from a shared counter,
+// so a thread finishing a cheap item immediately picks the next one instead of
+// waiting on a static range split. num_threads == 0 means one thread per online CPU.
+// The effective number of threads (never more than num_items) is returned.
+uint32_t thread_pool_run(uint32_t num_items, uint32_t num_threads, thread_pool_job_t job, void *ctx);
+
+// Same as thread_pool_run, except that no item is started anymore once *cancel is non zero.
+// Items already running finish, the caller tells a cancelled run apart by reading *cancel.
+uint32_t thread_pool_run_cancel(uint32_t num_items, uint32_t num_threads, thread_pool_job_t job, void *ctx, volatile int *cancel);
+
+#endif